@@ -0,0 +1,59 @@
+//***************************************************************************************
+// AllocationCounter.cpp
+//***************************************************************************************
+
+#include "AllocationCounter.h"
+#include <atomic>
+#include <crtdbg.h>
+
+#if defined(DEBUG) || defined(_DEBUG)
+#define ALLOCATION_HOOK 1
+#else
+#define ALLOCATION_HOOK 0
+#endif
+
+namespace
+{
+	std::atomic<std::uint64_t> gAllocations(0);
+	bool gInstalled = false;
+
+#if ALLOCATION_HOOK
+	_CRT_ALLOC_HOOK gPreviousHook = nullptr;
+
+	// Runs inside the allocator, so it must not allocate or call into the CRT.
+	int __cdecl AllocHook(int allocType, void* userData, size_t size, int blockType,
+		long requestNumber, const unsigned char* filename, int lineNumber)
+	{
+		// The CRT's own blocks (stdio buffers, locale data) are not the app's.
+		if(blockType != _CRT_BLOCK && (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC))
+			gAllocations.fetch_add(1, std::memory_order_relaxed);
+
+		if(gPreviousHook != nullptr)
+			return gPreviousHook(allocType, userData, size, blockType, requestNumber, filename, lineNumber);
+
+		// Nonzero lets the allocation go ahead.
+		return 1;
+	}
+#endif
+}
+
+void AllocationCounter::Install()
+{
+#if ALLOCATION_HOOK
+	if(!gInstalled)
+	{
+		gPreviousHook = _CrtSetAllocHook(AllocHook);
+		gInstalled = true;
+	}
+#endif
+}
+
+bool AllocationCounter::Enabled()
+{
+	return gInstalled;
+}
+
+std::uint64_t AllocationCounter::Count()
+{
+	return gAllocations.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,24 @@
+//***************************************************************************************
+// AllocationCounter.h
+//
+// Counts heap allocations through a CRT allocation hook, so a frame phase can check
+// that it did not allocate: read Count before and after.  The hook exists only in
+// the debug CRT; in other builds Enabled is false and Count stays 0.  Allocations on
+// every thread are counted, including the job threads a phase waits on.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+class AllocationCounter
+{
+public:
+	// Call once at startup, before the allocations of interest.
+	static void Install();
+
+	static bool Enabled();
+
+	// malloc, new and realloc calls since Install.
+	static std::uint64_t Count();
+};
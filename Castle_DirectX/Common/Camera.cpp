@@ -67,6 +67,26 @@ XMFLOAT3 Camera::GetLook3f()const
 	return mLook;
 }
 
+XMVECTOR Camera::GetOrientation()const
+{
+	XMMATRIX basis(
+		XMVectorSetW(XMLoadFloat3(&mRight), 0.0f),
+		XMVectorSetW(XMLoadFloat3(&mUp), 0.0f),
+		XMVectorSetW(XMLoadFloat3(&mLook), 0.0f),
+		XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	return XMQuaternionNormalize(XMQuaternionRotationMatrix(basis));
+}
+
+void Camera::SetOrientation(FXMVECTOR orientation)
+{
+	XMMATRIX basis = XMMatrixRotationQuaternion(XMQuaternionNormalize(orientation));
+	XMStoreFloat3(&mRight, basis.r[0]);
+	XMStoreFloat3(&mUp, basis.r[1]);
+	XMStoreFloat3(&mLook, basis.r[2]);
+
+	mViewDirty = true;
+}
+
 float Camera::GetNearZ()const
 {
 	return mNearZ;
@@ -124,8 +144,19 @@ void Camera::SetLens(float fovY, float aspect, float zn, float zf)
 	mNearWindowHeight = 2.0f * mNearZ * tanf( 0.5f*mFovY );
 	mFarWindowHeight  = 2.0f * mFarZ * tanf( 0.5f*mFovY );
 
-	XMMATRIX P = XMMatrixPerspectiveFovLH(mFovY, mAspect, mNearZ, mFarZ);
-	XMStoreFloat4x4(&mProj, P);
+	UpdateProjMatrix();
+}
+
+Camera::DepthMode Camera::GetDepthMode()const
+{
+	return mDepthMode;
+}
+
+void Camera::SetDepthMode(DepthMode mode)
+{
+	mDepthMode = mode;
+
+	UpdateProjMatrix();
 }
 
 void Camera::LookAt(FXMVECTOR pos, FXMVECTOR target, FXMVECTOR worldUp)
@@ -164,6 +195,28 @@ XMMATRIX Camera::GetProj()const
 	return XMLoadFloat4x4(&mProj);
 }
 
+XMMATRIX Camera::GetViewProj()const
+{
+	assert(!mViewDirty);
+	return XMLoadFloat4x4(&mViewProj);
+}
+
+XMMATRIX Camera::GetInvView()const
+{
+	assert(!mViewDirty);
+	return XMLoadFloat4x4(&mInvView);
+}
+
+XMMATRIX Camera::GetInvProj()const
+{
+	return XMLoadFloat4x4(&mInvProj);
+}
+
+XMMATRIX Camera::GetInvViewProj()const
+{
+	assert(!mViewDirty);
+	return XMLoadFloat4x4(&mInvViewProj);
+}
 
 XMFLOAT4X4 Camera::GetView4x4f()const
 {
@@ -176,6 +229,12 @@ XMFLOAT4X4 Camera::GetProj4x4f()const
 	return mProj;
 }
 
+const Frustum& Camera::GetFrustum()const
+{
+	assert(!mViewDirty);
+	return mFrustum;
+}
+
 void Camera::Strafe(float d)
 {
 	// mPosition += d*mRight
@@ -292,8 +351,65 @@ void Camera::UpdateViewMatrix()
 		mView(2, 3) = 0.0f;
 		mView(3, 3) = 1.0f;
 
+		// The view matrix is a rigid transform, so its inverse is the camera's world
+		// matrix: the basis vectors as rows, then the position.
+		mInvView = XMFLOAT4X4(
+			mRight.x,    mRight.y,    mRight.z,    0.0f,
+			mUp.x,       mUp.y,       mUp.z,       0.0f,
+			mLook.x,     mLook.y,     mLook.z,     0.0f,
+			mPosition.x, mPosition.y, mPosition.z, 1.0f);
+
 		mViewDirty = false;
+
+		UpdateViewProjMatrix();
+	}
+}
+
+void Camera::UpdateProjMatrix()
+{
+	const float yScale = 1.0f / tanf(0.5f*mFovY);
+	const float xScale = yScale / mAspect;
+
+	// Clip space z = a*z + b and w = z for view space depth z.  Standard matches
+	// XMMatrixPerspectiveFovLH; ReverseZInfinite is its limit as zf goes to infinity,
+	// with near and far swapped, so depth = zn/z.
+	float a = mFarZ / (mFarZ - mNearZ);
+	float b = -mNearZ*a;
+	if(mDepthMode == DepthMode::ReverseZInfinite)
+	{
+		a = 0.0f;
+		b = mNearZ;
 	}
+
+	mProj = XMFLOAT4X4(
+		xScale, 0.0f,   0.0f, 0.0f,
+		0.0f,   yScale, 0.0f, 0.0f,
+		0.0f,   0.0f,   a,    1.0f,
+		0.0f,   0.0f,   b,    0.0f);
+
+	// Solving the above back for x, y, z and w.
+	mInvProj = XMFLOAT4X4(
+		1.0f / xScale, 0.0f,          0.0f, 0.0f,
+		0.0f,          1.0f / yScale, 0.0f, 0.0f,
+		0.0f,          0.0f,          0.0f, 1.0f / b,
+		0.0f,          0.0f,          1.0f, -a / b);
+
+	if(!mViewDirty)
+		UpdateViewProjMatrix();
+}
+
+void Camera::UpdateViewProjMatrix()
+{
+	XMMATRIX view = XMLoadFloat4x4(&mView);
+	XMMATRIX proj = XMLoadFloat4x4(&mProj);
+	XMMATRIX invView = XMLoadFloat4x4(&mInvView);
+	XMMATRIX invProj = XMLoadFloat4x4(&mInvProj);
+
+	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+	XMStoreFloat4x4(&mViewProj, viewProj);
+	XMStoreFloat4x4(&mInvViewProj, XMMatrixMultiply(invProj, invView));
+
+	mFrustum = Frustum::FromViewProj(viewProj, GetPosition(), GetLook(), mNearZ, mFarZ);
 }
 
 
@@ -12,11 +12,23 @@
 #define CAMERA_H
 
 #include "d3dUtil.h"
+#include "Frustum.h"
 
 class Camera
 {
 public:
 
+	// How the projection maps view space depth.  Standard maps [zn, zf] to [0, 1].
+	// ReverseZInfinite maps zn to 1 and infinity to 0, so a float depth buffer keeps
+	// nearly uniform precision over distance; the depth buffer is then cleared to 0
+	// and tested with GREATER.  zf still bounds the far window and whatever else the
+	// app culls or bins against it.
+	enum class DepthMode
+	{
+		Standard,
+		ReverseZInfinite
+	};
+
 	Camera();
 	~Camera();
 
@@ -34,6 +46,10 @@ public:
 	DirectX::XMVECTOR GetLook()const;
 	DirectX::XMFLOAT3 GetLook3f()const;
 
+	// The basis as a unit quaternion rotating +x, +y, +z to right, up and look.
+	DirectX::XMVECTOR GetOrientation()const;
+	void SetOrientation(DirectX::FXMVECTOR orientation);
+
 	// Get frustum properties.
 	float GetNearZ()const;
 	float GetFarZ()const;
@@ -50,17 +66,30 @@ public:
 	// Set frustum.
 	void SetLens(float fovY, float aspect, float zn, float zf);
 
+	DepthMode GetDepthMode()const;
+	void SetDepthMode(DepthMode mode);
+
 	// Define camera space via LookAt parameters.
 	void LookAt(DirectX::FXMVECTOR pos, DirectX::FXMVECTOR target, DirectX::FXMVECTOR worldUp);
 	void LookAt(const DirectX::XMFLOAT3& pos, const DirectX::XMFLOAT3& target, const DirectX::XMFLOAT3& up);
 
-	// Get View/Proj matrices.
+	// Get View/Proj matrices.  The products and inverses are cached and rebuilt only
+	// by UpdateViewMatrix and SetLens/SetDepthMode, from the camera's basis and lens
+	// rather than by a general inverse.
 	DirectX::XMMATRIX GetView()const;
 	DirectX::XMMATRIX GetProj()const;
+	DirectX::XMMATRIX GetViewProj()const;
+	DirectX::XMMATRIX GetInvView()const;
+	DirectX::XMMATRIX GetInvProj()const;
+	DirectX::XMMATRIX GetInvViewProj()const;
 
 	DirectX::XMFLOAT4X4 GetView4x4f()const;
 	DirectX::XMFLOAT4X4 GetProj4x4f()const;
 
+	// World space frustum, rebuilt with the matrices above.  Its far plane is at zf
+	// in either depth mode.
+	const Frustum& GetFrustum()const;
+
 	// Strafe/Walk the camera a distance d.
 	void Strafe(float d);
 	void Walk(float d);
@@ -75,6 +104,8 @@ public:
 	void UpdateViewMatrix();
 
 private:
+	void UpdateProjMatrix();
+	void UpdateViewProjMatrix();
 
 	// Camera coordinate system with coordinates relative to world space.
 	DirectX::XMFLOAT3 mPosition = { 45.0f, 5.0f, -51.0f };
@@ -90,11 +121,19 @@ private:
 	float mNearWindowHeight = 0.0f;
 	float mFarWindowHeight = 0.0f;
 
+	DepthMode mDepthMode = DepthMode::Standard;
+
 	bool mViewDirty = true;
 
 	// Cache View/Proj matrices.
 	DirectX::XMFLOAT4X4 mView = MathHelper::Identity4x4();
 	DirectX::XMFLOAT4X4 mProj = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 mViewProj = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 mInvView = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 mInvProj = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 mInvViewProj = MathHelper::Identity4x4();
+
+	Frustum mFrustum;
 };
 
 #endif // CAMERA_H
\ No newline at end of file
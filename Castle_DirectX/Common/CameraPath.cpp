@@ -0,0 +1,222 @@
+//***************************************************************************************
+// CameraPath.cpp
+//***************************************************************************************
+
+#include "CameraPath.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	const char Magic[4] = { 'C', 'P', 'T', 'H' };
+	const std::uint32_t Version = 1;
+
+	// Keys past this in a file are taken as corruption rather than allocated.
+	const std::uint32_t MaxKeys = 1u << 24;
+
+	template<typename T>
+	void WriteValue(std::ostream& out, const T& value)
+	{
+		out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	bool ReadValue(std::istream& in, T& value)
+	{
+		return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+	}
+
+	std::int16_t PackSnorm(float value)
+	{
+		return (std::int16_t)lrintf(std::min(std::max(value, -1.0f), 1.0f)*32767.0f);
+	}
+}
+
+void CameraPath::Clear()
+{
+	mKeys.clear();
+}
+
+void CameraPath::Reserve(UINT keyCount)
+{
+	mKeys.reserve(keyCount);
+}
+
+void CameraPath::AddKey(float time, const Camera& camera)
+{
+	Key key;
+	key.Time = time;
+	key.Position = camera.GetPosition3f();
+
+	// q and -q are the same rotation; keep each key in the hemisphere of the one
+	// before so that interpolation never turns the long way round.
+	XMVECTOR orientation = camera.GetOrientation();
+	if(!mKeys.empty())
+	{
+		XMVECTOR previous = XMLoadFloat4(&mKeys.back().Orientation);
+		if(XMVectorGetX(XMQuaternionDot(previous, orientation)) < 0.0f)
+			orientation = XMVectorNegate(orientation);
+	}
+	XMStoreFloat4(&key.Orientation, orientation);
+
+	if(!mKeys.empty() && time <= mKeys.back().Time)
+	{
+		if(time == mKeys.back().Time)
+			mKeys.back() = key;
+		return;
+	}
+
+	mKeys.push_back(key);
+}
+
+UINT CameraPath::KeyCount()const
+{
+	return (UINT)mKeys.size();
+}
+
+const CameraPath::Key& CameraPath::GetKey(UINT i)const
+{
+	return mKeys[i];
+}
+
+float CameraPath::StartTime()const
+{
+	return mKeys.empty() ? 0.0f : mKeys.front().Time;
+}
+
+float CameraPath::EndTime()const
+{
+	return mKeys.empty() ? 0.0f : mKeys.back().Time;
+}
+
+float CameraPath::Duration()const
+{
+	return EndTime() - StartTime();
+}
+
+bool CameraPath::Sample(float time, XMFLOAT3& position, XMFLOAT4& orientation)const
+{
+	if(mKeys.empty())
+		return false;
+
+	const UINT last = (UINT)mKeys.size() - 1;
+	if(last == 0 || time <= mKeys.front().Time)
+	{
+		position = mKeys.front().Position;
+		orientation = mKeys.front().Orientation;
+		return true;
+	}
+	if(time >= mKeys.back().Time)
+	{
+		position = mKeys.back().Position;
+		orientation = mKeys.back().Orientation;
+		return true;
+	}
+
+	// The segment [i, i + 1] holding time, and its neighbours for the spline.
+	auto next = std::upper_bound(mKeys.begin(), mKeys.end(), time,
+		[](float t, const Key& key) { return t < key.Time; });
+	const UINT i = (UINT)(next - mKeys.begin()) - 1;
+
+	const Key& k0 = mKeys[i > 0 ? i - 1 : 0];
+	const Key& k1 = mKeys[i];
+	const Key& k2 = mKeys[i + 1];
+	const Key& k3 = mKeys[std::min(i + 2, last)];
+	const float s = (time - k1.Time) / (k2.Time - k1.Time);
+
+	XMStoreFloat3(&position, XMVectorCatmullRom(XMLoadFloat3(&k0.Position), XMLoadFloat3(&k1.Position),
+		XMLoadFloat3(&k2.Position), XMLoadFloat3(&k3.Position), s));
+	XMStoreFloat4(&orientation, XMQuaternionSlerp(XMLoadFloat4(&k1.Orientation), XMLoadFloat4(&k2.Orientation), s));
+
+	return true;
+}
+
+bool CameraPath::Apply(float time, Camera& camera)const
+{
+	XMFLOAT3 position;
+	XMFLOAT4 orientation;
+	if(!Sample(time, position, orientation))
+		return false;
+
+	camera.SetPosition(position);
+	camera.SetOrientation(XMLoadFloat4(&orientation));
+	return true;
+}
+
+bool CameraPath::Write(std::ostream& out)const
+{
+	out.write(Magic, sizeof(Magic));
+	WriteValue(out, Version);
+	WriteValue(out, (std::uint32_t)mKeys.size());
+
+	for(const Key& key : mKeys)
+	{
+		WriteValue(out, key.Time);
+		WriteValue(out, key.Position);
+
+		const std::int16_t orientation[4] =
+		{
+			PackSnorm(key.Orientation.x),
+			PackSnorm(key.Orientation.y),
+			PackSnorm(key.Orientation.z),
+			PackSnorm(key.Orientation.w)
+		};
+		WriteValue(out, orientation);
+	}
+
+	return (bool)out;
+}
+
+bool CameraPath::Read(std::istream& in)
+{
+	char magic[4];
+	std::uint32_t version = 0;
+	std::uint32_t keyCount = 0;
+	if(!ReadValue(in, magic) || !std::equal(magic, magic + 4, Magic) ||
+		!ReadValue(in, version) || version != Version ||
+		!ReadValue(in, keyCount) || keyCount > MaxKeys)
+		return false;
+
+	// The count is only as good as the bytes behind it, so keys are read one at
+	// a time instead of allocated up front.
+	std::vector<Key> keys;
+	for(std::uint32_t i = 0; i < keyCount; ++i)
+	{
+		Key key;
+		std::int16_t orientation[4];
+		if(!ReadValue(in, key.Time) || !ReadValue(in, key.Position) || !ReadValue(in, orientation))
+			return false;
+
+		// A zero quaternion is no rotation at all; normalizing it gives NaNs.
+		if(orientation[0] == 0 && orientation[1] == 0 && orientation[2] == 0 && orientation[3] == 0)
+			return false;
+
+		XMVECTOR q = XMVectorSet(orientation[0], orientation[1], orientation[2], orientation[3]);
+		XMStoreFloat4(&key.Orientation, XMQuaternionNormalize(q));
+		keys.push_back(key);
+	}
+
+	for(size_t i = 1; i < keys.size(); ++i)
+	{
+		if(!(keys[i].Time > keys[i - 1].Time))
+			return false;
+	}
+
+	mKeys.swap(keys);
+	return true;
+}
+
+bool CameraPath::Save(const std::wstring& filename)const
+{
+	std::ofstream fout(filename, std::ios::binary);
+	return fout && Write(fout);
+}
+
+bool CameraPath::Load(const std::wstring& filename)
+{
+	std::ifstream fin(filename, std::ios::binary);
+	return fin && Read(fin);
+}
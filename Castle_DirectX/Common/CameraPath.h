@@ -0,0 +1,66 @@
+//***************************************************************************************
+// CameraPath.h
+//
+// Records a camera route as timed keys of position and orientation and plays it
+// back at any time along it: positions follow a Catmull-Rom spline through the keys
+// and orientations are slerped, so a path recorded at the frame rate plays back
+// smoothly at any other.  Sampling looks the key up by binary search, so a path can
+// be scrubbed back and forth as cheaply as it is played.
+//
+// Binary layout, little endian:
+//   char[4] "CPTH", UINT32 version (1), UINT32 key count, then per key
+//   float time, float position[3], INT16 orientation[4] (unit quaternion * 32767),
+// 24 bytes a key.
+//***************************************************************************************
+
+#pragma once
+
+#include "Camera.h"
+#include <istream>
+#include <ostream>
+
+class CameraPath
+{
+public:
+	struct Key
+	{
+		float Time;
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT4 Orientation; // unit quaternion, see Camera::GetOrientation
+	};
+
+public:
+	CameraPath() = default;
+	CameraPath(const CameraPath& rhs) = delete;
+	CameraPath& operator=(const CameraPath& rhs) = delete;
+
+	void Clear();
+	void Reserve(UINT keyCount);
+
+	// Appends the camera's state at time, in seconds.  Keys must come in time
+	// order: one earlier than the last is ignored, one at the same time replaces it.
+	void AddKey(float time, const Camera& camera);
+
+	UINT KeyCount()const;
+	const Key& GetKey(UINT i)const;
+
+	// Times of the first and last keys; 0 without keys.
+	float StartTime()const;
+	float EndTime()const;
+	float Duration()const;
+
+	// Position and orientation at time, clamped to the path.  False without keys.
+	bool Sample(float time, DirectX::XMFLOAT3& position, DirectX::XMFLOAT4& orientation)const;
+
+	// Moves the camera to the path at time.  Call UpdateViewMatrix after.
+	bool Apply(float time, Camera& camera)const;
+
+	bool Write(std::ostream& out)const;
+	bool Read(std::istream& in);
+
+	bool Save(const std::wstring& filename)const;
+	bool Load(const std::wstring& filename);
+
+private:
+	std::vector<Key> mKeys;
+};
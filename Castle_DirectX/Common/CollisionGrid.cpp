@@ -0,0 +1,431 @@
+//***************************************************************************************
+// CollisionGrid.cpp
+//***************************************************************************************
+
+#include "CollisionGrid.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Entry and exit times of start + t*delta through [lo, hi] on one axis.
+	bool RaySlab(float start, float delta, float lo, float hi, float& t0, float& t1)
+	{
+		if(delta == 0.0f)
+		{
+			t0 = -FLT_MAX;
+			t1 = FLT_MAX;
+			return start > lo && start < hi;
+		}
+
+		t0 = (lo - start) / delta;
+		t1 = (hi - start) / delta;
+		if(t0 > t1)
+			std::swap(t0, t1);
+		return true;
+	}
+
+	// Entry and exit times of the ray o + t*d through a sphere of the given radius
+	// at the origin.  With d.z and o.z zero it is a circle in the xy plane.
+	bool RaySphere(const float o[3], const float d[3], float radius, float& t0, float& t1)
+	{
+		const float a = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+		const float c = o[0]*o[0] + o[1]*o[1] + o[2]*o[2] - radius*radius;
+		if(a == 0.0f)
+		{
+			t0 = -FLT_MAX;
+			t1 = FLT_MAX;
+			return c < 0.0f;
+		}
+
+		const float b = o[0]*d[0] + o[1]*d[1] + o[2]*d[2];
+		const float discriminant = b*b - a*c;
+		if(discriminant <= 0.0f)
+			return false;
+
+		const float root = sqrtf(discriminant);
+		t0 = (-b - root) / a;
+		t1 = (-b + root) / a;
+		return true;
+	}
+}
+
+const float CollisionGrid::Skin = 1.0e-3f;
+
+CollisionGrid::CollisionGrid(float cellSize)
+	: mCellSize(cellSize)
+{
+}
+
+void CollisionGrid::Build(const BoundingBox* boxes, UINT boxCount)
+{
+	mBoxes.resize(boxCount);
+
+	float minX = FLT_MAX;
+	float minZ = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float maxZ = -FLT_MAX;
+	for(UINT i = 0; i < boxCount; ++i)
+	{
+		const XMFLOAT3& c = boxes[i].Center;
+		const XMFLOAT3& e = boxes[i].Extents;
+		mBoxes[i] = { { c.x - e.x, c.y - e.y, c.z - e.z }, { c.x + e.x, c.y + e.y, c.z + e.z } };
+
+		minX = std::min(minX, c.x - e.x);
+		minZ = std::min(minZ, c.z - e.z);
+		maxX = std::max(maxX, c.x + e.x);
+		maxZ = std::max(maxZ, c.z + e.z);
+	}
+
+	if(boxCount == 0)
+	{
+		minX = minZ = 0.0f;
+		maxX = maxZ = 0.0f;
+	}
+
+	mOriginX = minX;
+	mOriginZ = minZ;
+	mCellsX = std::max<UINT>(1, (UINT)ceilf((maxX - minX) / mCellSize));
+	mCellsZ = std::max<UINT>(1, (UINT)ceilf((maxZ - minZ) / mCellSize));
+
+	// Count the boxes over each cell, turn the counts into offsets, then fill.
+	auto cellRange = [this](const Box& box, UINT& x0, UINT& x1, UINT& z0, UINT& z1)
+	{
+		x0 = std::min<UINT>((UINT)((box.Min[0] - mOriginX) / mCellSize), mCellsX - 1);
+		x1 = std::min<UINT>((UINT)((box.Max[0] - mOriginX) / mCellSize), mCellsX - 1);
+		z0 = std::min<UINT>((UINT)((box.Min[2] - mOriginZ) / mCellSize), mCellsZ - 1);
+		z1 = std::min<UINT>((UINT)((box.Max[2] - mOriginZ) / mCellSize), mCellsZ - 1);
+	};
+
+	mCells.assign(mCellsX*mCellsZ, Cell());
+	for(const Box& box : mBoxes)
+	{
+		UINT x0, x1, z0, z1;
+		cellRange(box, x0, x1, z0, z1);
+		for(UINT z = z0; z <= z1; ++z)
+			for(UINT x = x0; x <= x1; ++x)
+				mCells[z*mCellsX + x].Count++;
+	}
+
+	UINT offset = 0;
+	for(Cell& cell : mCells)
+	{
+		cell.Offset = offset;
+		offset += cell.Count;
+		cell.Count = 0;
+	}
+
+	mBoxIndices.resize(offset);
+	for(UINT i = 0; i < boxCount; ++i)
+	{
+		UINT x0, x1, z0, z1;
+		cellRange(mBoxes[i], x0, x1, z0, z1);
+		for(UINT z = z0; z <= z1; ++z)
+		{
+			for(UINT x = x0; x <= x1; ++x)
+			{
+				Cell& cell = mCells[z*mCellsX + x];
+				mBoxIndices[cell.Offset + cell.Count++] = i;
+			}
+		}
+	}
+}
+
+bool CollisionGrid::Sweep(const XMFLOAT3& start, const XMFLOAT3& delta, float radius, Hit& hit)const
+{
+	hit = Hit();
+	if(mBoxes.empty())
+		return false;
+
+	const float s[3] = { start.x, start.y, start.z };
+	const float d[3] = { delta.x, delta.y, delta.z };
+
+	// Cells under the xz bounds of the motion, grown by the radius.
+	const float minX = std::min(s[0], s[0] + d[0]) - radius - mOriginX;
+	const float maxX = std::max(s[0], s[0] + d[0]) + radius - mOriginX;
+	const float minZ = std::min(s[2], s[2] + d[2]) - radius - mOriginZ;
+	const float maxZ = std::max(s[2], s[2] + d[2]) + radius - mOriginZ;
+	const float sizeX = mCellsX*mCellSize;
+	const float sizeZ = mCellsZ*mCellSize;
+	if(maxX < 0.0f || maxZ < 0.0f || minX > sizeX || minZ > sizeZ)
+		return false;
+
+	const UINT x0 = std::min<UINT>((UINT)std::max(minX / mCellSize, 0.0f), mCellsX - 1);
+	const UINT x1 = std::min<UINT>((UINT)std::max(maxX / mCellSize, 0.0f), mCellsX - 1);
+	const UINT z0 = std::min<UINT>((UINT)std::max(minZ / mCellSize, 0.0f), mCellsZ - 1);
+	const UINT z1 = std::min<UINT>((UINT)std::max(maxZ / mCellSize, 0.0f), mCellsZ - 1);
+
+	// A box over several cells is tested once per cell; the earliest hit wins
+	// either way, and skipping repeats would need per query state.
+	for(UINT z = z0; z <= z1; ++z)
+	{
+		for(UINT x = x0; x <= x1; ++x)
+		{
+			const Cell& cell = mCells[z*mCellsX + x];
+			for(UINT i = cell.Offset; i < cell.Offset + cell.Count; ++i)
+			{
+				const UINT box = mBoxIndices[i];
+				float time;
+				float normal[3];
+				if(SweepBox(mBoxes[box], s, d, radius, time, normal) && (time < hit.Time || (time == hit.Time && box < hit.Box)))
+					Record(box, time, normal, hit);
+			}
+		}
+	}
+
+	return hit.Box != (UINT)-1;
+}
+
+bool CollisionGrid::SweepReference(const XMFLOAT3& start, const XMFLOAT3& delta, float radius, Hit& hit)const
+{
+	hit = Hit();
+
+	const float s[3] = { start.x, start.y, start.z };
+	const float d[3] = { delta.x, delta.y, delta.z };
+
+	for(UINT box = 0; box < (UINT)mBoxes.size(); ++box)
+	{
+		float time;
+		float normal[3];
+		if(SweepBox(mBoxes[box], s, d, radius, time, normal) && (time < hit.Time || (time == hit.Time && box < hit.Box)))
+			Record(box, time, normal, hit);
+	}
+
+	return hit.Box != (UINT)-1;
+}
+
+XMFLOAT3 CollisionGrid::Move(const XMFLOAT3& start, const XMFLOAT3& delta, float radius)const
+{
+	XMFLOAT3 position = start;
+	XMFLOAT3 motion = delta;
+
+	for(int i = 0; i < MaxSlides; ++i)
+	{
+		Hit hit;
+		if(!Sweep(position, motion, radius, hit))
+		{
+			position.x += motion.x;
+			position.y += motion.y;
+			position.z += motion.z;
+			break;
+		}
+
+		// Stop Skin short of the contact, then keep the part of the remaining
+		// motion that runs along the face.
+		const float length = sqrtf(motion.x*motion.x + motion.y*motion.y + motion.z*motion.z);
+		const float time = std::max(hit.Time - Skin / length, 0.0f);
+		position.x += motion.x*time;
+		position.y += motion.y*time;
+		position.z += motion.z*time;
+
+		const float remaining = 1.0f - time;
+		motion.x *= remaining;
+		motion.y *= remaining;
+		motion.z *= remaining;
+
+		const XMFLOAT3& n = hit.Normal;
+		const float into = motion.x*n.x + motion.y*n.y + motion.z*n.z;
+		motion.x -= into*n.x;
+		motion.y -= into*n.y;
+		motion.z -= into*n.z;
+	}
+
+	return position;
+}
+
+UINT CollisionGrid::BoxCount()const
+{
+	return (UINT)mBoxes.size();
+}
+
+UINT CollisionGrid::CellCount()const
+{
+	return (UINT)mCells.size();
+}
+
+bool CollisionGrid::SweepBox(const Box& box, const float start[3], const float delta[3], float radius,
+	float& time, float normal[3])
+{
+	// Quick out: the box grown by the radius with square edges holds the exact
+	// shape, so missing it misses the shape.
+	float enter = -FLT_MAX;
+	float exit = FLT_MAX;
+	for(int a = 0; a < 3; ++a)
+	{
+		float t0, t1;
+		if(!RaySlab(start[a], delta[a], box.Min[a] - radius, box.Max[a] + radius, t0, t1))
+			return false;
+		enter = std::max(enter, t0);
+		exit = std::min(exit, t1);
+	}
+	if(enter >= exit || exit <= 0.0f || enter > 1.0f)
+		return false;
+
+	// The exact shape is the union of three boxes, each grown along one axis, a
+	// cylinder round each edge and a sphere on each corner.  It is convex, so the
+	// ray enters it at the earliest entry into a piece and leaves at the latest exit.
+	enter = FLT_MAX;
+	exit = -FLT_MAX;
+	auto add = [&](float t0, float t1, float nx, float ny, float nz)
+	{
+		if(t0 < enter)
+		{
+			enter = t0;
+			normal[0] = nx;
+			normal[1] = ny;
+			normal[2] = nz;
+		}
+		exit = std::max(exit, t1);
+	};
+
+	// Outward face normal on axis a for a ray entering through it.
+	auto faceNormal = [delta](int a, float n[3])
+	{
+		n[0] = n[1] = n[2] = 0.0f;
+		if(a >= 0)
+			n[a] = delta[a] > 0.0f ? -1.0f : 1.0f;
+	};
+
+	for(int a = 0; a < 3; ++a)
+	{
+		float t0 = -FLT_MAX;
+		float t1 = FLT_MAX;
+		int entryAxis = -1;
+		bool hits = true;
+		for(int b = 0; b < 3; ++b)
+		{
+			const float grow = b == a ? radius : 0.0f;
+			float s0, s1;
+			if(!RaySlab(start[b], delta[b], box.Min[b] - grow, box.Max[b] + grow, s0, s1))
+			{
+				hits = false;
+				break;
+			}
+			if(s0 > t0)
+			{
+				t0 = s0;
+				entryAxis = b;
+			}
+			t1 = std::min(t1, s1);
+		}
+
+		if(hits && t0 < t1)
+		{
+			float n[3];
+			faceNormal(entryAxis, n);
+			add(t0, t1, n[0], n[1], n[2]);
+		}
+	}
+
+	for(int a = 0; a < 3; ++a)
+	{
+		const int b = (a + 1) % 3;
+		const int c = (a + 2) % 3;
+
+		float s0, s1;
+		if(!RaySlab(start[a], delta[a], box.Min[a], box.Max[a], s0, s1))
+			continue;
+
+		for(int edge = 0; edge < 4; ++edge)
+		{
+			const float eb = (edge & 1) ? box.Max[b] : box.Min[b];
+			const float ec = (edge & 2) ? box.Max[c] : box.Min[c];
+
+			float c0, c1;
+			const float o[3] = { start[b] - eb, start[c] - ec, 0.0f };
+			const float d[3] = { delta[b], delta[c], 0.0f };
+			if(!RaySphere(o, d, radius, c0, c1))
+				continue;
+
+			const float t0 = std::max(s0, c0);
+			const float t1 = std::min(s1, c1);
+			if(t0 >= t1)
+				continue;
+
+			float n[3] = { 0.0f, 0.0f, 0.0f };
+			if(c0 >= s0)
+			{
+				n[b] = (o[0] + t0*d[0]) / radius;
+				n[c] = (o[1] + t0*d[1]) / radius;
+			}
+			else
+			{
+				faceNormal(a, n);
+			}
+			add(t0, t1, n[0], n[1], n[2]);
+		}
+	}
+
+	for(int corner = 0; corner < 8; ++corner)
+	{
+		const float o[3] =
+		{
+			start[0] - ((corner & 1) ? box.Max[0] : box.Min[0]),
+			start[1] - ((corner & 2) ? box.Max[1] : box.Min[1]),
+			start[2] - ((corner & 4) ? box.Max[2] : box.Min[2])
+		};
+
+		float t0, t1;
+		if(RaySphere(o, delta, radius, t0, t1))
+			add(t0, t1, (o[0] + t0*delta[0]) / radius, (o[1] + t0*delta[1]) / radius, (o[2] + t0*delta[2]) / radius);
+	}
+
+	// Missed, behind, or beyond the end of the motion.
+	if(enter >= exit || exit <= 0.0f || enter > 1.0f)
+		return false;
+
+	if(enter >= 0.0f)
+	{
+		time = enter;
+		return true;
+	}
+
+	// Starting inside, which only rounding or a spawn point should cause: hit at
+	// once, pushing away from the nearest point of the box, if the motion heads
+	// further in; otherwise let it go.
+	float away[3];
+	float length = 0.0f;
+	for(int a = 0; a < 3; ++a)
+	{
+		away[a] = start[a] - std::min(std::max(start[a], box.Min[a]), box.Max[a]);
+		length += away[a]*away[a];
+	}
+
+	if(length > 0.0f)
+	{
+		length = sqrtf(length);
+		for(int a = 0; a < 3; ++a)
+			normal[a] = away[a] / length;
+	}
+	else
+	{
+		// Centre inside the box itself: out through the nearest face.
+		float depth = FLT_MAX;
+		for(int a = 0; a < 3; ++a)
+		{
+			for(float side : { -1.0f, 1.0f })
+			{
+				const float d = side < 0.0f ? start[a] - box.Min[a] : box.Max[a] - start[a];
+				if(d < depth)
+				{
+					depth = d;
+					normal[0] = normal[1] = normal[2] = 0.0f;
+					normal[a] = side;
+				}
+			}
+		}
+	}
+
+	time = 0.0f;
+	return delta[0]*normal[0] + delta[1]*normal[1] + delta[2]*normal[2] < 0.0f;
+}
+
+void CollisionGrid::Record(UINT box, float time, const float normal[3], Hit& hit)
+{
+	hit.Time = time;
+	hit.Normal = XMFLOAT3(normal[0], normal[1], normal[2]);
+	hit.Box = box;
+}
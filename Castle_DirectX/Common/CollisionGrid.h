@@ -0,0 +1,90 @@
+//***************************************************************************************
+// CollisionGrid.h
+//
+// Swept sphere collision against a static set of axis aligned boxes, for moving the
+// camera through the castle walls.  The boxes are bucketed into a uniform grid of
+// square cells over the xz plane (walls are tall and thin, so y is not split); a
+// sweep visits only the cells under the bounds of its motion.
+//
+// A sphere touches a box when its centre is inside the box grown by the radius,
+// with rounded edges and corners, so a sweep is a ray against that shape and the
+// sphere slides round wall ends and over wall tops.  A sphere that starts inside a
+// box, by rounding or by where it was put, can move out of it or along it, not
+// further in.
+//
+// No device is involved, so queries can be timed and checked headless.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class CollisionGrid
+{
+public:
+	struct Hit
+	{
+		float Time = 1.0f;                                  // fraction of the motion
+		DirectX::XMFLOAT3 Normal = { 0.0f, 0.0f, 0.0f };    // of the grown box, pointing out
+		UINT Box = (UINT)-1;
+	};
+
+	// Sweeps that hit, and the motion left over, per Move call at most.
+	static const int MaxSlides = 3;
+
+	// Distance kept between the sphere and a box it stops against, so the next
+	// sweep does not start touching it.
+	static const float Skin;
+
+public:
+	explicit CollisionGrid(float cellSize = 8.0f);
+	CollisionGrid(const CollisionGrid& rhs) = delete;
+	CollisionGrid& operator=(const CollisionGrid& rhs) = delete;
+
+	// Replaces the boxes and rebuilds the grid.
+	void Build(const DirectX::BoundingBox* boxes, UINT boxCount);
+
+	// Earliest contact of a sphere of the given radius moving from start by delta.
+	// Returns false when nothing is in the way.
+	bool Sweep(const DirectX::XMFLOAT3& start, const DirectX::XMFLOAT3& delta, float radius, Hit& hit)const;
+
+	// Same result as Sweep, testing every box.
+	bool SweepReference(const DirectX::XMFLOAT3& start, const DirectX::XMFLOAT3& delta, float radius, Hit& hit)const;
+
+	// Moves the sphere as far along delta as it can go, then slides the rest of the
+	// motion along whatever it hit.  Returns where the sphere ends up.
+	DirectX::XMFLOAT3 Move(const DirectX::XMFLOAT3& start, const DirectX::XMFLOAT3& delta, float radius)const;
+
+	UINT BoxCount()const;
+	UINT CellCount()const;
+
+private:
+	struct Box
+	{
+		float Min[3];
+		float Max[3];
+	};
+
+	// Box index range of one cell in mBoxIndices.
+	struct Cell
+	{
+		UINT Offset = 0;
+		UINT Count = 0;
+	};
+
+	// Contact time and the outward surface normal there.
+	static bool SweepBox(const Box& box, const float start[3], const float delta[3], float radius,
+		float& time, float normal[3]);
+	static void Record(UINT box, float time, const float normal[3], Hit& hit);
+
+private:
+	float mCellSize = 8.0f;
+	float mOriginX = 0.0f;
+	float mOriginZ = 0.0f;
+	UINT mCellsX = 0;
+	UINT mCellsZ = 0;
+
+	std::vector<Box> mBoxes;
+	std::vector<Cell> mCells;
+	std::vector<UINT> mBoxIndices;
+};
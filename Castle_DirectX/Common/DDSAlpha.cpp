@@ -0,0 +1,246 @@
+//***************************************************************************************
+// DDSAlpha.cpp
+//***************************************************************************************
+
+#include "DDSAlpha.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const uint32_t DDSMagic = 0x20534444; // "DDS "
+	const size_t DDSHeaderSize = 124;
+	const size_t DDSHeaderDX10Size = 20;
+
+	// DDS_PIXELFORMAT flags.
+	const uint32_t DDPFAlphaPixels = 0x1;
+	const uint32_t DDPFFourCC = 0x4;
+	const uint32_t DDPFRGB = 0x40;
+
+	// DXGI_FORMAT values used by DX10 headers.
+	enum : uint32_t
+	{
+		FormatR8G8B8A8Typeless = 27,
+		FormatR8G8B8A8UNorm = 28,
+		FormatR8G8B8A8UNormSRGB = 29,
+		FormatBC1Typeless = 70,
+		FormatBC1UNorm = 71,
+		FormatBC1UNormSRGB = 72,
+		FormatBC2Typeless = 73,
+		FormatBC2UNorm = 74,
+		FormatBC2UNormSRGB = 75,
+		FormatBC3Typeless = 76,
+		FormatBC3UNorm = 77,
+		FormatBC3UNormSRGB = 78,
+		FormatB8G8R8A8UNorm = 87,
+		FormatB8G8R8X8UNorm = 88,
+		FormatB8G8R8A8Typeless = 90,
+		FormatB8G8R8A8UNormSRGB = 91,
+	};
+
+	enum class Encoding
+	{
+		Unknown,
+		NoAlpha,
+		BC1,
+		BC2,
+		BC3,
+		Packed32, // 32 bits per texel, alpha selected by a mask
+	};
+
+	uint32_t ReadU32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t FourCC(char a, char b, char c, char d)
+	{
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
+
+	// Smallest alpha of a BC1 block: 0 when the block is in three-colour mode
+	// (color0 <= color1) and uses index 3, transparent black; otherwise 255.
+	uint8_t MinAlphaBC1(const uint8_t* block)
+	{
+		const uint16_t color0 = (uint16_t)(block[0] | (block[1] << 8));
+		const uint16_t color1 = (uint16_t)(block[2] | (block[3] << 8));
+		if(color0 > color1)
+			return 255;
+
+		const uint32_t indices = ReadU32(block + 4);
+		for(int i = 0; i < 16; ++i)
+		{
+			if(((indices >> (2*i)) & 0x3) == 3)
+				return 0;
+		}
+
+		return 255;
+	}
+
+	// BC2 stores 4 bits of explicit alpha per texel.
+	uint8_t MinAlphaBC2(const uint8_t* block)
+	{
+		uint8_t minNibble = 15;
+		for(int i = 0; i < 8; ++i)
+		{
+			minNibble = std::min<uint8_t>(minNibble, block[i] & 0xF);
+			minNibble = std::min<uint8_t>(minNibble, block[i] >> 4);
+		}
+
+		return (uint8_t)(minNibble*17);
+	}
+
+	// BC3 interpolates between two endpoints with 3-bit indices; only the
+	// palette entries the texels actually use count.
+	uint8_t MinAlphaBC3(const uint8_t* block)
+	{
+		const uint32_t alpha0 = block[0];
+		const uint32_t alpha1 = block[1];
+
+		uint32_t palette[8] = { alpha0, alpha1 };
+		if(alpha0 > alpha1)
+		{
+			for(uint32_t i = 1; i < 7; ++i)
+				palette[i + 1] = ((7 - i)*alpha0 + i*alpha1) / 7;
+		}
+		else
+		{
+			for(uint32_t i = 1; i < 5; ++i)
+				palette[i + 1] = ((5 - i)*alpha0 + i*alpha1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		for(int i = 0; i < 6; ++i)
+			indices |= (uint64_t)block[2 + i] << (8*i);
+
+		uint32_t minAlpha = 255;
+		for(int i = 0; i < 16; ++i)
+			minAlpha = std::min<uint32_t>(minAlpha, palette[(indices >> (3*i)) & 0x7]);
+
+		return (uint8_t)minAlpha;
+	}
+}
+
+DDSAlphaInfo AnalyzeDDSAlpha(const void* fileData, size_t fileSize)
+{
+	DDSAlphaInfo info;
+
+	const uint8_t* data = static_cast<const uint8_t*>(fileData);
+	if(fileSize < 4 + DDSHeaderSize || ReadU32(data) != DDSMagic)
+		return info;
+
+	const uint8_t* header = data + 4;
+	if(ReadU32(header) != DDSHeaderSize)
+		return info;
+
+	const uint8_t* pixelFormat = header + 72;
+	const uint32_t pfFlags = ReadU32(pixelFormat + 4);
+	const uint32_t fourCC = ReadU32(pixelFormat + 8);
+	const uint32_t rgbBitCount = ReadU32(pixelFormat + 12);
+	uint32_t alphaMask = ReadU32(pixelFormat + 28);
+
+	size_t payloadOffset = 4 + DDSHeaderSize;
+	Encoding encoding = Encoding::Unknown;
+
+	if((pfFlags & DDPFFourCC) && fourCC == FourCC('D', 'X', '1', '0'))
+	{
+		if(fileSize < payloadOffset + DDSHeaderDX10Size)
+			return info;
+
+		const uint32_t format = ReadU32(data + payloadOffset);
+		payloadOffset += DDSHeaderDX10Size;
+
+		switch(format)
+		{
+		case FormatBC1Typeless: case FormatBC1UNorm: case FormatBC1UNormSRGB:
+			encoding = Encoding::BC1;
+			break;
+		case FormatBC2Typeless: case FormatBC2UNorm: case FormatBC2UNormSRGB:
+			encoding = Encoding::BC2;
+			break;
+		case FormatBC3Typeless: case FormatBC3UNorm: case FormatBC3UNormSRGB:
+			encoding = Encoding::BC3;
+			break;
+		case FormatR8G8B8A8Typeless: case FormatR8G8B8A8UNorm: case FormatR8G8B8A8UNormSRGB:
+		case FormatB8G8R8A8Typeless: case FormatB8G8R8A8UNorm: case FormatB8G8R8A8UNormSRGB:
+			encoding = Encoding::Packed32;
+			alphaMask = 0xFF000000;
+			break;
+		case FormatB8G8R8X8UNorm:
+			encoding = Encoding::NoAlpha;
+			break;
+		default:
+			break;
+		}
+	}
+	else if(pfFlags & DDPFFourCC)
+	{
+		if(fourCC == FourCC('D', 'X', 'T', '1'))
+			encoding = Encoding::BC1;
+		else if(fourCC == FourCC('D', 'X', 'T', '2') || fourCC == FourCC('D', 'X', 'T', '3'))
+			encoding = Encoding::BC2;
+		else if(fourCC == FourCC('D', 'X', 'T', '4') || fourCC == FourCC('D', 'X', 'T', '5'))
+			encoding = Encoding::BC3;
+	}
+	else if(pfFlags & DDPFRGB)
+	{
+		if(!(pfFlags & DDPFAlphaPixels) || alphaMask == 0)
+			encoding = Encoding::NoAlpha;
+		else if(rgbBitCount == 32)
+			encoding = Encoding::Packed32;
+	}
+
+	if(encoding == Encoding::Unknown)
+		return info;
+
+	info.Valid = true;
+	info.HasAlphaChannel = encoding != Encoding::NoAlpha;
+	if(!info.HasAlphaChannel)
+		return info;
+
+	// Every mip level and array slice is a whole number of blocks (or texels), so
+	// the payload is scanned as one run.
+	const uint8_t* payload = data + payloadOffset;
+	const size_t payloadSize = fileSize - payloadOffset;
+
+	uint32_t minAlpha = 255;
+	switch(encoding)
+	{
+	case Encoding::BC1:
+		for(size_t i = 0; i + 8 <= payloadSize && minAlpha > 0; i += 8)
+			minAlpha = std::min<uint32_t>(minAlpha, MinAlphaBC1(payload + i));
+		break;
+	case Encoding::BC2:
+		for(size_t i = 0; i + 16 <= payloadSize && minAlpha > 0; i += 16)
+			minAlpha = std::min<uint32_t>(minAlpha, MinAlphaBC2(payload + i));
+		break;
+	case Encoding::BC3:
+		for(size_t i = 0; i + 16 <= payloadSize && minAlpha > 0; i += 16)
+			minAlpha = std::min<uint32_t>(minAlpha, MinAlphaBC3(payload + i));
+		break;
+	case Encoding::Packed32:
+	{
+		uint32_t shift = 0;
+		while(((alphaMask >> shift) & 1) == 0)
+			++shift;
+		const uint32_t maxValue = alphaMask >> shift;
+
+		for(size_t i = 0; i + 4 <= payloadSize && minAlpha > 0; i += 4)
+		{
+			const uint32_t value = (ReadU32(payload + i) & alphaMask) >> shift;
+			minAlpha = std::min<uint32_t>(minAlpha, value*255 / maxValue);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	info.MinAlpha = minAlpha / 255.0f;
+
+	return info;
+}
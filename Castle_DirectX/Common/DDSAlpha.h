@@ -0,0 +1,27 @@
+//***************************************************************************************
+// DDSAlpha.h
+//
+// Finds the smallest alpha value stored in a DDS file, over every mip level and array
+// slice, without creating a texture.  Handles BC1 (punch-through alpha), BC2, BC3 and
+// 32-bit uncompressed formats; formats without an alpha channel report 1.  Plain C++
+// with no Windows or D3D dependency.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct DDSAlphaInfo
+{
+	// False when the header is malformed or the format is not handled; the other
+	// fields are then meaningless.
+	bool Valid = false;
+
+	bool HasAlphaChannel = false;
+
+	// Smallest texel alpha in [0, 1].
+	float MinAlpha = 1.0f;
+};
+
+DDSAlphaInfo AnalyzeDDSAlpha(const void* fileData, size_t fileSize);
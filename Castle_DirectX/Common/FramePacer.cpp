@@ -0,0 +1,188 @@
+//***************************************************************************************
+// FramePacer.cpp
+//***************************************************************************************
+
+#include "FramePacer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+	const uint32_t WorkWindow = 16;
+
+	// Low latency mode starts this much earlier than the predicted work needs.
+	const std::int64_t WorkMargin = 500000; // 0.5 ms
+
+	// Assumed overshoot until two sleeps have been measured.  The estimate
+	// restarts after MaxSleepSamples sleeps so it follows timer changes.
+	const double InitialOvershoot = 1.0e6;
+	const uint32_t MaxSleepSamples = 1000;
+
+	const std::int64_t SleepTicks = 1000000; // 1 ms
+
+	std::int64_t SteadyClockNow()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+FramePacer::FramePacer(GameTimer::TickSource source)
+	: mSource(source != nullptr ? source : SteadyClockNow),
+	mWork(WorkWindow, 0)
+{
+}
+
+void FramePacer::SetTargetFps(double fps)
+{
+	mPeriod = fps > 0.0 ? (std::int64_t)std::llround(GameTimer::TicksPerSecond / fps) : 0;
+	mScheduled = false;
+}
+
+double FramePacer::TargetFps()const
+{
+	return mPeriod > 0 ? (double)GameTimer::TicksPerSecond / mPeriod : 0.0;
+}
+
+void FramePacer::SetLowLatency(bool value)
+{
+	mLowLatency = value;
+}
+
+bool FramePacer::LowLatency()const
+{
+	return mLowLatency;
+}
+
+void FramePacer::SetSyncInterval(uint32_t interval)
+{
+	mSyncInterval = std::min<uint32_t>(interval, 4);
+}
+
+uint32_t FramePacer::SyncInterval()const
+{
+	return mSyncInterval;
+}
+
+std::int64_t FramePacer::NextFrameStart(std::int64_t now)
+{
+	if(mPeriod == 0)
+	{
+		mFrameStart = now;
+		return now;
+	}
+
+	if(!mScheduled)
+	{
+		mScheduled = true;
+		mSlot = now;
+		mFrameStart = now;
+		return now;
+	}
+
+	mSlot += mPeriod;
+
+	// Rushing through the missed slots would only make a burst of short frames.
+	if(now > mSlot + mPeriod)
+	{
+		mMissedFrames++;
+		mSlot = now;
+		mFrameStart = now;
+		return now;
+	}
+
+	std::int64_t start = mSlot;
+	if(mLowLatency)
+		start = std::max<std::int64_t>(mSlot, mSlot + mPeriod - PredictedWork() - WorkMargin);
+
+	mFrameStart = std::max<std::int64_t>(start, now);
+	return mFrameStart;
+}
+
+void FramePacer::EndFrame(std::int64_t now)
+{
+	mWork[mNextWork] = std::max<std::int64_t>(now - mFrameStart, 0);
+	mNextWork = (mNextWork + 1) % WorkWindow;
+}
+
+void FramePacer::Wait()
+{
+	WaitUntil(NextFrameStart(Now()));
+}
+
+void FramePacer::EndFrame()
+{
+	EndFrame(Now());
+}
+
+void FramePacer::WaitUntil(std::int64_t deadline)
+{
+	for(;;)
+	{
+		const std::int64_t now = Now();
+		const std::int64_t remaining = deadline - now;
+		if(remaining <= 0)
+			return;
+
+		// Sleeping is only safe while even a late wake up lands before the deadline.
+		const double overshoot = mSleepSamples > 1 ?
+			mSleepMean + std::sqrt(mSleepM2 / (mSleepSamples - 1)) : InitialOvershoot;
+
+		if(remaining > SleepTicks + (std::int64_t)overshoot)
+		{
+			std::this_thread::sleep_for(std::chrono::nanoseconds(SleepTicks));
+			AddSleepSample(Now() - now - SleepTicks);
+		}
+		else
+		{
+			while(Now() < deadline)
+				std::this_thread::yield();
+			return;
+		}
+	}
+}
+
+uint64_t FramePacer::MissedFrames()const
+{
+	return mMissedFrames;
+}
+
+double FramePacer::PredictedWorkMs()const
+{
+	return PredictedWork() / 1.0e6;
+}
+
+double FramePacer::SleepOvershootMs()const
+{
+	return mSleepSamples > 0 ? mSleepMean / 1.0e6 : 0.0;
+}
+
+std::int64_t FramePacer::Now()const
+{
+	return mSource();
+}
+
+std::int64_t FramePacer::PredictedWork()const
+{
+	// The slowest recent frame: a late start costs a missed slot, an early one
+	// only a little latency.
+	return *std::max_element(mWork.begin(), mWork.end());
+}
+
+void FramePacer::AddSleepSample(std::int64_t overshoot)
+{
+	if(mSleepSamples == MaxSleepSamples)
+	{
+		mSleepSamples = 0;
+		mSleepMean = 0.0;
+		mSleepM2 = 0.0;
+	}
+
+	const double sample = (double)std::max<std::int64_t>(overshoot, 0);
+	mSleepSamples++;
+	const double delta = sample - mSleepMean;
+	mSleepMean += delta / mSleepSamples;
+	mSleepM2 += delta*(sample - mSleepMean);
+}
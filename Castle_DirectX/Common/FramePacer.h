@@ -0,0 +1,81 @@
+//***************************************************************************************
+// FramePacer.h
+//
+// Holds the main loop to a target frame rate.  Frame k is given the slot
+// [start + k*period, start + (k+1)*period); NextFrameStart says when to begin it and
+// WaitUntil gets there by sleeping while the remaining time exceeds the observed
+// sleep overshoot, then spinning.  A frame more than a period late moves the
+// schedule to now instead of rushing to catch up.  In low latency mode a frame
+// begins as late in its slot as the recent CPU work allows, so input is read just
+// before the frame is submitted.  Times are GameTimer ticks; no Windows dependency.
+//***************************************************************************************
+
+#pragma once
+
+#include "GameTimer.h"
+#include <cstdint>
+#include <vector>
+
+class FramePacer
+{
+public:
+	explicit FramePacer(GameTimer::TickSource source = nullptr);
+	FramePacer(const FramePacer& rhs) = delete;
+	FramePacer& operator=(const FramePacer& rhs) = delete;
+
+	// 0 runs unlimited.
+	void SetTargetFps(double fps);
+	double TargetFps()const;
+
+	void SetLowLatency(bool value);
+	bool LowLatency()const;
+
+	// Vertical blanks per Present; 0 presents immediately.
+	void SetSyncInterval(uint32_t interval);
+	uint32_t SyncInterval()const;
+
+	// When the next frame should begin, given the current time.  Call once per frame.
+	std::int64_t NextFrameStart(std::int64_t now);
+
+	// Call once the frame's CPU work is done, to predict the next one.
+	void EndFrame(std::int64_t now);
+
+	// NextFrameStart and WaitUntil on the current time.
+	void Wait();
+	void EndFrame();
+
+	// Sleeps then spins until deadline.
+	void WaitUntil(std::int64_t deadline);
+
+	// Frames that started more than a period late and restarted the schedule.
+	uint64_t MissedFrames()const;
+
+	// Predicted CPU time of the next frame, and how late a 1 ms sleep wakes up.
+	double PredictedWorkMs()const;
+	double SleepOvershootMs()const;
+
+	std::int64_t Now()const;
+
+private:
+	std::int64_t PredictedWork()const;
+	void AddSleepSample(std::int64_t overshoot);
+
+	GameTimer::TickSource mSource;
+
+	std::int64_t mPeriod = 0;
+	std::int64_t mSlot = 0;       // start of the current frame's slot
+	std::int64_t mFrameStart = 0;
+	bool mScheduled = false;
+	bool mLowLatency = false;
+	uint32_t mSyncInterval = 0;
+	uint64_t mMissedFrames = 0;
+
+	// CPU work of the last WorkWindow frames.
+	std::vector<std::int64_t> mWork;
+	uint32_t mNextWork = 0;
+
+	// Running mean and variance of the sleep overshoot (Welford).
+	uint32_t mSleepSamples = 0;
+	double mSleepMean = 0.0;
+	double mSleepM2 = 0.0;
+};
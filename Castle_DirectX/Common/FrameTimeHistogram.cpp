@@ -0,0 +1,240 @@
+//***************************************************************************************
+// FrameTimeHistogram.cpp
+//***************************************************************************************
+
+#include "FrameTimeHistogram.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	// Exact buckets below LinearLimit us; SubBuckets per power of two above.
+	const uint32_t LinearLimit = 128;
+	const uint32_t SubBuckets = 64;
+	const uint32_t SubBucketBits = 6;
+
+	// Highest power of two kept: 2^36 us is about 19 hours.
+	const uint32_t MaxExponent = 36;
+	const uint32_t BucketCount = LinearLimit + (MaxExponent - SubBucketBits)*SubBuckets;
+
+	uint32_t HighestBit(uint64_t value)
+	{
+		uint32_t bit = 0;
+		while(value >>= 1)
+			++bit;
+		return bit;
+	}
+
+	const char* Separator(bool first)
+	{
+		return first ? "" : ", ";
+	}
+}
+
+FrameTimeHistogram::FrameTimeHistogram()
+	: mCounts(BucketCount, 0)
+{
+}
+
+void FrameTimeHistogram::AddBudget(double budgetMs)
+{
+	Budget budget = { budgetMs, 0 };
+	mBudgets.push_back(budget);
+}
+
+void FrameTimeHistogram::Record(double frameMs)
+{
+	const double clampedMs = std::max<double>(frameMs, 0.0);
+	const uint64_t us = (uint64_t)(clampedMs*1000.0 + 0.5);
+
+	mCounts[BucketIndex(us)]++;
+
+	mMinUs = mCount == 0 ? us : std::min<uint64_t>(mMinUs, us);
+	mMaxUs = std::max<uint64_t>(mMaxUs, us);
+	mSumMs += clampedMs;
+	mCount++;
+
+	for(Budget& budget : mBudgets)
+	{
+		if(clampedMs > budget.Ms)
+			budget.Over++;
+	}
+}
+
+void FrameTimeHistogram::Reset()
+{
+	std::fill(mCounts.begin(), mCounts.end(), 0);
+	mCount = 0;
+	mMinUs = 0;
+	mMaxUs = 0;
+	mSumMs = 0.0;
+
+	for(Budget& budget : mBudgets)
+		budget.Over = 0;
+}
+
+uint64_t FrameTimeHistogram::Count()const
+{
+	return mCount;
+}
+
+double FrameTimeHistogram::MinMs()const
+{
+	return mMinUs / 1000.0;
+}
+
+double FrameTimeHistogram::MaxMs()const
+{
+	return mMaxUs / 1000.0;
+}
+
+double FrameTimeHistogram::MeanMs()const
+{
+	return mCount > 0 ? mSumMs / mCount : 0.0;
+}
+
+double FrameTimeHistogram::PercentileMs(double p)const
+{
+	if(mCount == 0)
+		return 0.0;
+
+	const double clamped = std::min<double>(std::max<double>(p, 0.0), 1.0);
+	const uint64_t rank = std::max<uint64_t>(1, (uint64_t)(clamped*mCount + 0.999999));
+
+	uint64_t seen = 0;
+	for(uint32_t i = 0; i < BucketCount; ++i)
+	{
+		seen += mCounts[i];
+		if(seen >= rank)
+			return std::min<uint64_t>(BucketHighUs(i) - 1, mMaxUs) / 1000.0;
+	}
+
+	return MaxMs();
+}
+
+uint32_t FrameTimeHistogram::BudgetCount()const
+{
+	return (uint32_t)mBudgets.size();
+}
+
+double FrameTimeHistogram::BudgetMs(uint32_t i)const
+{
+	return mBudgets[i].Ms;
+}
+
+uint64_t FrameTimeHistogram::FramesOverBudget(uint32_t i)const
+{
+	return mBudgets[i].Over;
+}
+
+bool FrameTimeHistogram::Write(const std::wstring& filename)const
+{
+	std::ofstream fout(filename);
+	if(!fout)
+		return false;
+
+	const bool csv = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, L".csv") == 0;
+	fout << (csv ? ToCsv() : ToJson());
+
+	return (bool)fout;
+}
+
+std::string FrameTimeHistogram::ToJson()const
+{
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(3);
+
+	out << "{\n";
+	out << "  \"frames\": " << mCount << ",\n";
+	out << "  \"min_ms\": " << MinMs() << ",\n";
+	out << "  \"mean_ms\": " << MeanMs() << ",\n";
+	out << "  \"p50_ms\": " << PercentileMs(0.5) << ",\n";
+	out << "  \"p90_ms\": " << PercentileMs(0.9) << ",\n";
+	out << "  \"p99_ms\": " << PercentileMs(0.99) << ",\n";
+	out << "  \"p999_ms\": " << PercentileMs(0.999) << ",\n";
+	out << "  \"max_ms\": " << MaxMs() << ",\n";
+
+	out << "  \"over_budget\": [";
+	for(size_t i = 0; i < mBudgets.size(); ++i)
+		out << Separator(i == 0) << "{ \"budget_ms\": " << mBudgets[i].Ms << ", \"frames\": " << mBudgets[i].Over << " }";
+	out << "],\n";
+
+	// [low_ms, high_ms, count] for each non-empty bucket.
+	out << "  \"buckets\": [";
+	bool first = true;
+	for(uint32_t i = 0; i < BucketCount; ++i)
+	{
+		if(mCounts[i] == 0)
+			continue;
+
+		out << Separator(first) << "[" << BucketLowUs(i) / 1000.0 << ", " << BucketHighUs(i) / 1000.0 << ", " << mCounts[i] << "]";
+		first = false;
+	}
+	out << "]\n";
+	out << "}\n";
+
+	return out.str();
+}
+
+std::string FrameTimeHistogram::ToCsv()const
+{
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(3);
+
+	out << "# frames " << mCount << ", min " << MinMs() << ", mean " << MeanMs() << ", p50 " << PercentileMs(0.5)
+		<< ", p90 " << PercentileMs(0.9) << ", p99 " << PercentileMs(0.99) << ", p99.9 " << PercentileMs(0.999)
+		<< ", max " << MaxMs() << " ms\n";
+	for(const Budget& budget : mBudgets)
+		out << "# over " << budget.Ms << " ms: " << budget.Over << " frames\n";
+
+	out << "low_ms,high_ms,count,cumulative\n";
+	uint64_t seen = 0;
+	for(uint32_t i = 0; i < BucketCount; ++i)
+	{
+		if(mCounts[i] == 0)
+			continue;
+
+		seen += mCounts[i];
+		out << BucketLowUs(i) / 1000.0 << ',' << BucketHighUs(i) / 1000.0 << ',' << mCounts[i] << ',';
+		out.precision(6);
+		out << (double)seen / mCount << '\n';
+		out.precision(3);
+	}
+
+	return out.str();
+}
+
+uint32_t FrameTimeHistogram::BucketIndex(uint64_t us)
+{
+	if(us < LinearLimit)
+		return (uint32_t)us;
+
+	// Shift so the top SubBucketBits+1 bits remain: [SubBuckets, 2*SubBuckets).
+	const uint32_t shift = std::min<uint32_t>(HighestBit(us), MaxExponent - 1) - SubBucketBits;
+	const uint64_t top = std::min<uint64_t>(us >> shift, 2*SubBuckets - 1);
+
+	return LinearLimit + (shift - 1)*SubBuckets + (uint32_t)(top - SubBuckets);
+}
+
+uint64_t FrameTimeHistogram::BucketLowUs(uint32_t index)
+{
+	if(index < LinearLimit)
+		return index;
+
+	const uint32_t shift = (index - LinearLimit) / SubBuckets + 1;
+	const uint64_t top = SubBuckets + (index - LinearLimit) % SubBuckets;
+
+	return top << shift;
+}
+
+uint64_t FrameTimeHistogram::BucketHighUs(uint32_t index)
+{
+	if(index < LinearLimit)
+		return index + 1;
+
+	const uint32_t shift = (index - LinearLimit) / SubBuckets + 1;
+	return BucketLowUs(index) + ((uint64_t)1 << shift);
+}
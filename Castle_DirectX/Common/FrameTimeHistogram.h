@@ -0,0 +1,64 @@
+//***************************************************************************************
+// FrameTimeHistogram.h
+//
+// Records frame times in a log-linear histogram (as HDR histograms do): times below
+// 128 us get a bucket per microsecond, and each power of two above that is split
+// into 64 buckets, so any percentile is within 1/64 (1.6%) of the exact value while
+// memory stays fixed.  Min, max, mean and the counts over each budget are exact.
+// No Windows or D3D dependency.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FrameTimeHistogram
+{
+public:
+	FrameTimeHistogram();
+
+	// Counts frames longer than budgetMs from now on; e.g. 16.7 for 60 Hz.
+	void AddBudget(double budgetMs);
+
+	void Record(double frameMs);
+	void Reset();
+
+	uint64_t Count()const;
+	double MinMs()const;
+	double MaxMs()const;
+	double MeanMs()const;
+
+	// Smallest time that at least fraction p of the frames do not exceed, e.g.
+	// 0.99 for p99.  Reported as the upper end of the bucket, capped at MaxMs.
+	double PercentileMs(double p)const;
+
+	uint32_t BudgetCount()const;
+	double BudgetMs(uint32_t i)const;
+	uint64_t FramesOverBudget(uint32_t i)const;
+
+	// Summary plus every non-empty bucket; the format follows the extension,
+	// .csv or otherwise JSON.
+	bool Write(const std::wstring& filename)const;
+	std::string ToJson()const;
+	std::string ToCsv()const;
+
+private:
+	static uint32_t BucketIndex(uint64_t us);
+	static uint64_t BucketLowUs(uint32_t index);
+	static uint64_t BucketHighUs(uint32_t index); // exclusive
+
+	std::vector<uint64_t> mCounts;
+	uint64_t mCount = 0;
+	uint64_t mMinUs = 0;
+	uint64_t mMaxUs = 0;
+	double mSumMs = 0.0;
+
+	struct Budget
+	{
+		double Ms;
+		uint64_t Over;
+	};
+	std::vector<Budget> mBudgets;
+};
@@ -0,0 +1,213 @@
+//***************************************************************************************
+// Frustum.cpp
+//***************************************************************************************
+
+#include "Frustum.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT BitCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+	// Bit i set for each lane i that is all ones.
+	UINT LaneMask(FXMVECTOR v)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+		return (UINT)_mm_movemask_ps(v);
+#else
+		XMUINT4 lanes;
+		XMStoreUInt4(&lanes, v);
+		return (lanes.x & 1) | ((lanes.y & 1) << 1) | ((lanes.z & 1) << 2) | ((lanes.w & 1) << 3);
+#endif
+	}
+
+	// Loads four consecutive floats from each array, or the remaining ones padded
+	// with zeros at the end of the arrays.
+	template<int N>
+	void LoadGroup(const float* const (&arrays)[N], UINT first, UINT count, XMVECTOR (&out)[N])
+	{
+		if(first + 4 <= count)
+		{
+			for(int i = 0; i < N; ++i)
+				out[i] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(arrays[i] + first));
+			return;
+		}
+
+		for(int i = 0; i < N; ++i)
+		{
+			float tail[4] = {};
+			for(UINT j = first; j < count; ++j)
+				tail[j - first] = arrays[i][j];
+			out[i] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(tail));
+		}
+	}
+
+	// Each plane's components replicated across a vector, plus |a|, |b|, |c| for the
+	// box radius along the normal.
+	struct SplatPlanes
+	{
+		XMVECTOR A[Frustum::PlaneCount];
+		XMVECTOR B[Frustum::PlaneCount];
+		XMVECTOR C[Frustum::PlaneCount];
+		XMVECTOR D[Frustum::PlaneCount];
+		XMVECTOR AbsA[Frustum::PlaneCount];
+		XMVECTOR AbsB[Frustum::PlaneCount];
+		XMVECTOR AbsC[Frustum::PlaneCount];
+
+		explicit SplatPlanes(const Frustum& frustum)
+		{
+			for(int i = 0; i < Frustum::PlaneCount; ++i)
+			{
+				XMVECTOR plane = XMLoadFloat4(&frustum.Planes[i]);
+				A[i] = XMVectorSplatX(plane);
+				B[i] = XMVectorSplatY(plane);
+				C[i] = XMVectorSplatZ(plane);
+				D[i] = XMVectorSplatW(plane);
+				AbsA[i] = XMVectorAbs(A[i]);
+				AbsB[i] = XMVectorAbs(B[i]);
+				AbsC[i] = XMVectorAbs(C[i]);
+			}
+		}
+	};
+
+	// Runs test(first) over groups of four and packs its lane masks into visible.
+	template<typename Test>
+	UINT TestGroups(UINT count, UINT* visible, Test test)
+	{
+		std::fill_n(visible, Frustum::MaskWords(count), 0u);
+
+		UINT visibleCount = 0;
+		for(UINT first = 0; first < count; first += 4)
+		{
+			UINT bits = LaneMask(test(first));
+			if(count - first < 4)
+				bits &= (1u << (count - first)) - 1;
+
+			visible[first / 32] |= bits << (first % 32);
+			visibleCount += BitCount[bits];
+		}
+
+		return visibleCount;
+	}
+}
+
+Frustum Frustum::FromViewProj(FXMMATRIX viewProj, FXMVECTOR eye, FXMVECTOR look, float nearZ, float farZ)
+{
+	// A point p is inside when -w <= x <= w and -w <= y <= w for (x, y, z, w) = p*M,
+	// so each side plane is a sum or difference of two columns of M.
+	XMMATRIX columns = XMMatrixTranspose(viewProj);
+
+	XMVECTOR planes[PlaneCount];
+	planes[Left] = XMVectorAdd(columns.r[3], columns.r[0]);
+	planes[Right] = XMVectorSubtract(columns.r[3], columns.r[0]);
+	planes[Bottom] = XMVectorAdd(columns.r[3], columns.r[1]);
+	planes[Top] = XMVectorSubtract(columns.r[3], columns.r[1]);
+
+	const float eyeDepth = XMVectorGetX(XMVector3Dot(eye, look));
+	planes[Near] = XMVectorSetW(look, -eyeDepth - nearZ);
+	planes[Far] = XMVectorSetW(XMVectorNegate(look), eyeDepth + farZ);
+
+	Frustum frustum;
+	for(int i = 0; i < PlaneCount; ++i)
+		XMStoreFloat4(&frustum.Planes[i], XMPlaneNormalize(planes[i]));
+
+	return frustum;
+}
+
+UINT Frustum::TestAabbs(const AabbArrays& boxes, UINT* visible)const
+{
+	const SplatPlanes planes(*this);
+	const float* const arrays[6] = { boxes.CenterX, boxes.CenterY, boxes.CenterZ, boxes.ExtentX, boxes.ExtentY, boxes.ExtentZ };
+
+	return TestGroups(boxes.Count, visible, [&planes, &arrays, &boxes](UINT first)
+	{
+		XMVECTOR v[6];
+		LoadGroup(arrays, first, boxes.Count, v);
+
+		// Outside a plane when the centre is further out than the box's extent
+		// along the plane normal.
+		XMVECTOR inside = XMVectorTrueInt();
+		for(int i = 0; i < PlaneCount; ++i)
+		{
+			XMVECTOR distance = XMVectorMultiplyAdd(planes.A[i], v[0],
+				XMVectorMultiplyAdd(planes.B[i], v[1], XMVectorMultiplyAdd(planes.C[i], v[2], planes.D[i])));
+			XMVECTOR radius = XMVectorMultiplyAdd(planes.AbsA[i], v[3],
+				XMVectorMultiplyAdd(planes.AbsB[i], v[4], XMVectorMultiply(planes.AbsC[i], v[5])));
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorAdd(distance, radius), XMVectorZero()));
+		}
+		return inside;
+	});
+}
+
+UINT Frustum::TestSpheres(const SphereArrays& spheres, UINT* visible)const
+{
+	const SplatPlanes planes(*this);
+	const float* const arrays[4] = { spheres.CenterX, spheres.CenterY, spheres.CenterZ, spheres.Radius };
+
+	return TestGroups(spheres.Count, visible, [&planes, &arrays, &spheres](UINT first)
+	{
+		XMVECTOR v[4];
+		LoadGroup(arrays, first, spheres.Count, v);
+
+		XMVECTOR inside = XMVectorTrueInt();
+		for(int i = 0; i < PlaneCount; ++i)
+		{
+			XMVECTOR distance = XMVectorMultiplyAdd(planes.A[i], v[0],
+				XMVectorMultiplyAdd(planes.B[i], v[1], XMVectorMultiplyAdd(planes.C[i], v[2], planes.D[i])));
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorAdd(distance, v[3]), XMVectorZero()));
+		}
+		return inside;
+	});
+}
+
+bool Frustum::IntersectsAabb(const XMFLOAT3& center, const XMFLOAT3& extents)const
+{
+	// Summed in the same order as TestAabbs, so the two agree exactly.
+	for(int i = 0; i < PlaneCount; ++i)
+	{
+		const XMFLOAT4& p = Planes[i];
+		const float distance = p.x*center.x + (p.y*center.y + (p.z*center.z + p.w));
+		const float radius = fabsf(p.x)*extents.x + (fabsf(p.y)*extents.y + fabsf(p.z)*extents.z);
+		if(distance + radius < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::IntersectsSphere(const XMFLOAT3& center, float radius)const
+{
+	for(int i = 0; i < PlaneCount; ++i)
+	{
+		const XMFLOAT4& p = Planes[i];
+		if(p.x*center.x + (p.y*center.y + (p.z*center.z + p.w)) + radius < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+UINT Frustum::MaskWords(UINT count)
+{
+	return (count + 31) / 32;
+}
+
+void TransformAabbs(BoundingBox* out, const BoundingBox* in, size_t count, CXMMATRIX M)
+{
+	// Half the box's extent along each axis after M is |M| times the extents.
+	const XMVECTOR absRow0 = XMVectorAbs(M.r[0]);
+	const XMVECTOR absRow1 = XMVectorAbs(M.r[1]);
+	const XMVECTOR absRow2 = XMVectorAbs(M.r[2]);
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		XMVECTOR center = XMVector3Transform(XMLoadFloat3(&in[i].Center), M);
+
+		XMVECTOR extents = XMLoadFloat3(&in[i].Extents);
+		XMVECTOR result = XMVectorMultiply(XMVectorSplatZ(extents), absRow2);
+		result = XMVectorMultiplyAdd(XMVectorSplatY(extents), absRow1, result);
+		result = XMVectorMultiplyAdd(XMVectorSplatX(extents), absRow0, result);
+
+		XMStoreFloat3(&out[i].Center, center);
+		XMStoreFloat3(&out[i].Extents, result);
+	}
+}
@@ -0,0 +1,77 @@
+//***************************************************************************************
+// Frustum.h
+//
+// A view frustum as six world space planes, and batch visibility tests of boxes and
+// spheres against it.  Each plane (a, b, c, d) is normalised, so a*x + b*y + c*z + d
+// is the signed distance of a point, positive on the inside.
+//
+// The batch tests take structure-of-arrays input, one array per component, and
+// test four objects per iteration: a component of four objects is one XMVECTOR load,
+// and the six planes are applied to all four at once.  An object is visible unless
+// it lies wholly outside one plane, so an object near a frustum corner can be
+// reported visible when it is not; nothing visible is ever rejected.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+// Axis aligned boxes as centre and half extents.
+struct AabbArrays
+{
+	const float* CenterX = nullptr;
+	const float* CenterY = nullptr;
+	const float* CenterZ = nullptr;
+	const float* ExtentX = nullptr;
+	const float* ExtentY = nullptr;
+	const float* ExtentZ = nullptr;
+	UINT Count = 0;
+};
+
+struct SphereArrays
+{
+	const float* CenterX = nullptr;
+	const float* CenterY = nullptr;
+	const float* CenterZ = nullptr;
+	const float* Radius = nullptr;
+	UINT Count = 0;
+};
+
+struct Frustum
+{
+	enum Plane
+	{
+		Left,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+		PlaneCount
+	};
+
+	DirectX::XMFLOAT4 Planes[PlaneCount];
+
+	// Side planes from a row vector view*proj matrix; the near and far planes are
+	// at nearZ and farZ along look from eye, so an infinite or reverse-Z projection
+	// still gets a finite far plane.
+	static Frustum FromViewProj(DirectX::FXMMATRIX viewProj, DirectX::FXMVECTOR eye, DirectX::FXMVECTOR look,
+		float nearZ, float farZ);
+
+	// Set bit i % 32 of visible[i / 32] for every visible object i and clear the
+	// others; visible holds MaskWords(count) words.  Returns the number visible.
+	UINT TestAabbs(const AabbArrays& boxes, UINT* visible)const;
+	UINT TestSpheres(const SphereArrays& spheres, UINT* visible)const;
+
+	// One at a time, for the odd object and for checking the batch tests.
+	bool IntersectsAabb(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents)const;
+	bool IntersectsSphere(const DirectX::XMFLOAT3& center, float radius)const;
+
+	static UINT MaskWords(UINT count);
+};
+
+// The box bounding each box after the affine transform M, e.g. object space bounds
+// to world space for the tests above; out may be the same array as in.  The same box
+// BoundingBox::Transform gives, but from the centre and |M| times the extents
+// rather than eight corners.
+void TransformAabbs(DirectX::BoundingBox* out, const DirectX::BoundingBox* in, size_t count, DirectX::CXMMATRIX M);
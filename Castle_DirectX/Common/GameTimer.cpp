@@ -2,131 +2,173 @@
 // GameTimer.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
-#include <windows.h>
 #include "GameTimer.h"
+#include <chrono>
+#include <cmath>
 
-GameTimer::GameTimer()
-: mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
-  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+namespace
+{
+	std::int64_t SteadyClockNow()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	double ToSeconds(std::int64_t ticks)
+	{
+		// Whole seconds and the remainder separately, so the double keeps
+		// nanosecond resolution however long the timer has run.
+		const std::int64_t seconds = ticks / GameTimer::TicksPerSecond;
+		const std::int64_t fraction = ticks % GameTimer::TicksPerSecond;
+		return (double)seconds + (double)fraction / GameTimer::TicksPerSecond;
+	}
+}
+
+GameTimer::GameTimer(TickSource source)
+: mSource(source != nullptr ? source : SteadyClockNow), mTotalTime(0), mDeltaTime(0),
+  mRealTotalTime(0), mRealDeltaTime(0), mPrevTime(0), mFixedDelta(0), mTimeScale(1.0),
+  mScaledRemainder(0.0), mStopped(false)
 {
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	mSecondsPerCount = 1.0 / (double)countsPerSec;
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
 // time when the clock is stopped.
+//
+// Rather than subtracting the paused time from the distance to mBaseTime as the
+// original did, each Tick adds its delta to the total and Stop/Start keep the
+// paused interval out of the next delta:
+//
+//                     |<--paused time-->|
+// ----*---------------*-----------------*------------*------> time
+//  Reset()          Stop()           Start()       Tick()
 float GameTimer::TotalTime()const
 {
-	// If we are stopped, do not count the time that has passed since we stopped.
-	// Moreover, if we previously already had a pause, the distance 
-	// mStopTime - mBaseTime includes paused time, which we do not want to count.
-	// To correct this, we can subtract the paused time from mStopTime:  
-	//
-	//                     |<--paused time-->|
-	// ----*---------------*-----------------*------------*------------*------> time
-	//  mBaseTime       mStopTime        startTime     mStopTime    mCurrTime
+	return (float)TotalSeconds();
+}
 
-	if( mStopped )
-	{
-		return (float)(((mStopTime - mPausedTime)-mBaseTime)*mSecondsPerCount);
-	}
+float GameTimer::DeltaTime()const
+{
+	return (float)DeltaSeconds();
+}
 
-	// The distance mCurrTime - mBaseTime includes paused time,
-	// which we do not want to count.  To correct this, we can subtract 
-	// the paused time from mCurrTime:  
-	//
-	//  (mCurrTime - mPausedTime) - mBaseTime 
-	//
-	//                     |<--paused time-->|
-	// ----*---------------*-----------------*------------*------> time
-	//  mBaseTime       mStopTime        startTime     mCurrTime
-	
-	else
-	{
-		return (float)(((mCurrTime-mPausedTime)-mBaseTime)*mSecondsPerCount);
-	}
+double GameTimer::TotalSeconds()const
+{
+	return ToSeconds(mTotalTime);
 }
 
-float GameTimer::DeltaTime()const
+double GameTimer::DeltaSeconds()const
 {
-	return (float)mDeltaTime;
+	return ToSeconds(mDeltaTime);
 }
 
-void GameTimer::Reset()
+double GameTimer::RealTotalSeconds()const
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	return ToSeconds(mRealTotalTime);
+}
 
-	mBaseTime = currTime;
-	mPrevTime = currTime;
-	mStopTime = 0;
-	mStopped  = false;
+double GameTimer::RealDeltaSeconds()const
+{
+	return ToSeconds(mRealDeltaTime);
 }
 
-void GameTimer::Start()
+std::int64_t GameTimer::TotalTicks()const
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	return mTotalTime;
+}
 
+void GameTimer::SetFixedDelta(double seconds)
+{
+	mFixedDelta = seconds > 0.0 ? (std::int64_t)std::llround(seconds*TicksPerSecond) : 0;
+}
 
-	// Accumulate the time elapsed between stop and start pairs.
-	//
-	//                     |<-------d------->|
-	// ----*---------------*-----------------*------------> time
-	//  mBaseTime       mStopTime        startTime     
+double GameTimer::FixedDelta()const
+{
+	return ToSeconds(mFixedDelta);
+}
 
+void GameTimer::SetTimeScale(double scale)
+{
+	mTimeScale = scale > 0.0 ? scale : 0.0;
+	mScaledRemainder = 0.0;
+}
+
+double GameTimer::TimeScale()const
+{
+	return mTimeScale;
+}
+
+void GameTimer::Reset()
+{
+	mPrevTime = Now();
+	mTotalTime = 0;
+	mDeltaTime = 0;
+	mRealTotalTime = 0;
+	mRealDeltaTime = 0;
+	mScaledRemainder = 0.0;
+	mStopped = false;
+}
+
+void GameTimer::Start()
+{
+	// The time between Stop and Start never reaches a delta.
 	if( mStopped )
 	{
-		mPausedTime += (startTime - mStopTime);	
-
-		mPrevTime = startTime;
-		mStopTime = 0;
+		mPrevTime = Now();
 		mStopped  = false;
 	}
 }
 
 void GameTimer::Stop()
 {
-	if( !mStopped )
-	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-
-		mStopTime = currTime;
-		mStopped  = true;
-	}
+	mStopped = true;
 }
 
 void GameTimer::Tick()
 {
 	if( mStopped )
 	{
-		mDeltaTime = 0.0;
+		mDeltaTime = 0;
+		mRealDeltaTime = 0;
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-	mCurrTime = currTime;
+	const std::int64_t currTime = Now();
 
 	// Time difference between this frame and the previous.
-	mDeltaTime = (mCurrTime - mPrevTime)*mSecondsPerCount;
+	mRealDeltaTime = currTime - mPrevTime;
 
 	// Prepare for next frame.
-	mPrevTime = mCurrTime;
+	mPrevTime = currTime;
 
 	// Force nonnegative.  The DXSDK's CDXUTTimer mentions that if the 
 	// processor goes into a power save mode or we get shuffled to another
-	// processor, then mDeltaTime can be negative.
-	if(mDeltaTime < 0.0)
+	// processor, then the delta can be negative.
+	if(mRealDeltaTime < 0)
 	{
-		mDeltaTime = 0.0;
+		mRealDeltaTime = 0;
 	}
-}
-
-
-
 
+	if(mFixedDelta > 0)
+	{
+		mDeltaTime = mFixedDelta;
+	}
+	else if(mTimeScale != 1.0)
+	{
+		// Carry the fraction of a tick so a slow scale still adds up exactly.
+		const double scaled = mRealDeltaTime*mTimeScale + mScaledRemainder;
+		mDeltaTime = (std::int64_t)scaled;
+		mScaledRemainder = scaled - (double)mDeltaTime;
+	}
+	else
+	{
+		mDeltaTime = mRealDeltaTime;
+	}
 
+	mTotalTime += mDeltaTime;
+	mRealTotalTime += mRealDeltaTime;
+}
 
+std::int64_t GameTimer::Now()const
+{
+	return mSource();
+}
@@ -1,34 +1,70 @@
 //***************************************************************************************
 // GameTimer.h by Frank Luna (C) 2011 All Rights Reserved.
+//
+// Counts in 64-bit nanoseconds from std::chrono::steady_clock (QueryPerformanceCounter
+// on Windows) and converts to seconds only on the way out, so a long run does not
+// lose precision.  Game time can be scaled, or advanced by a fixed step each Tick
+// for deterministic runs; the real frame time is kept alongside either way.
 //***************************************************************************************
 
 #ifndef GAMETIMER_H
 #define GAMETIMER_H
 
+#include <cstdint>
+
 class GameTimer
 {
 public:
-	GameTimer();
+	// Nanoseconds from an arbitrary, monotonic origin.
+	typedef std::int64_t (*TickSource)();
+
+	// source replaces the steady clock, e.g. to drive the timer by hand.
+	explicit GameTimer(TickSource source = nullptr);
 
 	float TotalTime()const; // in seconds
 	float DeltaTime()const; // in seconds
 
+	double TotalSeconds()const;
+	double DeltaSeconds()const;
+
+	// Wall clock time of the last frame and since Reset, ignoring the time scale
+	// and fixed step, but not counting time when the clock is stopped.
+	double RealTotalSeconds()const;
+	double RealDeltaSeconds()const;
+
+	std::int64_t TotalTicks()const;
+	static const std::int64_t TicksPerSecond = 1000000000;
+
+	// Each Tick advances game time by exactly seconds; 0 goes back to the clock.
+	void SetFixedDelta(double seconds);
+	double FixedDelta()const;
+
+	// Game time runs at scale times the clock; ignored while a fixed delta is set.
+	void SetTimeScale(double scale);
+	double TimeScale()const;
+
 	void Reset(); // Call before message loop.
 	void Start(); // Call when unpaused.
 	void Stop();  // Call when paused.
 	void Tick();  // Call every frame.
 
 private:
-	double mSecondsPerCount;
-	double mDeltaTime;
+	std::int64_t Now()const;
+
+	TickSource mSource;
+
+	std::int64_t mTotalTime;
+	std::int64_t mDeltaTime;
+	std::int64_t mRealTotalTime;
+	std::int64_t mRealDeltaTime;
+
+	std::int64_t mPrevTime;
 
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	std::int64_t mFixedDelta;
+	double mTimeScale;
+	double mScaledRemainder;
 
 	bool mStopped;
 };
 
-#endif // GAMETIMER_H
\ No newline at end of file
+#endif // GAMETIMER_H
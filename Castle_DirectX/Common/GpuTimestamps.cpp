@@ -0,0 +1,228 @@
+//***************************************************************************************
+// GpuTimestamps.cpp
+//***************************************************************************************
+
+#include "GpuTimestamps.h"
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+RollingStats::RollingStats(uint32_t windowSize)
+	: mSamples(std::max<uint32_t>(windowSize, 1), 0.0)
+{
+}
+
+void RollingStats::Add(double sample)
+{
+	mSamples[mNext] = sample;
+	mNext = (mNext + 1) % (uint32_t)mSamples.size();
+	mCount = std::min<uint32_t>(mCount + 1, (uint32_t)mSamples.size());
+}
+
+void RollingStats::Clear()
+{
+	mNext = 0;
+	mCount = 0;
+}
+
+uint32_t RollingStats::Count()const
+{
+	return mCount;
+}
+
+double RollingStats::Min()const
+{
+	if(mCount == 0)
+		return 0.0;
+
+	return *std::min_element(mSamples.begin(), mSamples.begin() + mCount);
+}
+
+double RollingStats::Max()const
+{
+	if(mCount == 0)
+		return 0.0;
+
+	return *std::max_element(mSamples.begin(), mSamples.begin() + mCount);
+}
+
+double RollingStats::Average()const
+{
+	if(mCount == 0)
+		return 0.0;
+
+	double sum = 0.0;
+	for(uint32_t i = 0; i < mCount; ++i)
+		sum += mSamples[i];
+
+	return sum / mCount;
+}
+
+double RollingStats::Percentile(double p)const
+{
+	if(mCount == 0)
+		return 0.0;
+
+	// Order does not matter once the window is full, so the first mCount
+	// slots are the samples either way.
+	std::vector<double> sorted(mSamples.begin(), mSamples.begin() + mCount);
+
+	const double clamped = std::min<double>(std::max<double>(p, 0.0), 1.0);
+	const size_t rank = std::min<size_t>((size_t)(clamped*mCount + 0.999999), mCount);
+	const size_t index = rank > 0 ? rank - 1 : 0;
+
+	std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+	return sorted[index];
+}
+
+GpuTimestampLog::GpuTimestampLog(uint32_t frameCount, uint32_t maxMarkers, uint32_t windowSize)
+	: mMaxMarkers(maxMarkers), mWindowSize(windowSize), mFrames(frameCount)
+{
+	for(Frame& frame : mFrames)
+	{
+		frame.Intervals.reserve(maxMarkers);
+		frame.Open.reserve(maxMarkers);
+	}
+}
+
+uint32_t GpuTimestampLog::MaxQueries()const
+{
+	return 2*mMaxMarkers;
+}
+
+void GpuTimestampLog::BeginFrame(uint32_t frame)
+{
+	assert(frame < mFrames.size());
+	mRecording = frame;
+
+	Frame& f = mFrames[frame];
+	f.Intervals.clear();
+	f.Open.clear();
+	f.QueryCount = 0;
+	f.Reserved = 0;
+	f.Pending = false;
+}
+
+uint32_t GpuTimestampLog::Begin(const char* name)
+{
+	assert(mRecording != NoQuery);
+	Frame& f = mFrames[mRecording];
+
+	// An unmatched Begin still pushes, so End always pops its own marker.
+	Interval interval = { FindOrAddMarker(name), NoQuery, NoQuery };
+	if(f.Reserved + 2 <= MaxQueries() && interval.Marker != NoQuery)
+	{
+		interval.BeginQuery = f.QueryCount++;
+		f.Reserved += 2;
+	}
+
+	f.Open.push_back((uint32_t)f.Intervals.size());
+	f.Intervals.push_back(interval);
+
+	return interval.BeginQuery;
+}
+
+uint32_t GpuTimestampLog::End()
+{
+	assert(mRecording != NoQuery);
+	Frame& f = mFrames[mRecording];
+	assert(!f.Open.empty());
+
+	Interval& interval = f.Intervals[f.Open.back()];
+	f.Open.pop_back();
+
+	// Begin reserved room for the end query.
+	if(interval.BeginQuery != NoQuery)
+		interval.EndQuery = f.QueryCount++;
+
+	return interval.EndQuery;
+}
+
+uint32_t GpuTimestampLog::EndFrame()
+{
+	assert(mRecording != NoQuery);
+	Frame& f = mFrames[mRecording];
+	assert(f.Open.empty());
+
+	f.Pending = f.QueryCount > 0;
+	mRecording = NoQuery;
+
+	return f.QueryCount;
+}
+
+bool GpuTimestampLog::Pending(uint32_t frame)const
+{
+	return mFrames[frame].Pending;
+}
+
+void GpuTimestampLog::Retire(uint32_t frame, const uint64_t* ticks, uint64_t ticksPerSecond)
+{
+	Frame& f = mFrames[frame];
+	if(!f.Pending || ticksPerSecond == 0)
+		return;
+
+	const double msPerTick = 1000.0 / (double)ticksPerSecond;
+	for(const Interval& interval : f.Intervals)
+	{
+		if(interval.EndQuery == NoQuery)
+			continue;
+
+		// Timestamps from a disjoint interval (e.g. a clock change) can go
+		// backwards; skip them rather than record a huge duration.
+		const uint64_t begin = ticks[interval.BeginQuery];
+		const uint64_t end = ticks[interval.EndQuery];
+		if(end >= begin)
+			mMarkers[interval.Marker].Stats.Add((end - begin)*msPerTick);
+	}
+
+	f.Pending = false;
+}
+
+uint32_t GpuTimestampLog::MarkerCount()const
+{
+	return (uint32_t)mMarkers.size();
+}
+
+const std::string& GpuTimestampLog::MarkerName(uint32_t marker)const
+{
+	return mMarkers[marker].Name;
+}
+
+const RollingStats& GpuTimestampLog::MarkerStats(uint32_t marker)const
+{
+	return mMarkers[marker].Stats;
+}
+
+std::string GpuTimestampLog::Report()const
+{
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(3);
+
+	out << "marker samples min_ms avg_ms p99_ms max_ms\n";
+	for(const Marker& marker : mMarkers)
+	{
+		out << marker.Name << ' ' << marker.Stats.Count() << ' ' << marker.Stats.Min() << ' '
+			<< marker.Stats.Average() << ' ' << marker.Stats.Percentile(0.99) << ' ' << marker.Stats.Max() << '\n';
+	}
+
+	return out.str();
+}
+
+uint32_t GpuTimestampLog::FindOrAddMarker(const char* name)
+{
+	// A handful of markers per frame; a linear scan avoids building a key.
+	for(uint32_t i = 0; i < (uint32_t)mMarkers.size(); ++i)
+	{
+		if(mMarkers[i].Name == name)
+			return i;
+	}
+
+	if(mMarkers.size() >= mMaxMarkers)
+		return NoQuery;
+
+	Marker marker = { name, RollingStats(mWindowSize) };
+	mMarkers.push_back(marker);
+
+	return (uint32_t)mMarkers.size() - 1;
+}
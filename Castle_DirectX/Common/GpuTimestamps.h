@@ -0,0 +1,107 @@
+//***************************************************************************************
+// GpuTimestamps.h
+//
+// Bookkeeping for GPU timestamp queries, kept apart from the device so it can be
+// driven by hand.  Each frame resource owns a query heap and a readback buffer with
+// MaxQueries() slots; while a frame is recorded, Begin/End hand out the query index
+// to write for each named marker.  Once that frame's fence has retired, Retire takes
+// the resolved ticks and adds each marker's duration to its rolling statistics.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The last WindowSize samples of a value.
+class RollingStats
+{
+public:
+	explicit RollingStats(uint32_t windowSize = 240);
+
+	void Add(double sample);
+	void Clear();
+
+	uint32_t Count()const;
+	double Min()const;
+	double Max()const;
+	double Average()const;
+
+	// p in [0, 1], nearest rank over the window.
+	double Percentile(double p)const;
+
+private:
+	std::vector<double> mSamples;
+	uint32_t mNext = 0;
+	uint32_t mCount = 0;
+};
+
+class GpuTimestampLog
+{
+public:
+	GpuTimestampLog(uint32_t frameCount, uint32_t maxMarkers, uint32_t windowSize);
+	GpuTimestampLog(const GpuTimestampLog& rhs) = delete;
+	GpuTimestampLog& operator=(const GpuTimestampLog& rhs) = delete;
+
+	// Queries each frame's heap must hold: a begin and an end per marker.
+	uint32_t MaxQueries()const;
+
+	// Starts recording frame; anything still unretired in its slot is dropped.
+	void BeginFrame(uint32_t frame);
+
+	// Query index to write a timestamp into, or NoQuery when the frame is out
+	// of queries.  Markers nest; End closes the innermost open one.
+	uint32_t Begin(const char* name);
+	uint32_t End();
+
+	// Number of queries written this frame, [0, count) to resolve.
+	uint32_t EndFrame();
+
+	// True when frame has resolved queries that Retire has not consumed.
+	bool Pending(uint32_t frame)const;
+
+	// ticks[i] is query i of frame, read back after its fence retired.
+	void Retire(uint32_t frame, const uint64_t* ticks, uint64_t ticksPerSecond);
+
+	uint32_t MarkerCount()const;
+	const std::string& MarkerName(uint32_t marker)const;
+	const RollingStats& MarkerStats(uint32_t marker)const;
+
+	// Writes "name min avg p99 max" in milliseconds, one marker per line.
+	std::string Report()const;
+
+	static const uint32_t NoQuery = 0xffffffff;
+
+private:
+	uint32_t FindOrAddMarker(const char* name);
+
+	struct Marker
+	{
+		std::string Name;
+		RollingStats Stats;
+	};
+
+	struct Interval
+	{
+		uint32_t Marker;
+		uint32_t BeginQuery;
+		uint32_t EndQuery;
+	};
+
+	struct Frame
+	{
+		std::vector<Interval> Intervals;
+		std::vector<uint32_t> Open; // indices into Intervals
+		uint32_t QueryCount = 0;
+		uint32_t Reserved = 0; // QueryCount plus the end queries of open markers
+		bool Pending = false;
+	};
+
+	uint32_t mMaxMarkers;
+	uint32_t mWindowSize;
+	uint32_t mRecording = NoQuery;
+
+	std::vector<Marker> mMarkers;
+	std::vector<Frame> mFrames;
+};
@@ -0,0 +1,283 @@
+//***************************************************************************************
+// LightClusters.cpp
+//***************************************************************************************
+
+#include "LightClusters.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace
+{
+	// First i in [0, count) for which pred(i) holds, or count.  pred must be false
+	// for a prefix of the range and true for the rest.
+	template<typename Pred>
+	UINT FirstTrue(UINT count, Pred pred)
+	{
+		UINT first = 0;
+		while(count > 0)
+		{
+			const UINT half = count / 2;
+			if(pred(first + half))
+			{
+				count = half;
+			}
+			else
+			{
+				first += half + 1;
+				count -= half + 1;
+			}
+		}
+
+		return first;
+	}
+}
+
+LightClusters::LightClusters(UINT tilesX, UINT tilesY, UINT slicesZ, UINT maxLightIndices)
+	: mTilesX(tilesX), mTilesY(tilesY), mSlicesZ(slicesZ), mMaxLightIndices(maxLightIndices)
+{
+	assert(tilesX > 0 && tilesY > 0 && slicesZ > 0);
+
+	mRanges.resize(ClusterCount());
+	mCursors.resize(ClusterCount());
+	mLightIndices.reserve(maxLightIndices);
+
+	SetProjection(0.25f*XM_PI, 1.0f, 1.0f, 1000.0f);
+}
+
+LightClusters::~LightClusters()
+{
+}
+
+void LightClusters::SetProjection(float fovY, float aspect, float nearZ, float farZ)
+{
+	mTanHalfFovY = tanf(0.5f*fovY);
+	mTanHalfFovX = aspect*mTanHalfFovY;
+	mNearZ = nearZ;
+	mFarZ = farZ;
+
+	// slice = log(z/near) / log(far/near) * SlicesZ
+	const float logDepthRange = logf(farZ / nearZ);
+	mSliceScale = mSlicesZ / logDepthRange;
+	mSliceBias = -mSlicesZ*logf(nearZ) / logDepthRange;
+
+	mSliceDepths.resize(mSlicesZ + 1);
+	for(UINT z = 0; z <= mSlicesZ; ++z)
+		mSliceDepths[z] = nearZ*powf(farZ / nearZ, (float)z / mSlicesZ);
+	mSliceDepths[mSlicesZ] = farZ;
+
+	mClusterMin.resize(ClusterCount());
+	mClusterMax.resize(ClusterCount());
+
+	for(UINT z = 0; z < mSlicesZ; ++z)
+	{
+		const float nearDepth = mSliceDepths[z];
+		const float farDepth = mSliceDepths[z + 1];
+
+		// A tile edge at NDC coordinate n is the line n*tanHalfFov*depth, so a
+		// cell's bounds take each edge at both the slice's near and far depth.
+		auto edgeMin = [=](float ndc, float tanHalfFov)
+		{
+			return std::min<float>(ndc*tanHalfFov*nearDepth, ndc*tanHalfFov*farDepth);
+		};
+		auto edgeMax = [=](float ndc, float tanHalfFov)
+		{
+			return std::max<float>(ndc*tanHalfFov*nearDepth, ndc*tanHalfFov*farDepth);
+		};
+
+		for(UINT y = 0; y < mTilesY; ++y)
+		{
+			// Tile rows run top to bottom, like pixel rows.
+			const float ndcTop = 1.0f - 2.0f*y / mTilesY;
+			const float ndcBottom = 1.0f - 2.0f*(y + 1) / mTilesY;
+
+			for(UINT x = 0; x < mTilesX; ++x)
+			{
+				const float ndcLeft = -1.0f + 2.0f*x / mTilesX;
+				const float ndcRight = -1.0f + 2.0f*(x + 1) / mTilesX;
+
+				const UINT cluster = ClusterIndex(x, y, z);
+				mClusterMin[cluster] = XMFLOAT3(edgeMin(ndcLeft, mTanHalfFovX), edgeMin(ndcBottom, mTanHalfFovY), nearDepth);
+				mClusterMax[cluster] = XMFLOAT3(edgeMax(ndcRight, mTanHalfFovX), edgeMax(ndcTop, mTanHalfFovY), farDepth);
+			}
+		}
+	}
+}
+
+void LightClusters::Bin(const Light* lights, UINT lightCount, FXMMATRIX view)
+{
+	BeginBin(lights, lightCount, view);
+
+	for(UINT i = 0; i < lightCount; ++i)
+	{
+		const XMFLOAT4& s = mViewSpheres[i];
+		const XMVECTOR sphere = XMLoadFloat4(&s);
+
+		// The cluster bounds grow monotonically along each axis (x to the right,
+		// y downwards, z away from the eye), so the clusters whose bounds overlap
+		// the sphere's box on an axis form one contiguous run found by bisection.
+		// Every cluster the reference accepts is inside the candidate runs.
+		const UINT firstZ = FirstTrue(mSlicesZ, [&](UINT z) { return mSliceDepths[z + 1] >= s.z - s.w; });
+		const UINT endZ = FirstTrue(mSlicesZ, [&](UINT z) { return mSliceDepths[z] > s.z + s.w; });
+
+		for(UINT z = firstZ; z < endZ; ++z)
+		{
+			const UINT row = ClusterIndex(0, 0, z);
+			const UINT firstX = FirstTrue(mTilesX, [&](UINT x) { return mClusterMax[row + x].x >= s.x - s.w; });
+			const UINT endX = FirstTrue(mTilesX, [&](UINT x) { return mClusterMin[row + x].x > s.x + s.w; });
+			const UINT firstY = FirstTrue(mTilesY, [&](UINT y) { return mClusterMin[row + y*mTilesX].y <= s.y + s.w; });
+			const UINT endY = FirstTrue(mTilesY, [&](UINT y) { return mClusterMax[row + y*mTilesX].y < s.y - s.w; });
+
+			for(UINT y = firstY; y < endY; ++y)
+			{
+				for(UINT x = firstX; x < endX; ++x)
+				{
+					const UINT cluster = ClusterIndex(x, y, z);
+					if(Intersects(cluster, sphere))
+						mPairs.push_back({ cluster, i });
+				}
+			}
+		}
+	}
+
+	EndBin();
+}
+
+void LightClusters::BinReference(const Light* lights, UINT lightCount, FXMMATRIX view)
+{
+	BeginBin(lights, lightCount, view);
+
+	for(UINT i = 0; i < lightCount; ++i)
+	{
+		const XMVECTOR sphere = XMLoadFloat4(&mViewSpheres[i]);
+		for(UINT cluster = 0; cluster < ClusterCount(); ++cluster)
+		{
+			if(Intersects(cluster, sphere))
+				mPairs.push_back({ cluster, i });
+		}
+	}
+
+	EndBin();
+}
+
+void LightClusters::BeginBin(const Light* lights, UINT lightCount, FXMMATRIX view)
+{
+	mViewSpheres.resize(lightCount);
+	for(UINT i = 0; i < lightCount; ++i)
+	{
+		XMVECTOR posV = XMVector3TransformCoord(XMLoadFloat3(&lights[i].Position), view);
+		XMStoreFloat4(&mViewSpheres[i], XMVectorSetW(posV, lights[i].FalloffEnd));
+	}
+
+	mPairs.clear();
+	mOverflowed = false;
+}
+
+void LightClusters::EndBin()
+{
+	// Counting sort by cluster.  Pairs were added in light order, so each
+	// cluster's indices come out sorted whichever way they were found.
+	for(Range& range : mRanges)
+		range = Range();
+
+	for(const auto& pair : mPairs)
+		mRanges[pair.first].Count++;
+
+	UINT offset = 0;
+	for(UINT cluster = 0; cluster < ClusterCount(); ++cluster)
+	{
+		Range& range = mRanges[cluster];
+		if(offset + range.Count > mMaxLightIndices)
+		{
+			range.Count = mMaxLightIndices - offset;
+			mOverflowed = true;
+		}
+
+		range.Offset = offset;
+		mCursors[cluster] = offset;
+		offset += range.Count;
+	}
+
+	mLightIndices.resize(offset);
+	for(const auto& pair : mPairs)
+	{
+		const Range& range = mRanges[pair.first];
+		UINT& cursor = mCursors[pair.first];
+		if(cursor < range.Offset + range.Count)
+			mLightIndices[cursor++] = pair.second;
+	}
+}
+
+bool LightClusters::Intersects(UINT cluster, FXMVECTOR sphere)const
+{
+	XMVECTOR bmin = XMLoadFloat3(&mClusterMin[cluster]);
+	XMVECTOR bmax = XMLoadFloat3(&mClusterMax[cluster]);
+
+	// Distance from the centre to the closest point of the box.
+	XMVECTOR offset = XMVectorSubtract(sphere, XMVectorClamp(sphere, bmin, bmax));
+	XMVECTOR radius = XMVectorSplatW(sphere);
+
+	return XMVector3LessOrEqual(XMVector3LengthSq(offset), XMVectorMultiply(radius, radius));
+}
+
+UINT LightClusters::TilesX()const
+{
+	return mTilesX;
+}
+
+UINT LightClusters::TilesY()const
+{
+	return mTilesY;
+}
+
+UINT LightClusters::SlicesZ()const
+{
+	return mSlicesZ;
+}
+
+UINT LightClusters::ClusterCount()const
+{
+	return mTilesX*mTilesY*mSlicesZ;
+}
+
+UINT LightClusters::MaxLightIndices()const
+{
+	return mMaxLightIndices;
+}
+
+UINT LightClusters::ClusterIndex(UINT x, UINT y, UINT z)const
+{
+	return (z*mTilesY + y)*mTilesX + x;
+}
+
+UINT LightClusters::SliceFromDepth(float viewZ)const
+{
+	// Matches the shader: slices below the near plane clamp to the first one.
+	const float slice = logf(std::max<float>(viewZ, mNearZ))*mSliceScale + mSliceBias;
+	return std::min<UINT>((UINT)std::max<float>(slice, 0.0f), mSlicesZ - 1);
+}
+
+float LightClusters::SliceScale()const
+{
+	return mSliceScale;
+}
+
+float LightClusters::SliceBias()const
+{
+	return mSliceBias;
+}
+
+const std::vector<LightClusters::Range>& LightClusters::Ranges()const
+{
+	return mRanges;
+}
+
+const std::vector<UINT>& LightClusters::LightIndices()const
+{
+	return mLightIndices;
+}
+
+bool LightClusters::Overflowed()const
+{
+	return mOverflowed;
+}
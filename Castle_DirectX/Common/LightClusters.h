@@ -0,0 +1,100 @@
+//***************************************************************************************
+// LightClusters.h
+//
+// Assigns point and spot lights to the clusters of a view frustum split into
+// TilesX x TilesY screen tiles and SlicesZ exponentially spaced depth slices.  Each
+// light is bounded by a sphere of radius FalloffEnd; Bin tests it against the view
+// space bounds of the clusters it could touch with DirectXMath vectors, and
+// BinReference does the same brute force over every cluster, for validation.
+//
+// The shaders find their cluster from the pixel position and view depth:
+//   tile  = pixel * (TilesX, TilesY) / RenderTargetSize
+//   slice = log(viewZ)*SliceScale() + SliceBias()
+// and read Ranges()[cluster] = (offset, count) into LightIndices().
+//
+// No device is involved, so binning can be timed and checked headless.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class LightClusters
+{
+public:
+	// Light index range of one cluster.
+	struct Range
+	{
+		UINT Offset = 0;
+		UINT Count = 0;
+	};
+
+public:
+	LightClusters(UINT tilesX, UINT tilesY, UINT slicesZ, UINT maxLightIndices);
+	LightClusters(const LightClusters& rhs) = delete;
+	LightClusters& operator=(const LightClusters& rhs) = delete;
+	~LightClusters();
+
+	// Rebuilds the cluster bounds.  Call when the projection changes.
+	void SetProjection(float fovY, float aspect, float nearZ, float farZ);
+
+	// Bins lights[i] (point or spot, world space) as seen through view.  Indices
+	// past MaxLightIndices() are dropped and Overflowed() reports it.
+	void Bin(const Light* lights, UINT lightCount, DirectX::FXMMATRIX view);
+
+	// Same result as Bin, testing every light against every cluster.
+	void BinReference(const Light* lights, UINT lightCount, DirectX::FXMMATRIX view);
+
+	UINT TilesX()const;
+	UINT TilesY()const;
+	UINT SlicesZ()const;
+	UINT ClusterCount()const;
+	UINT MaxLightIndices()const;
+
+	UINT ClusterIndex(UINT x, UINT y, UINT z)const;
+
+	// Depth slice containing view space depth viewZ, clamped to the grid.
+	UINT SliceFromDepth(float viewZ)const;
+	float SliceScale()const;
+	float SliceBias()const;
+
+	const std::vector<Range>& Ranges()const;
+	const std::vector<UINT>& LightIndices()const;
+	bool Overflowed()const;
+
+private:
+	void BeginBin(const Light* lights, UINT lightCount, DirectX::FXMMATRIX view);
+	void EndBin();
+
+	// True when the view space sphere (xyz centre, w radius) touches the cluster bounds.
+	bool Intersects(UINT cluster, DirectX::FXMVECTOR sphere)const;
+
+private:
+	UINT mTilesX = 0;
+	UINT mTilesY = 0;
+	UINT mSlicesZ = 0;
+	UINT mMaxLightIndices = 0;
+
+	float mTanHalfFovX = 1.0f;
+	float mTanHalfFovY = 1.0f;
+	float mNearZ = 1.0f;
+	float mFarZ = 1000.0f;
+	float mSliceScale = 0.0f;
+	float mSliceBias = 0.0f;
+
+	// View depth of each slice boundary; SlicesZ + 1 entries.
+	std::vector<float> mSliceDepths;
+
+	// View space bounds of every cluster.
+	std::vector<DirectX::XMFLOAT3> mClusterMin;
+	std::vector<DirectX::XMFLOAT3> mClusterMax;
+
+	// Scratch kept between frames so binning does not allocate once warm.
+	std::vector<DirectX::XMFLOAT4> mViewSpheres;
+	std::vector<std::pair<UINT, UINT>> mPairs; // (cluster, light)
+	std::vector<UINT> mCursors;
+
+	std::vector<Range> mRanges;
+	std::vector<UINT> mLightIndices;
+	bool mOverflowed = false;
+};
@@ -79,4 +79,28 @@ XMVECTOR MathHelper::RandHemisphereUnitVec3(XMVECTOR n)
 
 		return XMVector3Normalize(v);
 	}
-}
\ No newline at end of file
+}
+
+void MathHelper::TransposeMatrices(XMFLOAT4X4* out, const XMFLOAT4X4* in, size_t count)
+{
+	for(size_t i = 0; i < count; ++i)
+		XMStoreFloat4x4(&out[i], XMMatrixTranspose(XMLoadFloat4x4(&in[i])));
+}
+
+void MathHelper::MultiplyMatrices(XMFLOAT4X4* out, const XMFLOAT4X4* in, size_t count, CXMMATRIX M)
+{
+	for(size_t i = 0; i < count; ++i)
+		XMStoreFloat4x4(&out[i], XMMatrixMultiply(XMLoadFloat4x4(&in[i]), M));
+}
+
+void MathHelper::MultiplyTransposeMatrices(XMFLOAT4X4* out, const XMFLOAT4X4* in, size_t count, CXMMATRIX M)
+{
+	for(size_t i = 0; i < count; ++i)
+		XMStoreFloat4x4(&out[i], XMMatrixTranspose(XMMatrixMultiply(XMLoadFloat4x4(&in[i]), M)));
+}
+
+void MathHelper::TransformPoints(XMFLOAT3* out, const XMFLOAT3* in, size_t count, CXMMATRIX M)
+{
+	for(size_t i = 0; i < count; ++i)
+		XMStoreFloat3(&out[i], XMVector3TransformCoord(XMLoadFloat3(&in[i]), M));
+}
@@ -6,9 +6,12 @@
 
 #pragma once
 
+#if defined(_WIN32)
 #include <Windows.h>
+#endif
 #include <DirectXMath.h>
 #include <cstdint>
+#include <cstdlib>
 
 class MathHelper
 {
@@ -92,6 +95,21 @@ public:
     static DirectX::XMVECTOR RandUnitVec3();
     static DirectX::XMVECTOR RandHemisphereUnitVec3(DirectX::XMVECTOR n);
 
+	// Batch forms of DirectXMath's one at a time operations, for per-frame work over
+	// thousands of objects; out may be the same array as in.  Each element goes
+	// through DirectXMath: SSE on x86 and x64, NEON on ARM.
+
+	// out[i] = transpose(in[i]), the layout the shaders read.
+	static void TransposeMatrices(DirectX::XMFLOAT4X4* out, const DirectX::XMFLOAT4X4* in, size_t count);
+
+	// out[i] = in[i]*M, e.g. world matrices times viewProj.  The Transpose form
+	// stores the transposed product, ready for a shader.
+	static void MultiplyMatrices(DirectX::XMFLOAT4X4* out, const DirectX::XMFLOAT4X4* in, size_t count, DirectX::CXMMATRIX M);
+	static void MultiplyTransposeMatrices(DirectX::XMFLOAT4X4* out, const DirectX::XMFLOAT4X4* in, size_t count, DirectX::CXMMATRIX M);
+
+	// out[i] = XMVector3TransformCoord(in[i], M): points, divided by w.
+	static void TransformPoints(DirectX::XMFLOAT3* out, const DirectX::XMFLOAT3* in, size_t count, DirectX::CXMMATRIX M);
+
 	static const float Infinity;
 	static const float Pi;
 
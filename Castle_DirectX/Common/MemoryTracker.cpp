@@ -0,0 +1,245 @@
+//***************************************************************************************
+// MemoryTracker.cpp
+//***************************************************************************************
+
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	const int CategoryCount = (int)MemoryCategory::Count;
+
+	const char* const gCategoryNames[CategoryCount] =
+	{
+		"texture", "geometry", "upload", "frameResource", "renderTarget", "readback", "cpuBlob", "cpuHeap"
+	};
+
+	struct Allocation
+	{
+		MemoryCategory Category;
+		std::string Name;
+		std::uint64_t Bytes;
+	};
+
+	// Allocations of one category and name, for the report.
+	struct Asset
+	{
+		int Category = 0;
+		std::string Name;
+		std::uint64_t Bytes = 0;
+		std::uint32_t Count = 0;
+	};
+
+	struct CategoryTotals
+	{
+		std::uint64_t Current = 0;
+		std::uint64_t Peak = 0;
+		std::uint32_t Count = 0;
+	};
+
+	struct Registry
+	{
+		std::mutex Mutex;
+		std::unordered_map<const void*, Allocation> Allocations;
+		CategoryTotals Categories[CategoryCount];
+		std::uint64_t Total = 0;
+		std::uint64_t TotalPeak = 0;
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	void RemoveLocked(Registry& registry, const void* key)
+	{
+		auto it = registry.Allocations.find(key);
+		if(it == registry.Allocations.end())
+			return;
+
+		CategoryTotals& totals = registry.Categories[(int)it->second.Category];
+		totals.Current -= it->second.Bytes;
+		totals.Count--;
+		registry.Total -= it->second.Bytes;
+		registry.Allocations.erase(it);
+	}
+
+	double ToMB(std::uint64_t bytes)
+	{
+		return bytes / (1024.0*1024.0);
+	}
+}
+
+void MemoryTracker::Add(const void* key, MemoryCategory category, const std::string& name, std::uint64_t bytes)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	RemoveLocked(registry, key);
+
+	Allocation allocation = { category, name, bytes };
+	registry.Allocations.emplace(key, allocation);
+
+	CategoryTotals& totals = registry.Categories[(int)category];
+	totals.Current += bytes;
+	totals.Peak = std::max<std::uint64_t>(totals.Peak, totals.Current);
+	totals.Count++;
+
+	registry.Total += bytes;
+	registry.TotalPeak = std::max<std::uint64_t>(registry.TotalPeak, registry.Total);
+}
+
+void MemoryTracker::Remove(const void* key)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	RemoveLocked(registry, key);
+}
+
+const char* MemoryTracker::CategoryName(MemoryCategory category)
+{
+	return gCategoryNames[(int)category];
+}
+
+std::uint64_t MemoryTracker::CurrentBytes(MemoryCategory category)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	return registry.Categories[(int)category].Current;
+}
+
+std::uint64_t MemoryTracker::PeakBytes(MemoryCategory category)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	return registry.Categories[(int)category].Peak;
+}
+
+std::uint32_t MemoryTracker::Allocations(MemoryCategory category)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	return registry.Categories[(int)category].Count;
+}
+
+std::uint64_t MemoryTracker::TotalBytes()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	return registry.Total;
+}
+
+std::uint64_t MemoryTracker::TotalPeakBytes()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	return registry.TotalPeak;
+}
+
+std::string MemoryTracker::Report()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(3);
+
+	out << std::left << std::setw(16) << "category" << std::right << std::setw(14) << "current_mb"
+		<< std::setw(14) << "peak_mb" << std::setw(8) << "count" << "\n";
+	for(int i = 0; i < CategoryCount; ++i)
+	{
+		const CategoryTotals& totals = registry.Categories[i];
+		out << std::left << std::setw(16) << gCategoryNames[i] << std::right << std::setw(14) << ToMB(totals.Current)
+			<< std::setw(14) << ToMB(totals.Peak) << std::setw(8) << totals.Count << "\n";
+	}
+	out << std::left << std::setw(16) << "total" << std::right << std::setw(14) << ToMB(registry.Total)
+		<< std::setw(14) << ToMB(registry.TotalPeak) << std::setw(8) << registry.Allocations.size() << "\n";
+
+	// Allocations sharing a name (e.g. one per frame resource) are summed.
+	std::map<std::pair<int, std::string>, Asset> grouped;
+	for(const auto& entry : registry.Allocations)
+	{
+		Asset& asset = grouped[std::make_pair((int)entry.second.Category, entry.second.Name)];
+		asset.Category = (int)entry.second.Category;
+		asset.Name = entry.second.Name;
+		asset.Bytes += entry.second.Bytes;
+		asset.Count++;
+	}
+
+	std::vector<Asset> assets;
+	for(const auto& entry : grouped)
+		assets.push_back(entry.second);
+
+	std::stable_sort(assets.begin(), assets.end(), [](const Asset& a, const Asset& b)
+	{
+		if(a.Category != b.Category)
+			return a.Category < b.Category;
+		return a.Bytes > b.Bytes;
+	});
+
+	out << "\n";
+	for(const Asset& asset : assets)
+	{
+		out << std::left << std::setw(16) << gCategoryNames[asset.Category] << std::setw(32) << asset.Name
+			<< std::right << std::setw(12) << ToMB(asset.Bytes) << " MB";
+		if(asset.Count > 1)
+			out << "  x" << asset.Count;
+		out << "\n";
+	}
+
+	return out.str();
+}
+
+bool MemoryTracker::WriteReport(const std::wstring& filename)
+{
+	std::ofstream fout(filename);
+	if(!fout)
+		return false;
+
+	fout << Report();
+	return (bool)fout;
+}
+
+std::string MemoryTracker::ToJson()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(3);
+
+	out << "{ ";
+	for(int i = 0; i < CategoryCount; ++i)
+	{
+		const CategoryTotals& totals = registry.Categories[i];
+		out << "\"" << gCategoryNames[i] << "\": { \"current_mb\": " << ToMB(totals.Current)
+			<< ", \"peak_mb\": " << ToMB(totals.Peak) << ", \"count\": " << totals.Count << " }, ";
+	}
+	out << "\"total\": { \"current_mb\": " << ToMB(registry.Total) << ", \"peak_mb\": " << ToMB(registry.TotalPeak)
+		<< ", \"count\": " << registry.Allocations.size() << " } }";
+
+	return out.str();
+}
+
+void MemoryTracker::Reset()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	registry.Allocations.clear();
+	for(CategoryTotals& totals : registry.Categories)
+		totals = CategoryTotals();
+	registry.Total = 0;
+	registry.TotalPeak = 0;
+}
@@ -0,0 +1,58 @@
+//***************************************************************************************
+// MemoryTracker.h
+//
+// Running totals of what the app has allocated, by category and by asset name.  Each
+// allocation is registered under a key (the resource or blob pointer) and removed
+// with it; d3dUtil::TrackResource and d3dUtil::CreateBlob do both for D3D objects.
+// Keeps the current bytes, the peak and the count of every category, and the
+// allocations themselves for a per-asset breakdown.  No Windows or D3D dependency.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+enum class MemoryCategory : int
+{
+	Texture = 0,
+	Geometry,
+	Upload,        // upload heaps of textures and geometry
+	FrameResource, // per-frame constant, structured and dynamic vertex buffers
+	RenderTarget,  // swap chain and depth buffers
+	Readback,
+	CpuBlob,       // system memory copies of geometry and shader bytecode
+	CpuHeap,       // simulation and other large CPU arrays
+	Count
+};
+
+class MemoryTracker
+{
+public:
+	// Registers bytes under key, replacing anything key already had.
+	static void Add(const void* key, MemoryCategory category, const std::string& name, std::uint64_t bytes);
+
+	// Forgets key; unknown keys are ignored.
+	static void Remove(const void* key);
+
+	static const char* CategoryName(MemoryCategory category);
+
+	static std::uint64_t CurrentBytes(MemoryCategory category);
+	static std::uint64_t PeakBytes(MemoryCategory category);
+	static std::uint32_t Allocations(MemoryCategory category);
+
+	// Over all categories; the peak is of the sum, not the sum of the peaks.
+	static std::uint64_t TotalBytes();
+	static std::uint64_t TotalPeakBytes();
+
+	// A table per category, then the live allocations grouped by category and name,
+	// largest first.
+	static std::string Report();
+	static bool WriteReport(const std::wstring& filename);
+
+	// { "texture": { "current_mb": .., "peak_mb": .., "count": .. }, .. }
+	static std::string ToJson();
+
+	// Forgets every allocation and peak.
+	static void Reset();
+};
@@ -0,0 +1,154 @@
+//***************************************************************************************
+// MicroBenchmark.cpp
+//***************************************************************************************
+
+#include "MicroBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	const std::uint64_t MaxIterations = (std::uint64_t)1 << 30;
+
+	volatile const void* gSink = nullptr;
+
+	double ElapsedNs(const std::function<void()>& body, std::uint64_t iterations)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for(std::uint64_t i = 0; i < iterations; ++i)
+			body();
+		const auto end = std::chrono::steady_clock::now();
+
+		return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	}
+}
+
+MicroBenchmark::MicroBenchmark(const Options& options)
+	: mOptions(options)
+{
+}
+
+const MicroBenchmark::Result& MicroBenchmark::Run(const std::string& name, const std::function<void()>& body)
+{
+	const double minSampleNs = mOptions.MinSampleMs*1.0e6;
+
+	std::uint64_t iterations = 1;
+	while(iterations < MaxIterations && ElapsedNs(body, iterations) < minSampleNs)
+		iterations *= 2;
+
+	for(int i = 0; i < mOptions.WarmupSamples; ++i)
+		ElapsedNs(body, iterations);
+
+	std::vector<double> samples(std::max<int>(mOptions.Samples, 1));
+	for(double& sample : samples)
+		sample = ElapsedNs(body, iterations) / iterations;
+
+	Result result;
+	result.Name = name;
+	result.Iterations = iterations;
+	result.Samples = (int)samples.size();
+	result.MedianNs = Median(samples);
+	result.MadNs = MedianAbsoluteDeviation(samples, result.MedianNs);
+	result.MinNs = *std::min_element(samples.begin(), samples.end());
+	result.MaxNs = *std::max_element(samples.begin(), samples.end());
+
+	mResults.push_back(result);
+	return mResults.back();
+}
+
+const std::vector<MicroBenchmark::Result>& MicroBenchmark::Results()const
+{
+	return mResults;
+}
+
+std::string MicroBenchmark::ToJson()const
+{
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(1);
+
+	out << "{\n";
+	out << "  \"options\": { \"warmup_samples\": " << mOptions.WarmupSamples << ", \"samples\": " << mOptions.Samples
+		<< ", \"min_sample_ms\": " << mOptions.MinSampleMs << " },\n";
+	out << "  \"results\": [\n";
+	for(size_t i = 0; i < mResults.size(); ++i)
+	{
+		const Result& r = mResults[i];
+		out << "    { \"name\": \"" << r.Name << "\", \"median_ns\": " << r.MedianNs << ", \"mad_ns\": " << r.MadNs
+			<< ", \"min_ns\": " << r.MinNs << ", \"max_ns\": " << r.MaxNs << ", \"iterations\": " << r.Iterations
+			<< ", \"samples\": " << r.Samples << " }" << (i + 1 == mResults.size() ? "\n" : ",\n");
+	}
+	out << "  ]\n";
+	out << "}\n";
+
+	return out.str();
+}
+
+std::string MicroBenchmark::ToText()const
+{
+	size_t width = 4;
+	for(const Result& r : mResults)
+		width = std::max<size_t>(width, r.Name.size());
+
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(1);
+
+	out << std::string(width - 4, ' ') << "case      median_ns         mad_ns    mad%\n";
+	for(const Result& r : mResults)
+	{
+		out << std::string(width - r.Name.size(), ' ') << r.Name << ' ';
+		out.width(14);
+		out << r.MedianNs << ' ';
+		out.width(14);
+		out << r.MadNs << ' ';
+		out.width(7);
+		out << (r.MedianNs > 0.0 ? 100.0*r.MadNs / r.MedianNs : 0.0) << '\n';
+	}
+
+	return out.str();
+}
+
+bool MicroBenchmark::Write(const std::wstring& filename)const
+{
+	std::ofstream fout(filename);
+	if(!fout)
+		return false;
+
+	const bool text = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, L".txt") == 0;
+	fout << (text ? ToText() : ToJson());
+
+	return (bool)fout;
+}
+
+void MicroBenchmark::Consume(const void* p)
+{
+	gSink = p;
+}
+
+double MicroBenchmark::Median(std::vector<double> values)
+{
+	if(values.empty())
+		return 0.0;
+
+	const size_t middle = values.size() / 2;
+	std::nth_element(values.begin(), values.begin() + middle, values.end());
+	const double upper = values[middle];
+	if(values.size() % 2 == 1)
+		return upper;
+
+	const double lower = *std::max_element(values.begin(), values.begin() + middle);
+	return 0.5*(lower + upper);
+}
+
+double MicroBenchmark::MedianAbsoluteDeviation(const std::vector<double>& values, double median)
+{
+	std::vector<double> deviations(values.size());
+	for(size_t i = 0; i < values.size(); ++i)
+		deviations[i] = std::fabs(values[i] - median);
+
+	return Median(deviations);
+}
@@ -0,0 +1,69 @@
+//***************************************************************************************
+// MicroBenchmark.h
+//
+// Times small pieces of CPU code for comparison across builds.  Each case is first
+// calibrated: the body is repeated, doubling the count, until one sample takes at
+// least MinSampleMs.  Then some warm up samples are thrown away, and Samples more are
+// timed.  A case reports the median time per call and the median absolute deviation
+// (MAD), which ignore the odd preempted sample in a way the mean and standard
+// deviation do not.  No Windows or D3D dependency.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class MicroBenchmark
+{
+public:
+	struct Options
+	{
+		int WarmupSamples = 3;
+		int Samples = 31;
+		double MinSampleMs = 2.0;
+	};
+
+	struct Result
+	{
+		std::string Name;
+		std::uint64_t Iterations; // calls per sample
+		int Samples;
+		double MedianNs;          // per call
+		double MadNs;
+		double MinNs;
+		double MaxNs;
+	};
+
+	MicroBenchmark() = default;
+	explicit MicroBenchmark(const Options& options);
+	MicroBenchmark(const MicroBenchmark& rhs) = delete;
+	MicroBenchmark& operator=(const MicroBenchmark& rhs) = delete;
+
+	// Times body and appends a result.  Setup belongs outside body; anything body
+	// computes should go through Consume so the optimizer cannot drop it.
+	const Result& Run(const std::string& name, const std::function<void()>& body);
+
+	const std::vector<Result>& Results()const;
+
+	// { "options": {..}, "results": [ { "name": .., "median_ns": .., .. }, .. ] }
+	std::string ToJson()const;
+
+	// One aligned line per case.
+	std::string ToText()const;
+
+	// JSON, or text when the extension is .txt.
+	bool Write(const std::wstring& filename)const;
+
+	// Keeps a value alive as far as the optimizer can tell.
+	static void Consume(const void* p);
+
+	static double Median(std::vector<double> values);
+	static double MedianAbsoluteDeviation(const std::vector<double>& values, double median);
+
+private:
+	Options mOptions;
+	std::vector<Result> mResults;
+};
@@ -0,0 +1,437 @@
+//***************************************************************************************
+// NullRenderContext.cpp
+//***************************************************************************************
+
+#include "NullRenderContext.h"
+#include <cstring>
+
+namespace
+{
+	// Reads back what NullRenderContext::Write* appended.
+	class StreamReader
+	{
+	public:
+		StreamReader(const std::vector<std::uint8_t>& stream)
+			: mData(stream.data()), mEnd(stream.data() + stream.size())
+		{
+		}
+
+		bool AtEnd()const { return mData >= mEnd; }
+
+		std::uint8_t U8() { return *mData++; }
+
+		std::uint32_t U32()
+		{
+			std::uint32_t value;
+			memcpy(&value, mData, sizeof(value));
+			mData += sizeof(value);
+			return value;
+		}
+
+		std::uint64_t U64()
+		{
+			std::uint64_t value;
+			memcpy(&value, mData, sizeof(value));
+			mData += sizeof(value);
+			return value;
+		}
+
+		float Float()
+		{
+			float value;
+			memcpy(&value, mData, sizeof(value));
+			mData += sizeof(value);
+			return value;
+		}
+
+	private:
+		const std::uint8_t* mData;
+		const std::uint8_t* mEnd;
+	};
+
+	void WriteHex(std::ostream& out, std::uint64_t value)
+	{
+		const auto flags = out.flags();
+		out << " 0x" << std::hex << value;
+		out.flags(flags);
+	}
+}
+
+NullRenderContext::NullRenderContext()
+{
+	// Enough for the castle frame so recording does not grow the stream.
+	mStream.reserve(64*1024);
+}
+
+void NullRenderContext::Reset()
+{
+	mStream.clear();
+	mStats = RenderStats();
+}
+
+const RenderStats& NullRenderContext::Stats()const
+{
+	return mStats;
+}
+
+const std::vector<std::uint8_t>& NullRenderContext::Stream()const
+{
+	return mStream;
+}
+
+void NullRenderContext::SetPipelineState(ID3D12PipelineState* pso)
+{
+	BeginCommand(Op::SetPipelineState);
+	WritePointer(pso);
+	mStats.PipelineBinds++;
+}
+
+void NullRenderContext::SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+	BeginCommand(Op::SetGraphicsRootSignature);
+	WritePointer(rootSignature);
+	mStats.RootSignatureBinds++;
+}
+
+void NullRenderContext::SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps)
+{
+	BeginCommand(Op::SetDescriptorHeaps);
+	WriteU32(count);
+	for(UINT i = 0; i < count; ++i)
+		WritePointer(heaps[i]);
+	mStats.DescriptorHeapBinds++;
+}
+
+void NullRenderContext::SetViewport(const D3D12_VIEWPORT& viewport)
+{
+	BeginCommand(Op::SetViewport);
+	WriteFloat(viewport.TopLeftX);
+	WriteFloat(viewport.TopLeftY);
+	WriteFloat(viewport.Width);
+	WriteFloat(viewport.Height);
+	WriteFloat(viewport.MinDepth);
+	WriteFloat(viewport.MaxDepth);
+}
+
+void NullRenderContext::SetScissorRect(const D3D12_RECT& rect)
+{
+	BeginCommand(Op::SetScissorRect);
+	WriteU32((std::uint32_t)rect.left);
+	WriteU32((std::uint32_t)rect.top);
+	WriteU32((std::uint32_t)rect.right);
+	WriteU32((std::uint32_t)rect.bottom);
+}
+
+void NullRenderContext::SetRenderTargets(UINT count, const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargets,
+	const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencil)
+{
+	BeginCommand(Op::SetRenderTargets);
+	WriteU32(count);
+	for(UINT i = 0; i < count; ++i)
+		WriteU64(renderTargets[i].ptr);
+	WriteU64(depthStencil != nullptr ? depthStencil->ptr : 0);
+	mStats.RenderTargetBinds++;
+}
+
+void NullRenderContext::ClearRenderTarget(D3D12_CPU_DESCRIPTOR_HANDLE renderTarget, const float color[4])
+{
+	BeginCommand(Op::ClearRenderTarget);
+	WriteU64(renderTarget.ptr);
+	for(int i = 0; i < 4; ++i)
+		WriteFloat(color[i]);
+	mStats.Clears++;
+}
+
+void NullRenderContext::ClearDepthStencil(D3D12_CPU_DESCRIPTOR_HANDLE depthStencil, float depth, UINT8 stencil)
+{
+	BeginCommand(Op::ClearDepthStencil);
+	WriteU64(depthStencil.ptr);
+	WriteFloat(depth);
+	Write(&stencil, sizeof(stencil));
+	mStats.Clears++;
+}
+
+void NullRenderContext::Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+{
+	BeginCommand(Op::Transition);
+	WritePointer(resource);
+	WriteU32((std::uint32_t)before);
+	WriteU32((std::uint32_t)after);
+	mStats.Barriers++;
+}
+
+void NullRenderContext::SetGraphicsRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE table)
+{
+	BeginCommand(Op::SetGraphicsRootDescriptorTable);
+	WriteU32(rootIndex);
+	WriteU64(table.ptr);
+	mStats.DescriptorTableBinds++;
+}
+
+void NullRenderContext::SetGraphicsRoot32BitConstants(UINT rootIndex, UINT count, const void* data, UINT offset)
+{
+	BeginCommand(Op::SetGraphicsRoot32BitConstants);
+	WriteU32(rootIndex);
+	WriteU32(count);
+	WriteU32(offset);
+	Write(data, count*sizeof(std::uint32_t));
+	mStats.RootConstantBinds++;
+}
+
+void NullRenderContext::SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	BeginCommand(Op::SetGraphicsRootConstantBufferView);
+	WriteU32(rootIndex);
+	WriteU64(address);
+	mStats.RootBufferBinds++;
+}
+
+void NullRenderContext::SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	BeginCommand(Op::SetGraphicsRootShaderResourceView);
+	WriteU32(rootIndex);
+	WriteU64(address);
+	mStats.RootBufferBinds++;
+}
+
+void NullRenderContext::SetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+	BeginCommand(Op::SetVertexBuffers);
+	WriteU32(startSlot);
+	WriteU32(count);
+	for(UINT i = 0; i < count; ++i)
+	{
+		WriteU64(views[i].BufferLocation);
+		WriteU32(views[i].SizeInBytes);
+		WriteU32(views[i].StrideInBytes);
+	}
+	mStats.VertexBufferBinds++;
+}
+
+void NullRenderContext::SetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view)
+{
+	BeginCommand(Op::SetIndexBuffer);
+	WriteU64(view.BufferLocation);
+	WriteU32(view.SizeInBytes);
+	WriteU32((std::uint32_t)view.Format);
+	mStats.IndexBufferBinds++;
+}
+
+void NullRenderContext::SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+	BeginCommand(Op::SetPrimitiveTopology);
+	WriteU32((std::uint32_t)topology);
+	mStats.TopologyChanges++;
+}
+
+void NullRenderContext::DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance)
+{
+	BeginCommand(Op::DrawInstanced);
+	WriteU32(vertexCount);
+	WriteU32(instanceCount);
+	WriteU32(startVertex);
+	WriteU32(startInstance);
+	mStats.Draws++;
+	mStats.Instances += instanceCount;
+}
+
+void NullRenderContext::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex,
+	INT baseVertex, UINT startInstance)
+{
+	BeginCommand(Op::DrawIndexedInstanced);
+	WriteU32(indexCount);
+	WriteU32(instanceCount);
+	WriteU32(startIndex);
+	WriteU32((std::uint32_t)baseVertex);
+	WriteU32(startInstance);
+	mStats.Draws++;
+	mStats.Instances += instanceCount;
+}
+
+void NullRenderContext::WriteTimestamp(ID3D12QueryHeap* queryHeap, UINT index)
+{
+	BeginCommand(Op::WriteTimestamp);
+	WritePointer(queryHeap);
+	WriteU32(index);
+	mStats.Queries++;
+}
+
+void NullRenderContext::ResolveTimestamps(ID3D12QueryHeap* queryHeap, UINT startIndex, UINT count,
+	ID3D12Resource* destination, UINT64 destinationOffset)
+{
+	BeginCommand(Op::ResolveTimestamps);
+	WritePointer(queryHeap);
+	WriteU32(startIndex);
+	WriteU32(count);
+	WritePointer(destination);
+	WriteU64(destinationOffset);
+	mStats.Queries++;
+}
+
+void NullRenderContext::WriteText(std::ostream& out)const
+{
+	StreamReader in(mStream);
+	while(!in.AtEnd())
+	{
+		switch((Op)in.U8())
+		{
+		case Op::SetPipelineState:
+			out << "SetPipelineState";
+			WriteHex(out, in.U64());
+			break;
+		case Op::SetGraphicsRootSignature:
+			out << "SetGraphicsRootSignature";
+			WriteHex(out, in.U64());
+			break;
+		case Op::SetDescriptorHeaps:
+		{
+			out << "SetDescriptorHeaps";
+			const std::uint32_t count = in.U32();
+			for(std::uint32_t i = 0; i < count; ++i)
+				WriteHex(out, in.U64());
+			break;
+		}
+		case Op::SetViewport:
+			out << "SetViewport";
+			for(int i = 0; i < 6; ++i)
+				out << ' ' << in.Float();
+			break;
+		case Op::SetScissorRect:
+			out << "SetScissorRect";
+			for(int i = 0; i < 4; ++i)
+				out << ' ' << (std::int32_t)in.U32();
+			break;
+		case Op::SetRenderTargets:
+		{
+			out << "SetRenderTargets";
+			const std::uint32_t count = in.U32();
+			for(std::uint32_t i = 0; i <= count; ++i)
+				WriteHex(out, in.U64());
+			break;
+		}
+		case Op::ClearRenderTarget:
+			out << "ClearRenderTarget";
+			WriteHex(out, in.U64());
+			for(int i = 0; i < 4; ++i)
+				out << ' ' << in.Float();
+			break;
+		case Op::ClearDepthStencil:
+			out << "ClearDepthStencil";
+			WriteHex(out, in.U64());
+			out << ' ' << in.Float();
+			out << ' ' << (std::uint32_t)in.U8();
+			break;
+		case Op::Transition:
+			out << "Transition";
+			WriteHex(out, in.U64());
+			WriteHex(out, in.U32());
+			WriteHex(out, in.U32());
+			break;
+		case Op::SetGraphicsRootDescriptorTable:
+			out << "SetGraphicsRootDescriptorTable " << in.U32();
+			WriteHex(out, in.U64());
+			break;
+		case Op::SetGraphicsRoot32BitConstants:
+		{
+			out << "SetGraphicsRoot32BitConstants " << in.U32();
+			const std::uint32_t count = in.U32();
+			out << ' ' << count << ' ' << in.U32();
+			for(std::uint32_t i = 0; i < count; ++i)
+				WriteHex(out, in.U32());
+			break;
+		}
+		case Op::SetGraphicsRootConstantBufferView:
+			out << "SetGraphicsRootConstantBufferView " << in.U32();
+			WriteHex(out, in.U64());
+			break;
+		case Op::SetGraphicsRootShaderResourceView:
+			out << "SetGraphicsRootShaderResourceView " << in.U32();
+			WriteHex(out, in.U64());
+			break;
+		case Op::SetVertexBuffers:
+		{
+			out << "SetVertexBuffers " << in.U32();
+			const std::uint32_t count = in.U32();
+			for(std::uint32_t i = 0; i < count; ++i)
+			{
+				WriteHex(out, in.U64());
+				out << ' ' << in.U32();
+				out << ' ' << in.U32();
+			}
+			break;
+		}
+		case Op::SetIndexBuffer:
+			out << "SetIndexBuffer";
+			WriteHex(out, in.U64());
+			out << ' ' << in.U32();
+			out << ' ' << in.U32();
+			break;
+		case Op::SetPrimitiveTopology:
+			out << "SetPrimitiveTopology " << in.U32();
+			break;
+		case Op::DrawInstanced:
+			out << "DrawInstanced";
+			for(int i = 0; i < 4; ++i)
+				out << ' ' << in.U32();
+			break;
+		case Op::DrawIndexedInstanced:
+			out << "DrawIndexedInstanced";
+			out << ' ' << in.U32();
+			out << ' ' << in.U32();
+			out << ' ' << in.U32();
+			out << ' ' << (std::int32_t)in.U32();
+			out << ' ' << in.U32();
+			break;
+		case Op::WriteTimestamp:
+			out << "WriteTimestamp";
+			WriteHex(out, in.U64());
+			out << ' ' << in.U32();
+			break;
+		case Op::ResolveTimestamps:
+			out << "ResolveTimestamps";
+			WriteHex(out, in.U64());
+			out << ' ' << in.U32();
+			out << ' ' << in.U32();
+			WriteHex(out, in.U64());
+			out << ' ' << in.U64();
+			break;
+		default:
+			out << "<corrupt stream>\n";
+			return;
+		}
+
+		out << '\n';
+	}
+}
+
+void NullRenderContext::BeginCommand(Op op)
+{
+	mStream.push_back((std::uint8_t)op);
+	mStats.Commands++;
+}
+
+void NullRenderContext::Write(const void* data, size_t size)
+{
+	const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+	mStream.insert(mStream.end(), bytes, bytes + size);
+}
+
+void NullRenderContext::WriteU32(std::uint32_t value)
+{
+	Write(&value, sizeof(value));
+}
+
+void NullRenderContext::WriteU64(std::uint64_t value)
+{
+	Write(&value, sizeof(value));
+}
+
+void NullRenderContext::WritePointer(const void* p)
+{
+	WriteU64((std::uint64_t)(uintptr_t)p);
+}
+
+void NullRenderContext::WriteFloat(float value)
+{
+	Write(&value, sizeof(value));
+}
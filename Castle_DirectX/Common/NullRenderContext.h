@@ -0,0 +1,102 @@
+//***************************************************************************************
+// NullRenderContext.h
+//
+// A RenderContext that submits nothing.  Each call is appended to a byte stream as a
+// one byte opcode followed by its arguments (pointers and GPU addresses as 64-bit
+// values), and counted.  Used to measure the CPU cost of recording a frame without a
+// swap chain, and to compare the command streams of two runs.
+//
+// Only command recording is replaced.  The pointers and GPU addresses recorded are
+// those of real resources, root signatures, PSOs and descriptor heaps, so a D3D12
+// device (WARP at least) is still created and needed.
+//***************************************************************************************
+
+#pragma once
+
+#include "RenderContext.h"
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+class NullRenderContext : public RenderContext
+{
+public:
+	NullRenderContext();
+	NullRenderContext(const NullRenderContext& rhs) = delete;
+	NullRenderContext& operator=(const NullRenderContext& rhs) = delete;
+
+	// Starts a new frame: empties the stream (keeping its capacity) and zeroes the stats.
+	void Reset();
+
+	const RenderStats& Stats()const;
+	const std::vector<std::uint8_t>& Stream()const;
+
+	// Decodes the stream as one command per line, for diffing recorded frames.
+	void WriteText(std::ostream& out)const;
+
+	virtual void SetPipelineState(ID3D12PipelineState* pso)override;
+	virtual void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)override;
+	virtual void SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps)override;
+
+	virtual void SetViewport(const D3D12_VIEWPORT& viewport)override;
+	virtual void SetScissorRect(const D3D12_RECT& rect)override;
+	virtual void SetRenderTargets(UINT count, const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargets,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencil)override;
+
+	virtual void ClearRenderTarget(D3D12_CPU_DESCRIPTOR_HANDLE renderTarget, const float color[4])override;
+	virtual void ClearDepthStencil(D3D12_CPU_DESCRIPTOR_HANDLE depthStencil, float depth, UINT8 stencil)override;
+	virtual void Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)override;
+
+	virtual void SetGraphicsRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE table)override;
+	virtual void SetGraphicsRoot32BitConstants(UINT rootIndex, UINT count, const void* data, UINT offset)override;
+	virtual void SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)override;
+	virtual void SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)override;
+
+	virtual void SetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views)override;
+	virtual void SetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view)override;
+	virtual void SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)override;
+
+	virtual void DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance)override;
+	virtual void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex,
+		INT baseVertex, UINT startInstance)override;
+
+	virtual void WriteTimestamp(ID3D12QueryHeap* queryHeap, UINT index)override;
+	virtual void ResolveTimestamps(ID3D12QueryHeap* queryHeap, UINT startIndex, UINT count,
+		ID3D12Resource* destination, UINT64 destinationOffset)override;
+
+private:
+	enum class Op : std::uint8_t
+	{
+		SetPipelineState,
+		SetGraphicsRootSignature,
+		SetDescriptorHeaps,
+		SetViewport,
+		SetScissorRect,
+		SetRenderTargets,
+		ClearRenderTarget,
+		ClearDepthStencil,
+		Transition,
+		SetGraphicsRootDescriptorTable,
+		SetGraphicsRoot32BitConstants,
+		SetGraphicsRootConstantBufferView,
+		SetGraphicsRootShaderResourceView,
+		SetVertexBuffers,
+		SetIndexBuffer,
+		SetPrimitiveTopology,
+		DrawInstanced,
+		DrawIndexedInstanced,
+		WriteTimestamp,
+		ResolveTimestamps,
+	};
+
+	void BeginCommand(Op op);
+	void Write(const void* data, size_t size);
+	void WriteU32(std::uint32_t value);
+	void WriteU64(std::uint64_t value);
+	void WritePointer(const void* p);
+	void WriteFloat(float value);
+
+private:
+	std::vector<std::uint8_t> mStream;
+	RenderStats mStats;
+};
@@ -0,0 +1,201 @@
+//***************************************************************************************
+// OverlayBatch.cpp
+//***************************************************************************************
+
+#include "OverlayBatch.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT GlyphCount = OverlayBatch::LastChar - OverlayBatch::FirstChar + 1;
+
+	// The glyphs, then one solid cell for rectangles.
+	const UINT SolidCell = GlyphCount;
+	const UINT AtlasRows = (GlyphCount + 1 + OverlayBatch::AtlasColumns - 1) / OverlayBatch::AtlasColumns;
+}
+
+OverlayBatch::OverlayBatch(UINT maxQuads)
+	: mVertices(maxQuads*6)
+{
+}
+
+FontAtlas OverlayBatch::CreateFontAtlas(const wchar_t* faceName, int pixelHeight)
+{
+	HDC dc = CreateCompatibleDC(nullptr);
+	if(dc == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
+	// Grayscale antialiasing; ClearType would leave colour fringes in the coverage.
+	HFONT font = CreateFontW(-pixelHeight, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, ANSI_CHARSET,
+		OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, FIXED_PITCH | FF_MODERN, faceName);
+	HGDIOBJ oldFont = SelectObject(dc, font);
+
+	TEXTMETRICW metrics = {};
+	GetTextMetricsW(dc, &metrics);
+
+	FontAtlas atlas;
+	atlas.CellWidth = (UINT)metrics.tmAveCharWidth;
+	atlas.CellHeight = (UINT)metrics.tmHeight;
+	atlas.Width = atlas.CellWidth*AtlasColumns;
+	atlas.Height = atlas.CellHeight*AtlasRows;
+
+	// Top-down 32-bit DIB, so row 0 is the top of the atlas.
+	BITMAPINFO info = {};
+	info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	info.bmiHeader.biWidth = (LONG)atlas.Width;
+	info.bmiHeader.biHeight = -(LONG)atlas.Height;
+	info.bmiHeader.biPlanes = 1;
+	info.bmiHeader.biBitCount = 32;
+	info.bmiHeader.biCompression = BI_RGB;
+
+	void* bits = nullptr;
+	HBITMAP bitmap = CreateDIBSection(dc, &info, DIB_RGB_COLORS, &bits, nullptr, 0);
+	if(bitmap == nullptr)
+	{
+		const HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+		SelectObject(dc, oldFont);
+		DeleteObject(font);
+		DeleteDC(dc);
+		ThrowIfFailed(hr);
+	}
+	HGDIOBJ oldBitmap = SelectObject(dc, bitmap);
+
+	PatBlt(dc, 0, 0, (int)atlas.Width, (int)atlas.Height, BLACKNESS);
+	SetTextColor(dc, RGB(255, 255, 255));
+	SetBkMode(dc, TRANSPARENT);
+
+	for(UINT i = 0; i < GlyphCount; ++i)
+	{
+		const char c = (char)(FirstChar + i);
+		TextOutA(dc, (int)((i % AtlasColumns)*atlas.CellWidth), (int)((i / AtlasColumns)*atlas.CellHeight), &c, 1);
+	}
+	GdiFlush();
+
+	// White text on black: any colour channel is the coverage.
+	const BYTE* bgra = static_cast<const BYTE*>(bits);
+	atlas.Pixels.resize(atlas.Width*atlas.Height);
+	for(size_t i = 0; i < atlas.Pixels.size(); ++i)
+		atlas.Pixels[i] = bgra[4*i + 1];
+
+	const UINT solidX = (SolidCell % AtlasColumns)*atlas.CellWidth;
+	const UINT solidY = (SolidCell / AtlasColumns)*atlas.CellHeight;
+	for(UINT y = solidY; y < solidY + atlas.CellHeight; ++y)
+		std::fill_n(&atlas.Pixels[y*atlas.Width + solidX], atlas.CellWidth, (BYTE)255);
+
+	SelectObject(dc, oldBitmap);
+	SelectObject(dc, oldFont);
+	DeleteObject(bitmap);
+	DeleteObject(font);
+	DeleteDC(dc);
+
+	return atlas;
+}
+
+void OverlayBatch::SetFont(const FontAtlas& atlas)
+{
+	mCellWidth = (float)atlas.CellWidth;
+	mCellHeight = (float)atlas.CellHeight;
+}
+
+float OverlayBatch::CharWidth()const
+{
+	return mCellWidth;
+}
+
+float OverlayBatch::LineHeight()const
+{
+	return mCellHeight;
+}
+
+void OverlayBatch::Clear()
+{
+	mVertexCount = 0;
+	mDroppedQuads = 0;
+}
+
+void OverlayBatch::AddRect(float x, float y, float width, float height, UINT color)
+{
+	// Every vertex loads the same texel in the middle of the solid cell.
+	const float u = CellU(SolidCell) + 0.5f*mCellWidth;
+	const float v = CellV(SolidCell) + 0.5f*mCellHeight;
+	AddQuad(x, y, x + width, y + height, u, v, u, v, color);
+}
+
+float OverlayBatch::AddText(float x, float y, const char* text, UINT color)
+{
+	// Whole pixels, so each texel lands on one pixel.
+	float penX = floorf(x);
+	float penY = floorf(y);
+
+	for(const char* c = text; *c != '\0'; ++c)
+	{
+		if(*c == '\n')
+		{
+			penX = floorf(x);
+			penY += mCellHeight;
+			continue;
+		}
+
+		if(*c != ' ')
+		{
+			const UINT cell = (*c >= FirstChar && *c <= LastChar) ? (UINT)(*c - FirstChar) : (UINT)('?' - FirstChar);
+			const float u = CellU(cell);
+			const float v = CellV(cell);
+			AddQuad(penX, penY, penX + mCellWidth, penY + mCellHeight, u, v, u + mCellWidth, v + mCellHeight, color);
+		}
+
+		penX += mCellWidth;
+	}
+
+	return penX;
+}
+
+const OverlayVertex* OverlayBatch::Vertices()const
+{
+	return mVertices.data();
+}
+
+UINT OverlayBatch::VertexCount()const
+{
+	return mVertexCount;
+}
+
+UINT OverlayBatch::DroppedQuads()const
+{
+	return mDroppedQuads;
+}
+
+UINT OverlayBatch::Rgba(BYTE r, BYTE g, BYTE b, BYTE a)
+{
+	return (UINT)r | ((UINT)g << 8) | ((UINT)b << 16) | ((UINT)a << 24);
+}
+
+void OverlayBatch::AddQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, UINT color)
+{
+	if(mVertexCount + 6 > (UINT)mVertices.size())
+	{
+		mDroppedQuads++;
+		return;
+	}
+
+	OverlayVertex* v = &mVertices[mVertexCount];
+	v[0] = { XMFLOAT2(x0, y0), XMFLOAT2(u0, v0), color };
+	v[1] = { XMFLOAT2(x1, y0), XMFLOAT2(u1, v0), color };
+	v[2] = { XMFLOAT2(x0, y1), XMFLOAT2(u0, v1), color };
+	v[3] = v[2];
+	v[4] = v[1];
+	v[5] = { XMFLOAT2(x1, y1), XMFLOAT2(u1, v1), color };
+	mVertexCount += 6;
+}
+
+float OverlayBatch::CellU(UINT cell)const
+{
+	return (cell % AtlasColumns)*mCellWidth;
+}
+
+float OverlayBatch::CellV(UINT cell)const
+{
+	return (cell / AtlasColumns)*mCellHeight;
+}
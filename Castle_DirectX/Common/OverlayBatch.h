@@ -0,0 +1,81 @@
+//***************************************************************************************
+// OverlayBatch.h
+//
+// Screen-space text and rectangles for debug overlays, batched into one triangle
+// list.  Text uses a fixed-pitch font atlas rendered with GDI at startup; the atlas
+// also has a solid cell, so rectangles share the vertices, texture and PSO of the
+// text and a whole overlay is a single draw.  Positions are in pixels from the
+// top-left corner.  The vertices are allocated once, so a frame's text does not
+// allocate; quads past the capacity are dropped and counted.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+// Texture coordinates are in atlas texels; the pixel shader loads rather than samples.
+struct OverlayVertex
+{
+	DirectX::XMFLOAT2 Pos;
+	DirectX::XMFLOAT2 TexC;
+	UINT Color; // R8G8B8A8_UNORM
+};
+
+// Coverage in one byte per texel (R8_UNORM), AtlasColumns glyph cells per row.
+struct FontAtlas
+{
+	UINT Width = 0;
+	UINT Height = 0;
+	UINT CellWidth = 0;
+	UINT CellHeight = 0;
+	std::vector<BYTE> Pixels;
+};
+
+class OverlayBatch
+{
+public:
+	explicit OverlayBatch(UINT maxQuads);
+	OverlayBatch(const OverlayBatch& rhs) = delete;
+	OverlayBatch& operator=(const OverlayBatch& rhs) = delete;
+
+	// Renders the printable ASCII range with a fixed-pitch font; pixelHeight is
+	// the character height.  Throws if GDI cannot create the bitmap.
+	static FontAtlas CreateFontAtlas(const wchar_t* faceName, int pixelHeight);
+
+	// Glyph metrics for laying out text; call once the atlas exists.
+	void SetFont(const FontAtlas& atlas);
+
+	float CharWidth()const;
+	float LineHeight()const;
+
+	void Clear();
+
+	void AddRect(float x, float y, float width, float height, UINT color);
+
+	// '\n' starts a new line at x.  Returns the x after the last character.
+	float AddText(float x, float y, const char* text, UINT color);
+
+	const OverlayVertex* Vertices()const;
+	UINT VertexCount()const;
+	UINT DroppedQuads()const;
+
+	static UINT Rgba(BYTE r, BYTE g, BYTE b, BYTE a);
+
+	static const char FirstChar = ' ';
+	static const char LastChar = '~';
+	static const UINT AtlasColumns = 16;
+
+private:
+	void AddQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, UINT color);
+
+	// Top-left texel of a glyph cell; the cell after LastChar is solid.
+	float CellU(UINT cell)const;
+	float CellV(UINT cell)const;
+
+	std::vector<OverlayVertex> mVertices;
+	UINT mVertexCount = 0;
+	UINT mDroppedQuads = 0;
+
+	float mCellWidth = 8.0f;
+	float mCellHeight = 16.0f;
+};
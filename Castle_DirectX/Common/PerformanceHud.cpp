@@ -0,0 +1,150 @@
+//***************************************************************************************
+// PerformanceHud.cpp
+//***************************************************************************************
+
+#include "PerformanceHud.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const int PanelColumns = 40;
+	const float Padding = 4.0f;
+	const float GraphLines = 4.0f;
+
+	const UINT PanelColor = OverlayBatch::Rgba(0, 0, 0, 160);
+	const UINT GraphColor = OverlayBatch::Rgba(40, 40, 40, 200);
+	const UINT HeaderColor = OverlayBatch::Rgba(255, 210, 90, 255);
+	const UINT TextColor = OverlayBatch::Rgba(220, 220, 220, 255);
+	const UINT BudgetColor = OverlayBatch::Rgba(255, 255, 255, 160);
+	const UINT FastColor = OverlayBatch::Rgba(80, 200, 80, 255);
+	const UINT SlowColor = OverlayBatch::Rgba(230, 200, 60, 255);
+	const UINT MissedColor = OverlayBatch::Rgba(230, 70, 60, 255);
+
+	void CopyTiming(HudSnapshot::Timing& timing, const char* name, double ms)
+	{
+		strncpy_s(timing.Name, name, _TRUNCATE);
+		timing.Ms = ms;
+	}
+
+	// Formats the panel one line at a time into a stack buffer and passes each
+	// line to emit(text, color).
+	template<typename Emit>
+	void ForEachLine(const HudSnapshot& s, Emit emit)
+	{
+		const double kb = 1.0 / 1024.0;
+		const double mb = 1.0 / (1024.0*1024.0);
+		char line[PanelColumns + 1];
+
+		snprintf(line, sizeof(line), "frame %7.2f ms  %6.1f fps", s.FrameMs, s.FrameMs > 0.0 ? 1000.0 / s.FrameMs : 0.0);
+		emit(line, HeaderColor);
+		snprintf(line, sizeof(line), "cpu   %7.2f ms  gpu %7.2f ms", s.CpuMs, s.GpuMs);
+		emit(line, HeaderColor);
+
+		emit("cpu stage                        ms", HeaderColor);
+		for(int i = 0; i < s.CpuStageCount; ++i)
+		{
+			snprintf(line, sizeof(line), "  %-24.24s %8.3f", s.CpuStages[i].Name, s.CpuStages[i].Ms);
+			emit(line, TextColor);
+		}
+
+		emit("gpu layer (average)              ms", HeaderColor);
+		for(int i = 0; i < s.GpuLayerCount; ++i)
+		{
+			snprintf(line, sizeof(line), "  %-24.24s %8.3f", s.GpuLayers[i].Name, s.GpuLayers[i].Ms);
+			emit(line, TextColor);
+		}
+
+		const RenderStats& c = s.Commands;
+		snprintf(line, sizeof(line), "draws %u  instances %llu", c.Draws, (unsigned long long)c.Instances);
+		emit(line, TextColor);
+		snprintf(line, sizeof(line), "binds pso %u  table %u  root %u", c.PipelineBinds, c.DescriptorTableBinds,
+			c.RootConstantBinds + c.RootBufferBinds);
+		emit(line, TextColor);
+		snprintf(line, sizeof(line), "upload %.1f KB  waves %.3f ms", s.UploadBytes*kb, s.WavesMs);
+		emit(line, TextColor);
+		snprintf(line, sizeof(line), "memory gpu %.1f MB  cpu %.1f MB", s.GpuMemoryBytes*mb, s.CpuMemoryBytes*mb);
+		emit(line, TextColor);
+		snprintf(line, sizeof(line), "working set %.1f MB", s.WorkingSetBytes*mb);
+		emit(line, TextColor);
+	}
+}
+
+const double PerformanceHud::GraphMaxMs = 50.0;
+const double PerformanceHud::GraphBudgetMs = 1000.0 / 60.0;
+
+void HudSnapshot::AddCpuStage(const char* name, double ms)
+{
+	if(CpuStageCount < MaxTimings)
+		CopyTiming(CpuStages[CpuStageCount++], name, ms);
+}
+
+void HudSnapshot::AddGpuLayer(const char* name, double ms)
+{
+	if(GpuLayerCount < MaxTimings)
+		CopyTiming(GpuLayers[GpuLayerCount++], name, ms);
+}
+
+PerformanceHud::PerformanceHud(UINT historySize)
+	: mFrameMs(historySize, 0.0f)
+{
+}
+
+void PerformanceHud::AddFrame(const HudSnapshot& snapshot)
+{
+	mFrameMs[mNext] = (float)snapshot.FrameMs;
+	mNext = (mNext + 1) % (UINT)mFrameMs.size();
+	mCount = std::min<UINT>(mCount + 1, (UINT)mFrameMs.size());
+}
+
+void PerformanceHud::Build(const HudSnapshot& snapshot, OverlayBatch& batch, float x, float y)const
+{
+	int lineCount = 0;
+	ForEachLine(snapshot, [&lineCount](const char*, UINT) { ++lineCount; });
+
+	const float lineHeight = batch.LineHeight();
+	const float width = PanelColumns*batch.CharWidth();
+	const float graphHeight = GraphLines*lineHeight;
+
+	// Background first; the batch draws in order.
+	batch.AddRect(x, y, width + 2.0f*Padding, lineCount*lineHeight + graphHeight + 3.0f*Padding, PanelColor);
+
+	float lineY = y + Padding;
+	ForEachLine(snapshot, [&](const char* text, UINT color)
+	{
+		batch.AddText(x + Padding, lineY, text, color);
+		lineY += lineHeight;
+	});
+
+	// Frame time graph, newest frame on the right.
+	const float graphX = x + Padding;
+	const float graphY = lineY + Padding;
+	const float graphBottom = graphY + graphHeight;
+	batch.AddRect(graphX, graphY, width, graphHeight, GraphColor);
+
+	const UINT historySize = (UINT)mFrameMs.size();
+	const float barWidth = width / historySize;
+	for(UINT i = 0; i < mCount; ++i)
+	{
+		const float ms = mFrameMs[(mNext + historySize - mCount + i) % historySize];
+		const float height = graphHeight*(float)std::min<double>(ms / GraphMaxMs, 1.0);
+
+		UINT color = FastColor;
+		if(ms > 2.0*GraphBudgetMs)
+			color = MissedColor;
+		else if(ms > GraphBudgetMs)
+			color = SlowColor;
+
+		batch.AddRect(graphX + (historySize - mCount + i)*barWidth, graphBottom - height,
+			std::max<float>(barWidth - 1.0f, 1.0f), height, color);
+	}
+
+	const float budgetY = graphBottom - graphHeight*(float)(GraphBudgetMs / GraphMaxMs);
+	batch.AddRect(graphX, floorf(budgetY), width, 1.0f, BudgetColor);
+}
+
+void PerformanceHud::WriteText(std::ostream& out, const HudSnapshot& snapshot)
+{
+	ForEachLine(snapshot, [&out](const char* text, UINT) { out << text << '\n'; });
+}
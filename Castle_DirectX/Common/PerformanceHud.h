@@ -0,0 +1,79 @@
+//***************************************************************************************
+// PerformanceHud.h
+//
+// In-app performance overlay.  While it is shown the app fills a HudSnapshot each
+// frame, a plain copy of the numbers for one frame (CPU stage and GPU layer times,
+// command counts, upload bytes and memory); PerformanceHud keeps a rolling history
+// of frame times and lays a snapshot out as text and a bar graph in an
+// OverlayBatch.  The same snapshot can be written as text, e.g. from a headless run.
+//***************************************************************************************
+
+#pragma once
+
+#include "OverlayBatch.h"
+#include "RenderContext.h"
+#include <ostream>
+
+struct HudSnapshot
+{
+	static const int MaxTimings = 16;
+
+	// Names are copied, so a snapshot does not depend on where they came from.
+	struct Timing
+	{
+		char Name[32];
+		double Ms;
+	};
+
+	// Wall clock time of the frame, the sum of its CPU stages and the GPU time
+	// of the whole frame (a few frames late).
+	double FrameMs = 0.0;
+	double CpuMs = 0.0;
+	double GpuMs = 0.0;
+
+	Timing CpuStages[MaxTimings] = {};
+	int CpuStageCount = 0;
+	Timing GpuLayers[MaxTimings] = {};
+	int GpuLayerCount = 0;
+
+	RenderStats Commands;
+	UINT64 UploadBytes = 0;
+
+	// Wave simulation step, also one of the CPU stages.
+	double WavesMs = 0.0;
+
+	// Tracked GPU resources, tracked CPU allocations and the process working set.
+	UINT64 GpuMemoryBytes = 0;
+	UINT64 CpuMemoryBytes = 0;
+	UINT64 WorkingSetBytes = 0;
+
+	// Ignored once MaxTimings are in.
+	void AddCpuStage(const char* name, double ms);
+	void AddGpuLayer(const char* name, double ms);
+};
+
+class PerformanceHud
+{
+public:
+	explicit PerformanceHud(UINT historySize = 120);
+	PerformanceHud(const PerformanceHud& rhs) = delete;
+	PerformanceHud& operator=(const PerformanceHud& rhs) = delete;
+
+	// Adds the frame to the graph history.
+	void AddFrame(const HudSnapshot& snapshot);
+
+	// A panel with its top-left corner at (x, y).  Does not allocate.
+	void Build(const HudSnapshot& snapshot, OverlayBatch& batch, float x, float y)const;
+
+	// The panel's text, one line per row.
+	static void WriteText(std::ostream& out, const HudSnapshot& snapshot);
+
+	// Frame time at the top of the graph, and the budget line drawn across it.
+	static const double GraphMaxMs;
+	static const double GraphBudgetMs;
+
+private:
+	std::vector<float> mFrameMs;
+	UINT mNext = 0;
+	UINT mCount = 0;
+};
@@ -0,0 +1,280 @@
+//***************************************************************************************
+// PipelineStateCache.cpp
+//***************************************************************************************
+
+#include "PipelineStateCache.h"
+#include <iomanip>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	template<typename T>
+	std::uint64_t HashValue(const T& value, std::uint64_t seed)
+	{
+		return d3dUtil::HashBytes(&value, sizeof(T), seed);
+	}
+
+	std::uint64_t HashBytecode(const D3D12_SHADER_BYTECODE& code, std::uint64_t seed)
+	{
+		seed = HashValue(code.BytecodeLength, seed);
+		return d3dUtil::HashBytes(code.pShaderBytecode, code.BytecodeLength, seed);
+	}
+
+	// The blend and depth/stencil descriptions contain padding, so they are
+	// hashed field by field rather than as raw bytes.
+	std::uint64_t HashBlend(const D3D12_BLEND_DESC& blend, std::uint64_t seed)
+	{
+		seed = HashValue(blend.AlphaToCoverageEnable, seed);
+		seed = HashValue(blend.IndependentBlendEnable, seed);
+		for(const D3D12_RENDER_TARGET_BLEND_DESC& rt : blend.RenderTarget)
+		{
+			seed = HashValue(rt.BlendEnable, seed);
+			seed = HashValue(rt.LogicOpEnable, seed);
+			seed = HashValue(rt.SrcBlend, seed);
+			seed = HashValue(rt.DestBlend, seed);
+			seed = HashValue(rt.BlendOp, seed);
+			seed = HashValue(rt.SrcBlendAlpha, seed);
+			seed = HashValue(rt.DestBlendAlpha, seed);
+			seed = HashValue(rt.BlendOpAlpha, seed);
+			seed = HashValue(rt.LogicOp, seed);
+			seed = HashValue(rt.RenderTargetWriteMask, seed);
+		}
+
+		return seed;
+	}
+
+	std::uint64_t HashStencilOp(const D3D12_DEPTH_STENCILOP_DESC& op, std::uint64_t seed)
+	{
+		seed = HashValue(op.StencilFailOp, seed);
+		seed = HashValue(op.StencilDepthFailOp, seed);
+		seed = HashValue(op.StencilPassOp, seed);
+		return HashValue(op.StencilFunc, seed);
+	}
+
+	std::uint64_t HashDepthStencil(const D3D12_DEPTH_STENCIL_DESC& ds, std::uint64_t seed)
+	{
+		seed = HashValue(ds.DepthEnable, seed);
+		seed = HashValue(ds.DepthWriteMask, seed);
+		seed = HashValue(ds.DepthFunc, seed);
+		seed = HashValue(ds.StencilEnable, seed);
+		seed = HashValue(ds.StencilReadMask, seed);
+		seed = HashValue(ds.StencilWriteMask, seed);
+		seed = HashStencilOp(ds.FrontFace, seed);
+		return HashStencilOp(ds.BackFace, seed);
+	}
+
+	std::uint64_t HashInputLayout(const D3D12_INPUT_LAYOUT_DESC& layout, std::uint64_t seed)
+	{
+		seed = HashValue(layout.NumElements, seed);
+		for(UINT i = 0; i < layout.NumElements; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& e = layout.pInputElementDescs[i];
+			seed = d3dUtil::HashString(e.SemanticName, seed);
+			seed = HashValue(e.SemanticIndex, seed);
+			seed = HashValue(e.Format, seed);
+			seed = HashValue(e.InputSlot, seed);
+			seed = HashValue(e.AlignedByteOffset, seed);
+			seed = HashValue(e.InputSlotClass, seed);
+			seed = HashValue(e.InstanceDataStepRate, seed);
+		}
+
+		return seed;
+	}
+
+	std::uint64_t FileSize(std::ifstream& fin)
+	{
+		fin.seekg(0, std::ios_base::end);
+		std::uint64_t size = (std::uint64_t)fin.tellg();
+		fin.seekg(0, std::ios_base::beg);
+
+		return size;
+	}
+}
+
+PipelineStateCache::PipelineStateCache(ID3D12Device* device, IDXGIFactory4* factory, const std::wstring& cacheDir)
+	: md3dDevice(device), mCacheDir(cacheDir), mHits(0), mMisses(0)
+{
+	if(!CreateDirectoryW(mCacheDir.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		::OutputDebugStringA("PipelineStateCache: could not create the cache directory; PSOs will not be cached.\n");
+	}
+
+	ComPtr<IDXGIAdapter1> adapter;
+	ThrowIfFailed(factory->EnumAdapterByLuid(device->GetAdapterLuid(), IID_PPV_ARGS(&adapter)));
+
+	DXGI_ADAPTER_DESC adapterDesc;
+	ThrowIfFailed(adapter->GetDesc(&adapterDesc));
+
+	// The user-mode driver version is only reported through this legacy query.
+	LARGE_INTEGER driverVersion = {};
+	if(FAILED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion)))
+	{
+		::OutputDebugStringA("PipelineStateCache: could not read the driver version; PSOs will not be cached.\n");
+		mUseDisk = false;
+	}
+
+	mAdapterHash = HashAdapter(adapterDesc, driverVersion.QuadPart);
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::GetOrCreate(
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+	std::uint64_t rootSignatureHash)
+{
+	const std::uint64_t key = HashDesc(desc, rootSignatureHash);
+
+	ComPtr<ID3D12PipelineState> pso;
+
+	std::vector<char> blob;
+	if(ReadEntry(key, blob))
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC cachedDesc = desc;
+		cachedDesc.CachedPSO.pCachedBlob = blob.data();
+		cachedDesc.CachedPSO.CachedBlobSizeInBytes = blob.size();
+
+		// The driver may still reject the blob (D3D12_ERROR_ADAPTER_NOT_FOUND,
+		// D3D12_ERROR_DRIVER_VERSION_MISMATCH); fall through and recompile.
+		if(SUCCEEDED(md3dDevice->CreateGraphicsPipelineState(&cachedDesc, IID_PPV_ARGS(&pso))))
+		{
+			++mHits;
+			return pso;
+		}
+	}
+
+	++mMisses;
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC uncachedDesc = desc;
+	uncachedDesc.CachedPSO = { nullptr, 0 };
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&uncachedDesc, IID_PPV_ARGS(&pso)));
+
+	WriteEntry(key, pso.Get());
+
+	return pso;
+}
+
+std::uint64_t PipelineStateCache::HashDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+	std::uint64_t rootSignatureHash)
+{
+	std::uint64_t hash = d3dUtil::HashBytes(&rootSignatureHash, sizeof(rootSignatureHash));
+
+	hash = HashBytecode(desc.VS, hash);
+	hash = HashBytecode(desc.PS, hash);
+	hash = HashBytecode(desc.DS, hash);
+	hash = HashBytecode(desc.HS, hash);
+	hash = HashBytecode(desc.GS, hash);
+
+	// Stream output is not used by this app; hash the counts so a future user at
+	// least gets a different key.
+	hash = HashValue(desc.StreamOutput.NumEntries, hash);
+	hash = HashValue(desc.StreamOutput.NumStrides, hash);
+	hash = HashValue(desc.StreamOutput.RasterizedStream, hash);
+
+	hash = HashBlend(desc.BlendState, hash);
+	hash = HashValue(desc.SampleMask, hash);
+	hash = HashValue(desc.RasterizerState, hash);
+	hash = HashDepthStencil(desc.DepthStencilState, hash);
+	hash = HashInputLayout(desc.InputLayout, hash);
+	hash = HashValue(desc.IBStripCutValue, hash);
+	hash = HashValue(desc.PrimitiveTopologyType, hash);
+	hash = HashValue(desc.NumRenderTargets, hash);
+	hash = HashValue(desc.RTVFormats, hash);
+	hash = HashValue(desc.DSVFormat, hash);
+	hash = HashValue(desc.SampleDesc, hash);
+	hash = HashValue(desc.NodeMask, hash);
+	hash = HashValue(desc.Flags, hash);
+
+	return hash;
+}
+
+std::uint64_t PipelineStateCache::HashAdapter(const DXGI_ADAPTER_DESC& adapterDesc, std::int64_t driverVersion)
+{
+	std::uint64_t hash = HashValue(adapterDesc.VendorId, 14695981039346656037ull);
+	hash = HashValue(adapterDesc.DeviceId, hash);
+	hash = HashValue(adapterDesc.SubSysId, hash);
+	hash = HashValue(adapterDesc.Revision, hash);
+
+	return HashValue(driverVersion, hash);
+}
+
+bool PipelineStateCache::IsEntryValid(const EntryHeader& header, std::uint64_t key,
+	std::uint64_t adapterHash, std::uint64_t fileSize)
+{
+	return header.Magic == EntryMagic &&
+		header.Version == EntryVersion &&
+		header.Key == key &&
+		header.AdapterHash == adapterHash &&
+		header.BlobSize > 0 &&
+		fileSize == sizeof(EntryHeader) + header.BlobSize;
+}
+
+std::uint64_t PipelineStateCache::AdapterHash()const
+{
+	return mAdapterHash;
+}
+
+UINT PipelineStateCache::Hits()const
+{
+	return mHits;
+}
+
+UINT PipelineStateCache::Misses()const
+{
+	return mMisses;
+}
+
+std::wstring PipelineStateCache::EntryFilename(std::uint64_t key)const
+{
+	std::wostringstream name;
+	name << mCacheDir << L"\\" << std::hex << std::setw(16) << std::setfill(L'0') << key << L".pso";
+
+	return name.str();
+}
+
+bool PipelineStateCache::ReadEntry(std::uint64_t key, std::vector<char>& blob)const
+{
+	if(!mUseDisk)
+		return false;
+
+	std::ifstream fin(EntryFilename(key), std::ios::binary);
+	if(!fin)
+		return false;
+
+	const std::uint64_t fileSize = FileSize(fin);
+
+	EntryHeader header;
+	if(!fin.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return false;
+
+	// Entries written for another adapter or driver are stale; the caller
+	// recompiles and overwrites them.
+	if(!IsEntryValid(header, key, mAdapterHash, fileSize))
+		return false;
+
+	blob.resize((size_t)header.BlobSize);
+	return (bool)fin.read(blob.data(), blob.size());
+}
+
+void PipelineStateCache::WriteEntry(std::uint64_t key, ID3D12PipelineState* pso)const
+{
+	if(!mUseDisk)
+		return;
+
+	ComPtr<ID3DBlob> blob;
+	if(FAILED(pso->GetCachedBlob(&blob)) || blob->GetBufferSize() == 0)
+		return;
+
+	EntryHeader header;
+	header.Magic = EntryMagic;
+	header.Version = EntryVersion;
+	header.Key = key;
+	header.AdapterHash = mAdapterHash;
+	header.BlobSize = blob->GetBufferSize();
+
+	std::ofstream fout(EntryFilename(key), std::ios::binary | std::ios::trunc);
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	fout.write(reinterpret_cast<const char*>(blob->GetBufferPointer()), blob->GetBufferSize());
+}
@@ -0,0 +1,77 @@
+//***************************************************************************************
+// PipelineStateCache.h
+//
+// Disk cache of driver-compiled pipeline state blobs (ID3D12PipelineState::GetCachedBlob).
+// Entries are keyed on a hash of the complete pipeline description (shader bytecode,
+// input layout, fixed-function state, formats and root signature).  Each entry also
+// records the adapter and driver it was produced on; when either changes the entry is
+// discarded and the PSO is compiled again.  If the driver version cannot be read the
+// disk is not used at all, since a driver upgrade could not be told apart.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include <atomic>
+
+class PipelineStateCache
+{
+public:
+	// On-disk header written in front of every cached blob.
+	struct EntryHeader
+	{
+		std::uint32_t Magic = 0;
+		std::uint32_t Version = 0;
+		std::uint64_t Key = 0;
+		std::uint64_t AdapterHash = 0;
+		std::uint64_t BlobSize = 0;
+	};
+
+	static const std::uint32_t EntryMagic = 0x434f5350; // "PSOC"
+	static const std::uint32_t EntryVersion = 1;
+
+public:
+	PipelineStateCache(ID3D12Device* device, IDXGIFactory4* factory, const std::wstring& cacheDir);
+	PipelineStateCache(const PipelineStateCache& rhs) = delete;
+	PipelineStateCache& operator=(const PipelineStateCache& rhs) = delete;
+	~PipelineStateCache();
+
+	// Creates the PSO from a cached blob when a valid one exists.  Otherwise the
+	// driver compiles it and the resulting blob is written to the cache.  Safe to
+	// call from several threads at once.
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> GetOrCreate(
+		const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+		std::uint64_t rootSignatureHash);
+
+	// Hash of every field of the description that affects the compiled pipeline.
+	// The root signature is identified by the hash of its serialized blob because
+	// desc.pRootSignature is only a pointer.
+	static std::uint64_t HashDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+		std::uint64_t rootSignatureHash);
+
+	// Hash of the hardware and driver identity.  The LUID is deliberately left out
+	// because it changes on every boot.
+	static std::uint64_t HashAdapter(const DXGI_ADAPTER_DESC& adapterDesc, std::int64_t driverVersion);
+
+	// True if a cached entry may be handed to the driver for this key and adapter.
+	static bool IsEntryValid(const EntryHeader& header, std::uint64_t key,
+		std::uint64_t adapterHash, std::uint64_t fileSize);
+
+	std::uint64_t AdapterHash()const;
+	UINT Hits()const;
+	UINT Misses()const;
+
+private:
+	std::wstring EntryFilename(std::uint64_t key)const;
+	bool ReadEntry(std::uint64_t key, std::vector<char>& blob)const;
+	void WriteEntry(std::uint64_t key, ID3D12PipelineState* pso)const;
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+	std::wstring mCacheDir;
+	std::uint64_t mAdapterHash = 0;
+	bool mUseDisk = true;
+
+	std::atomic<UINT> mHits;
+	std::atomic<UINT> mMisses;
+};
@@ -0,0 +1,189 @@
+//***************************************************************************************
+// Profiler.cpp
+//***************************************************************************************
+
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Profiler.h"
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_RDTSC 1
+#else
+#define PROFILER_RDTSC 0
+#endif
+
+namespace
+{
+	struct ZoneEvent
+	{
+		const char* Name;
+		std::uint64_t Start;
+		std::uint64_t End;
+		std::uint32_t Depth;
+	};
+
+	// Written only by its own thread; Written is published with release order so
+	// the exporter sees complete events.
+	struct ThreadBuffer
+	{
+		unsigned long ThreadId = 0;
+		std::string Name; // guarded by Registry::Mutex
+		std::unique_ptr<ZoneEvent[]> Events;
+		std::atomic<std::uint64_t> Written;
+		std::uint32_t Depth = 0;
+	};
+
+	// Buffers outlive their threads so the trace still shows finished jobs.
+	struct Registry
+	{
+		Registry()
+			: OriginTicks(Profiler::Now()), OriginTime(std::chrono::steady_clock::now())
+		{
+		}
+
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+
+		// Pairs a tick count with a clock time, to convert ticks on export.
+		std::uint64_t OriginTicks;
+		std::chrono::steady_clock::time_point OriginTime;
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local ThreadBuffer* tBuffer = nullptr;
+
+	ThreadBuffer& CurrentThreadBuffer()
+	{
+		if(tBuffer == nullptr)
+		{
+			auto buffer = std::make_unique<ThreadBuffer>();
+			buffer->ThreadId = GetCurrentThreadId();
+			buffer->Events.reset(new ZoneEvent[Profiler::EventsPerThread]);
+			buffer->Written.store(0, std::memory_order_relaxed);
+
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.Mutex);
+			tBuffer = buffer.get();
+			registry.Buffers.push_back(std::move(buffer));
+		}
+
+		return *tBuffer;
+	}
+}
+
+std::uint64_t Profiler::Now()
+{
+#if PROFILER_RDTSC
+	return __rdtsc();
+#else
+	return (std::uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadBuffer& buffer = CurrentThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+	buffer.Name = name;
+}
+
+void Profiler::Record(const char* name, std::uint64_t start, std::uint64_t end, std::uint32_t depth)
+{
+	ThreadBuffer& buffer = CurrentThreadBuffer();
+
+	const std::uint64_t index = buffer.Written.load(std::memory_order_relaxed);
+	buffer.Events[index & (EventsPerThread - 1)] = { name, start, end, depth };
+	buffer.Written.store(index + 1, std::memory_order_release);
+}
+
+bool Profiler::WriteChromeTrace(const std::wstring& filename)
+{
+	Registry& registry = GetRegistry();
+
+	// Ticks per microsecond over the whole run so far; rdtsc runs at a constant
+	// rate on every CPU this targets, so one ratio converts all threads.
+	const std::uint64_t nowTicks = Now();
+	const double elapsedUs = std::chrono::duration<double, std::micro>(
+		std::chrono::steady_clock::now() - registry.OriginTime).count();
+	const double ticksPerUs = elapsedUs > 0.0 ? (nowTicks - registry.OriginTicks) / elapsedUs : 1.0;
+
+	std::ofstream fout(filename);
+	if(!fout)
+		return false;
+	fout << std::fixed;
+	fout.precision(3);
+
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	// The oldest slots of a buffer may be overwritten while they are copied, so
+	// they are left out.
+	const std::uint64_t margin = EventsPerThread / 16;
+
+	std::vector<ZoneEvent> events;
+	events.reserve(EventsPerThread);
+
+	// Complete ("X") events; ts and dur are in microseconds.
+	fout << "{\"traceEvents\":[\n";
+	bool first = true;
+	for(const auto& buffer : registry.Buffers)
+	{
+		if(!buffer->Name.empty())
+		{
+			fout << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+				<< buffer->ThreadId << ",\"args\":{\"name\":\"" << buffer->Name << "\"}}";
+			first = false;
+		}
+
+		const std::uint64_t written = buffer->Written.load(std::memory_order_acquire);
+		const std::uint64_t count = std::min<std::uint64_t>(written, EventsPerThread - margin);
+
+		events.clear();
+		for(std::uint64_t i = written - count; i < written; ++i)
+			events.push_back(buffer->Events[i & (EventsPerThread - 1)]);
+
+		// Zones finish children first; sort parents ahead of the zones they contain.
+		std::sort(events.begin(), events.end(), [](const ZoneEvent& a, const ZoneEvent& b)
+		{
+			return a.Start != b.Start ? a.Start < b.Start : a.Depth < b.Depth;
+		});
+
+		for(const ZoneEvent& e : events)
+		{
+			const double startUs = ((double)e.Start - (double)registry.OriginTicks) / ticksPerUs;
+			const double durationUs = (double)(e.End - e.Start) / ticksPerUs;
+
+			fout << (first ? "" : ",\n") << "{\"name\":\"" << e.Name << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+				<< buffer->ThreadId << ",\"ts\":" << startUs << ",\"dur\":" << durationUs << "}";
+			first = false;
+		}
+	}
+	fout << "\n]}\n";
+
+	return true;
+}
+
+Profiler::Zone::Zone(const char* name)
+	: mName(name)
+{
+	CurrentThreadBuffer().Depth++;
+	mStart = Now();
+}
+
+Profiler::Zone::~Zone()
+{
+	const std::uint64_t end = Now();
+	Record(mName, mStart, end, --CurrentThreadBuffer().Depth);
+}
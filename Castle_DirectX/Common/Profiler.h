@@ -0,0 +1,63 @@
+//***************************************************************************************
+// Profiler.h
+//
+// Scoped CPU zones for the frame loop.  Each thread appends finished zones to its own
+// ring buffer without locking, so the buffers always hold the most recent few seconds
+// of every thread; WriteChromeTrace dumps them in Chrome trace format (chrome://tracing
+// or ui.perfetto.dev).  Timestamps are rdtsc on x86/x64 and steady_clock elsewhere.
+//
+// Build with PROFILER_ENABLED=0 to compile every PROFILE_SCOPE out.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+class Profiler
+{
+public:
+	// Zones kept per thread; older zones are overwritten.
+	static const std::uint32_t EventsPerThread = 1 << 16;
+
+	// Raw timestamp in profiler ticks.
+	static std::uint64_t Now();
+
+	// Names the calling thread in the trace.  The name is copied.
+	static void SetThreadName(const char* name);
+
+	// Records a finished zone on the calling thread.  name must outlive the
+	// profiler; PROFILE_SCOPE passes string literals.
+	static void Record(const char* name, std::uint64_t start, std::uint64_t end, std::uint32_t depth);
+
+	// Writes the buffered zones of every thread.  Safe to call while other threads
+	// record, though zones being overwritten at that moment may be dropped.
+	static bool WriteChromeTrace(const std::wstring& filename);
+
+	// Times the enclosing scope.  Use through PROFILE_SCOPE.
+	class Zone
+	{
+	public:
+		explicit Zone(const char* name);
+		Zone(const Zone& rhs) = delete;
+		Zone& operator=(const Zone& rhs) = delete;
+		~Zone();
+
+	private:
+		const char* mName;
+		std::uint64_t mStart;
+	};
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_SCOPE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#endif
@@ -0,0 +1,179 @@
+//***************************************************************************************
+// RenderContext.cpp
+//***************************************************************************************
+
+#include "RenderContext.h"
+
+D3D12RenderContext::D3D12RenderContext(ID3D12GraphicsCommandList* cmdList)
+	: mCmdList(cmdList)
+{
+}
+
+void D3D12RenderContext::SetPipelineState(ID3D12PipelineState* pso)
+{
+	mCmdList->SetPipelineState(pso);
+
+	mStats.PipelineBinds++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+	mCmdList->SetGraphicsRootSignature(rootSignature);
+
+	mStats.RootSignatureBinds++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps)
+{
+	mCmdList->SetDescriptorHeaps(count, heaps);
+
+	mStats.DescriptorHeapBinds++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetViewport(const D3D12_VIEWPORT& viewport)
+{
+	mCmdList->RSSetViewports(1, &viewport);
+
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetScissorRect(const D3D12_RECT& rect)
+{
+	mCmdList->RSSetScissorRects(1, &rect);
+
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetRenderTargets(UINT count, const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargets,
+	const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencil)
+{
+	mCmdList->OMSetRenderTargets(count, renderTargets, false, depthStencil);
+
+	mStats.RenderTargetBinds++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::ClearRenderTarget(D3D12_CPU_DESCRIPTOR_HANDLE renderTarget, const float color[4])
+{
+	mCmdList->ClearRenderTargetView(renderTarget, color, 0, nullptr);
+
+	mStats.Clears++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::ClearDepthStencil(D3D12_CPU_DESCRIPTOR_HANDLE depthStencil, float depth, UINT8 stencil)
+{
+	mCmdList->ClearDepthStencilView(depthStencil, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL,
+		depth, stencil, 0, nullptr);
+
+	mStats.Clears++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+{
+	mCmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after));
+
+	mStats.Barriers++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetGraphicsRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE table)
+{
+	mCmdList->SetGraphicsRootDescriptorTable(rootIndex, table);
+
+	mStats.DescriptorTableBinds++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetGraphicsRoot32BitConstants(UINT rootIndex, UINT count, const void* data, UINT offset)
+{
+	mCmdList->SetGraphicsRoot32BitConstants(rootIndex, count, data, offset);
+
+	mStats.RootConstantBinds++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	mCmdList->SetGraphicsRootConstantBufferView(rootIndex, address);
+
+	mStats.RootBufferBinds++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	mCmdList->SetGraphicsRootShaderResourceView(rootIndex, address);
+
+	mStats.RootBufferBinds++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+	mCmdList->IASetVertexBuffers(startSlot, count, views);
+
+	mStats.VertexBufferBinds++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view)
+{
+	mCmdList->IASetIndexBuffer(&view);
+
+	mStats.IndexBufferBinds++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+	mCmdList->IASetPrimitiveTopology(topology);
+
+	mStats.TopologyChanges++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance)
+{
+	mCmdList->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+
+	mStats.Draws++;
+	mStats.Instances += instanceCount;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex,
+	INT baseVertex, UINT startInstance)
+{
+	mCmdList->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+
+	mStats.Draws++;
+	mStats.Instances += instanceCount;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::WriteTimestamp(ID3D12QueryHeap* queryHeap, UINT index)
+{
+	mCmdList->EndQuery(queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, index);
+
+	mStats.Queries++;
+	mStats.Commands++;
+}
+
+void D3D12RenderContext::ResolveTimestamps(ID3D12QueryHeap* queryHeap, UINT startIndex, UINT count,
+	ID3D12Resource* destination, UINT64 destinationOffset)
+{
+	mCmdList->ResolveQueryData(queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, startIndex, count, destination, destinationOffset);
+
+	mStats.Queries++;
+	mStats.Commands++;
+}
+
+const RenderStats& D3D12RenderContext::Stats()const
+{
+	return mStats;
+}
@@ -0,0 +1,115 @@
+//***************************************************************************************
+// RenderContext.h
+//
+// The command recording calls a frame makes, behind an interface so the same frame can
+// be recorded into a D3D12 command list or only captured.  D3D12RenderContext forwards
+// every call to a graphics command list; NullRenderContext (NullRenderContext.h)
+// encodes them into an in-memory stream and counts them.  Resources, descriptors and
+// PSOs are still created on the device; only recording goes through the context.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+// What a context recorded since it was created or last reset.
+struct RenderStats
+{
+	UINT Draws = 0;
+	UINT64 Instances = 0;
+	UINT PipelineBinds = 0;
+	UINT RootSignatureBinds = 0;
+	UINT DescriptorHeapBinds = 0;
+	UINT DescriptorTableBinds = 0;
+	UINT RootConstantBinds = 0;
+	UINT RootBufferBinds = 0; // root CBVs and SRVs
+	UINT VertexBufferBinds = 0;
+	UINT IndexBufferBinds = 0;
+	UINT TopologyChanges = 0;
+	UINT RenderTargetBinds = 0;
+	UINT Clears = 0;
+	UINT Barriers = 0;
+	UINT Queries = 0; // timestamps written and resolves
+	UINT Commands = 0;
+};
+
+class RenderContext
+{
+public:
+	virtual ~RenderContext() = default;
+
+	virtual void SetPipelineState(ID3D12PipelineState* pso) = 0;
+	virtual void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature) = 0;
+	virtual void SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps) = 0;
+
+	virtual void SetViewport(const D3D12_VIEWPORT& viewport) = 0;
+	virtual void SetScissorRect(const D3D12_RECT& rect) = 0;
+	virtual void SetRenderTargets(UINT count, const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargets,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencil) = 0;
+
+	virtual void ClearRenderTarget(D3D12_CPU_DESCRIPTOR_HANDLE renderTarget, const float color[4]) = 0;
+	virtual void ClearDepthStencil(D3D12_CPU_DESCRIPTOR_HANDLE depthStencil, float depth, UINT8 stencil) = 0;
+	virtual void Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after) = 0;
+
+	virtual void SetGraphicsRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE table) = 0;
+	virtual void SetGraphicsRoot32BitConstants(UINT rootIndex, UINT count, const void* data, UINT offset) = 0;
+	virtual void SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address) = 0;
+	virtual void SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address) = 0;
+
+	virtual void SetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views) = 0;
+	virtual void SetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view) = 0;
+	virtual void SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) = 0;
+
+	virtual void DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance) = 0;
+	virtual void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex,
+		INT baseVertex, UINT startInstance) = 0;
+
+	virtual void WriteTimestamp(ID3D12QueryHeap* queryHeap, UINT index) = 0;
+	virtual void ResolveTimestamps(ID3D12QueryHeap* queryHeap, UINT startIndex, UINT count,
+		ID3D12Resource* destination, UINT64 destinationOffset) = 0;
+};
+
+class D3D12RenderContext : public RenderContext
+{
+public:
+	explicit D3D12RenderContext(ID3D12GraphicsCommandList* cmdList);
+	D3D12RenderContext(const D3D12RenderContext& rhs) = delete;
+	D3D12RenderContext& operator=(const D3D12RenderContext& rhs) = delete;
+
+	virtual void SetPipelineState(ID3D12PipelineState* pso)override;
+	virtual void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)override;
+	virtual void SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps)override;
+
+	virtual void SetViewport(const D3D12_VIEWPORT& viewport)override;
+	virtual void SetScissorRect(const D3D12_RECT& rect)override;
+	virtual void SetRenderTargets(UINT count, const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargets,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* depthStencil)override;
+
+	virtual void ClearRenderTarget(D3D12_CPU_DESCRIPTOR_HANDLE renderTarget, const float color[4])override;
+	virtual void ClearDepthStencil(D3D12_CPU_DESCRIPTOR_HANDLE depthStencil, float depth, UINT8 stencil)override;
+	virtual void Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)override;
+
+	virtual void SetGraphicsRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE table)override;
+	virtual void SetGraphicsRoot32BitConstants(UINT rootIndex, UINT count, const void* data, UINT offset)override;
+	virtual void SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)override;
+	virtual void SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)override;
+
+	virtual void SetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views)override;
+	virtual void SetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view)override;
+	virtual void SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)override;
+
+	virtual void DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance)override;
+	virtual void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex,
+		INT baseVertex, UINT startInstance)override;
+
+	virtual void WriteTimestamp(ID3D12QueryHeap* queryHeap, UINT index)override;
+	virtual void ResolveTimestamps(ID3D12QueryHeap* queryHeap, UINT startIndex, UINT count,
+		ID3D12Resource* destination, UINT64 destinationOffset)override;
+
+	// Counted as in NullRenderContext, so a real frame can be reported too.
+	const RenderStats& Stats()const;
+
+private:
+	ID3D12GraphicsCommandList* mCmdList = nullptr;
+	RenderStats mStats;
+};
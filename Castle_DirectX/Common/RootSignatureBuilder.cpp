@@ -0,0 +1,189 @@
+//***************************************************************************************
+// RootSignatureBuilder.cpp
+//***************************************************************************************
+
+#include "RootSignatureBuilder.h"
+
+using Microsoft::WRL::ComPtr;
+
+UINT RootSignatureBuilder::AddConstants(UINT num32BitValues, UINT shaderRegister, UINT registerSpace,
+	D3D12_SHADER_VISIBILITY visibility)
+{
+	D3D12_ROOT_PARAMETER1 param = {};
+	param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	param.Constants.Num32BitValues = num32BitValues;
+	param.Constants.ShaderRegister = shaderRegister;
+	param.Constants.RegisterSpace = registerSpace;
+	param.ShaderVisibility = visibility;
+
+	mParameters.push_back(param);
+	return (UINT)mParameters.size() - 1;
+}
+
+UINT RootSignatureBuilder::AddCBV(UINT shaderRegister, UINT registerSpace, D3D12_ROOT_DESCRIPTOR_FLAGS flags,
+	D3D12_SHADER_VISIBILITY visibility)
+{
+	D3D12_ROOT_PARAMETER1 param = {};
+	param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+	param.Descriptor = { shaderRegister, registerSpace, flags };
+	param.ShaderVisibility = visibility;
+
+	mParameters.push_back(param);
+	return (UINT)mParameters.size() - 1;
+}
+
+UINT RootSignatureBuilder::AddSRV(UINT shaderRegister, UINT registerSpace, D3D12_ROOT_DESCRIPTOR_FLAGS flags,
+	D3D12_SHADER_VISIBILITY visibility)
+{
+	D3D12_ROOT_PARAMETER1 param = {};
+	param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	param.Descriptor = { shaderRegister, registerSpace, flags };
+	param.ShaderVisibility = visibility;
+
+	mParameters.push_back(param);
+	return (UINT)mParameters.size() - 1;
+}
+
+UINT RootSignatureBuilder::AddTable(const std::vector<D3D12_DESCRIPTOR_RANGE1>& ranges,
+	D3D12_SHADER_VISIBILITY visibility)
+{
+	mRanges.push_back(ranges);
+
+	D3D12_ROOT_PARAMETER1 param = {};
+	param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	param.DescriptorTable.NumDescriptorRanges = (UINT)mRanges.back().size();
+	param.DescriptorTable.pDescriptorRanges = mRanges.back().data();
+	param.ShaderVisibility = visibility;
+
+	mParameters.push_back(param);
+	return (UINT)mParameters.size() - 1;
+}
+
+void RootSignatureBuilder::AddStaticSampler(const D3D12_STATIC_SAMPLER_DESC& sampler)
+{
+	mStaticSamplers.push_back(sampler);
+}
+
+void RootSignatureBuilder::SetFlags(D3D12_ROOT_SIGNATURE_FLAGS flags)
+{
+	mFlags = flags;
+}
+
+D3D12_DESCRIPTOR_RANGE1 RootSignatureBuilder::Range(D3D12_DESCRIPTOR_RANGE_TYPE type, UINT numDescriptors,
+	UINT baseShaderRegister, UINT registerSpace, D3D12_DESCRIPTOR_RANGE_FLAGS flags)
+{
+	D3D12_DESCRIPTOR_RANGE1 range;
+	range.RangeType = type;
+	range.NumDescriptors = numDescriptors;
+	range.BaseShaderRegister = baseShaderRegister;
+	range.RegisterSpace = registerSpace;
+	range.Flags = flags;
+	range.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+	return range;
+}
+
+D3D12_VERSIONED_ROOT_SIGNATURE_DESC RootSignatureBuilder::Desc_1_1()const
+{
+	D3D12_VERSIONED_ROOT_SIGNATURE_DESC desc = {};
+	desc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+	desc.Desc_1_1.NumParameters = (UINT)mParameters.size();
+	desc.Desc_1_1.pParameters = mParameters.data();
+	desc.Desc_1_1.NumStaticSamplers = (UINT)mStaticSamplers.size();
+	desc.Desc_1_1.pStaticSamplers = mStaticSamplers.data();
+	desc.Desc_1_1.Flags = mFlags;
+
+	return desc;
+}
+
+D3D12_VERSIONED_ROOT_SIGNATURE_DESC RootSignatureBuilder::Desc_1_0()
+{
+	// Version 1.0 has no flags; the runtime treats every descriptor as volatile
+	// and all data as static-while-set-at-execute, which is always correct.
+	mParameters_1_0.clear();
+	mRanges_1_0.clear();
+
+	for(const D3D12_ROOT_PARAMETER1& param : mParameters)
+	{
+		D3D12_ROOT_PARAMETER param_1_0 = {};
+		param_1_0.ParameterType = param.ParameterType;
+		param_1_0.ShaderVisibility = param.ShaderVisibility;
+
+		switch(param.ParameterType)
+		{
+		case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+		{
+			mRanges_1_0.emplace_back();
+			std::vector<D3D12_DESCRIPTOR_RANGE>& ranges = mRanges_1_0.back();
+			for(UINT i = 0; i < param.DescriptorTable.NumDescriptorRanges; ++i)
+			{
+				const D3D12_DESCRIPTOR_RANGE1& r = param.DescriptorTable.pDescriptorRanges[i];
+				ranges.push_back({ r.RangeType, r.NumDescriptors, r.BaseShaderRegister,
+					r.RegisterSpace, r.OffsetInDescriptorsFromTableStart });
+			}
+			param_1_0.DescriptorTable.NumDescriptorRanges = (UINT)ranges.size();
+			param_1_0.DescriptorTable.pDescriptorRanges = ranges.data();
+			break;
+		}
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+			param_1_0.Constants = param.Constants;
+			break;
+		default:
+			param_1_0.Descriptor.ShaderRegister = param.Descriptor.ShaderRegister;
+			param_1_0.Descriptor.RegisterSpace = param.Descriptor.RegisterSpace;
+			break;
+		}
+
+		mParameters_1_0.push_back(param_1_0);
+	}
+
+	D3D12_VERSIONED_ROOT_SIGNATURE_DESC desc = {};
+	desc.Version = D3D_ROOT_SIGNATURE_VERSION_1_0;
+	desc.Desc_1_0.NumParameters = (UINT)mParameters_1_0.size();
+	desc.Desc_1_0.pParameters = mParameters_1_0.data();
+	desc.Desc_1_0.NumStaticSamplers = (UINT)mStaticSamplers.size();
+	desc.Desc_1_0.pStaticSamplers = mStaticSamplers.data();
+	desc.Desc_1_0.Flags = mFlags;
+
+	return desc;
+}
+
+D3D_ROOT_SIGNATURE_VERSION RootSignatureBuilder::HighestVersion(ID3D12Device* device)
+{
+	D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
+	featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+
+	if(FAILED(device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
+		return D3D_ROOT_SIGNATURE_VERSION_1_0;
+
+	return featureData.HighestVersion;
+}
+
+ComPtr<ID3DBlob> RootSignatureBuilder::Serialize(D3D_ROOT_SIGNATURE_VERSION version)
+{
+	ComPtr<ID3DBlob> serializedRootSig = nullptr;
+	ComPtr<ID3DBlob> errorBlob = nullptr;
+	HRESULT hr = S_OK;
+
+	if(version == D3D_ROOT_SIGNATURE_VERSION_1_0)
+	{
+		// Older runtimes lack D3D12SerializeVersionedRootSignature.
+		D3D12_VERSIONED_ROOT_SIGNATURE_DESC desc = Desc_1_0();
+		hr = D3D12SerializeRootSignature(&desc.Desc_1_0, D3D_ROOT_SIGNATURE_VERSION_1,
+			serializedRootSig.GetAddressOf(), errorBlob.GetAddressOf());
+	}
+	else
+	{
+		D3D12_VERSIONED_ROOT_SIGNATURE_DESC desc = Desc_1_1();
+		hr = D3D12SerializeVersionedRootSignature(&desc,
+			serializedRootSig.GetAddressOf(), errorBlob.GetAddressOf());
+	}
+
+	if(errorBlob != nullptr)
+	{
+		::OutputDebugStringA((char*)errorBlob->GetBufferPointer());
+	}
+	ThrowIfFailed(hr);
+
+	return serializedRootSig;
+}
@@ -0,0 +1,63 @@
+//***************************************************************************************
+// RootSignatureBuilder.h
+//
+// Builds a root signature description in the version 1.1 layout (per-parameter
+// DATA_STATIC / DESCRIPTORS_VOLATILE flags) and serializes it as 1.1, or as 1.0 with
+// the flags dropped when the runtime does not support 1.1.  Building the description
+// does not need a device, so the layout can be inspected on its own.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include <deque>
+
+class RootSignatureBuilder
+{
+public:
+	RootSignatureBuilder() = default;
+	RootSignatureBuilder(const RootSignatureBuilder& rhs) = delete;
+	RootSignatureBuilder& operator=(const RootSignatureBuilder& rhs) = delete;
+
+	// Each Add* returns the index of the new root parameter.
+	UINT AddConstants(UINT num32BitValues, UINT shaderRegister, UINT registerSpace,
+		D3D12_SHADER_VISIBILITY visibility);
+
+	UINT AddCBV(UINT shaderRegister, UINT registerSpace, D3D12_ROOT_DESCRIPTOR_FLAGS flags,
+		D3D12_SHADER_VISIBILITY visibility);
+
+	UINT AddSRV(UINT shaderRegister, UINT registerSpace, D3D12_ROOT_DESCRIPTOR_FLAGS flags,
+		D3D12_SHADER_VISIBILITY visibility);
+
+	UINT AddTable(const std::vector<D3D12_DESCRIPTOR_RANGE1>& ranges, D3D12_SHADER_VISIBILITY visibility);
+
+	void AddStaticSampler(const D3D12_STATIC_SAMPLER_DESC& sampler);
+
+	void SetFlags(D3D12_ROOT_SIGNATURE_FLAGS flags);
+
+	static D3D12_DESCRIPTOR_RANGE1 Range(D3D12_DESCRIPTOR_RANGE_TYPE type, UINT numDescriptors,
+		UINT baseShaderRegister, UINT registerSpace, D3D12_DESCRIPTOR_RANGE_FLAGS flags);
+
+	// The returned descriptions point into the builder and stay valid until it
+	// is modified or destroyed.
+	D3D12_VERSIONED_ROOT_SIGNATURE_DESC Desc_1_1()const;
+	D3D12_VERSIONED_ROOT_SIGNATURE_DESC Desc_1_0();
+
+	// Highest root signature version the device accepts (1.1 or 1.0).
+	static D3D_ROOT_SIGNATURE_VERSION HighestVersion(ID3D12Device* device);
+
+	// Serializes for the given version; errors are written to the debug output.
+	Microsoft::WRL::ComPtr<ID3DBlob> Serialize(D3D_ROOT_SIGNATURE_VERSION version);
+
+private:
+	std::vector<D3D12_ROOT_PARAMETER1> mParameters;
+	std::vector<D3D12_STATIC_SAMPLER_DESC> mStaticSamplers;
+	D3D12_ROOT_SIGNATURE_FLAGS mFlags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+	// Range storage; a deque keeps earlier tables' pointers valid as tables are added.
+	std::deque<std::vector<D3D12_DESCRIPTOR_RANGE1>> mRanges;
+
+	// Version 1.0 copies, rebuilt by Desc_1_0.
+	std::vector<D3D12_ROOT_PARAMETER> mParameters_1_0;
+	std::deque<std::vector<D3D12_DESCRIPTOR_RANGE>> mRanges_1_0;
+};
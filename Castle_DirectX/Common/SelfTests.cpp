@@ -0,0 +1,919 @@
+//***************************************************************************************
+// SelfTests.cpp
+//***************************************************************************************
+
+#include "SelfTests.h"
+#include "Camera.h"
+#include "FramePacer.h"
+#include "Frustum.h"
+#include "GameTimer.h"
+#include "GpuTimestamps.h"
+#include "MathHelper.h"
+#include "MemoryTracker.h"
+#include "PipelineStateCache.h"
+#include "ShaderCache.h"
+#include "ShaderDependencyGraph.h"
+#include "d3dUtil.h"
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	// Compares the camera's cached products and inverses with XMMatrixMultiply and
+	// XMMatrixInverse over a few poses in both depth modes, after both a view and a lens
+	// change, and checks that reverse-Z puts the near plane at depth 1 and far points
+	// close to 0.
+	bool CheckCameraMatrices()
+	{
+		const float tolerance = 1.0e-4f;
+		auto nearEqual = [tolerance](FXMMATRIX a, CXMMATRIX b)
+		{
+			for(int r = 0; r < 4; ++r)
+			{
+				XMVECTOR limit = XMVectorMultiplyAdd(XMVectorAbs(b.r[r]), XMVectorReplicate(tolerance), XMVectorReplicate(tolerance));
+				if(!XMVector4LessOrEqual(XMVectorAbs(XMVectorSubtract(a.r[r], b.r[r])), limit))
+					return false;
+			}
+			return true;
+		};
+
+		auto check = [&nearEqual](const Camera& camera)
+		{
+			XMMATRIX view = camera.GetView();
+			XMMATRIX proj = camera.GetProj();
+			XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+
+			return nearEqual(camera.GetViewProj(), viewProj) &&
+				nearEqual(camera.GetInvView(), XMMatrixInverse(nullptr, view)) &&
+				nearEqual(camera.GetInvProj(), XMMatrixInverse(nullptr, proj)) &&
+				nearEqual(camera.GetInvViewProj(), XMMatrixInverse(nullptr, viewProj));
+		};
+
+		const XMFLOAT3 poses[][2] =
+		{
+			{ XMFLOAT3(45.0f, 5.0f, -51.0f), XMFLOAT3(0.0f, 0.0f, 0.0f) },
+			{ XMFLOAT3(-120.0f, 40.0f, 80.0f), XMFLOAT3(10.0f, -5.0f, 3.0f) },
+			{ XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(0.0f, 2.0f, 1.0f) },
+		};
+
+		Camera camera;
+		for(Camera::DepthMode mode : { Camera::DepthMode::Standard, Camera::DepthMode::ReverseZInfinite })
+		{
+			camera.SetDepthMode(mode);
+			for(const auto& pose : poses)
+			{
+				camera.SetLens(0.25f*MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+				camera.LookAt(pose[0], pose[1], XMFLOAT3(0.0f, 1.0f, 0.0f));
+				camera.Pitch(0.1f);
+				camera.UpdateViewMatrix();
+				if(!check(camera))
+					return false;
+
+				camera.SetLens(0.3f*MathHelper::Pi, 4.0f / 3.0f, 0.5f, 500.0f);
+				if(!check(camera))
+					return false;
+			}
+
+			if(mode == Camera::DepthMode::ReverseZInfinite)
+			{
+				XMVECTOR eye = camera.GetPosition();
+				XMVECTOR look = camera.GetLook();
+				float nearDepth = XMVectorGetZ(XMVector3TransformCoord(
+					XMVectorMultiplyAdd(XMVectorReplicate(camera.GetNearZ()), look, eye), camera.GetViewProj()));
+				float farDepth = XMVectorGetZ(XMVector3TransformCoord(
+					XMVectorMultiplyAdd(XMVectorReplicate(1.0e6f), look, eye), camera.GetViewProj()));
+				if(fabsf(nearDepth - 1.0f) > tolerance || farDepth <= 0.0f || farDepth > tolerance)
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Compares MathHelper's batch transforms with DirectXMath one element at a time,
+	// both into a separate array and in place.  TransformAabbs is compared with
+	// BoundingBox::Transform of the eight corners.
+	bool CheckBatchTransforms()
+	{
+		const UINT count = 1001;
+		const float tolerance = 1.0e-4f;
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+
+		auto close = [tolerance](const float* a, const float* b, int n)
+		{
+			for(int i = 0; i < n; ++i)
+			{
+				if(fabsf(a[i] - b[i]) > tolerance*(1.0f + fabsf(b[i])))
+					return false;
+			}
+			return true;
+		};
+
+		XMMATRIX M = XMMatrixScaling(1.5f, 0.5f, 2.0f)*XMMatrixRotationRollPitchYaw(0.3f, 1.2f, -0.4f)*XMMatrixTranslation(4.0f, -2.0f, 7.0f);
+		XMMATRIX viewProj = XMMatrixLookAtLH(XMVectorSet(-20.0f, 15.0f, -30.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f))*
+			XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+
+		std::vector<XMFLOAT4X4> matrices(count);
+		for(XMFLOAT4X4& m : matrices)
+		{
+			for(auto& row : m.m)
+				for(float& f : row)
+					f = value(random);
+		}
+
+		std::vector<XMFLOAT4X4> out(count);
+		std::vector<XMFLOAT4X4> inPlace(matrices);
+		MathHelper::TransposeMatrices(out.data(), matrices.data(), count);
+		MathHelper::TransposeMatrices(inPlace.data(), inPlace.data(), count);
+		for(UINT i = 0; i < count; ++i)
+		{
+			XMFLOAT4X4 expected;
+			XMStoreFloat4x4(&expected, XMMatrixTranspose(XMLoadFloat4x4(&matrices[i])));
+			if(memcmp(&out[i], &expected, sizeof(expected)) != 0 || memcmp(&inPlace[i], &expected, sizeof(expected)) != 0)
+				return false;
+		}
+
+		MathHelper::MultiplyMatrices(out.data(), matrices.data(), count, viewProj);
+		for(UINT i = 0; i < count; ++i)
+		{
+			XMFLOAT4X4 expected;
+			XMStoreFloat4x4(&expected, XMMatrixMultiply(XMLoadFloat4x4(&matrices[i]), viewProj));
+			if(!close(&out[i].m[0][0], &expected.m[0][0], 16))
+				return false;
+		}
+
+		MathHelper::MultiplyTransposeMatrices(out.data(), matrices.data(), count, viewProj);
+		for(UINT i = 0; i < count; ++i)
+		{
+			XMFLOAT4X4 expected;
+			XMStoreFloat4x4(&expected, XMMatrixTranspose(XMMatrixMultiply(XMLoadFloat4x4(&matrices[i]), viewProj)));
+			if(!close(&out[i].m[0][0], &expected.m[0][0], 16))
+				return false;
+		}
+
+		// Points in front of the camera, so w stays well away from 0.
+		std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+		std::vector<XMFLOAT3> points(count);
+		for(XMFLOAT3& p : points)
+			p = XMFLOAT3(position(random), position(random), position(random));
+
+		std::vector<XMFLOAT3> transformed(count);
+		MathHelper::TransformPoints(transformed.data(), points.data(), count, viewProj);
+		for(UINT i = 0; i < count; ++i)
+		{
+			XMFLOAT3 expected;
+			XMStoreFloat3(&expected, XMVector3TransformCoord(XMLoadFloat3(&points[i]), viewProj));
+			if(!close(&transformed[i].x, &expected.x, 3))
+				return false;
+		}
+
+		std::uniform_real_distribution<float> extent(0.1f, 3.0f);
+		std::vector<BoundingBox> boxes(count);
+		for(BoundingBox& box : boxes)
+			box = BoundingBox(XMFLOAT3(position(random), position(random), position(random)), XMFLOAT3(extent(random), extent(random), extent(random)));
+
+		std::vector<BoundingBox> inPlaceBoxes(boxes);
+		TransformAabbs(inPlaceBoxes.data(), inPlaceBoxes.data(), count, M);
+		for(UINT i = 0; i < count; ++i)
+		{
+			BoundingBox expected;
+			boxes[i].Transform(expected, M);
+			if(!close(&inPlaceBoxes[i].Center.x, &expected.Center.x, 3) || !close(&inPlaceBoxes[i].Extents.x, &expected.Extents.x, 3))
+				return false;
+		}
+
+		return true;
+	}
+
+	// Compares the batch frustum tests with the one at a time ones over boxes and
+	// spheres round the camera, an odd count so the four-wide loops have objects left
+	// over, and checks the visible counts they return.
+	bool CheckFrustumBatches()
+	{
+		const UINT count = 10001;
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> size(0.5f, 5.0f);
+		std::vector<float> data[6];
+		for(std::vector<float>& component : data)
+			component.resize(count);
+		for(UINT i = 0; i < count; ++i)
+		{
+			data[0][i] = position(random);
+			data[1][i] = position(random);
+			data[2][i] = position(random);
+			data[3][i] = size(random);
+			data[4][i] = size(random);
+			data[5][i] = size(random);
+		}
+
+		AabbArrays boxes;
+		boxes.CenterX = data[0].data();
+		boxes.CenterY = data[1].data();
+		boxes.CenterZ = data[2].data();
+		boxes.ExtentX = data[3].data();
+		boxes.ExtentY = data[4].data();
+		boxes.ExtentZ = data[5].data();
+		boxes.Count = count;
+
+		SphereArrays spheres;
+		spheres.CenterX = boxes.CenterX;
+		spheres.CenterY = boxes.CenterY;
+		spheres.CenterZ = boxes.CenterZ;
+		spheres.Radius = boxes.ExtentX;
+		spheres.Count = count;
+
+		Camera camera;
+		camera.SetLens(0.25f*MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+		camera.LookAt(XMFLOAT3(-20.0f, 15.0f, -30.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+		camera.UpdateViewMatrix();
+
+		const Frustum& frustum = camera.GetFrustum();
+		std::vector<UINT> boxMask(Frustum::MaskWords(count));
+		std::vector<UINT> sphereMask(Frustum::MaskWords(count));
+		const UINT visibleBoxes = frustum.TestAabbs(boxes, boxMask.data());
+		const UINT visibleSpheres = frustum.TestSpheres(spheres, sphereMask.data());
+
+		UINT expectedBoxes = 0;
+		UINT expectedSpheres = 0;
+		for(UINT i = 0; i < count; ++i)
+		{
+			const XMFLOAT3 center(data[0][i], data[1][i], data[2][i]);
+			const XMFLOAT3 extents(data[3][i], data[4][i], data[5][i]);
+			const bool boxVisible = frustum.IntersectsAabb(center, extents);
+			const bool sphereVisible = frustum.IntersectsSphere(center, extents.x);
+			if(boxVisible != (((boxMask[i / 32] >> (i % 32)) & 1) != 0) ||
+				sphereVisible != (((sphereMask[i / 32] >> (i % 32)) & 1) != 0))
+				return false;
+
+			expectedBoxes += boxVisible ? 1 : 0;
+			expectedSpheres += sphereVisible ? 1 : 0;
+		}
+
+		// Some boxes on each side, so both outcomes are covered, and no bits set past
+		// the last object.
+		return visibleBoxes == expectedBoxes && visibleSpheres == expectedSpheres &&
+			expectedBoxes > 0 && expectedBoxes < count &&
+			(boxMask.back() >> (count % 32)) == 0 && (sphereMask.back() >> (count % 32)) == 0;
+	}
+
+	// Checks that the pipeline cache key changes with any one field of the description,
+	// the shader bytecode or the root signature, and that entries are only accepted
+	// whole, with the right magic, version, key and adapter.
+	bool CheckPipelineCacheKeys()
+	{
+		const char vsBytes[] = "vertex shader bytecode";
+		const char psBytes[] = "pixel shader bytecode";
+		const D3D12_INPUT_ELEMENT_DESC layout[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+		};
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+		ZeroMemory(&desc, sizeof(desc));
+		desc.VS = { vsBytes, sizeof(vsBytes) };
+		desc.PS = { psBytes, sizeof(psBytes) };
+		desc.InputLayout = { layout, _countof(layout) };
+		desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+		desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+		desc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+		desc.SampleMask = UINT_MAX;
+		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		desc.NumRenderTargets = 1;
+		desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+		desc.SampleDesc.Count = 1;
+
+		const std::uint64_t rootSignatureHash = 1234;
+		const std::uint64_t key = PipelineStateCache::HashDesc(desc, rootSignatureHash);
+		if(PipelineStateCache::HashDesc(desc, rootSignatureHash) != key ||
+			PipelineStateCache::HashDesc(desc, rootSignatureHash + 1) == key)
+			return false;
+
+		// One field changed at a time.
+		const char vsEdited[] = "vertex shader bytecodf";
+		const D3D12_INPUT_ELEMENT_DESC layoutEdited[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+		};
+		const std::function<void(D3D12_GRAPHICS_PIPELINE_STATE_DESC&)> edits[] =
+		{
+			[&vsEdited](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.VS = { vsEdited, sizeof(vsEdited) }; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.PS = { nullptr, 0 }; },
+			[&layoutEdited](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.InputLayout = { layoutEdited, _countof(layoutEdited) }; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.RenderTarget[0].BlendEnable = TRUE; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DepthStencilState.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_NEVER; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.SampleDesc.Count = 4; },
+		};
+		for(const auto& edit : edits)
+		{
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC edited = desc;
+			edit(edited);
+			if(PipelineStateCache::HashDesc(edited, rootSignatureHash) == key)
+				return false;
+		}
+
+		DXGI_ADAPTER_DESC adapter = {};
+		adapter.VendorId = 0x10de;
+		adapter.DeviceId = 0x1b80;
+		const std::uint64_t adapterHash = PipelineStateCache::HashAdapter(adapter, 0x0017000100000000ll);
+		DXGI_ADAPTER_DESC otherAdapter = adapter;
+		otherAdapter.DeviceId = 0x1b81;
+		if(PipelineStateCache::HashAdapter(adapter, 0x0017000100000001ll) == adapterHash ||
+			PipelineStateCache::HashAdapter(otherAdapter, 0x0017000100000000ll) == adapterHash)
+			return false;
+
+		PipelineStateCache::EntryHeader header;
+		header.Magic = PipelineStateCache::EntryMagic;
+		header.Version = PipelineStateCache::EntryVersion;
+		header.Key = key;
+		header.AdapterHash = adapterHash;
+		header.BlobSize = 4096;
+		const std::uint64_t fileSize = sizeof(header) + header.BlobSize;
+		if(!PipelineStateCache::IsEntryValid(header, key, adapterHash, fileSize) ||
+			PipelineStateCache::IsEntryValid(header, key, adapterHash, fileSize - 1) ||
+			PipelineStateCache::IsEntryValid(header, key, adapterHash, sizeof(header)) ||
+			PipelineStateCache::IsEntryValid(header, key + 1, adapterHash, fileSize) ||
+			PipelineStateCache::IsEntryValid(header, key, adapterHash + 1, fileSize))
+			return false;
+
+		PipelineStateCache::EntryHeader badMagic = header;
+		badMagic.Magic = ~badMagic.Magic;
+		PipelineStateCache::EntryHeader badVersion = header;
+		badVersion.Version = PipelineStateCache::EntryVersion + 1;
+		PipelineStateCache::EntryHeader empty = header;
+		empty.BlobSize = 0;
+		return !PipelineStateCache::IsEntryValid(badMagic, key, adapterHash, fileSize) &&
+			!PipelineStateCache::IsEntryValid(badVersion, key, adapterHash, fileSize) &&
+			!PipelineStateCache::IsEntryValid(empty, key, adapterHash, sizeof(header));
+	}
+
+	// Builds the shader graph from in-memory sources, two files sharing an include
+	// that has an include of its own, and checks that touching a shared include
+	// reaches every permutation and PSO built from it while touching a leaf file
+	// reaches only that file's.
+	bool CheckShaderDependencies()
+	{
+		const std::unordered_map<std::wstring, std::string> sources =
+		{
+			{ L"Shaders\\Default.hlsl", "#include \"Common.hlsl\"\nfloat4 PS() : SV_Target;\n" },
+			{ L"Shaders\\TreeSprite.hlsl", "  #  include \"Common.hlsl\"\n" },
+			{ L"Shaders\\Common.hlsl", "#include \"LightingUtil.hlsl\"\n" },
+			{ L"Shaders\\LightingUtil.hlsl", "float3 ComputeLighting();\n" },
+			{ L"Shaders\\Overlay.hlsl", "float4 VS() : SV_Position;\n" }
+		};
+		auto read = [&sources](const std::wstring& filename, std::string& contents)
+		{
+			auto source = sources.find(filename);
+			if(source == sources.end())
+				return false;
+
+			contents = source->second;
+			return true;
+		};
+
+		const std::vector<std::wstring> defaultFiles = ShaderCache::GatherSourceFiles(L"Shaders\\Default.hlsl", read);
+		if(defaultFiles != std::vector<std::wstring>{ L"Shaders\\Default.hlsl", L"Shaders\\Common.hlsl", L"Shaders\\LightingUtil.hlsl" })
+			return false;
+
+		ShaderDependencyGraph graph;
+		const std::pair<const char*, const wchar_t*> shaders[] =
+		{
+			{ "standardVS", L"Shaders\\Default.hlsl" },
+			{ "opaquePS", L"Shaders\\Default.hlsl" },
+			{ "treeSpriteVS", L"Shaders\\TreeSprite.hlsl" },
+			{ "treeSpritePS", L"Shaders\\TreeSprite.hlsl" },
+			{ "overlayVS", L"Shaders\\Overlay.hlsl" },
+			{ "overlayPS", L"Shaders\\Overlay.hlsl" }
+		};
+		for(const auto& shader : shaders)
+			graph.SetShaderSources(shader.first, ShaderCache::GatherSourceFiles(shader.second, read));
+
+		graph.SetPipelineShaders("opaque", { "standardVS", "opaquePS" });
+		graph.SetPipelineShaders("opaqueDepth", { "standardVS" });
+		graph.SetPipelineShaders("treeSprites", { "treeSpriteVS", "treeSpritePS" });
+		graph.SetPipelineShaders("overlay", { "overlayVS", "overlayPS" });
+
+		typedef std::vector<std::string> Names;
+
+		// The include's include, spelt the way a file watcher might report it.
+		const Names fromInclude = graph.ShadersAffectedBy({ L".\\shaders/LIGHTINGUTIL.hlsl" });
+		if(fromInclude != Names{ "standardVS", "opaquePS", "treeSpriteVS", "treeSpritePS" } ||
+			graph.PipelinesUsing(fromInclude) != Names{ "opaque", "opaqueDepth", "treeSprites" })
+			return false;
+
+		const Names fromLeaf = graph.ShadersAffectedBy({ L"Shaders\\TreeSprite.hlsl" });
+		if(fromLeaf != Names{ "treeSpriteVS", "treeSpritePS" } || graph.PipelinesUsing(fromLeaf) != Names{ "treeSprites" })
+			return false;
+
+		const Names fromOverlay = graph.ShadersAffectedBy({ L"Shaders\\Overlay.hlsl" });
+		if(fromOverlay != Names{ "overlayVS", "overlayPS" } || graph.PipelinesUsing(fromOverlay) != Names{ "overlay" })
+			return false;
+
+		return graph.ShadersAffectedBy({ L"Shaders\\Unused.hlsl" }).empty();
+	}
+
+	// Checks GpuTimestampLog by hand over a two-frame ring: query indices of nested
+	// markers, NoQuery once the heap is full, Pending until Retire consumes a frame,
+	// and durations in milliseconds at a 1 MHz timestamp frequency.
+	bool CheckGpuTimestamps()
+	{
+		// Three markers, so six queries a frame.
+		GpuTimestampLog log(2, 3, 8);
+		if(log.MaxQueries() != 6)
+			return false;
+
+		// Frame 0: "frame" around "shadow" and then "opaque", in query order.
+		log.BeginFrame(0);
+		const uint32_t frame0[] =
+		{
+			log.Begin("frame"), log.Begin("shadow"), log.End(), log.Begin("opaque"), log.End(), log.End()
+		};
+		for(uint32_t i = 0; i < _countof(frame0); ++i)
+		{
+			if(frame0[i] != i)
+				return false;
+		}
+		if(log.EndFrame() != 6 || !log.Pending(0) || log.Pending(1))
+			return false;
+
+		// Frame 1: three open markers fill the heap, so a fourth gets no queries, and
+		// neither does its End; the ones around it still close in order.
+		log.BeginFrame(1);
+		const uint32_t frame1[] =
+		{
+			log.Begin("frame"), log.Begin("shadow"), log.Begin("opaque"), log.Begin("shadow"),
+			log.End(), log.End(), log.End(), log.End()
+		};
+		const uint32_t expected1[] = { 0, 1, 2, GpuTimestampLog::NoQuery, GpuTimestampLog::NoQuery, 3, 4, 5 };
+		if(memcmp(frame1, expected1, sizeof(frame1)) != 0 || log.EndFrame() != 6 || !log.Pending(1))
+			return false;
+
+		// A tick is a microsecond, 0.001 ms.
+		const uint64_t ticksPerSecond = 1000000;
+		const uint64_t ticks0[] = { 1000, 1500, 3500, 4000, 9000, 10000 };
+		const uint64_t ticks1[] = { 0, 100, 200, 700, 900, 1000 };
+
+		log.Retire(0, ticks0, ticksPerSecond);
+		if(log.Pending(0) || !log.Pending(1) || log.MarkerCount() != 3 ||
+			log.MarkerName(0) != "frame" || log.MarkerName(1) != "shadow" || log.MarkerName(2) != "opaque")
+			return false;
+
+		// Retiring twice adds nothing.
+		log.Retire(0, ticks0, ticksPerSecond);
+		log.Retire(1, ticks1, ticksPerSecond);
+		if(log.Pending(1))
+			return false;
+
+		// frame: 9 ms then 1 ms; shadow: 2 ms then 0.8 ms; opaque: 5 ms then 0.5 ms.
+		const double expectedMs[3][2] = { { 1.0, 9.0 }, { 0.8, 2.0 }, { 0.5, 5.0 } };
+		for(uint32_t marker = 0; marker < 3; ++marker)
+		{
+			const RollingStats& stats = log.MarkerStats(marker);
+			if(stats.Count() != 2 ||
+				fabs(stats.Min() - expectedMs[marker][0]) > 1.0e-9 || fabs(stats.Max() - expectedMs[marker][1]) > 1.0e-9)
+				return false;
+		}
+
+		// Reusing frame 0's slot drops what it had not retired.
+		log.BeginFrame(0);
+		log.Begin("frame");
+		log.End();
+		if(log.EndFrame() != 2 || !log.Pending(0))
+			return false;
+		log.BeginFrame(0);
+		if(log.EndFrame() != 0 || log.Pending(0))
+			return false;
+
+		return true;
+	}
+
+	// Hand-driven clock for the GameTimer and FramePacer checks, in nanoseconds.
+	std::int64_t gFakeTicks = 0;
+
+	std::int64_t FakeTickSource()
+	{
+		return gFakeTicks;
+	}
+
+	// Checks GameTimer on the fake clock: a Stop/Start gap never reaches the totals, a
+	// fixed step replaces the frame time, a scale of 1/4 carries its fraction of a
+	// tick from frame to frame, and seconds keep 1 ns resolution after ten days.
+	bool CheckGameTimer()
+	{
+		const std::int64_t ms = GameTimer::TicksPerSecond / 1000;
+
+		gFakeTicks = 5000*ms;
+		GameTimer timer(FakeTickSource);
+		timer.Reset();
+
+		gFakeTicks += 16*ms;
+		timer.Tick();
+		if(timer.TotalTicks() != 16*ms || timer.DeltaSeconds() != 0.016)
+			return false;
+
+		// Ten seconds paused, then 4 ms of running.
+		timer.Stop();
+		gFakeTicks += 10000*ms;
+		timer.Tick();
+		if(timer.TotalTicks() != 16*ms || timer.DeltaSeconds() != 0.0 || timer.RealDeltaSeconds() != 0.0)
+			return false;
+		timer.Start();
+		gFakeTicks += 4*ms;
+		timer.Tick();
+		if(timer.TotalTicks() != 20*ms || timer.RealTotalSeconds() != 0.020)
+			return false;
+
+		// A 1/60 s step whatever the clock did; the real time still follows the clock.
+		const std::int64_t step = 16666667;
+		timer.SetFixedDelta(1.0/60.0);
+		gFakeTicks += 50*ms;
+		timer.Tick();
+		if(timer.TotalTicks() != 20*ms + step || timer.RealDeltaSeconds() != 0.050 || timer.RealTotalSeconds() != 0.070)
+			return false;
+		timer.SetFixedDelta(0.0);
+
+		// A quarter of a tick a frame: whole ticks every fourth frame, none lost.
+		timer.SetTimeScale(0.25);
+		const std::int64_t beforeScale = timer.TotalTicks();
+		for(int frame = 1; frame <= 8; ++frame)
+		{
+			gFakeTicks += 1;
+			timer.Tick();
+			if(timer.TotalTicks() != beforeScale + frame/4)
+				return false;
+		}
+		timer.SetTimeScale(1.0);
+
+		// Ten days and 1 ns, then 1 ns more.
+		const std::int64_t tenDays = 864000*GameTimer::TicksPerSecond;
+		timer.Reset();
+		gFakeTicks += tenDays + 1;
+		timer.Tick();
+		if(timer.TotalTicks() != tenDays + 1 || fabs(timer.TotalSeconds() - 864000.0 - 1.0e-9) > 2.0e-10)
+			return false;
+		gFakeTicks += 1;
+		timer.Tick();
+		if(timer.TotalTicks() != tenDays + 2 || timer.DeltaSeconds() != 1.0e-9 ||
+			fabs(timer.TotalSeconds() - 864000.0 - 2.0e-9) > 2.0e-10)
+			return false;
+
+		return true;
+	}
+
+	// Checks FramePacer's schedule on the fake clock at 100 fps: frames begin exactly
+	// on their 10 ms slots, a hitch longer than a period restarts the schedule once and
+	// counts one missed frame, and low latency mode begins a frame as late in its slot
+	// as the slowest recent frame plus the 0.5 ms margin allows.
+	bool CheckFramePacer()
+	{
+		const std::int64_t ms = GameTimer::TicksPerSecond / 1000;
+		const std::int64_t period = 10*ms;
+		const std::int64_t t0 = 1000*ms;
+
+		FramePacer pacer(FakeTickSource);
+		pacer.SetTargetFps(100.0);
+		if(pacer.TargetFps() != 100.0)
+			return false;
+
+		auto startAt = [&pacer](std::int64_t now) { gFakeTicks = now; return pacer.NextFrameStart(pacer.Now()); };
+		auto endAt = [&pacer](std::int64_t now) { gFakeTicks = now; pacer.EndFrame(); };
+
+		// The first frame starts the schedule; early ones wait for their slot, and
+		// one a little late starts at once without moving the slots after it.
+		if(startAt(t0) != t0)
+			return false;
+		for(std::int64_t k = 1; k <= 5; ++k)
+		{
+			if(startAt(t0 + k*period - 1*ms) != t0 + k*period)
+				return false;
+		}
+		if(startAt(t0 + 6*period + 3*ms) != t0 + 6*period + 3*ms || startAt(t0 + 6*period + 4*ms) != t0 + 7*period)
+			return false;
+		if(pacer.MissedFrames() != 0)
+			return false;
+
+		// A 25 ms hitch: slot 8 is more than a period gone, so the schedule restarts
+		// from now rather than rushing frames 8 and 9.
+		const std::int64_t hitch = t0 + 7*period + 25*ms;
+		if(startAt(hitch) != hitch || pacer.MissedFrames() != 1)
+			return false;
+		if(startAt(hitch + 2*ms) != hitch + period || startAt(hitch + period + 2*ms) != hitch + 2*period ||
+			pacer.MissedFrames() != 1)
+			return false;
+
+		// Low latency: 3 ms of work starts frame 1 at 10 - 3 - 0.5 = 6.5 ms into its slot.
+		FramePacer lowLatency(FakeTickSource);
+		lowLatency.SetTargetFps(100.0);
+		lowLatency.SetLowLatency(true);
+
+		auto startLowAt = [&lowLatency](std::int64_t now) { gFakeTicks = now; return lowLatency.NextFrameStart(lowLatency.Now()); };
+		auto endLowAt = [&lowLatency](std::int64_t now) { gFakeTicks = now; lowLatency.EndFrame(); };
+
+		const std::int64_t late = 6*ms + ms/2;
+		if(startLowAt(t0) != t0)
+			return false;
+		endLowAt(t0 + 3*ms);
+		if(lowLatency.PredictedWorkMs() != 3.0 || startLowAt(t0 + 4*ms) != t0 + period + late)
+			return false;
+
+		// A faster frame does not lower the prediction, a slower one raises it; work
+		// longer than the slot allows starts on the slot itself.
+		endLowAt(t0 + period + late + 2*ms);
+		if(startLowAt(t0 + period + late + 3*ms) != t0 + 2*period + late)
+			return false;
+		endLowAt(t0 + 2*period + late + 12*ms);
+		if(lowLatency.PredictedWorkMs() != 12.0 || startLowAt(t0 + 3*period - 1*ms) != t0 + 3*period)
+			return false;
+
+		// Unlimited frames start whenever they are asked for.
+		pacer.SetTargetFps(0.0);
+		if(startAt(hitch + 3*period) != hitch + 3*period)
+			return false;
+		endAt(hitch + 3*period + 1*ms);
+
+		return lowLatency.MissedFrames() == 0;
+	}
+
+	// Checks MemoryTracker's bookkeeping: adding under a key, replacing it in place or
+	// into another category, removing it (twice, and keys never added), the totals and
+	// peaks per category and overall, and the per-asset lines of the report.  Starts
+	// and ends with Reset, so only run it when nothing else is tracked.
+	bool CheckMemoryTracker()
+	{
+		const std::uint64_t MB = 1024*1024;
+		const int keys[8] = {};
+
+		MemoryTracker::Reset();
+		MemoryTracker::Add(&keys[0], MemoryCategory::Texture, "grass", 1*MB);
+		MemoryTracker::Add(&keys[1], MemoryCategory::Texture, "water", 3*MB);
+		MemoryTracker::Add(&keys[2], MemoryCategory::Geometry, "hills", MB/2);
+		if(MemoryTracker::CurrentBytes(MemoryCategory::Texture) != 4*MB || MemoryTracker::Allocations(MemoryCategory::Texture) != 2 ||
+			MemoryTracker::TotalBytes() != 4*MB + MB/2 || MemoryTracker::TotalPeakBytes() != 4*MB + MB/2)
+			return false;
+
+		// Replacing grows grass in place, then moves hills to another category.
+		MemoryTracker::Add(&keys[0], MemoryCategory::Texture, "grass", 2*MB);
+		MemoryTracker::Add(&keys[2], MemoryCategory::Upload, "hillsUpload", MB/4);
+		if(MemoryTracker::CurrentBytes(MemoryCategory::Texture) != 5*MB || MemoryTracker::Allocations(MemoryCategory::Texture) != 2 ||
+			MemoryTracker::CurrentBytes(MemoryCategory::Geometry) != 0 || MemoryTracker::Allocations(MemoryCategory::Geometry) != 0 ||
+			MemoryTracker::PeakBytes(MemoryCategory::Geometry) != MB/2 || MemoryTracker::CurrentBytes(MemoryCategory::Upload) != MB/4 ||
+			MemoryTracker::TotalBytes() != 5*MB + MB/4 || MemoryTracker::TotalPeakBytes() != 5*MB + MB/2)
+			return false;
+
+		// Removing keeps the peaks; a second Remove and an unknown key do nothing.
+		MemoryTracker::Remove(&keys[1]);
+		MemoryTracker::Remove(&keys[1]);
+		MemoryTracker::Remove(&keys[7]);
+		if(MemoryTracker::CurrentBytes(MemoryCategory::Texture) != 2*MB || MemoryTracker::PeakBytes(MemoryCategory::Texture) != 5*MB ||
+			MemoryTracker::Allocations(MemoryCategory::Texture) != 1 ||
+			MemoryTracker::TotalBytes() != 2*MB + MB/4 || MemoryTracker::TotalPeakBytes() != 5*MB + MB/2)
+			return false;
+
+		// One asset per frame resource, summed under its name, and a larger texture.
+		MemoryTracker::Add(&keys[3], MemoryCategory::FrameResource, "frameCB", 1*MB);
+		MemoryTracker::Add(&keys[4], MemoryCategory::FrameResource, "frameCB", 1*MB);
+		MemoryTracker::Add(&keys[5], MemoryCategory::Texture, "sky", 3*MB);
+		if(MemoryTracker::Allocations(MemoryCategory::FrameResource) != 2 || MemoryTracker::TotalBytes() != 7*MB + MB/4)
+			return false;
+
+		// Category, name and size columns of 16, 32 and 12; largest first in a category.
+		const std::string report = MemoryTracker::Report();
+		const size_t sky = report.find("\ntexture         sky                                    3.000 MB\n");
+		const size_t grass = report.find("\ntexture         grass                                  2.000 MB\n");
+		const size_t upload = report.find("\nupload          hillsUpload                            0.250 MB\n");
+		const size_t frameCB = report.find("\nframeResource   frameCB                                2.000 MB  x2\n");
+		if(sky == std::string::npos || grass == std::string::npos || upload == std::string::npos || frameCB == std::string::npos ||
+			!(sky < grass && grass < upload && upload < frameCB) ||
+			report.find("water") != std::string::npos || report.find("hills ") != std::string::npos)
+			return false;
+
+		MemoryTracker::Reset();
+		return MemoryTracker::TotalBytes() == 0 && MemoryTracker::TotalPeakBytes() == 0 &&
+			MemoryTracker::Allocations(MemoryCategory::Texture) == 0;
+	}
+
+	// Just enough of a resource for d3dUtil::TrackResource: it keeps its name and
+	// private data interfaces, and releases the interfaces when it is destroyed, as
+	// the runtime does.  Everything else fails.
+	class FakeResource : public ID3D12Resource
+	{
+	public:
+		const std::wstring& Name()const
+		{
+			return mName;
+		}
+
+		virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object)override
+		{
+			if(riid == __uuidof(IUnknown) || riid == __uuidof(ID3D12Resource))
+			{
+				*object = static_cast<ID3D12Resource*>(this);
+				AddRef();
+				return S_OK;
+			}
+
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+
+		virtual ULONG STDMETHODCALLTYPE AddRef()override
+		{
+			return ++mRefCount;
+		}
+
+		virtual ULONG STDMETHODCALLTYPE Release()override
+		{
+			const ULONG refCount = --mRefCount;
+			if(refCount == 0)
+			{
+				for(auto& data : mInterfaces)
+					data.second->Release();
+				delete this;
+			}
+			return refCount;
+		}
+
+		virtual HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* dataSize, void* data)override
+		{
+			return DXGI_ERROR_NOT_FOUND;
+		}
+
+		virtual HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT dataSize, const void* data)override
+		{
+			return E_NOTIMPL;
+		}
+
+		// Replacing or clearing an interface releases the one it had.
+		virtual HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* data)override
+		{
+			IUnknown* added = const_cast<IUnknown*>(data);
+			if(added != nullptr)
+				added->AddRef();
+
+			for(auto it = mInterfaces.begin(); it != mInterfaces.end(); ++it)
+			{
+				if(it->first == guid)
+				{
+					IUnknown* replaced = it->second;
+					mInterfaces.erase(it);
+					replaced->Release();
+					break;
+				}
+			}
+
+			if(added != nullptr)
+				mInterfaces.push_back(std::make_pair(guid, added));
+			return S_OK;
+		}
+
+		virtual HRESULT STDMETHODCALLTYPE SetName(LPCWSTR name)override
+		{
+			mName = name;
+			return S_OK;
+		}
+
+		virtual HRESULT STDMETHODCALLTYPE GetDevice(REFIID riid, void** device)override
+		{
+			*device = nullptr;
+			return E_NOTIMPL;
+		}
+
+		virtual HRESULT STDMETHODCALLTYPE Map(UINT subresource, const D3D12_RANGE* readRange, void** data)override
+		{
+			return E_NOTIMPL;
+		}
+
+		virtual void STDMETHODCALLTYPE Unmap(UINT subresource, const D3D12_RANGE* writtenRange)override
+		{
+		}
+
+		virtual D3D12_RESOURCE_DESC STDMETHODCALLTYPE GetDesc()override
+		{
+			return CD3DX12_RESOURCE_DESC::Buffer(0);
+		}
+
+		virtual D3D12_GPU_VIRTUAL_ADDRESS STDMETHODCALLTYPE GetGPUVirtualAddress()override
+		{
+			return 0;
+		}
+
+		virtual HRESULT STDMETHODCALLTYPE WriteToSubresource(UINT dstSubresource, const D3D12_BOX* dstBox,
+			const void* srcData, UINT srcRowPitch, UINT srcDepthPitch)override
+		{
+			return E_NOTIMPL;
+		}
+
+		virtual HRESULT STDMETHODCALLTYPE ReadFromSubresource(void* dstData, UINT dstRowPitch, UINT dstDepthPitch,
+			UINT srcSubresource, const D3D12_BOX* srcBox)override
+		{
+			return E_NOTIMPL;
+		}
+
+		virtual HRESULT STDMETHODCALLTYPE GetHeapProperties(D3D12_HEAP_PROPERTIES* heapProperties,
+			D3D12_HEAP_FLAGS* heapFlags)override
+		{
+			return E_NOTIMPL;
+		}
+
+	private:
+		std::vector<std::pair<GUID, IUnknown*>> mInterfaces;
+		ULONG mRefCount = 1;
+		std::wstring mName;
+	};
+
+	// Checks the D3D side of the MemoryTracker on a FakeResource: TrackResource adds
+	// and names it, tracking it again moves it rather than counting it twice, and it
+	// stays tracked until its last reference goes.  A CreateBlob blob is counted
+	// until it is released.  Starts and ends with Reset, like CheckMemoryTracker.
+	bool CheckResourceTracking()
+	{
+		MemoryTracker::Reset();
+
+		FakeResource* resource = new FakeResource;
+		d3dUtil::TrackResource(resource, 4096, MemoryCategory::Texture, "grass");
+		if(MemoryTracker::CurrentBytes(MemoryCategory::Texture) != 4096 || MemoryTracker::Allocations(MemoryCategory::Texture) != 1 ||
+			resource->Name() != L"grass")
+			return false;
+
+		// The earlier notifier is released when it is replaced, and must not take the
+		// new entry with it.
+		d3dUtil::TrackResource(resource, 8192, MemoryCategory::Upload, "grass.upload");
+		if(MemoryTracker::CurrentBytes(MemoryCategory::Texture) != 0 || MemoryTracker::Allocations(MemoryCategory::Texture) != 0 ||
+			MemoryTracker::CurrentBytes(MemoryCategory::Upload) != 8192 || MemoryTracker::TotalBytes() != 8192)
+			return false;
+
+		resource->AddRef();
+		resource->Release();
+		if(MemoryTracker::TotalBytes() != 8192)
+			return false;
+		resource->Release();
+		if(MemoryTracker::TotalBytes() != 0 || MemoryTracker::Allocations(MemoryCategory::Upload) != 0)
+			return false;
+
+		Microsoft::WRL::ComPtr<ID3DBlob> blob = d3dUtil::CreateBlob(100, MemoryCategory::CpuBlob, "vertices");
+		if(blob->GetBufferSize() != 100 || MemoryTracker::CurrentBytes(MemoryCategory::CpuBlob) != 100)
+			return false;
+		blob = nullptr;
+		if(MemoryTracker::TotalBytes() != 0 || MemoryTracker::TotalPeakBytes() != 8192)
+			return false;
+
+		MemoryTracker::Reset();
+		return true;
+	}
+
+	const SelfTest gCommonSelfTests[] =
+	{
+		{ "camera matrices", CheckCameraMatrices },
+		{ "batch transforms", CheckBatchTransforms },
+		{ "frustum batches", CheckFrustumBatches },
+		{ "pipeline cache keys", CheckPipelineCacheKeys },
+		{ "shader dependencies", CheckShaderDependencies },
+		{ "GPU timestamps", CheckGpuTimestamps },
+		{ "GameTimer", CheckGameTimer },
+		{ "FramePacer", CheckFramePacer },
+		{ "MemoryTracker", CheckMemoryTracker },
+		{ "resource tracking", CheckResourceTracking },
+	};
+}
+
+int RunSelfTests(const SelfTest* appTests, size_t appTestCount)
+{
+	int failed = 0;
+	int run = 0;
+	auto check = [&failed, &run](const SelfTest& test)
+	{
+		++run;
+		if(test.Run())
+			return;
+
+		const std::string message = std::string("Self-test failed: ") + test.Name + "\n";
+		fputs(message.c_str(), stderr);
+		OutputDebugStringA(message.c_str());
+		++failed;
+	};
+
+	for(const SelfTest& test : gCommonSelfTests)
+		check(test);
+	for(size_t i = 0; i < appTestCount; ++i)
+		check(appTests[i]);
+
+	if(failed == 0)
+		return 0;
+
+	fprintf(stderr, "%d of %d self-tests failed.\n", failed, run);
+	return 2;
+}
@@ -0,0 +1,23 @@
+//***************************************************************************************
+// SelfTests.h
+//
+// Checks of the Common code that need no window or device, run by -selftest in
+// place of unit tests.  An app passes its own checks to RunSelfTests, which runs the
+// Common ones first.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+
+struct SelfTest
+{
+	const char* Name;
+
+	// Returns false if the check fails.
+	bool (*Run)();
+};
+
+// Runs every Common check and then each of appTests, and reports each one that
+// fails to stderr and the debugger.  Returns 0 if all of them pass, else 2.
+int RunSelfTests(const SelfTest* appTests, size_t appTestCount);
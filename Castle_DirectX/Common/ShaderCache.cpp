@@ -0,0 +1,199 @@
+//***************************************************************************************
+// ShaderCache.cpp
+//***************************************************************************************
+
+#include "ShaderCache.h"
+#include <iomanip>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	bool ReadFileContents(const std::wstring& filename, std::string& contents)
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		if(!fin)
+			return false;
+
+		std::ostringstream ss;
+		ss << fin.rdbuf();
+		contents = ss.str();
+
+		return true;
+	}
+
+	bool FileExists(const std::wstring& filename)
+	{
+		DWORD attributes = GetFileAttributesW(filename.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) == 0;
+	}
+
+	std::wstring DirectoryOf(const std::wstring& filename)
+	{
+		size_t slash = filename.find_last_of(L"\\/");
+		return slash == std::wstring::npos ? std::wstring() : filename.substr(0, slash + 1);
+	}
+
+	std::wstring StemOf(const std::wstring& filename)
+	{
+		size_t slash = filename.find_last_of(L"\\/");
+		std::wstring name = slash == std::wstring::npos ? filename : filename.substr(slash + 1);
+
+		size_t dot = name.find_last_of(L'.');
+		return dot == std::wstring::npos ? name : name.substr(0, dot);
+	}
+
+	// Appends the quoted file names of all #include directives in the source.
+	void ParseIncludes(const std::string& source, std::vector<std::string>& includes)
+	{
+		std::istringstream lines(source);
+		std::string line;
+		while(std::getline(lines, line))
+		{
+			size_t pos = line.find_first_not_of(" \t");
+			if(pos == std::string::npos || line[pos] != '#')
+				continue;
+
+			pos = line.find_first_not_of(" \t", pos + 1);
+			if(pos == std::string::npos || line.compare(pos, 7, "include") != 0)
+				continue;
+
+			size_t open = line.find('"', pos + 7);
+			size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+			if(close != std::string::npos)
+				includes.push_back(line.substr(open + 1, close - open - 1));
+		}
+	}
+}
+
+ShaderCache::ShaderCache(const std::wstring& cacheDir)
+	: mCacheDir(cacheDir), mHits(0), mMisses(0)
+{
+	if(!CreateDirectoryW(mCacheDir.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		::OutputDebugStringA("ShaderCache: could not create the cache directory; shaders will not be cached.\n");
+	}
+}
+
+ShaderCache::~ShaderCache()
+{
+}
+
+ComPtr<ID3DBlob> ShaderCache::GetOrCompile(
+	const std::wstring& filename,
+	const D3D_SHADER_MACRO* defines,
+	const std::string& entrypoint,
+	const std::string& target)
+{
+	const UINT compileFlags = d3dUtil::ShaderCompileFlags();
+	const std::uint64_t key = ComputeKey(filename, defines, entrypoint, target, compileFlags);
+	const std::wstring cachedFile = CacheFilename(filename, entrypoint, target, key);
+
+	if(FileExists(cachedFile))
+	{
+		++mHits;
+		return d3dUtil::LoadBinary(cachedFile);
+	}
+
+	++mMisses;
+	ComPtr<ID3DBlob> byteCode = d3dUtil::CompileShader(filename, defines, entrypoint, target);
+
+	// A failed write only costs a recompile next launch, so it is not fatal.
+	if(FAILED(D3DWriteBlobToFile(byteCode.Get(), cachedFile.c_str(), TRUE)))
+	{
+		::OutputDebugStringA("ShaderCache: failed to write a cache entry.\n");
+	}
+
+	return byteCode;
+}
+
+std::uint64_t ShaderCache::ComputeKey(
+	const std::wstring& filename,
+	const D3D_SHADER_MACRO* defines,
+	const std::string& entrypoint,
+	const std::string& target,
+	UINT compileFlags)
+{
+	std::uint64_t key = d3dUtil::HashBytes(&compileFlags, sizeof(compileFlags));
+	key = d3dUtil::HashString(entrypoint, key);
+	key = d3dUtil::HashString(target, key);
+
+	for(const D3D_SHADER_MACRO* d = defines; d != nullptr && d->Name != nullptr; ++d)
+	{
+		key = d3dUtil::HashString(d->Name, key);
+		key = d3dUtil::HashString(d->Definition != nullptr ? d->Definition : "", key);
+	}
+
+	// Hash the contents of the shader and its includes, not their names or
+	// timestamps, so touching a file without changing it keeps the entry valid.
+	std::string contents;
+	for(const std::wstring& source : GatherSourceFiles(filename))
+	{
+		contents.clear();
+		ReadFileContents(source, contents);
+		key = d3dUtil::HashString(contents, key);
+	}
+
+	return key;
+}
+
+std::vector<std::wstring> ShaderCache::GatherSourceFiles(const std::wstring& filename)
+{
+	return GatherSourceFiles(filename, ReadFileContents);
+}
+
+std::vector<std::wstring> ShaderCache::GatherSourceFiles(const std::wstring& filename,
+	const std::function<bool(const std::wstring&, std::string&)>& read)
+{
+	std::vector<std::wstring> files;
+	std::vector<std::wstring> pending = { filename };
+
+	while(!pending.empty())
+	{
+		std::wstring file = pending.back();
+		pending.pop_back();
+
+		if(std::find(files.begin(), files.end(), file) != files.end())
+			continue;
+		files.push_back(file);
+
+		std::string source;
+		if(!read(file, source))
+			continue;
+
+		std::vector<std::string> includes;
+		ParseIncludes(source, includes);
+
+		const std::wstring dir = DirectoryOf(file);
+		for(auto it = includes.rbegin(); it != includes.rend(); ++it)
+			pending.push_back(dir + AnsiToWString(*it));
+	}
+
+	return files;
+}
+
+const std::wstring& ShaderCache::CacheDir()const
+{
+	return mCacheDir;
+}
+
+UINT ShaderCache::Hits()const
+{
+	return mHits;
+}
+
+UINT ShaderCache::Misses()const
+{
+	return mMisses;
+}
+
+std::wstring ShaderCache::CacheFilename(const std::wstring& filename, const std::string& entrypoint,
+	const std::string& target, std::uint64_t key)const
+{
+	std::wostringstream name;
+	name << mCacheDir << L"\\" << StemOf(filename) << L"_" << AnsiToWString(entrypoint)
+		<< L"_" << AnsiToWString(target) << L"_"
+		<< std::hex << std::setw(16) << std::setfill(L'0') << key << L".cso";
+
+	return name.str();
+}
@@ -0,0 +1,64 @@
+//***************************************************************************************
+// ShaderCache.h
+//
+// Disk cache of compiled shader bytecode.  Each entry is keyed on a hash of the shader
+// source, every file it #includes, the macro defines, the entry point, the target
+// profile and the compile flags, so editing any of them produces a cache miss and
+// the shader is recompiled.  On a hit the precompiled .cso is loaded instead of
+// running D3DCompileFromFile.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include <atomic>
+#include <functional>
+
+class ShaderCache
+{
+public:
+	explicit ShaderCache(const std::wstring& cacheDir);
+	ShaderCache(const ShaderCache& rhs) = delete;
+	ShaderCache& operator=(const ShaderCache& rhs) = delete;
+	~ShaderCache();
+
+	// Returns the cached bytecode if an entry with a matching key exists; otherwise
+	// compiles the shader and stores the result in the cache directory.
+	Microsoft::WRL::ComPtr<ID3DBlob> GetOrCompile(
+		const std::wstring& filename,
+		const D3D_SHADER_MACRO* defines,
+		const std::string& entrypoint,
+		const std::string& target);
+
+	// Hash identifying one compiled permutation of a shader file.
+	static std::uint64_t ComputeKey(
+		const std::wstring& filename,
+		const D3D_SHADER_MACRO* defines,
+		const std::string& entrypoint,
+		const std::string& target,
+		UINT compileFlags);
+
+	// Returns the shader file followed by every file it #includes (recursively).
+	// Includes are resolved relative to the including file, which matches
+	// D3D_COMPILE_STANDARD_FILE_INCLUDE.
+	static std::vector<std::wstring> GatherSourceFiles(const std::wstring& filename);
+
+	// The same, with each file's contents from read instead of the disk; a file
+	// read fails for is listed but not scanned for includes.
+	static std::vector<std::wstring> GatherSourceFiles(const std::wstring& filename,
+		const std::function<bool(const std::wstring&, std::string&)>& read);
+
+	const std::wstring& CacheDir()const;
+	UINT Hits()const;
+	UINT Misses()const;
+
+private:
+	std::wstring CacheFilename(const std::wstring& filename, const std::string& entrypoint,
+		const std::string& target, std::uint64_t key)const;
+
+private:
+	std::wstring mCacheDir;
+
+	std::atomic<UINT> mHits;
+	std::atomic<UINT> mMisses;
+};
@@ -0,0 +1,106 @@
+//***************************************************************************************
+// ShaderDependencyGraph.cpp
+//***************************************************************************************
+
+#include "ShaderDependencyGraph.h"
+#include <algorithm>
+#include <cwctype>
+
+namespace
+{
+	std::wstring Widen(const std::string& str)
+	{
+		return std::wstring(str.begin(), str.end());
+	}
+
+	template<typename Container, typename T>
+	bool Contains(const Container& c, const T& value)
+	{
+		return std::find(c.begin(), c.end(), value) != c.end();
+	}
+}
+
+void ShaderDependencyGraph::SetShaderSources(const std::string& shader, const std::vector<std::wstring>& files)
+{
+	Node node = { shader, {} };
+	for(const std::wstring& file : files)
+		node.Inputs.push_back(NormalizePath(file));
+
+	auto it = std::find_if(mShaders.begin(), mShaders.end(), [&shader](const Node& n) { return n.Name == shader; });
+	if(it != mShaders.end())
+		*it = node;
+	else
+		mShaders.push_back(node);
+}
+
+void ShaderDependencyGraph::SetPipelineShaders(const std::string& pipeline, const std::vector<std::string>& shaders)
+{
+	// Shader names are ASCII identifiers, so widening them byte by byte is enough
+	// to share the Node type with the file lists.
+	Node node = { pipeline, {} };
+	for(const std::string& shader : shaders)
+		node.Inputs.push_back(Widen(shader));
+
+	auto it = std::find_if(mPipelines.begin(), mPipelines.end(), [&pipeline](const Node& n) { return n.Name == pipeline; });
+	if(it != mPipelines.end())
+		*it = node;
+	else
+		mPipelines.push_back(node);
+}
+
+std::vector<std::string> ShaderDependencyGraph::ShadersAffectedBy(const std::vector<std::wstring>& changedFiles)const
+{
+	std::vector<std::wstring> changed;
+	for(const std::wstring& file : changedFiles)
+		changed.push_back(NormalizePath(file));
+
+	std::vector<std::string> affected;
+	for(const Node& shader : mShaders)
+	{
+		for(const std::wstring& input : shader.Inputs)
+		{
+			if(Contains(changed, input))
+			{
+				affected.push_back(shader.Name);
+				break;
+			}
+		}
+	}
+
+	return affected;
+}
+
+std::vector<std::string> ShaderDependencyGraph::PipelinesUsing(const std::vector<std::string>& shaders)const
+{
+	std::vector<std::wstring> changed;
+	for(const std::string& shader : shaders)
+		changed.push_back(Widen(shader));
+
+	std::vector<std::string> affected;
+	for(const Node& pipeline : mPipelines)
+	{
+		for(const std::wstring& input : pipeline.Inputs)
+		{
+			if(Contains(changed, input))
+			{
+				affected.push_back(pipeline.Name);
+				break;
+			}
+		}
+	}
+
+	return affected;
+}
+
+std::wstring ShaderDependencyGraph::NormalizePath(const std::wstring& filename)
+{
+	std::wstring path = filename;
+	for(wchar_t& c : path)
+		c = c == L'/' ? L'\\' : (wchar_t)std::towlower(c);
+
+	// Drop leading ".\" so "Shaders\a.hlsl" and ".\Shaders\a.hlsl" match.
+	while(path.compare(0, 2, L".\\") == 0)
+		path.erase(0, 2);
+
+	return path;
+}
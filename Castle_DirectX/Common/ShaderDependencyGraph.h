@@ -0,0 +1,48 @@
+//***************************************************************************************
+// ShaderDependencyGraph.h
+//
+// Tracks which source files each shader permutation was compiled from and which
+// shaders each pipeline state uses, so a changed file maps to exactly the shaders
+// that need recompiling and the PSOs that need rebuilding.  Plain C++ with no D3D or
+// Win32 dependency.
+//***************************************************************************************
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+class ShaderDependencyGraph
+{
+public:
+	ShaderDependencyGraph() = default;
+	ShaderDependencyGraph(const ShaderDependencyGraph& rhs) = delete;
+	ShaderDependencyGraph& operator=(const ShaderDependencyGraph& rhs) = delete;
+
+	// Replaces the source files of a shader: the file it is compiled from followed
+	// by everything it #includes (see ShaderCache::GatherSourceFiles).
+	void SetShaderSources(const std::string& shader, const std::vector<std::wstring>& files);
+
+	// Replaces the shaders a pipeline state is built from.
+	void SetPipelineShaders(const std::string& pipeline, const std::vector<std::string>& shaders);
+
+	// Shaders depending on any of the files, in the order they were registered.
+	std::vector<std::string> ShadersAffectedBy(const std::vector<std::wstring>& changedFiles)const;
+
+	// Pipelines using any of the shaders, in the order they were registered.
+	std::vector<std::string> PipelinesUsing(const std::vector<std::string>& shaders)const;
+
+	// File names are compared case-insensitively with '/' and '\' treated alike,
+	// matching how Windows resolves them.
+	static std::wstring NormalizePath(const std::wstring& filename);
+
+private:
+	struct Node
+	{
+		std::string Name;
+		std::vector<std::wstring> Inputs;
+	};
+
+	std::vector<Node> mShaders;
+	std::vector<Node> mPipelines;
+};
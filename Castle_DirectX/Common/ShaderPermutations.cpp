@@ -0,0 +1,155 @@
+//***************************************************************************************
+// ShaderPermutations.cpp
+//***************************************************************************************
+
+#include "ShaderPermutations.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// The shaders index a float3 shadow factor per directional light, so at most
+	// three are supported.
+	const UINT gDirLightBuckets[] = { 0, 1, 2, 3 };
+	const UINT gPointLightBuckets[] = { 0, 2, 4, 8 };
+	const UINT gSpotLightBuckets[] = { 0, 1, 2, 4 };
+
+	static_assert(3 + 8 + 4 <= MaxLights, "Largest light buckets do not fit in PassConstants::Lights.");
+
+	template<size_t N>
+	UINT RoundUpToBucket(const UINT (&buckets)[N], UINT count)
+	{
+		for(UINT bucket : buckets)
+		{
+			if(count <= bucket)
+				return bucket;
+		}
+
+		return buckets[N - 1];
+	}
+
+	std::wstring VariantName(const std::wstring& filename, const std::string& entrypoint,
+		const std::string& target, const ShaderPermutations::Key& key)
+	{
+		std::wostringstream name;
+		name << filename << L'|' << AnsiToWString(entrypoint) << L'|' << AnsiToWString(target) << L'|'
+			<< key.NumDirLights << L'.' << key.NumPointLights << L'.' << key.NumSpotLights << L'.' << key.Features;
+
+		return name.str();
+	}
+}
+
+UINT ShaderPermutations::Key::LightCount()const
+{
+	return NumDirLights + NumPointLights + NumSpotLights;
+}
+
+bool ShaderPermutations::Key::operator==(const Key& rhs)const
+{
+	return NumDirLights == rhs.NumDirLights &&
+		NumPointLights == rhs.NumPointLights &&
+		NumSpotLights == rhs.NumSpotLights &&
+		Features == rhs.Features;
+}
+
+bool ShaderPermutations::Key::operator!=(const Key& rhs)const
+{
+	return !(*this == rhs);
+}
+
+ShaderPermutations::ShaderPermutations(ShaderCache& cache)
+	: mShaderCache(cache)
+{
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+}
+
+ShaderPermutations::Key ShaderPermutations::Select(UINT numDirLights, UINT numPointLights,
+	UINT numSpotLights, UINT features)
+{
+	Key key;
+	key.NumDirLights = RoundUpToBucket(gDirLightBuckets, numDirLights);
+	key.NumPointLights = RoundUpToBucket(gPointLightBuckets, numPointLights);
+	key.NumSpotLights = RoundUpToBucket(gSpotLightBuckets, numSpotLights);
+	key.Features = features;
+
+	return key;
+}
+
+bool ShaderPermutations::Fits(const Key& key, UINT numDirLights, UINT numPointLights, UINT numSpotLights)
+{
+	return numDirLights <= key.NumDirLights &&
+		numPointLights <= key.NumPointLights &&
+		numSpotLights <= key.NumSpotLights;
+}
+
+ShaderPermutations::Key ShaderPermutations::Unlit(UINT features)
+{
+	return Select(0, 0, 0, features);
+}
+
+ComPtr<ID3DBlob> ShaderPermutations::GetOrCompile(
+	const std::wstring& filename,
+	const std::string& entrypoint,
+	const std::string& target,
+	const Key& key)
+{
+	const std::wstring name = VariantName(filename, entrypoint, target, key);
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mVariants.find(name);
+		if(it != mVariants.end())
+			return it->second;
+	}
+
+	const std::string dirLights = std::to_string(key.NumDirLights);
+	const std::string pointLights = std::to_string(key.NumPointLights);
+	const std::string spotLights = std::to_string(key.NumSpotLights);
+
+	std::vector<D3D_SHADER_MACRO> defines =
+	{
+		{ "NUM_DIR_LIGHTS", dirLights.c_str() },
+		{ "NUM_POINT_LIGHTS", pointLights.c_str() },
+		{ "NUM_SPOT_LIGHTS", spotLights.c_str() },
+	};
+
+	if(key.Features & FeatureFog)
+		defines.push_back({ "FOG", "1" });
+	if(key.Features & FeatureAlphaTest)
+		defines.push_back({ "ALPHA_TEST", "1" });
+	if(key.Features & FeatureClustered)
+		defines.push_back({ "CLUSTERED", "1" });
+
+	defines.push_back({ NULL, NULL });
+
+	// Compile outside the lock; two threads asking for the same new variant at
+	// once both compile it and the second result is discarded.
+	ComPtr<ID3DBlob> byteCode = mShaderCache.GetOrCompile(filename, defines.data(), entrypoint, target);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto inserted = mVariants.insert({ name, byteCode });
+
+	return inserted.first->second;
+}
+
+void ShaderPermutations::Evict(const std::wstring& filename)
+{
+	const std::wstring prefix = filename + L'|';
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	for(auto it = mVariants.begin(); it != mVariants.end(); )
+	{
+		if(it->first.compare(0, prefix.size(), prefix) == 0)
+			it = mVariants.erase(it);
+		else
+			++it;
+	}
+}
+
+UINT ShaderPermutations::VariantCount()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return (UINT)mVariants.size();
+}
@@ -0,0 +1,76 @@
+//***************************************************************************************
+// ShaderPermutations.h
+//
+// Generates variants of a shader for a given number of directional, point and spot
+// lights and a set of feature flags.  Light counts are rounded up to a small set of
+// buckets so a handful of variants covers every light setup; the caller pads the
+// light array with zero-strength lights up to the bucket sizes.  Compiled variants
+// are kept in memory and go through the ShaderCache on disk.
+//***************************************************************************************
+
+#pragma once
+
+#include "ShaderCache.h"
+#include <mutex>
+
+class ShaderPermutations
+{
+public:
+	// Feature flags, each mapped to a shader macro.
+	enum Feature : UINT
+	{
+		FeatureNone      = 0,
+		FeatureFog       = 1 << 0, // FOG
+		FeatureAlphaTest = 1 << 1, // ALPHA_TEST
+		FeatureClustered = 1 << 2, // CLUSTERED: point/spot lights come from the light clusters
+	};
+
+	// Identifies one variant.  The light counts are bucket sizes, not the number of
+	// lights actually in use.
+	struct Key
+	{
+		UINT NumDirLights = 0;
+		UINT NumPointLights = 0;
+		UINT NumSpotLights = 0;
+		UINT Features = FeatureNone;
+
+		UINT LightCount()const;
+		bool operator==(const Key& rhs)const;
+		bool operator!=(const Key& rhs)const;
+	};
+
+public:
+	explicit ShaderPermutations(ShaderCache& cache);
+	ShaderPermutations(const ShaderPermutations& rhs) = delete;
+	ShaderPermutations& operator=(const ShaderPermutations& rhs) = delete;
+	~ShaderPermutations();
+
+	// Smallest variant whose buckets hold the given lights.  Counts larger than the
+	// biggest bucket are clamped; Fits() reports whether that happened.
+	static Key Select(UINT numDirLights, UINT numPointLights, UINT numSpotLights, UINT features);
+
+	static bool Fits(const Key& key, UINT numDirLights, UINT numPointLights, UINT numSpotLights);
+
+	// Key for stages that do no lighting (vertex and geometry shaders), so they are
+	// not compiled once per light bucket.
+	static Key Unlit(UINT features);
+
+	// Returns the compiled variant, compiling it on first use.  Thread-safe.
+	Microsoft::WRL::ComPtr<ID3DBlob> GetOrCompile(
+		const std::wstring& filename,
+		const std::string& entrypoint,
+		const std::string& target,
+		const Key& key);
+
+	// Forgets the variants compiled from filename so the next GetOrCompile asks
+	// the ShaderCache again, which misses if the file or its includes changed.
+	void Evict(const std::wstring& filename);
+
+	UINT VariantCount()const;
+
+private:
+	ShaderCache& mShaderCache;
+
+	mutable std::mutex mMutex;
+	std::unordered_map<std::wstring, Microsoft::WRL::ComPtr<ID3DBlob>> mVariants;
+};
@@ -0,0 +1,75 @@
+//***************************************************************************************
+// ShaderWatcher.cpp
+//***************************************************************************************
+
+#include "ShaderWatcher.h"
+
+ShaderWatcher::ShaderWatcher(const std::wstring& directory, const std::wstring& pattern)
+	: mDirectory(directory), mPattern(pattern)
+{
+	mNotification = FindFirstChangeNotificationW(mDirectory.c_str(), FALSE,
+		FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+
+	if(mNotification == INVALID_HANDLE_VALUE)
+	{
+		::OutputDebugStringA("ShaderWatcher: could not watch the shader directory; hot reload is disabled.\n");
+	}
+
+	// Record the current state so the first Poll only reports later edits.
+	Scan(nullptr);
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+	if(mNotification != INVALID_HANDLE_VALUE)
+		FindCloseChangeNotification(mNotification);
+}
+
+bool ShaderWatcher::Poll(std::vector<std::wstring>& changedFiles)
+{
+	if(mNotification == INVALID_HANDLE_VALUE)
+		return false;
+
+	if(WaitForSingleObject(mNotification, 0) != WAIT_OBJECT_0)
+		return false;
+
+	// Re-arm before scanning so a write landing during the scan signals again.
+	FindNextChangeNotification(mNotification);
+
+	const size_t count = changedFiles.size();
+	Scan(&changedFiles);
+
+	return changedFiles.size() > count;
+}
+
+void ShaderWatcher::Scan(std::vector<std::wstring>* changedFiles)
+{
+	WIN32_FIND_DATAW data;
+	HANDLE find = FindFirstFileW((mDirectory + L"\\" + mPattern).c_str(), &data);
+	if(find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			continue;
+
+		ULARGE_INTEGER writeTime;
+		writeTime.LowPart = data.ftLastWriteTime.dwLowDateTime;
+		writeTime.HighPart = data.ftLastWriteTime.dwHighDateTime;
+
+		const std::wstring path = mDirectory + L"\\" + data.cFileName;
+
+		// Editors often write a file several times per save; each write is reported
+		// and the recompile simply runs again.
+		ULONGLONG& lastWrite = mWriteTimes[path];
+		if(lastWrite != writeTime.QuadPart)
+		{
+			if(changedFiles != nullptr)
+				changedFiles->push_back(path);
+			lastWrite = writeTime.QuadPart;
+		}
+	} while(FindNextFileW(find, &data));
+
+	FindClose(find);
+}
@@ -0,0 +1,39 @@
+//***************************************************************************************
+// ShaderWatcher.h
+//
+// Watches a shader directory for edits.  Uses a Win32 change notification so Poll()
+// is a single non-blocking wait while nothing changes; when the directory is
+// signalled, the files' last-write times are compared with the previous scan to find
+// which ones were modified.
+//***************************************************************************************
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ShaderWatcher
+{
+public:
+	// pattern selects the files to track, e.g. L"*.hlsl".
+	ShaderWatcher(const std::wstring& directory, const std::wstring& pattern);
+	ShaderWatcher(const ShaderWatcher& rhs) = delete;
+	ShaderWatcher& operator=(const ShaderWatcher& rhs) = delete;
+	~ShaderWatcher();
+
+	// Appends the paths (directory\name) of files written since the last call and
+	// returns true if there were any.  Never blocks.
+	bool Poll(std::vector<std::wstring>& changedFiles);
+
+private:
+	void Scan(std::vector<std::wstring>* changedFiles);
+
+private:
+	std::wstring mDirectory;
+	std::wstring mPattern;
+	HANDLE mNotification = INVALID_HANDLE_VALUE;
+
+	std::unordered_map<std::wstring, ULONGLONG> mWriteTimes;
+};
@@ -0,0 +1,57 @@
+//***************************************************************************************
+// StartupTimeline.cpp
+//***************************************************************************************
+
+#include <windows.h>
+#include <fstream>
+#include "StartupTimeline.h"
+
+StartupTimeline::StartupTimeline()
+	: mOrigin(std::chrono::steady_clock::now())
+{
+}
+
+double StartupTimeline::NowUs()const
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - mOrigin).count();
+}
+
+void StartupTimeline::Record(const std::string& name, double startUs, double endUs)
+{
+	Event e = { name, GetCurrentThreadId(), startUs, endUs };
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mEvents.push_back(e);
+}
+
+bool StartupTimeline::Write(const std::wstring& filename)const
+{
+	std::ofstream fout(filename);
+	if(!fout)
+		return false;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	// Complete ("X") events; ts and dur are in microseconds.
+	fout << "{\"traceEvents\":[\n";
+	for(size_t i = 0; i < mEvents.size(); ++i)
+	{
+		const Event& e = mEvents[i];
+		fout << "{\"name\":\"" << e.Name << "\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.ThreadId
+			<< ",\"ts\":" << e.StartUs << ",\"dur\":" << (e.EndUs - e.StartUs) << "}"
+			<< (i + 1 < mEvents.size() ? ",\n" : "\n");
+	}
+	fout << "]}\n";
+
+	return true;
+}
+
+StartupTimeline::Scope::Scope(StartupTimeline& timeline, const std::string& name)
+	: mTimeline(timeline), mName(name), mStartUs(timeline.NowUs())
+{
+}
+
+StartupTimeline::Scope::~Scope()
+{
+	mTimeline.Record(mName, mStartUs, mTimeline.NowUs());
+}
@@ -0,0 +1,59 @@
+//***************************************************************************************
+// StartupTimeline.h
+//
+// Records when each initialization job ran and on which thread, so the overlap of
+// the parallel shader/PSO jobs with the main-thread loading can be inspected.  The
+// result is written in Chrome trace format (chrome://tracing or ui.perfetto.dev).
+//***************************************************************************************
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class StartupTimeline
+{
+public:
+	StartupTimeline();
+	StartupTimeline(const StartupTimeline& rhs) = delete;
+	StartupTimeline& operator=(const StartupTimeline& rhs) = delete;
+
+	// Microseconds since the timeline was constructed.
+	double NowUs()const;
+
+	// Thread-safe; may be called from any job.
+	void Record(const std::string& name, double startUs, double endUs);
+
+	bool Write(const std::wstring& filename)const;
+
+	// Records the lifetime of the enclosing scope.
+	class Scope
+	{
+	public:
+		Scope(StartupTimeline& timeline, const std::string& name);
+		Scope(const Scope& rhs) = delete;
+		Scope& operator=(const Scope& rhs) = delete;
+		~Scope();
+
+	private:
+		StartupTimeline& mTimeline;
+		std::string mName;
+		double mStartUs;
+	};
+
+private:
+	struct Event
+	{
+		std::string Name;
+		unsigned long ThreadId;
+		double StartUs;
+		double EndUs;
+	};
+
+	std::chrono::steady_clock::time_point mOrigin;
+
+	mutable std::mutex mMutex;
+	std::vector<Event> mEvents;
+};
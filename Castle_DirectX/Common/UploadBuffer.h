@@ -53,6 +53,31 @@ public:
     void CopyData(int elementIndex, const T& data)
     {
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
+        mBytesWritten += sizeof(T);
+    }
+
+    // Copies only the first byteCount bytes of the element, e.g. the part of a
+    // constant buffer the bound shaders actually read.
+    void CopyData(int elementIndex, const T& data, UINT byteCount)
+    {
+        assert(byteCount <= sizeof(T));
+        memcpy(&mMappedData[elementIndex*mElementByteSize], &data, byteCount);
+        mBytesWritten += byteCount;
+    }
+
+    // Copies count consecutive elements; constant buffer elements are padded, so
+    // this is only for tightly packed buffers.
+    void CopyRange(int firstElement, const T* data, UINT count)
+    {
+        assert(!mIsConstantBuffer);
+        memcpy(&mMappedData[firstElement*mElementByteSize], data, count*sizeof(T));
+        mBytesWritten += count*sizeof(T);
+    }
+
+    // Total bytes copied into the buffer since it was created.
+    UINT64 BytesWritten()const
+    {
+        return mBytesWritten;
     }
 
 private:
@@ -61,4 +86,6 @@ private:
 
     UINT mElementByteSize = 0;
     bool mIsConstantBuffer = false;
+
+    UINT64 mBytesWritten = 0;
 };
\ No newline at end of file
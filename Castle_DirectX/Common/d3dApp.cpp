@@ -3,6 +3,7 @@
 //***************************************************************************************
 
 #include "d3dApp.h"
+#include "Profiler.h"
 #include <WindowsX.h>
 
 using Microsoft::WRL::ComPtr;
@@ -29,12 +30,22 @@ D3DApp::D3DApp(HINSTANCE hInstance)
     // Only one D3DApp can be constructed.
     assert(mApp == nullptr);
     mApp = this;
+
+	// Frames missing a 60 Hz or 30 Hz refresh.
+	mFrameTimes.AddBudget(1000.0 / 60.0);
+	mFrameTimes.AddBudget(1000.0 / 30.0);
 }
 
 D3DApp::~D3DApp()
 {
 	if(md3dDevice != nullptr)
 		FlushCommandQueue();
+
+	if(mFrameLatencyWaitable != nullptr)
+		CloseHandle(mFrameLatencyWaitable);
+
+	if(mFenceEvent != nullptr)
+		CloseHandle(mFenceEvent);
 }
 
 HINSTANCE D3DApp::AppInst()const
@@ -69,10 +80,44 @@ void D3DApp::Set4xMsaaState(bool value)
     }
 }
 
+const FrameTimeHistogram& D3DApp::FrameTimes()const
+{
+	return mFrameTimes;
+}
+
+GameTimer& D3DApp::Timer()
+{
+	return mTimer;
+}
+
+FramePacer& D3DApp::Pacer()
+{
+	return mPacer;
+}
+
+void D3DApp::SetLowLatency(bool value)
+{
+	mPacer.SetLowLatency(value);
+	ApplyFrameLatency();
+}
+
+void D3DApp::SetHeadless(bool value)
+{
+	mHeadless = value;
+}
+
+void D3DApp::SetDriverType(D3D_DRIVER_TYPE type)
+{
+	md3dDriverType = type;
+}
+
 int D3DApp::Run()
 {
 	MSG msg = {0};
  
+	// 1 ms sleeps for the frame pacer.
+	timeBeginPeriod(1);
+
 	mTimer.Reset();
 
 	while(msg.message != WM_QUIT)
@@ -86,21 +131,29 @@ int D3DApp::Run()
 		// Otherwise, do animation/game stuff.
 		else
         {	
-			mTimer.Tick();
-
 			if( !mAppPaused )
 			{
+				WaitForNextFrame();
+				mTimer.Tick();
+
+				PROFILE_SCOPE("Frame");
 				CalculateFrameStats();
 				Update(mTimer);	
                 Draw(mTimer);
+				mPacer.EndFrame();
 			}
 			else
 			{
-				Sleep(100);
+				mTimer.Tick();
+
+				// Wake as soon as a message arrives rather than after a fixed sleep.
+				MsgWaitForMultipleObjects(0, nullptr, FALSE, 100, QS_ALLINPUT);
 			}
         }
     }
 
+	timeEndPeriod(1);
+
 	return (int)msg.wParam;
 }
 
@@ -159,7 +212,7 @@ void D3DApp::OnResize()
 		SwapChainBufferCount, 
 		mClientWidth, mClientHeight, 
 		mBackBufferFormat, 
-		DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH));
+		mSwapChainFlags));
 
 	mCurrBackBuffer = 0;
  
@@ -167,6 +220,7 @@ void D3DApp::OnResize()
 	for (UINT i = 0; i < SwapChainBufferCount; i++)
 	{
 		ThrowIfFailed(mSwapChain->GetBuffer(i, IID_PPV_ARGS(&mSwapChainBuffer[i])));
+		d3dUtil::TrackResource(md3dDevice.Get(), mSwapChainBuffer[i].Get(), MemoryCategory::RenderTarget, "SwapChainBuffer");
 		md3dDevice->CreateRenderTargetView(mSwapChainBuffer[i].Get(), nullptr, rtvHeapHandle);
 		rtvHeapHandle.Offset(1, mRtvDescriptorSize);
 	}
@@ -185,7 +239,21 @@ void D3DApp::OnResize()
 	//   1. SRV format: DXGI_FORMAT_R24_UNORM_X8_TYPELESS
 	//   2. DSV Format: DXGI_FORMAT_D24_UNORM_S8_UINT
 	// we need to create the depth buffer resource with a typeless format.  
-	depthStencilDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
+	switch(mDepthStencilFormat)
+	{
+	case DXGI_FORMAT_D32_FLOAT:
+		depthStencilDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		break;
+	case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+		depthStencilDesc.Format = DXGI_FORMAT_R32G8X24_TYPELESS;
+		break;
+	case DXGI_FORMAT_D16_UNORM:
+		depthStencilDesc.Format = DXGI_FORMAT_R16_TYPELESS;
+		break;
+	default:
+		depthStencilDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
+		break;
+	}
 
     depthStencilDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
     depthStencilDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
@@ -194,7 +262,7 @@ void D3DApp::OnResize()
 
     D3D12_CLEAR_VALUE optClear;
     optClear.Format = mDepthStencilFormat;
-    optClear.DepthStencil.Depth = 1.0f;
+    optClear.DepthStencil.Depth = mDepthClearValue;
     optClear.DepthStencil.Stencil = 0;
     ThrowIfFailed(md3dDevice->CreateCommittedResource(
         &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
@@ -203,6 +271,7 @@ void D3DApp::OnResize()
 		D3D12_RESOURCE_STATE_COMMON,
         &optClear,
         IID_PPV_ARGS(mDepthStencilBuffer.GetAddressOf())));
+	d3dUtil::TrackResource(md3dDevice.Get(), mDepthStencilBuffer.Get(), MemoryCategory::RenderTarget, "DepthStencil");
 
     // Create descriptor to mip level 0 of entire resource using the format of the resource.
 	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc;
@@ -365,6 +434,8 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
         else if((int)wParam == VK_F2)
             Set4xMsaaState(!m4xMsaaState);
+        else
+            OnKeyUp(wParam);
 
         return 0;
 	}
@@ -406,8 +477,11 @@ bool D3DApp::InitMainWindow()
 		return false;
 	}
 
-	ShowWindow(mhMainWnd, SW_SHOW);
-	UpdateWindow(mhMainWnd);
+	if(!mHeadless)
+	{
+		ShowWindow(mhMainWnd, SW_SHOW);
+		UpdateWindow(mhMainWnd);
+	}
 
 	return true;
 }
@@ -426,14 +500,20 @@ bool D3DApp::InitDirect3D()
 	ThrowIfFailed(CreateDXGIFactory1(IID_PPV_ARGS(&mdxgiFactory)));
 
 	// Try to create hardware device.
-	HRESULT hardwareResult = D3D12CreateDevice(
-		nullptr,             // default adapter
-		D3D_FEATURE_LEVEL_11_0,
-		IID_PPV_ARGS(&md3dDevice));
+	HRESULT hardwareResult = E_FAIL;
+	if(md3dDriverType != D3D_DRIVER_TYPE_WARP)
+	{
+		hardwareResult = D3D12CreateDevice(
+			nullptr,             // default adapter
+			D3D_FEATURE_LEVEL_11_0,
+			IID_PPV_ARGS(&md3dDevice));
+	}
 
 	// Fallback to WARP device.
 	if(FAILED(hardwareResult))
 	{
+		md3dDriverType = D3D_DRIVER_TYPE_WARP;
+
 		ComPtr<IDXGIAdapter> pWarpAdapter;
 		ThrowIfFailed(mdxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(&pWarpAdapter)));
 
@@ -446,6 +526,11 @@ bool D3DApp::InitDirect3D()
 	ThrowIfFailed(md3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE,
 		IID_PPV_ARGS(&mFence)));
 
+	// One event for every fence wait, rather than a new one per wait.
+	mFenceEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+	if(mFenceEvent == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
 	mRtvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 	mDsvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 	mCbvSrvUavDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
@@ -509,6 +594,15 @@ void D3DApp::CreateSwapChain()
     // Release the previous swapchain we will be recreating.
     mSwapChain.Reset();
 
+	if(mFrameLatencyWaitable != nullptr)
+	{
+		CloseHandle(mFrameLatencyWaitable);
+		mFrameLatencyWaitable = nullptr;
+	}
+
+	// The waitable object lets Run block before a frame starts instead of in Present.
+	mSwapChainFlags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH | DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+
     DXGI_SWAP_CHAIN_DESC sd;
     sd.BufferDesc.Width = mClientWidth;
     sd.BufferDesc.Height = mClientHeight;
@@ -524,13 +618,39 @@ void D3DApp::CreateSwapChain()
     sd.OutputWindow = mhMainWnd;
     sd.Windowed = true;
 	sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-    sd.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+    sd.Flags = mSwapChainFlags;
 
 	// Note: Swap chain uses queue to perform flush.
     ThrowIfFailed(mdxgiFactory->CreateSwapChain(
 		mCommandQueue.Get(),
 		&sd, 
 		mSwapChain.GetAddressOf()));
+
+	ComPtr<IDXGISwapChain2> swapChain2;
+	ThrowIfFailed(mSwapChain.As(&swapChain2));
+	mFrameLatencyWaitable = swapChain2->GetFrameLatencyWaitableObject();
+	ApplyFrameLatency();
+}
+
+void D3DApp::ApplyFrameLatency()
+{
+	if(mSwapChain == nullptr)
+		return;
+
+	// Two queued frames keep the GPU busy; one halves the input latency.
+	ComPtr<IDXGISwapChain2> swapChain2;
+	ThrowIfFailed(mSwapChain.As(&swapChain2));
+	ThrowIfFailed(swapChain2->SetMaximumFrameLatency(mPacer.LowLatency() ? 1 : 2));
+}
+
+void D3DApp::WaitForNextFrame()
+{
+	PROFILE_SCOPE("WaitForNextFrame");
+
+	if(mFrameLatencyWaitable != nullptr)
+		WaitForSingleObjectEx(mFrameLatencyWaitable, 1000, TRUE);
+
+	mPacer.Wait();
 }
 
 void D3DApp::FlushCommandQueue()
@@ -546,14 +666,12 @@ void D3DApp::FlushCommandQueue()
 	// Wait until the GPU has completed commands up to this fence point.
     if(mFence->GetCompletedValue() < mCurrentFence)
 	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-
+		PROFILE_SCOPE("FlushCommandQueue");
         // Fire event when GPU hits current fence.  
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFence, eventHandle));
+        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFence, mFenceEvent));
 
         // Wait until the GPU hits current fence event is fired.
-		WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
+		WaitForSingleObject(mFenceEvent, INFINITE);
 	}
 }
 
@@ -584,12 +702,17 @@ void D3DApp::CalculateFrameStats()
 	// are appended to the window caption bar.
     
 	static int frameCnt = 0;
-	static float timeElapsed = 0.0f;
+	static double timeElapsed = 0.0;
 
 	frameCnt++;
 
+	// Real time, so a time scale or fixed step does not skew the stats.
+	const double frameMs = 1000.0*mTimer.RealDeltaSeconds();
+	mFrameTimes.Record(frameMs);
+	mFrameTimesWindow.Record(frameMs);
+
 	// Compute averages over one second period.
-	if( (mTimer.TotalTime() - timeElapsed) >= 1.0f )
+	if( (mTimer.RealTotalSeconds() - timeElapsed) >= 1.0 )
 	{
 		float fps = (float)frameCnt; // fps = frameCnt / 1
 		float mspf = 1000.0f / fps;
@@ -597,15 +720,19 @@ void D3DApp::CalculateFrameStats()
         wstring fpsStr = to_wstring(fps);
         wstring mspfStr = to_wstring(mspf);
 
+        // The average hides stutter, so show the worst frames of the second too.
         wstring windowText = mMainWndCaption +
             L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+            L"   mspf: " + mspfStr +
+            L"   p99: " + to_wstring(mFrameTimesWindow.PercentileMs(0.99)) +
+            L"   max: " + to_wstring(mFrameTimesWindow.MaxMs());
 
         SetWindowText(mhMainWnd, windowText.c_str());
 		
 		// Reset for next average.
 		frameCnt = 0;
-		timeElapsed += 1.0f;
+		mFrameTimesWindow.Reset();
+		timeElapsed += 1.0;
 	}
 }
 
@@ -9,11 +9,14 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "FrameTimeHistogram.h"
+#include "FramePacer.h"
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
 #pragma comment(lib, "D3D12.lib")
 #pragma comment(lib, "dxgi.lib")
+#pragma comment(lib, "winmm.lib")
 
 class D3DApp
 {
@@ -35,6 +38,24 @@ public:
     bool Get4xMsaaState()const;
     void Set4xMsaaState(bool value);
 
+	// Call before Initialize.  A headless app never shows its window; WARP skips
+	// the hardware adapter.
+	void SetHeadless(bool value);
+	void SetDriverType(D3D_DRIVER_TYPE type);
+
+	// Every frame time since Run started.
+	const FrameTimeHistogram& FrameTimes()const;
+
+	// For the fixed delta and time scale modes.
+	GameTimer& Timer();
+
+	// Target frame rate and sync interval; see SetLowLatency for the latency mode.
+	FramePacer& Pacer();
+
+	// Queues at most one frame on the swap chain and starts each frame as late as
+	// the pacer allows.
+	void SetLowLatency(bool value);
+
 	int Run();
  
     virtual bool Initialize();
@@ -51,6 +72,9 @@ protected:
 	virtual void OnMouseUp(WPARAM btnState, int x, int y)  { }
 	virtual void OnMouseMove(WPARAM btnState, int x, int y){ }
 
+	// Called for key releases the framework does not handle itself.
+	virtual void OnKeyUp(WPARAM key){ }
+
 protected:
 
 	bool InitMainWindow();
@@ -60,6 +84,10 @@ protected:
 
 	void FlushCommandQueue();
 
+	// Blocks until the swap chain can take another frame and the pacer's start time.
+	void WaitForNextFrame();
+	void ApplyFrameLatency();
+
 	ID3D12Resource* CurrentBackBuffer()const;
 	D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView()const;
 	D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView()const;
@@ -86,15 +114,23 @@ protected:
     bool      m4xMsaaState = false;    // 4X MSAA enabled
     UINT      m4xMsaaQuality = 0;      // quality level of 4X MSAA
 
+	// Frame times for the whole run, and for the current caption update.
+	FrameTimeHistogram mFrameTimes;
+	FrameTimeHistogram mFrameTimesWindow;
+
 	// Used to keep track of the delta-time and game time (4.4).
 	GameTimer mTimer;
 	
     Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory;
     Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;
+	UINT mSwapChainFlags = 0;
+	HANDLE mFrameLatencyWaitable = nullptr; // signaled when a frame may be queued
+	FramePacer mPacer;
     Microsoft::WRL::ComPtr<ID3D12Device> md3dDevice;
 
     Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
     UINT64 mCurrentFence = 0;
+	HANDLE mFenceEvent = nullptr; // auto-reset, for waits on mFence
 	
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> mCommandQueue;
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mDirectCmdListAlloc;
@@ -118,8 +154,11 @@ protected:
 	// Derived class should set these in derived constructor to customize starting values.
 	std::wstring mMainWndCaption = L"d3d App";
 	D3D_DRIVER_TYPE md3dDriverType = D3D_DRIVER_TYPE_HARDWARE;
+	bool mHeadless = false;
     DXGI_FORMAT mBackBufferFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
     DXGI_FORMAT mDepthStencilFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	// Depth the buffer is cleared to: 1, or 0 with a reverse-Z projection.
+	float mDepthClearValue = 1.0f;
 	int mClientWidth = 800;
 	int mClientHeight = 600;
 };
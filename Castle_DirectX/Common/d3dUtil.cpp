@@ -5,6 +5,123 @@
 
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+	// {5C1E6F0B-3A7D-4B8E-9F21-6D0A4C7B2E19}
+	const GUID MemoryTrackerNotifierGuid =
+		{ 0x5c1e6f0b, 0x3a7d, 0x4b8e, { 0x9f, 0x21, 0x6d, 0x0a, 0x4c, 0x7b, 0x2e, 0x19 } };
+
+	// Attached to a resource as private data; the resource releases it, and so
+	// removes the resource from the MemoryTracker, when it is destroyed.
+	class ReleaseNotifier : public IUnknown
+	{
+	public:
+		explicit ReleaseNotifier(const void* key) : mKey(key)
+		{
+		}
+
+		virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object)override
+		{
+			if(riid == __uuidof(IUnknown))
+			{
+				*object = static_cast<IUnknown*>(this);
+				AddRef();
+				return S_OK;
+			}
+
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+
+		virtual ULONG STDMETHODCALLTYPE AddRef()override
+		{
+			return InterlockedIncrement(&mRefCount);
+		}
+
+		virtual ULONG STDMETHODCALLTYPE Release()override
+		{
+			const ULONG refCount = InterlockedDecrement(&mRefCount);
+			if(refCount == 0)
+			{
+				MemoryTracker::Remove(mKey);
+				delete this;
+			}
+			return refCount;
+		}
+
+	private:
+		const void* mKey;
+		ULONG mRefCount = 1;
+	};
+
+	// Tracker names are for reports; paths here are ASCII.
+	std::string Narrow(const std::wstring& str)
+	{
+		std::string narrow;
+		narrow.reserve(str.size());
+		for(wchar_t c : str)
+			narrow.push_back((char)c);
+		return narrow;
+	}
+
+	// A blob in system memory that is counted while it lives.
+	class TrackedBlob : public ID3DBlob
+	{
+	public:
+		TrackedBlob(SIZE_T byteSize, MemoryCategory category, const std::string& name)
+			: mData(new std::uint8_t[byteSize]), mByteSize(byteSize)
+		{
+			MemoryTracker::Add(this, category, name, byteSize);
+		}
+
+		virtual ~TrackedBlob()
+		{
+			MemoryTracker::Remove(this);
+		}
+
+		virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object)override
+		{
+			if(riid == __uuidof(IUnknown) || riid == __uuidof(ID3DBlob))
+			{
+				*object = static_cast<ID3DBlob*>(this);
+				AddRef();
+				return S_OK;
+			}
+
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+
+		virtual ULONG STDMETHODCALLTYPE AddRef()override
+		{
+			return InterlockedIncrement(&mRefCount);
+		}
+
+		virtual ULONG STDMETHODCALLTYPE Release()override
+		{
+			const ULONG refCount = InterlockedDecrement(&mRefCount);
+			if(refCount == 0)
+				delete this;
+			return refCount;
+		}
+
+		virtual LPVOID STDMETHODCALLTYPE GetBufferPointer()override
+		{
+			return mData.get();
+		}
+
+		virtual SIZE_T STDMETHODCALLTYPE GetBufferSize()override
+		{
+			return mByteSize;
+		}
+
+	private:
+		std::unique_ptr<std::uint8_t[]> mData;
+		SIZE_T mByteSize;
+		ULONG mRefCount = 1;
+	};
+}
+
 DxException::DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber) :
     ErrorCode(hr),
     FunctionName(functionName),
@@ -26,8 +143,7 @@ ComPtr<ID3DBlob> d3dUtil::LoadBinary(const std::wstring& filename)
     std::ifstream::pos_type size = (int)fin.tellg();
     fin.seekg(0, std::ios_base::beg);
 
-    ComPtr<ID3DBlob> blob;
-    ThrowIfFailed(D3DCreateBlob(size, blob.GetAddressOf()));
+    ComPtr<ID3DBlob> blob = CreateBlob((SIZE_T)size, MemoryCategory::CpuBlob, Narrow(filename));
 
     fin.read((char*)blob->GetBufferPointer(), size);
     fin.close();
@@ -35,6 +151,25 @@ ComPtr<ID3DBlob> d3dUtil::LoadBinary(const std::wstring& filename)
     return blob;
 }
 
+std::uint64_t d3dUtil::HashBytes(const void* data, size_t byteSize, std::uint64_t seed)
+{
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+
+    std::uint64_t hash = seed;
+    for(size_t i = 0; i < byteSize; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+std::uint64_t d3dUtil::HashString(const std::string& str, std::uint64_t seed)
+{
+    return HashBytes(str.c_str(), str.size() + 1, seed);
+}
+
 Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
     ID3D12Device* device,
     ID3D12GraphicsCommandList* cmdList,
@@ -87,16 +222,51 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
     return defaultBuffer;
 }
 
+void d3dUtil::TrackResource(ID3D12Device* device, ID3D12Resource* resource,
+	MemoryCategory category, const std::string& name)
+{
+	const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	const D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &desc);
+	TrackResource(resource, info.SizeInBytes, category, name);
+}
+
+void d3dUtil::TrackResource(ID3D12Resource* resource, UINT64 byteSize,
+	MemoryCategory category, const std::string& name)
+{
+	// Replacing an earlier notifier releases it, so do that before adding.
+	ReleaseNotifier* notifier = new ReleaseNotifier(resource);
+	ThrowIfFailed(resource->SetPrivateDataInterface(MemoryTrackerNotifierGuid, notifier));
+	notifier->Release();
+
+	MemoryTracker::Add(resource, category, name, byteSize);
+
+	resource->SetName(std::wstring(name.begin(), name.end()).c_str());
+}
+
+ComPtr<ID3DBlob> d3dUtil::CreateBlob(SIZE_T byteSize, MemoryCategory category, const std::string& name)
+{
+	ComPtr<ID3DBlob> blob;
+	blob.Attach(new TrackedBlob(byteSize, category, name));
+	return blob;
+}
+
+UINT d3dUtil::ShaderCompileFlags()
+{
+	UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)  
+	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+	return compileFlags;
+}
+
 ComPtr<ID3DBlob> d3dUtil::CompileShader(
 	const std::wstring& filename,
 	const D3D_SHADER_MACRO* defines,
 	const std::string& entrypoint,
 	const std::string& target)
 {
-	UINT compileFlags = 0;
-#if defined(DEBUG) || defined(_DEBUG)  
-	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
+	UINT compileFlags = ShaderCompileFlags();
 
 	HRESULT hr = S_OK;
 
@@ -24,6 +24,7 @@
 #include "d3dx12.h"
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
+#include "MemoryTracker.h"
 
 extern const int gNumFrameResources;
 
@@ -110,6 +111,16 @@ public:
 
     static Microsoft::WRL::ComPtr<ID3DBlob> LoadBinary(const std::wstring& filename);
 
+    // 64-bit FNV-1a hash.  Pass a previous result as the seed to hash several
+    // ranges into one value.
+    static std::uint64_t HashBytes(const void* data, size_t byteSize,
+        std::uint64_t seed = 14695981039346656037ull);
+
+    // Hashes the characters plus the terminating null, so that consecutive strings
+    // hashed into the same seed cannot run together ("ab","c" vs "a","bc").
+    static std::uint64_t HashString(const std::string& str,
+        std::uint64_t seed = 14695981039346656037ull);
+
     static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
         ID3D12Device* device,
         ID3D12GraphicsCommandList* cmdList,
@@ -117,6 +128,22 @@ public:
         UINT64 byteSize,
         Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
 
+	// Adds resource to the MemoryTracker at the size the device allocates for it,
+	// and names it for debuggers.  It is removed when the resource is destroyed.
+	static void TrackResource(ID3D12Device* device, ID3D12Resource* resource,
+		MemoryCategory category, const std::string& name);
+
+	// The same at a size the caller already knows.
+	static void TrackResource(ID3D12Resource* resource, UINT64 byteSize,
+		MemoryCategory category, const std::string& name);
+
+	// D3DCreateBlob, counted by the MemoryTracker until the blob is released.
+	static Microsoft::WRL::ComPtr<ID3DBlob> CreateBlob(SIZE_T byteSize,
+		MemoryCategory category, const std::string& name);
+
+	// Flags CompileShader passes to the compiler for this build configuration.
+	static UINT ShaderCompileFlags();
+
 	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
 		const std::wstring& filename,
 		const D3D_SHADER_MACRO* defines,
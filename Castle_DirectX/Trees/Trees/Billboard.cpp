@@ -0,0 +1,42 @@
+//***************************************************************************************
+// Billboard.cpp
+//***************************************************************************************
+
+#include "Billboard.h"
+
+using namespace DirectX;
+
+static_assert(sizeof(TreeSpriteVertex) == 20, "TreeSpriteVertex must match the HLSL TreeSprite stride.");
+
+BillboardVertex ExpandBillboardCorner(const XMFLOAT3& centerW, const XMFLOAT2& sizeW,
+	const XMFLOAT3& eyePosW, unsigned int corner)
+{
+	XMVECTOR center = XMLoadFloat3(&centerW);
+	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	// y-axis aligned, so project the look vector to the xz-plane.
+	XMVECTOR look = XMVectorSubtract(XMLoadFloat3(&eyePosW), center);
+	look = XMVector3Normalize(XMVectorSetY(look, 0.0f));
+	XMVECTOR right = XMVector3Cross(up, look);
+
+	const float halfWidth = 0.5f*sizeW.x;
+	const float halfHeight = 0.5f*sizeW.y;
+
+	// Corners 0 and 1 are on the +right side, 0 and 2 at the bottom.
+	const float side = corner < 2 ? 1.0f : -1.0f;
+	const float height = (corner & 1) ? 1.0f : -1.0f;
+
+	XMVECTOR pos = center + (side*halfWidth)*right + (height*halfHeight)*up;
+
+	BillboardVertex v;
+	XMStoreFloat3(&v.PosW, pos);
+	XMStoreFloat3(&v.NormalW, look);
+	v.TexC = XMFLOAT2(corner < 2 ? 0.0f : 1.0f, (corner & 1) ? 0.0f : 1.0f);
+
+	return v;
+}
+
+unsigned int BillboardTextureSlice(unsigned int treeIndex, unsigned int sliceCount)
+{
+	return treeIndex % sliceCount;
+}
@@ -0,0 +1,33 @@
+//***************************************************************************************
+// Billboard.h
+//
+// CPU reference of the tree billboard expansion done on the GPU by ExpandBillboard in
+// TreeSprite.hlsl (used by both the geometry shader and the vertex-pulling path).
+// Keep the two in sync.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+
+// Matches the tree sprite vertex buffer layout and the TreeSprite structured buffer
+// element in TreeSprite.hlsl (20 bytes, no padding).
+struct TreeSpriteVertex
+{
+	DirectX::XMFLOAT3 Pos;
+	DirectX::XMFLOAT2 Size;
+};
+
+struct BillboardVertex
+{
+	DirectX::XMFLOAT3 PosW;
+	DirectX::XMFLOAT3 NormalW;
+	DirectX::XMFLOAT2 TexC;
+};
+
+// Corner [0, 4) of the y-axis aligned quad facing eyePosW, in triangle strip order.
+BillboardVertex ExpandBillboardCorner(const DirectX::XMFLOAT3& centerW, const DirectX::XMFLOAT2& sizeW,
+	const DirectX::XMFLOAT3& eyePosW, unsigned int corner);
+
+// Texture array slice the pixel shader samples for the given tree.
+unsigned int BillboardTextureSlice(unsigned int treeIndex, unsigned int sliceCount);
@@ -0,0 +1,120 @@
+//***************************************************************************************
+// CastleScene.cpp
+//***************************************************************************************
+
+#include "CastleScene.h"
+
+using namespace DirectX;
+
+const CastleWall gCastleWalls[] =
+{
+	// Verticals
+	{ { -39.667f, 5.0f, 45.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -39.667f, 5.0f, 22.667f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -39.667f, 5.0f, 0.0f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -39.667f, 5.0f, -22.667f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -28.334f, 5.0f, 45.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -28.334f, 5.0f, 34.0f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -28.334f, 5.0f, 11.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -28.334f, 5.0f, -45.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -17.0f, 5.0f, 45.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -17.0f, 5.0f, -22.667f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -17.0f, 5.0f, -34.0f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -5.66f, 5.0f, 34.0f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -5.66f, 5.0f, -22.667f }, { 0.5f, 6.0f, 11.334f } },
+	{ { -5.66f, 5.0f, -45.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 5.66f, 5.0f, 34.0f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 5.66f, 5.0f, -34.0f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 17.0f, 5.0f, 45.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 17.0f, 5.0f, 22.667f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 17.0f, 5.0f, -22.667f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 17.0f, 5.0f, -34.0f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 17.0f, 5.0f, -45.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 28.334f, 5.0f, 45.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 28.334f, 5.0f, 22.667f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 28.334f, 5.0f, 11.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 28.334f, 5.0f, 0.0f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 28.334f, 5.0f, -22.667f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 28.334f, 5.0f, -45.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 39.667f, 5.0f, 45.334f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 39.667f, 5.0f, 22.667f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 39.667f, 5.0f, 0.0f }, { 0.5f, 6.0f, 11.334f } },
+	{ { 39.667f, 5.0f, -34.0f }, { 0.5f, 6.0f, 11.334f } },
+
+	// Horizontals
+	{ { -45.334f, 5.0f, 5.66f }, { 11.334f, 6.0f, 0.5f } },
+	{ { -45.334f, 5.0f, -5.66f }, { 11.334f, 6.0f, 0.5f } },
+	{ { -34.0f, 5.0f, 17.0f }, { 11.334f, 6.0f, 0.5f } },
+	{ { -34.0f, 5.0f, 5.66f }, { 11.334f, 6.0f, 0.5f } },
+	{ { -34.0f, 5.0f, -17.0f }, { 11.334f, 6.0f, 0.5f } },
+	{ { -34.0f, 5.0f, -28.33f }, { 11.334f, 6.0f, 0.5f } },
+	{ { -34.0f, 5.0f, -39.66f }, { 11.334f, 6.0f, 0.5f } },
+	{ { -22.667f, 5.0f, 39.66f }, { 11.334f, 6.0f, 0.5f } },
+	{ { -22.667f, 5.0f, 17.0f }, { 11.334f, 6.0f, 0.5f } },
+	{ { -11.334f, 5.0f, 28.334f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 0.0f, 5.0f, 39.667f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 0.0f, 5.0f, -28.334f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 11.334f, 5.0f, 28.334f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 22.667f, 5.0f, 39.667f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 22.667f, 5.0f, -5.667f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 22.667f, 5.0f, -28.334f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 22.667f, 5.0f, -39.667f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 34.0f, 5.0f, 28.334f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 34.0f, 5.0f, 17.0f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 34.0f, 5.0f, -17.0f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 45.334f, 5.0f, 5.66f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 45.334f, 5.0f, -5.66f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 45.334f, 5.0f, -28.334f }, { 11.334f, 6.0f, 0.5f } },
+	{ { 45.334f, 5.0f, -39.667f }, { 11.334f, 6.0f, 0.5f } },
+
+	// Perimeter
+	{ { -51.0f, 5.0f, 0.0f }, { 0.5f, 6.0f, 102.0f } },
+	{ { 51.0f, 5.0f, 0.0f }, { 0.5f, 6.0f, 102.0f } },
+	{ { 0.0f, 5.0f, 51.0f }, { 102.0f, 6.0f, 0.5f } },
+	{ { -5.667f, 5.0f, -51.0f }, { 90.667f, 6.0f, 0.5f } },
+};
+
+const UINT gCastleWallCount = _countof(gCastleWalls);
+
+std::vector<BoundingBox> CastleWallBounds()
+{
+	std::vector<BoundingBox> bounds;
+	for(const CastleWall& wall : gCastleWalls)
+		bounds.push_back(BoundingBox(wall.Center, XMFLOAT3(0.5f*wall.Size.x, 0.5f*wall.Size.y, 0.5f*wall.Size.z)));
+	return bounds;
+}
+
+// The flythrough's keys: the camera moves from one to the next in
+// gBenchmarkKeySeconds, eased at both ends, and looks at the interpolated target.
+struct BenchmarkKey
+{
+	XMFLOAT3 Position;
+	XMFLOAT3 Target;
+};
+
+const BenchmarkKey gBenchmarkPath[] =
+{
+	{ { -70.0f, 30.0f, -70.0f }, { 0.0f, 0.0f, 0.0f } },
+	{ {  70.0f, 30.0f, -70.0f }, { 0.0f, 0.0f, 0.0f } },
+	{ {  70.0f, 30.0f,  70.0f }, { 0.0f, 0.0f, 0.0f } },
+	{ { -70.0f, 30.0f,  70.0f }, { 0.0f, 0.0f, 0.0f } },
+	{ { -34.0f,  4.0f, -60.0f }, { -34.0f, 4.0f,  0.0f } },
+	{ { -34.0f,  4.0f,  60.0f }, { -34.0f, 4.0f, 120.0f } },
+};
+
+void PlaceOnBenchmarkPath(double seconds, Camera& camera)
+{
+	const int keyCount = _countof(gBenchmarkPath);
+	const double t = seconds / gBenchmarkKeySeconds;
+	const int step = (int)t;
+	const int key = step % keyCount;
+	const float s = (float)(t - step);
+	const float eased = s*s*(3.0f - 2.0f*s);
+
+	const BenchmarkKey& from = gBenchmarkPath[key];
+	const BenchmarkKey& to = gBenchmarkPath[(key + 1) % keyCount];
+
+	XMVECTOR pos = XMVectorLerp(XMLoadFloat3(&from.Position), XMLoadFloat3(&to.Position), eased);
+	XMVECTOR target = XMVectorLerp(XMLoadFloat3(&from.Target), XMLoadFloat3(&to.Target), eased);
+	camera.LookAt(pos, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+}
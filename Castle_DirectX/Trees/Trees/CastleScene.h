@@ -0,0 +1,35 @@
+//***************************************************************************************
+// CastleScene.h
+//
+// The castle's layout and the -benchmark flythrough, shared by the app, the
+// self-tests and the micro-benchmarks.  Needs no window or device.
+//***************************************************************************************
+
+#pragma once
+
+#include "../../Common/Camera.h"
+#include <vector>
+
+// Castle maze walls: unit boxes scaled to Size and centred at Center.
+struct CastleWall
+{
+	DirectX::XMFLOAT3 Center;
+	DirectX::XMFLOAT3 Size;
+};
+
+extern const CastleWall gCastleWalls[];
+extern const UINT gCastleWallCount;
+
+// World space bounds of gCastleWalls, for camera collision.
+std::vector<DirectX::BoundingBox> CastleWallBounds();
+
+// Radius of the sphere that stops the camera at walls; more than the distance to
+// the corners of the near plane, so walls are never clipped.
+const float gCameraRadius = 1.0f;
+
+// -benchmark flies a loop round the castle from above, then down an aisle of the
+// maze, taking this long from one key to the next.
+const float gBenchmarkKeySeconds = 5.0f;
+
+// Puts the camera where the flythrough is seconds into the loop.
+void PlaceOnBenchmarkPath(double seconds, Camera& camera);
@@ -1,6 +1,8 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount)
+FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount,
+    UINT clusterLightCount, UINT clusterCount, UINT clusterLightIndexCount, UINT timestampCount,
+    UINT overlayVertexCount)
 {
     ThrowIfFailed(device->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
@@ -8,13 +10,48 @@ FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCo
 
   //  FrameCB = std::make_unique<UploadBuffer<FrameConstants>>(device, 1, true);
     PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-    MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
-    ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+    MaterialBuffer = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, false);
+    ObjectBuffer = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, false);
+
+    ClusterLights = std::make_unique<UploadBuffer<Light>>(device, clusterLightCount, false);
+    ClusterRanges = std::make_unique<UploadBuffer<LightClusters::Range>>(device, clusterCount, false);
+    ClusterLightIndices = std::make_unique<UploadBuffer<UINT>>(device, clusterLightIndexCount, false);
 
     WavesVB = std::make_unique<UploadBuffer<Vertex>>(device, waveVertCount, false);
+    OverlayVB = std::make_unique<UploadBuffer<OverlayVertex>>(device, overlayVertexCount, false);
+
+    D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+    queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    queryHeapDesc.Count = timestampCount;
+    ThrowIfFailed(device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(TimestampQueries.GetAddressOf())));
+
+    ThrowIfFailed(device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(timestampCount*sizeof(UINT64)),
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(TimestampReadback.GetAddressOf())));
+
+    d3dUtil::TrackResource(device, PassCB->Resource(), MemoryCategory::FrameResource, "PassCB");
+    d3dUtil::TrackResource(device, MaterialBuffer->Resource(), MemoryCategory::FrameResource, "MaterialBuffer");
+    d3dUtil::TrackResource(device, ObjectBuffer->Resource(), MemoryCategory::FrameResource, "ObjectBuffer");
+    d3dUtil::TrackResource(device, ClusterLights->Resource(), MemoryCategory::FrameResource, "ClusterLights");
+    d3dUtil::TrackResource(device, ClusterRanges->Resource(), MemoryCategory::FrameResource, "ClusterRanges");
+    d3dUtil::TrackResource(device, ClusterLightIndices->Resource(), MemoryCategory::FrameResource, "ClusterLightIndices");
+    d3dUtil::TrackResource(device, WavesVB->Resource(), MemoryCategory::FrameResource, "WavesVB");
+    d3dUtil::TrackResource(device, OverlayVB->Resource(), MemoryCategory::FrameResource, "OverlayVB");
+    d3dUtil::TrackResource(device, TimestampReadback.Get(), MemoryCategory::Readback, "TimestampReadback");
 }
 
 FrameResource::~FrameResource()
 {
 
+}
+
+UINT64 FrameResource::UploadBytesWritten()const
+{
+    return PassCB->BytesWritten() + MaterialBuffer->BytesWritten() + ObjectBuffer->BytesWritten() +
+        ClusterLights->BytesWritten() + ClusterRanges->BytesWritten() + ClusterLightIndices->BytesWritten() +
+        WavesVB->BytesWritten() + OverlayVB->BytesWritten();
 }
\ No newline at end of file
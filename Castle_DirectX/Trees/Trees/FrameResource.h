@@ -3,6 +3,8 @@
 #include "../../Common/d3dUtil.h"
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
+#include "../../Common/LightClusters.h"
+#include "../../Common/OverlayBatch.h"
 
 struct ObjectConstants
 {
@@ -34,6 +36,15 @@ struct PassConstants
 	float gFogRange = 300.0f;
 	DirectX::XMFLOAT2 cbPerObjectPad2;
 
+	// Clustered lighting: grid size, pixel to tile scale and the depth slice
+	// mapping slice = log(viewZ)*ClusterZScale + ClusterZBias.  Kept ahead of
+	// Lights, which is only uploaded up to the lights in use.
+	DirectX::XMUINT3 ClusterDims = { 1, 1, 1 };
+	float ClusterZScale = 0.0f;
+	DirectX::XMFLOAT2 ClusterTileScale = { 0.0f, 0.0f };
+	float ClusterZBias = 0.0f;
+	float cbPerObjectPad3 = 0.0f;
+
     // Indices [0, NUM_DIR_LIGHTS) are directional lights;
     // indices [NUM_DIR_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHTS) are point lights;
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
@@ -54,11 +65,16 @@ struct FrameResource
 {
 public:
     
-    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount);
+    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount,
+        UINT clusterLightCount, UINT clusterCount, UINT clusterLightIndexCount, UINT timestampCount,
+        UINT overlayVertexCount);
     FrameResource(const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     ~FrameResource();
 
+    // Bytes written to all of this frame's upload buffers so far.
+    UINT64 UploadBytesWritten()const;
+
     // We cannot reset the allocator until the GPU is done processing the commands.
     // So each frame needs their own allocator.
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
@@ -67,13 +83,30 @@ public:
     // that reference it.  So each frame needs their own cbuffers.
    // std::unique_ptr<UploadBuffer<FrameConstants>> FrameCB = nullptr;
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
-    std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
-    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
+
+    // Object and material data are tightly packed structured buffers indexed
+    // by the per-draw root constants.
+    std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialBuffer = nullptr;
+    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectBuffer = nullptr;
+
+    // Clustered lighting: the point and spot lights, an (offset, count) range
+    // into ClusterLightIndices per cluster, and the light indices themselves.
+    std::unique_ptr<UploadBuffer<Light>> ClusterLights = nullptr;
+    std::unique_ptr<UploadBuffer<LightClusters::Range>> ClusterRanges = nullptr;
+    std::unique_ptr<UploadBuffer<UINT>> ClusterLightIndices = nullptr;
 
     // We cannot update a dynamic vertex buffer until the GPU is done processing
     // the commands that reference it.  So each frame needs their own.
     std::unique_ptr<UploadBuffer<Vertex>> WavesVB = nullptr;
 
+    // Performance HUD text and graph, rebuilt every frame.
+    std::unique_ptr<UploadBuffer<OverlayVertex>> OverlayVB = nullptr;
+
+    // GPU timestamps written while this frame executes, resolved into the
+    // readback buffer and read once Fence has passed.
+    Microsoft::WRL::ComPtr<ID3D12QueryHeap> TimestampQueries;
+    Microsoft::WRL::ComPtr<ID3D12Resource> TimestampReadback;
+
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
     UINT64 Fence = 0;
@@ -0,0 +1,381 @@
+//***************************************************************************************
+// MicroBenchmarks.cpp
+//***************************************************************************************
+
+#include "MicroBenchmarks.h"
+#include "../../Common/Camera.h"
+#include "../../Common/CameraPath.h"
+#include "../../Common/CollisionGrid.h"
+#include "../../Common/DDSAlpha.h"
+#include "../../Common/Frustum.h"
+#include "../../Common/GeometryGenerator.h"
+#include "../../Common/MathHelper.h"
+#include "../../Common/MicroBenchmark.h"
+#include "CastleScene.h"
+#include "FrameResource.h"
+#include "Waves.h"
+#include <functional>
+#include <random>
+
+using Microsoft::WRL::ComPtr;
+using namespace DirectX;
+
+int RunMicroBenchmarks()
+{
+	MicroBenchmark bench;
+
+	for(int size : { 64, 128, 256, 512 })
+	{
+		Waves waves(size, size, 1.0f, 0.03f, 4.0f, 0.2f);
+		waves.Disturb(size / 2, size / 2, 0.5f);
+
+		// One simulation step per call.
+		bench.Run("waves/step_" + std::to_string(size), [&waves]()
+		{
+			waves.Update(0.03f);
+			MicroBenchmark::Consume(&waves.Position(0));
+		});
+	}
+
+	GeometryGenerator geoGen;
+	auto runShape = [&bench](const std::string& name, std::function<GeometryGenerator::MeshData()> create)
+	{
+		bench.Run(name, [&create]()
+		{
+			GeometryGenerator::MeshData mesh = create();
+			MicroBenchmark::Consume(mesh.Vertices.data());
+		});
+	};
+	runShape("geometry/box", [&geoGen]() { return geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3); });
+	runShape("geometry/sphere", [&geoGen]() { return geoGen.CreateSphere(0.5f, 20, 20); });
+	runShape("geometry/geosphere", [&geoGen]() { return geoGen.CreateGeosphere(0.5f, 3); });
+	runShape("geometry/cylinder", [&geoGen]() { return geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20); });
+	runShape("geometry/grid", [&geoGen]() { return geoGen.CreateGrid(160.0f, 160.0f, 50, 50); });
+	runShape("geometry/quad", [&geoGen]() { return geoGen.CreateQuad(0.0f, 0.0f, 1.0f, 1.0f, 0.0f); });
+	runShape("geometry/pyramid", [&geoGen]() { return geoGen.CreatePyrimid(1.0f); });
+	runShape("geometry/cone", [&geoGen]() { return geoGen.CreateCone(1.0f, 1.0f, 20, 20); });
+	runShape("geometry/diamond", [&geoGen]() { return geoGen.CreateDiamond(1.0f, 1.0f, 1.0f, 1.0f, 3); });
+	runShape("geometry/prism", [&geoGen]() { return geoGen.CreateTriangularPrisim(1.0f, 1.0f, 1.0f, 3); });
+	runShape("geometry/tetrahedron", [&geoGen]() { return geoGen.CreateTetrahedron(1.0f); });
+	runShape("geometry/wedge", [&geoGen]() { return geoGen.CreateWedge(1.0f, 1.0f, 1.0f, 3); });
+
+	// Subdivide is private; the geosphere is an icosahedron subdivided n times.
+	for(UINT level = 0; level <= 5; ++level)
+		runShape("subdivide/level_" + std::to_string(level), [&geoGen, level]() { return geoGen.CreateGeosphere(0.5f, level); });
+
+	Camera camera;
+	camera.SetLens(0.25f*MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+	bench.Run("camera/update_view", [&camera]()
+	{
+		camera.RotateY(0.001f);
+		camera.UpdateViewMatrix();
+		MicroBenchmark::Consume(&camera);
+	});
+	bench.Run("camera/set_lens", [&camera]()
+	{
+		camera.SetLens(0.25f*MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+		MicroBenchmark::Consume(&camera);
+	});
+
+	// The view, projection and inverses UpdateMainPassCB stores every frame, from
+	// the camera's cache; general_inverses is the same without the cache.
+	PassConstants pass;
+	bench.Run("camera/pass_matrices", [&camera, &pass]()
+	{
+		XMMATRIX view = camera.GetView();
+		XMMATRIX proj = camera.GetProj();
+		XMMATRIX viewProj = camera.GetViewProj();
+		XMMATRIX invView = camera.GetInvView();
+		XMMATRIX invProj = camera.GetInvProj();
+		XMMATRIX invViewProj = camera.GetInvViewProj();
+
+		XMStoreFloat4x4(&pass.View, XMMatrixTranspose(view));
+		XMStoreFloat4x4(&pass.InvView, XMMatrixTranspose(invView));
+		XMStoreFloat4x4(&pass.Proj, XMMatrixTranspose(proj));
+		XMStoreFloat4x4(&pass.InvProj, XMMatrixTranspose(invProj));
+		XMStoreFloat4x4(&pass.ViewProj, XMMatrixTranspose(viewProj));
+		XMStoreFloat4x4(&pass.InvViewProj, XMMatrixTranspose(invViewProj));
+		MicroBenchmark::Consume(&pass);
+	});
+	bench.Run("camera/general_inverses", [&camera, &pass]()
+	{
+		XMMATRIX view = camera.GetView();
+		XMMATRIX proj = camera.GetProj();
+		XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+		XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+		XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
+		XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
+
+		XMStoreFloat4x4(&pass.View, XMMatrixTranspose(view));
+		XMStoreFloat4x4(&pass.InvView, XMMatrixTranspose(invView));
+		XMStoreFloat4x4(&pass.Proj, XMMatrixTranspose(proj));
+		XMStoreFloat4x4(&pass.InvProj, XMMatrixTranspose(invProj));
+		XMStoreFloat4x4(&pass.ViewProj, XMMatrixTranspose(viewProj));
+		XMStoreFloat4x4(&pass.InvViewProj, XMMatrixTranspose(invViewProj));
+		MicroBenchmark::Consume(&pass);
+	});
+
+	// MathHelper's batch transforms and TransformAabbs over 4096 objects against
+	// DirectXMath one at a time: transposes, world times viewProj, points and boxes.
+	const UINT transformCount = 4096;
+	std::mt19937 transformRandom(1234);
+	std::uniform_real_distribution<float> transformPosition(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> transformSize(0.5f, 5.0f);
+	std::vector<XMFLOAT4X4> transformWorlds(transformCount);
+	std::vector<XMFLOAT4X4> transformOut(transformCount);
+	std::vector<XMFLOAT3> transformPoints(transformCount);
+	std::vector<XMFLOAT3> transformedPoints(transformCount);
+	std::vector<BoundingBox> transformBoxes(transformCount);
+	std::vector<BoundingBox> transformedBoxes(transformCount);
+	for(UINT i = 0; i < transformCount; ++i)
+	{
+		const XMFLOAT3 p(transformPosition(transformRandom), transformPosition(transformRandom), transformPosition(transformRandom));
+		XMStoreFloat4x4(&transformWorlds[i], XMMatrixRotationY(0.01f*i)*XMMatrixTranslation(p.x, p.y, p.z));
+		transformPoints[i] = p;
+		transformBoxes[i] = BoundingBox(p, XMFLOAT3(transformSize(transformRandom), transformSize(transformRandom), transformSize(transformRandom)));
+	}
+	const XMMATRIX transformViewProj = camera.GetViewProj();
+	const XMMATRIX transformWorld = XMMatrixRotationY(0.5f)*XMMatrixTranslation(10.0f, 0.0f, -5.0f);
+
+	bench.Run("math/transpose_4096", [&transformWorlds, &transformOut, transformCount]()
+	{
+		MathHelper::TransposeMatrices(transformOut.data(), transformWorlds.data(), transformCount);
+		MicroBenchmark::Consume(transformOut.data());
+	});
+	bench.Run("math/transpose_4096_one_at_a_time", [&transformWorlds, &transformOut, transformCount]()
+	{
+		for(UINT i = 0; i < transformCount; ++i)
+			XMStoreFloat4x4(&transformOut[i], XMMatrixTranspose(XMLoadFloat4x4(&transformWorlds[i])));
+		MicroBenchmark::Consume(transformOut.data());
+	});
+	bench.Run("math/world_view_proj_4096", [&transformWorlds, &transformOut, &transformViewProj, transformCount]()
+	{
+		MathHelper::MultiplyTransposeMatrices(transformOut.data(), transformWorlds.data(), transformCount, transformViewProj);
+		MicroBenchmark::Consume(transformOut.data());
+	});
+	bench.Run("math/world_view_proj_4096_one_at_a_time", [&transformWorlds, &transformOut, &transformViewProj, transformCount]()
+	{
+		for(UINT i = 0; i < transformCount; ++i)
+		{
+			XMMATRIX worldViewProj = XMMatrixMultiply(XMLoadFloat4x4(&transformWorlds[i]), transformViewProj);
+			XMStoreFloat4x4(&transformOut[i], XMMatrixTranspose(worldViewProj));
+		}
+		MicroBenchmark::Consume(transformOut.data());
+	});
+	bench.Run("math/points_4096", [&transformPoints, &transformedPoints, &transformViewProj, transformCount]()
+	{
+		MathHelper::TransformPoints(transformedPoints.data(), transformPoints.data(), transformCount, transformViewProj);
+		MicroBenchmark::Consume(transformedPoints.data());
+	});
+	bench.Run("math/points_4096_one_at_a_time", [&transformPoints, &transformedPoints, &transformViewProj, transformCount]()
+	{
+		for(UINT i = 0; i < transformCount; ++i)
+			XMStoreFloat3(&transformedPoints[i], XMVector3TransformCoord(XMLoadFloat3(&transformPoints[i]), transformViewProj));
+		MicroBenchmark::Consume(transformedPoints.data());
+	});
+	bench.Run("math/aabbs_4096", [&transformBoxes, &transformedBoxes, &transformWorld, transformCount]()
+	{
+		TransformAabbs(transformedBoxes.data(), transformBoxes.data(), transformCount, transformWorld);
+		MicroBenchmark::Consume(transformedBoxes.data());
+	});
+	bench.Run("math/aabbs_4096_bounding_box_transform", [&transformBoxes, &transformedBoxes, &transformWorld, transformCount]()
+	{
+		for(UINT i = 0; i < transformCount; ++i)
+			transformBoxes[i].Transform(transformedBoxes[i], transformWorld);
+		MicroBenchmark::Consume(transformedBoxes.data());
+	});
+
+	// Frustum culling of 100k boxes and spheres scattered around the camera, four
+	// per SIMD iteration, against the same test one object at a time.
+	const UINT cullCount = 100000;
+	std::mt19937 cullRandom(1234);
+	std::uniform_real_distribution<float> cullPosition(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> cullHeight(0.0f, 50.0f);
+	std::uniform_real_distribution<float> cullSize(0.5f, 5.0f);
+	std::vector<float> cullData[6];
+	for(std::vector<float>& component : cullData)
+		component.resize(cullCount);
+	for(UINT i = 0; i < cullCount; ++i)
+	{
+		cullData[0][i] = cullPosition(cullRandom);
+		cullData[1][i] = cullHeight(cullRandom);
+		cullData[2][i] = cullPosition(cullRandom);
+		cullData[3][i] = cullSize(cullRandom);
+		cullData[4][i] = cullSize(cullRandom);
+		cullData[5][i] = cullSize(cullRandom);
+	}
+
+	AabbArrays boxes;
+	boxes.CenterX = cullData[0].data();
+	boxes.CenterY = cullData[1].data();
+	boxes.CenterZ = cullData[2].data();
+	boxes.ExtentX = cullData[3].data();
+	boxes.ExtentY = cullData[4].data();
+	boxes.ExtentZ = cullData[5].data();
+	boxes.Count = cullCount;
+
+	SphereArrays spheres;
+	spheres.CenterX = boxes.CenterX;
+	spheres.CenterY = boxes.CenterY;
+	spheres.CenterZ = boxes.CenterZ;
+	spheres.Radius = boxes.ExtentX;
+	spheres.Count = cullCount;
+
+	const Frustum& frustum = camera.GetFrustum();
+	std::vector<UINT> boxMask(Frustum::MaskWords(cullCount));
+	std::vector<UINT> sphereMask(Frustum::MaskWords(cullCount));
+
+	bench.Run("frustum/aabbs_100k", [&frustum, &boxes, &boxMask]()
+	{
+		UINT visible = frustum.TestAabbs(boxes, boxMask.data());
+		MicroBenchmark::Consume(&visible);
+	});
+	bench.Run("frustum/spheres_100k", [&frustum, &spheres, &sphereMask]()
+	{
+		UINT visible = frustum.TestSpheres(spheres, sphereMask.data());
+		MicroBenchmark::Consume(&visible);
+	});
+	bench.Run("frustum/aabbs_100k_one_at_a_time", [cullCount, &frustum, &cullData, &boxMask]()
+	{
+		std::fill(boxMask.begin(), boxMask.end(), 0u);
+		for(UINT i = 0; i < cullCount; ++i)
+		{
+			const XMFLOAT3 center(cullData[0][i], cullData[1][i], cullData[2][i]);
+			const XMFLOAT3 extents(cullData[3][i], cullData[4][i], cullData[5][i]);
+			if(frustum.IntersectsAabb(center, extents))
+				boxMask[i / 32] |= 1u << (i % 32);
+		}
+		MicroBenchmark::Consume(boxMask.data());
+	});
+
+	// One camera move per call, about a frame's walk, round the castle walls and
+	// through 4096 random walls over a 1000 x 1000 area.
+	const UINT moveCount = 1024;
+	std::mt19937 moveRandom(1234);
+	std::uniform_real_distribution<float> moveStep(-0.5f, 0.5f);
+	std::vector<XMFLOAT3> moveDeltas(moveCount);
+	for(XMFLOAT3& delta : moveDeltas)
+		delta = XMFLOAT3(moveStep(moveRandom), 0.0f, moveStep(moveRandom));
+
+	auto runMoves = [&bench, &moveRandom, &moveDeltas, moveCount](const std::string& name,
+		const std::vector<BoundingBox>& walls, float halfSize)
+	{
+		CollisionGrid grid;
+		grid.Build(walls.data(), (UINT)walls.size());
+
+		std::uniform_real_distribution<float> position(-halfSize, halfSize);
+		std::vector<XMFLOAT3> starts(moveCount);
+		for(XMFLOAT3& start : starts)
+			start = XMFLOAT3(position(moveRandom), 5.0f, position(moveRandom));
+
+		UINT next = 0;
+		bench.Run(name, [&grid, &starts, &moveDeltas, &next, moveCount]()
+		{
+			XMFLOAT3 end = grid.Move(starts[next], moveDeltas[next], gCameraRadius);
+			next = (next + 1) % moveCount;
+			MicroBenchmark::Consume(&end);
+		});
+	};
+	runMoves("collision/move_castle", CastleWallBounds(), 55.0f);
+
+	std::vector<BoundingBox> randomWalls;
+	std::uniform_real_distribution<float> wallPosition(-500.0f, 500.0f);
+	for(UINT i = 0; i < 4096; ++i)
+	{
+		const XMFLOAT3 center(wallPosition(moveRandom), 5.0f, wallPosition(moveRandom));
+		randomWalls.push_back(BoundingBox(center, i % 2 == 0 ? XMFLOAT3(0.25f, 3.0f, 5.0f) : XMFLOAT3(5.0f, 3.0f, 0.25f)));
+	}
+	runMoves("collision/move_4096_walls", randomWalls, 500.0f);
+
+	// Scrubbing a minute of flythrough recorded at 60 fps: one sample at a random
+	// time per call.
+	CameraPath scrubPath;
+	Camera scrubCamera;
+	scrubPath.Reserve(3600);
+	for(UINT i = 0; i < 3600; ++i)
+	{
+		PlaceOnBenchmarkPath(i / 60.0, scrubCamera);
+		scrubCamera.UpdateViewMatrix();
+		scrubPath.AddKey(i / 60.0f, scrubCamera);
+	}
+
+	std::uniform_real_distribution<float> scrubTime(0.0f, scrubPath.EndTime());
+	std::vector<float> scrubTimes(moveCount);
+	for(float& time : scrubTimes)
+		time = scrubTime(moveRandom);
+
+	UINT nextScrub = 0;
+	bench.Run("camera_path/sample", [&scrubPath, &scrubTimes, &nextScrub, moveCount]()
+	{
+		XMFLOAT3 position;
+		XMFLOAT4 orientation;
+		scrubPath.Sample(scrubTimes[nextScrub], position, orientation);
+		nextScrub = (nextScrub + 1) % moveCount;
+		MicroBenchmark::Consume(&position);
+		MicroBenchmark::Consume(&orientation);
+	});
+
+	WIN32_FIND_DATAW found;
+	HANDLE find = FindFirstFileW(L"../../Textures/*.dds", &found);
+	if(find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			ComPtr<ID3DBlob> file = d3dUtil::LoadBinary(std::wstring(L"../../Textures/") + found.cFileName);
+			const std::wstring filename(found.cFileName);
+			bench.Run("dds/" + std::string(filename.begin(), filename.end()), [&file]()
+			{
+				DDSAlphaInfo info = AnalyzeDDSAlpha(file->GetBufferPointer(), file->GetBufferSize());
+				MicroBenchmark::Consume(&info);
+			});
+		} while(FindNextFileW(find, &found));
+		FindClose(find);
+	}
+
+	// Constant packing into memory laid out like the upload buffers: tightly
+	// packed object constants, and a pass constant buffer padded to 256 bytes.
+	const UINT objectCount = 256;
+	std::vector<XMFLOAT4X4> worlds(objectCount);
+	for(UINT i = 0; i < objectCount; ++i)
+		XMStoreFloat4x4(&worlds[i], XMMatrixTranslation((float)i, 0.0f, 0.0f));
+
+	std::vector<ObjectConstants> objects(objectCount);
+	bench.Run("pack/object_constants_" + std::to_string(objectCount), [&worlds, &objects]()
+	{
+		for(size_t i = 0; i < worlds.size(); ++i)
+		{
+			ObjectConstants constants;
+			XMStoreFloat4x4(&constants.World, XMMatrixTranspose(XMLoadFloat4x4(&worlds[i])));
+			XMStoreFloat4x4(&constants.TexTransform, XMMatrixIdentity());
+			memcpy(&objects[i], &constants, sizeof(constants));
+		}
+		MicroBenchmark::Consume(objects.data());
+	});
+
+	// The same with UpdateObjectCBs' gather and batch transpose.
+	std::vector<ObjectConstants> gathered(objectCount);
+	bench.Run("pack/object_constants_" + std::to_string(objectCount) + "_batched", [&worlds, &gathered, &objects]()
+	{
+		for(size_t i = 0; i < worlds.size(); ++i)
+		{
+			gathered[i].World = worlds[i];
+			gathered[i].TexTransform = MathHelper::Identity4x4();
+		}
+
+		XMFLOAT4X4* matrices = reinterpret_cast<XMFLOAT4X4*>(gathered.data());
+		MathHelper::TransposeMatrices(matrices, matrices, 2*gathered.size());
+		for(size_t i = 0; i < gathered.size(); ++i)
+			memcpy(&objects[i], &gathered[i], sizeof(ObjectConstants));
+		MicroBenchmark::Consume(objects.data());
+	});
+
+	std::vector<BYTE> passBuffer(d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants)));
+	bench.Run("pack/pass_constants", [&pass, &passBuffer]()
+	{
+		memcpy(passBuffer.data(), &pass, sizeof(pass));
+		MicroBenchmark::Consume(passBuffer.data());
+	});
+
+	const bool written = bench.Write(L"microbench.json") && bench.Write(L"microbench.txt");
+	return written ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+//***************************************************************************************
+// MicroBenchmarks.h
+//
+// -microbench: CPU micro-benchmarks of the Common code and the per-frame packing,
+// without a window or device.  Times only; the self-tests check the same code.
+//***************************************************************************************
+
+#pragma once
+
+// Wave steps, every GeometryGenerator shape, subdivision levels, camera matrices,
+// batch transforms, frustum culling, camera collision, camera path sampling, DDS
+// parsing of every file in Textures and constant packing.  Writes microbench.json
+// (for comparing builds) and microbench.txt; returns 1 if it cannot.
+int RunMicroBenchmarks();
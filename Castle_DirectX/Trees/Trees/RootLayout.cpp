@@ -0,0 +1,45 @@
+//***************************************************************************************
+// RootLayout.cpp
+//***************************************************************************************
+
+#include "RootLayout.h"
+
+void BuildRootLayout(RootSignatureBuilder& builder, D3D12_STATIC_SAMPLER_DESC sampler)
+{
+	// Textures are uploaded once and their descriptors written once during
+	// initialization, so both the data and the descriptors are static.
+	UINT slot = builder.AddTable({ RootSignatureBuilder::Range(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0,
+		D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC) }, D3D12_SHADER_VISIBILITY_PIXEL);
+	assert(slot == RootDiffuseTexture);
+
+	// Two 32-bit indices replace the per-draw object and material CBVs.
+	slot = builder.AddConstants(2, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+	assert(slot == RootDrawIndices);
+
+	// Rewritten by the CPU each frame, but never while a frame using them executes.
+	slot = builder.AddCBV(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_ALL);
+	assert(slot == RootPass);
+	slot = builder.AddSRV(0, 1, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_VERTEX);
+	assert(slot == RootObjects);
+	slot = builder.AddSRV(1, 1, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_ALL);
+	assert(slot == RootMaterials);
+
+	// The tree points live in a default-heap buffer written once at startup.
+	slot = builder.AddSRV(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC, D3D12_SHADER_VISIBILITY_VERTEX);
+	assert(slot == RootTreeSprites);
+
+	// Light clusters, rewritten by the CPU each frame like the pass constants.
+	slot = builder.AddSRV(2, 1, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_PIXEL);
+	assert(slot == RootClusterLights);
+	slot = builder.AddSRV(3, 1, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_PIXEL);
+	assert(slot == RootClusterRanges);
+	slot = builder.AddSRV(4, 1, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_PIXEL);
+	assert(slot == RootClusterLightIndices);
+
+	sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+	builder.AddStaticSampler(sampler);
+
+	builder.SetFlags(D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS);
+}
@@ -0,0 +1,29 @@
+//***************************************************************************************
+// RootLayout.h
+//
+// The app's root signature layout, described without a device so -selftest can
+// check it.
+//***************************************************************************************
+
+#pragma once
+
+#include "../../Common/RootSignatureBuilder.h"
+
+// Root parameter slots, ordered from most to least frequently changed.
+enum RootParameter : UINT
+{
+	RootDiffuseTexture = 0, // table, t0, pixel
+	RootDrawIndices,        // root constants, b0: object and material index
+	RootPass,               // CBV, b1
+	RootObjects,            // SRV, t0 space1, vertex
+	RootMaterials,          // SRV, t1 space1
+	RootTreeSprites,        // SRV, t1, vertex
+	RootClusterLights,      // SRV, t2 space1, pixel
+	RootClusterRanges,      // SRV, t3 space1, pixel
+	RootClusterLightIndices,// SRV, t4 space1, pixel
+	RootParameterCount
+};
+
+// Describes the RootParameter slots in builder; sampler is the one static sampler,
+// made pixel-only here.
+void BuildRootLayout(RootSignatureBuilder& builder, D3D12_STATIC_SAMPLER_DESC sampler);
@@ -0,0 +1,39 @@
+//***************************************************************************************
+// ClusteredLighting.hlsl
+//
+// Point and spot lights binned per view frustum cluster on the CPU (LightClusters).
+// Included after cbPass by the shaders built with CLUSTERED; the forward gLights
+// array then only holds the directional lights.
+//***************************************************************************************
+
+// Point lights have SpotPower 0; every other light is a spot light.
+StructuredBuffer<Light> gClusterLights       : register(t2, space1);
+StructuredBuffer<uint2> gClusterRanges       : register(t3, space1);
+StructuredBuffer<uint>  gClusterLightIndices : register(t4, space1);
+
+// posH is SV_Position in the pixel shader: xy in pixels, w the view space depth.
+uint ClusterIndex(float4 posH)
+{
+    uint2 tile = min(uint2(posH.xy*gClusterTileScale), gClusterDims.xy - 1);
+    uint slice = min(uint(max(log(posH.w)*gClusterZScale + gClusterZBias, 0.0f)), gClusterDims.z - 1);
+
+    return (slice*gClusterDims.y + tile.y)*gClusterDims.x + tile.x;
+}
+
+float3 ComputeClusteredLighting(float4 posH, Material mat, float3 pos, float3 normal, float3 toEye)
+{
+    uint2 range = gClusterRanges[ClusterIndex(posH)];
+
+    float3 result = 0.0f;
+    for(uint i = 0; i < range.y; ++i)
+    {
+        Light L = gClusterLights[gClusterLightIndices[range.x + i]];
+
+        if(L.SpotPower > 0.0f)
+            result += ComputeSpotLight(L, mat, pos, normal, toEye);
+        else
+            result += ComputePointLight(L, mat, pos, normal, toEye);
+    }
+
+    return result;
+}
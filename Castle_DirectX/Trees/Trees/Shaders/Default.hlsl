@@ -24,18 +24,32 @@
 Texture2D    gDiffuseMap : register(t0);
 
 
-SamplerState gsamPointWrap        : register(s0);
-SamplerState gsamPointClamp       : register(s1);
-SamplerState gsamLinearWrap       : register(s2);
-SamplerState gsamLinearClamp      : register(s3);
+// The only static sampler in the root signature.
 SamplerState gsamAnisotropicWrap  : register(s4);
-SamplerState gsamAnisotropicClamp : register(s5);
 
-// Constant data that varies per frame.
-cbuffer cbPerObject : register(b0)
+struct ObjectData
 {
-    float4x4 gWorld;
-	float4x4 gTexTransform;
+    float4x4 World;
+	float4x4 TexTransform;
+};
+
+struct MaterialData
+{
+	float4   DiffuseAlbedo;
+    float3   FresnelR0;
+    float    Roughness;
+	float4x4 MatTransform;
+};
+
+// Per-object and per-material data for the whole frame; each draw selects its
+// entries with the root constants below.
+StructuredBuffer<ObjectData>   gObjects   : register(t0, space1);
+StructuredBuffer<MaterialData> gMaterials : register(t1, space1);
+
+cbuffer cbDrawIndices : register(b0)
+{
+    uint gObjectIndex;
+    uint gMaterialIndex;
 };
 
 // Constant data that varies per material.
@@ -62,6 +76,13 @@ cbuffer cbPass : register(b1)
 	float gFogRange;
 	float2 cbPerObjectPad2;
 
+	// Clustered lighting grid; see ClusteredLighting.hlsl.
+	uint3 gClusterDims;
+	float gClusterZScale;
+	float2 gClusterTileScale;
+	float gClusterZBias;
+	float cbPerObjectPad3;
+
     // Indices [0, NUM_DIR_LIGHTS) are directional lights;
     // indices [NUM_DIR_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHTS) are point lights;
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
@@ -69,13 +90,9 @@ cbuffer cbPass : register(b1)
     Light gLights[MaxLights];
 };
 
-cbuffer cbMaterial : register(b2)
-{
-	float4   gDiffuseAlbedo;
-    float3   gFresnelR0;
-    float    gRoughness;
-	float4x4 gMatTransform;
-};
+#ifdef CLUSTERED
+#include "ClusteredLighting.hlsl"
+#endif
 
 struct VertexIn
 {
@@ -95,27 +112,32 @@ struct VertexOut
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout = (VertexOut)0.0f;
+
+	ObjectData obj = gObjects[gObjectIndex];
+	MaterialData mat = gMaterials[gMaterialIndex];
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(vin.PosL, 1.0f), obj.World);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul(vin.NormalL, (float3x3)obj.World);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
 	
 	// Output vertex attributes for interpolation across triangle.
-	float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
-	vout.TexC = mul(texC, gMatTransform).xy;
+	float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), obj.TexTransform);
+	vout.TexC = mul(texC, mat.MatTransform).xy;
 
     return vout;
 }
 
 float4 PS(VertexOut pin) : SV_Target
 {
-    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
+	MaterialData matData = gMaterials[gMaterialIndex];
+
+    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC) * matData.DiffuseAlbedo;
 	
 #ifdef ALPHA_TEST
 	// Discard pixel if texture alpha < 0.1.  We do this test as soon 
@@ -135,12 +157,16 @@ float4 PS(VertexOut pin) : SV_Target
     // Light terms.
     float4 ambient = gAmbientLight*diffuseAlbedo;
 
-    const float shininess = 1.0f - gRoughness;
-    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
+    const float shininess = 1.0f - matData.Roughness;
+    Material mat = { diffuseAlbedo, matData.FresnelR0, shininess };
     float3 shadowFactor = 1.0f;
     float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
         pin.NormalW, toEyeW, shadowFactor);
 
+#ifdef CLUSTERED
+    directLight.rgb += ComputeClusteredLighting(pin.PosH, mat, pin.PosW, pin.NormalW, toEyeW);
+#endif
+
     float4 litColor = ambient + directLight;
 
 #ifdef FOG
@@ -154,4 +180,12 @@ float4 PS(VertexOut pin) : SV_Target
     return litColor;
 }
 
+// Depth pre-pass for alpha-tested geometry: the same clip as PS, without lighting.
+void PSAlphaClip(VertexOut pin)
+{
+	MaterialData matData = gMaterials[gMaterialIndex];
+
+	float alpha = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC).a * matData.DiffuseAlbedo.a;
+	clip(alpha - 0.1f);
+}
 
@@ -14,6 +14,8 @@ struct Light
     float FalloffEnd;   // point/spot light only
     float3 Position;    // point light only
     float SpotPower;    // spot light only
+    float3 Color;       // unused; keeps the layout in sync with the C++ Light
+    float LightColor;   // unused
 };
 
 struct Material
@@ -0,0 +1,58 @@
+//***************************************************************************************
+// Overlay.hlsl
+//
+// Screen-space text and rectangles batched by OverlayBatch.  Positions are in pixels
+// from the top-left corner and texture coordinates in atlas texels; the atlas holds
+// glyph coverage, with a solid cell for rectangles.
+//***************************************************************************************
+
+Texture2D gFontAtlas : register(t0);
+
+// Only the leading members of the pass constants are read.
+cbuffer cbPass : register(b1)
+{
+    float4x4 gView;
+    float4x4 gInvView;
+    float4x4 gProj;
+    float4x4 gInvProj;
+    float4x4 gViewProj;
+    float4x4 gInvViewProj;
+    float3 gEyePosW;
+    float cbPerObjectPad1;
+    float2 gRenderTargetSize;
+    float2 gInvRenderTargetSize;
+};
+
+struct VertexIn
+{
+	float2 PosS  : POSITION;
+	float2 TexC  : TEXCOORD;
+	float4 Color : COLOR;
+};
+
+struct VertexOut
+{
+	float4 PosH  : SV_POSITION;
+	float2 TexC  : TEXCOORD;
+	float4 Color : COLOR;
+};
+
+VertexOut VS(VertexIn vin)
+{
+	VertexOut vout;
+
+	// Pixels to NDC, with y pointing down the screen.
+	float2 ndc = vin.PosS*gInvRenderTargetSize*float2(2.0f, -2.0f) + float2(-1.0f, 1.0f);
+	vout.PosH = float4(ndc, 0.0f, 1.0f);
+	vout.TexC = vin.TexC;
+	vout.Color = vin.Color;
+
+	return vout;
+}
+
+float4 PS(VertexOut pin) : SV_Target
+{
+	// Glyphs are drawn at their atlas size on whole pixels, so a load is exact.
+	float coverage = gFontAtlas.Load(int3(pin.TexC, 0)).r;
+	return float4(pin.Color.rgb, pin.Color.a*coverage);
+}
@@ -20,19 +20,43 @@
 
 Texture2DArray gTreeMapArray : register(t0);
 
+// Per-tree data read by the vertex-pulling path (VSPulled).  Same layout as the
+// tree sprite vertex buffer, which is bound here as a root SRV.
+struct TreeSprite
+{
+	float3 CenterW;
+	float2 SizeW;
+};
+
+StructuredBuffer<TreeSprite> gTreeSprites : register(t1);
+
 
-SamplerState gsamPointWrap        : register(s0);
-SamplerState gsamPointClamp       : register(s1);
-SamplerState gsamLinearWrap       : register(s2);
-SamplerState gsamLinearClamp      : register(s3);
+// The only static sampler in the root signature.
 SamplerState gsamAnisotropicWrap  : register(s4);
-SamplerState gsamAnisotropicClamp : register(s5);
 
-// Constant data that varies per frame.
-cbuffer cbPerObject : register(b0)
+struct ObjectData
+{
+    float4x4 World;
+	float4x4 TexTransform;
+};
+
+struct MaterialData
+{
+	float4   DiffuseAlbedo;
+    float3   FresnelR0;
+    float    Roughness;
+	float4x4 MatTransform;
+};
+
+// Per-object and per-material data for the whole frame; each draw selects its
+// entries with the root constants below.
+StructuredBuffer<ObjectData>   gObjects   : register(t0, space1);
+StructuredBuffer<MaterialData> gMaterials : register(t1, space1);
+
+cbuffer cbDrawIndices : register(b0)
 {
-    float4x4 gWorld;
-	float4x4 gTexTransform;
+    uint gObjectIndex;
+    uint gMaterialIndex;
 };
 
 // Constant data that varies per material.
@@ -59,6 +83,13 @@ cbuffer cbPass : register(b1)
 	float gFogRange;
 	float2 cbPerObjectPad2;
 
+	// Clustered lighting grid; see ClusteredLighting.hlsl.
+	uint3 gClusterDims;
+	float gClusterZScale;
+	float2 gClusterTileScale;
+	float gClusterZBias;
+	float cbPerObjectPad3;
+
     // Indices [0, NUM_DIR_LIGHTS) are directional lights;
     // indices [NUM_DIR_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHTS) are point lights;
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
@@ -66,13 +97,10 @@ cbuffer cbPass : register(b1)
     Light gLights[MaxLights];
 };
 
-cbuffer cbMaterial : register(b2)
-{
-	float4   gDiffuseAlbedo;
-    float3   gFresnelR0;
-    float    gRoughness;
-	float4x4 gMatTransform;
-};
+#ifdef CLUSTERED
+#include "ClusteredLighting.hlsl"
+#endif
+
  
 struct VertexIn
 {
@@ -95,6 +123,43 @@ struct GeoOut
     uint   PrimID  : SV_PrimitiveID;
 };
 
+// Output of the vertex-pulling path.  SV_PrimitiveID restarts for every
+// instance, so the tree index is passed down explicitly.
+struct PulledVertexOut
+{
+	float4 PosH    : SV_POSITION;
+    float3 PosW    : POSITION;
+    float3 NormalW : NORMAL;
+    float2 TexC    : TEXCOORD;
+    nointerpolation uint TreeID : TREEID;
+};
+
+//
+// Computes corner [0, 4) of a billboard aligned with the y-axis and facing the
+// eye, in triangle strip order.  Shared by the GS and the vertex-pulling VS and
+// mirrored on the CPU by ExpandBillboardCorner (Billboard.h).
+//
+void ExpandBillboard(float3 centerW, float2 sizeW, uint corner,
+                     out float3 posW, out float3 normalW, out float2 texC)
+{
+	float3 up = float3(0.0f, 1.0f, 0.0f);
+	float3 look = gEyePosW - centerW;
+	look.y = 0.0f; // y-axis aligned, so project to xz-plane
+	look = normalize(look);
+	float3 right = cross(up, look);
+
+	float halfWidth  = 0.5f*sizeW.x;
+	float halfHeight = 0.5f*sizeW.y;
+
+	// Corners 0 and 1 are on the +right side, 0 and 2 at the bottom.
+	float side = (corner < 2) ? 1.0f : -1.0f;
+	float height = (corner & 1) ? 1.0f : -1.0f;
+
+	posW    = centerW + side*halfWidth*right + height*halfHeight*up;
+	normalW = look;
+	texC    = float2((corner < 2) ? 0.0f : 1.0f, (corner & 1) ? 0.0f : 1.0f);
+}
+
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout;
@@ -114,59 +179,43 @@ void GS(point VertexOut gin[1],
         inout TriangleStream<GeoOut> triStream)
 {	
 	//
-	// Compute the local coordinate system of the sprite relative to the world
-	// space such that the billboard is aligned with the y-axis and faces the eye.
-	//
-
-	float3 up = float3(0.0f, 1.0f, 0.0f);
-	float3 look = gEyePosW - gin[0].CenterW;
-	look.y = 0.0f; // y-axis aligned, so project to xz-plane
-	look = normalize(look);
-	float3 right = cross(up, look);
-
-	//
-	// Compute triangle strip vertices (quad) in world space.
-	//
-	float halfWidth  = 0.5f*gin[0].SizeW.x;
-	float halfHeight = 0.5f*gin[0].SizeW.y;
-	
-	float4 v[4];
-	v[0] = float4(gin[0].CenterW + halfWidth*right - halfHeight*up, 1.0f);
-	v[1] = float4(gin[0].CenterW + halfWidth*right + halfHeight*up, 1.0f);
-	v[2] = float4(gin[0].CenterW - halfWidth*right - halfHeight*up, 1.0f);
-	v[3] = float4(gin[0].CenterW - halfWidth*right + halfHeight*up, 1.0f);
-
-	//
-	// Transform quad vertices to world space and output 
-	// them as a triangle strip.
+	// Expand the point into a quad in world space and output it as a
+	// triangle strip.
 	//
-	
-	float2 texC[4] = 
-	{
-		float2(0.0f, 1.0f),
-		float2(0.0f, 0.0f),
-		float2(1.0f, 1.0f),
-		float2(1.0f, 0.0f)
-	};
-	
 	GeoOut gout;
 	[unroll]
-	for(int i = 0; i < 4; ++i)
+	for(uint i = 0; i < 4; ++i)
 	{
-		gout.PosH     = mul(v[i], gViewProj);
-		gout.PosW     = v[i].xyz;
-		gout.NormalW  = look;
-		gout.TexC     = texC[i];
+		ExpandBillboard(gin[0].CenterW, gin[0].SizeW, i, gout.PosW, gout.NormalW, gout.TexC);
+		gout.PosH     = mul(float4(gout.PosW, 1.0f), gViewProj);
 		gout.PrimID   = primID;
 		
 		triStream.Append(gout);
 	}
 }
 
-float4 PS(GeoOut pin) : SV_Target
+// Vertex-pulling alternative to VS+GS: drawn as DrawInstanced(4, treeCount)
+// with a triangle strip topology and no input layout.  Each instance is one
+// tree and each vertex one corner of its quad.
+PulledVertexOut VSPulled(uint vertexID : SV_VertexID, uint instanceID : SV_InstanceID)
+{
+	TreeSprite tree = gTreeSprites[instanceID];
+
+	PulledVertexOut vout;
+	ExpandBillboard(tree.CenterW, tree.SizeW, vertexID, vout.PosW, vout.NormalW, vout.TexC);
+	vout.PosH   = mul(float4(vout.PosW, 1.0f), gViewProj);
+	vout.TreeID = instanceID;
+
+	return vout;
+}
+
+// The texture array slice is picked by tree index, as before.
+float4 ShadeTree(float4 posH, float3 posW, float3 normalW, float2 texC, uint treeID)
 {
-	float3 uvw = float3(pin.TexC, pin.PrimID%3);
-    float4 diffuseAlbedo = gTreeMapArray.Sample(gsamAnisotropicWrap, uvw) * gDiffuseAlbedo;
+	MaterialData matData = gMaterials[gMaterialIndex];
+
+	float3 uvw = float3(texC, treeID%3);
+    float4 diffuseAlbedo = gTreeMapArray.Sample(gsamAnisotropicWrap, uvw) * matData.DiffuseAlbedo;
 	
 #ifdef ALPHA_TEST
 	// Discard pixel if texture alpha < 0.1.  We do this test as soon 
@@ -176,21 +225,25 @@ float4 PS(GeoOut pin) : SV_Target
 #endif
 
     // Interpolating normal can unnormalize it, so renormalize it.
-    pin.NormalW = normalize(pin.NormalW);
+    normalW = normalize(normalW);
 
     // Vector from point being lit to eye. 
-	float3 toEyeW = gEyePosW - pin.PosW;
+	float3 toEyeW = gEyePosW - posW;
 	float distToEye = length(toEyeW);
 	toEyeW /= distToEye; // normalize
 
     // Light terms.
     float4 ambient = gAmbientLight*diffuseAlbedo;
 
-    const float shininess = 1.0f - gRoughness;
-    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
+    const float shininess = 1.0f - matData.Roughness;
+    Material mat = { diffuseAlbedo, matData.FresnelR0, shininess };
     float3 shadowFactor = 1.0f;
-    float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
-        pin.NormalW, toEyeW, shadowFactor);
+    float4 directLight = ComputeLighting(gLights, mat, posW,
+        normalW, toEyeW, shadowFactor);
+
+#ifdef CLUSTERED
+    directLight.rgb += ComputeClusteredLighting(posH, mat, posW, normalW, toEyeW);
+#endif
 
     float4 litColor = ambient + directLight;
 
@@ -205,4 +258,12 @@ float4 PS(GeoOut pin) : SV_Target
     return litColor;
 }
 
+float4 PS(GeoOut pin) : SV_Target
+{
+	return ShadeTree(pin.PosH, pin.PosW, pin.NormalW, pin.TexC, pin.PrimID);
+}
 
+float4 PSPulled(PulledVertexOut pin) : SV_Target
+{
+	return ShadeTree(pin.PosH, pin.PosW, pin.NormalW, pin.TexC, pin.TreeID);
+}
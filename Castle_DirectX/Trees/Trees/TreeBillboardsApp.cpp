@@ -7,8 +7,38 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/CameraPath.h"
+#include "../../Common/CollisionGrid.h"
+#include "../../Common/Frustum.h"
+#include "../../Common/ShaderCache.h"
+#include "../../Common/ShaderPermutations.h"
+#include "../../Common/ShaderDependencyGraph.h"
+#include "../../Common/ShaderWatcher.h"
+#include "../../Common/PipelineStateCache.h"
+#include "../../Common/RootSignatureBuilder.h"
+#include "../../Common/LightClusters.h"
+#include "../../Common/DDSAlpha.h"
+#include "../../Common/StartupTimeline.h"
+#include "../../Common/RenderContext.h"
+#include "../../Common/NullRenderContext.h"
+#include "../../Common/Profiler.h"
+#include "../../Common/GpuTimestamps.h"
+#include "../../Common/AllocationCounter.h"
+#include "../../Common/PerformanceHud.h"
 #include "FrameResource.h"
+#include "Billboard.h"
+#include "CastleScene.h"
+#include "MicroBenchmarks.h"
+#include "RootLayout.h"
+#include "TreeSelfTests.h"
 #include "Waves.h"
+#include <ppltasks.h>
+#include <random>
+#include <cfloat>
+#include <cstdio>
+#include <psapi.h>
+
+#pragma comment(lib, "psapi.lib")
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -38,7 +68,8 @@ struct RenderItem
 	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
 	int NumFramesDirty = gNumFrameResources;
 
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
+	// Index into the frame's object buffer for this render item; passed to the
+	// shaders as a root constant.
 	UINT ObjCBIndex = -1;
 
 	Material* Mat = nullptr;
@@ -53,6 +84,198 @@ struct RenderItem
     int BaseVertexLocation = 0;
 };
 
+// Every shader permutation the app uses.  Shared by BuildShadersAndInputLayouts and
+// the offline -compileshaders step so both produce the same shader cache entries.
+// Lit stages are compiled for the light buckets of the main pass; the others use
+// the unlit variant.
+struct ShaderDesc
+{
+	const char* Name;
+	const wchar_t* Filename;
+	UINT Features;
+	bool Lit;
+	const char* EntryPoint;
+	const char* Target;
+};
+
+const UINT gFogFeatures = ShaderPermutations::FeatureFog;
+const UINT gAlphaTestFeatures = ShaderPermutations::FeatureFog | ShaderPermutations::FeatureAlphaTest;
+
+// Alpha below which the alpha-tested pixel shaders clip().
+const float gAlphaTestThreshold = 0.1f;
+
+const ShaderDesc gShaderDescs[] =
+{
+	{ "standardVS",         L"Shaders\\Default.hlsl",    0,                  false, "VS",          "vs_5_0" },
+	{ "opaquePS",           L"Shaders\\Default.hlsl",    gFogFeatures,       true,  "PS",          "ps_5_0" },
+	{ "alphaTestedPS",      L"Shaders\\Default.hlsl",    gAlphaTestFeatures, true,  "PS",          "ps_5_0" },
+	{ "alphaClipPS",        L"Shaders\\Default.hlsl",    0,                  false, "PSAlphaClip", "ps_5_0" },
+	{ "treeSpriteVS",       L"Shaders\\TreeSprite.hlsl", 0,                  false, "VS",          "vs_5_0" },
+	{ "treeSpriteGS",       L"Shaders\\TreeSprite.hlsl", 0,                  false, "GS",          "gs_5_0" },
+	{ "treeSpritePS",       L"Shaders\\TreeSprite.hlsl", gAlphaTestFeatures, true,  "PS",          "ps_5_0" },
+	{ "treeSpritePulledVS", L"Shaders\\TreeSprite.hlsl", 0,                  false, "VSPulled",    "vs_5_0" },
+	{ "treeSpritePulledPS", L"Shaders\\TreeSprite.hlsl", gAlphaTestFeatures, true,  "PSPulled",    "ps_5_0" },
+	{ "overlayVS",          L"Shaders\\Overlay.hlsl",    0,                  false, "VS",          "vs_5_0" },
+	{ "overlayPS",          L"Shaders\\Overlay.hlsl",    0,                  false, "PS",          "ps_5_0" },
+};
+
+// Object buffer entries of gCastleWalls start here, in table order.
+const UINT gFirstWallObjectIndex = 45;
+
+const int gBenchmarkWarmupFrames = 60;
+
+// R records the camera once a frame; this many keys, ten minutes at 60 fps, are
+// reserved when it starts so recording does not reallocate.
+const UINT gRecordedPathKeys = 60*60*10;
+
+// -headless frames that may allocate while caches and pools fill.
+const int gAllocationWarmupFrames = 8;
+const unsigned gBenchmarkSeed = 1234;
+
+// Clustered lighting grid and per-frame buffer capacities.
+const UINT gClusterTilesX = 16;
+const UINT gClusterTilesY = 9;
+const UINT gClusterSlicesZ = 24;
+const UINT gMaxClusterLights = 1024;
+const UINT gMaxClusterLightIndices = gClusterTilesX*gClusterTilesY*gClusterSlicesZ*32;
+
+// GPU timestamp markers per frame, and the frames each marker's statistics cover.
+const UINT gMaxGpuMarkers = 16;
+const UINT gGpuStatsWindow = 240;
+
+// Performance HUD: quads per frame (text and graph bars), and the font atlas's
+// slot in the SRV heap, after the material textures.
+const UINT gMaxOverlayQuads = 2048;
+const UINT gOverlayFontSrvIndex = 12;
+
+// Seconds between the HUD's memory samples; memory changes slowly and reading
+// the process counters is a system call.
+const double gHudMemorySampleSeconds = 0.5;
+
+// Lights of the main pass, grouped by type.  They are packed into
+// PassConstants::Lights in this order, padded up to the variant's buckets.
+struct SceneLights
+{
+	std::vector<Light> Directional;
+	std::vector<Light> Point;
+	std::vector<Light> Spot;
+};
+
+SceneLights CreateSceneLights()
+{
+	SceneLights lights;
+	lights.Directional.resize(3);
+	lights.Directional[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
+	lights.Directional[0].Strength = { 0.0f, 1.0f, 0.0f };
+	lights.Directional[1].Direction = { -0.57735f, -0.57735f, 0.57735f };
+	lights.Directional[1].Strength = { 1.0f, 0.0f, 0.0f };
+	lights.Directional[2].Direction = { 0.0f, -0.707f, -0.707f };
+	lights.Directional[2].Strength = { 0.0f, 0.0f, 1.0f };
+
+	// Torches on both faces of every wall, about every five units.
+	const float torchSpacing = 5.0f;
+	for(UINT w = 0; w < gCastleWallCount; ++w)
+	{
+		const CastleWall& wall = gCastleWalls[w];
+		const bool alongZ = wall.Size.z > wall.Size.x;
+		const float length = alongZ ? wall.Size.z : wall.Size.x;
+		const float offset = 0.5f*(alongZ ? wall.Size.x : wall.Size.z) + 0.3f;
+		const UINT count = std::max<UINT>(1, (UINT)(length / torchSpacing));
+
+		for(UINT i = 0; i < count; ++i)
+		{
+			const float along = ((i + 0.5f) / count - 0.5f)*length;
+			for(float side : { -1.0f, 1.0f })
+			{
+				Light torch;
+				torch.Strength = { 0.8f, 0.45f, 0.15f };
+				torch.FalloffStart = 1.0f;
+				torch.FalloffEnd = 6.0f;
+				torch.SpotPower = 0.0f;
+				torch.Position.x = wall.Center.x + (alongZ ? side*offset : along);
+				torch.Position.y = wall.Center.y + 0.25f*wall.Size.y;
+				torch.Position.z = wall.Center.z + (alongZ ? along : side*offset);
+				lights.Point.push_back(torch);
+			}
+		}
+	}
+
+	return lights;
+}
+
+// Smallest light variant holding every light of the pass.  With more point or spot
+// lights than the forward buckets hold, the lit stages switch to clustered lighting
+// and the buckets only hold the directional lights.
+ShaderPermutations::Key SelectLightBuckets(const SceneLights& lights)
+{
+	const UINT numDirLights = (UINT)lights.Directional.size();
+	const UINT numPointLights = (UINT)lights.Point.size();
+	const UINT numSpotLights = (UINT)lights.Spot.size();
+
+	ShaderPermutations::Key buckets = ShaderPermutations::Select(numDirLights,
+		numPointLights, numSpotLights, ShaderPermutations::FeatureNone);
+
+	if(!ShaderPermutations::Fits(buckets, numDirLights, numPointLights, numSpotLights))
+	{
+		assert(numPointLights + numSpotLights <= gMaxClusterLights);
+		buckets = ShaderPermutations::Select(numDirLights, 0, 0, ShaderPermutations::FeatureClustered);
+	}
+	assert(ShaderPermutations::Fits(buckets, numDirLights, 0, 0));
+
+	return buckets;
+}
+
+// Point then spot lights, as indexed by the light clusters.  Point lights are
+// marked with SpotPower 0 for the shaders.
+std::vector<Light> ClusteredLightList(const SceneLights& lights)
+{
+	std::vector<Light> list;
+	list.reserve(lights.Point.size() + lights.Spot.size());
+
+	for(Light light : lights.Point)
+	{
+		light.SpotPower = 0.0f;
+		list.push_back(light);
+	}
+	list.insert(list.end(), lights.Spot.begin(), lights.Spot.end());
+
+	return list;
+}
+
+ShaderPermutations::Key PermutationFor(const ShaderDesc& desc, const ShaderPermutations::Key& lightBuckets)
+{
+	if(!desc.Lit)
+		return ShaderPermutations::Unlit(desc.Features);
+
+	// Light buckets carry the clustered lighting feature.
+	ShaderPermutations::Key key = lightBuckets;
+	key.Features = desc.Features | lightBuckets.Features;
+
+	return key;
+}
+
+const ShaderDesc& FindShaderDesc(const std::string& name)
+{
+	for(const ShaderDesc& desc : gShaderDescs)
+	{
+		if(name == desc.Name)
+			return desc;
+	}
+
+	throw std::out_of_range("Unknown shader " + name);
+}
+
+D3D12_SHADER_BYTECODE ShaderBytecode(ID3DBlob* blob)
+{
+	D3D12_SHADER_BYTECODE code = { nullptr, 0 };
+	if(blob != nullptr)
+		code = { reinterpret_cast<BYTE*>(blob->GetBufferPointer()), blob->GetBufferSize() };
+
+	return code;
+}
+
+const wchar_t* gShaderCacheDir = L"ShaderCache";
+
 enum class RenderLayer : int
 {
 	Opaque = 0,
@@ -62,6 +285,227 @@ enum class RenderLayer : int
 	Count
 };
 
+// Every PSO a frame binds.  ResolvePipelines fills a table indexed by these once
+// the PSO jobs finish, so binding one is an array lookup.
+enum class Pipeline : int
+{
+	Opaque = 0,
+	Transparent,
+	AlphaTested,
+	OpaqueDepth,
+	AlphaTestedDepth,
+	OpaqueEqual,
+	AlphaTestedEqual,
+	TreeSprites,
+	TreeSpritesPulled,
+	Overlay,
+	Count
+};
+
+// Names of the Pipeline values in mPSOs, the startup trace and shader reloads.
+const char* const gPipelineNames[] =
+{
+	"opaque", "transparent", "alphaTested", "opaqueDepth", "alphaTestedDepth",
+	"opaqueEqual", "alphaTestedEqual", "treeSprites", "treeSpritesPulled", "overlay"
+};
+static_assert(_countof(gPipelineNames) == (int)Pipeline::Count, "A Pipeline value has no name.");
+
+// CPU stages of a frame, timed every frame and reported by -headless.
+enum FrameStage : int
+{
+	StageHotReload = 0,
+	StageInput,
+	StageWaitForGpu,
+	StageAnimateMaterials,
+	StageObjects,
+	StageMaterials,
+	StageLightClusters,
+	StagePass,
+	StageWaves,
+	StageHud,
+	StageRecord,
+	StageSubmit,
+	StageCount
+};
+
+const char* const gFrameStageNames[StageCount] =
+{
+	"hotReload", "input", "waitForGpu", "animateMaterials", "objects",
+	"materials", "lightClusters", "pass", "waves", "hud", "record", "submit"
+};
+
+// Adds the time until the end of the scope to totalMs, and the heap allocations
+// made meanwhile to allocations.
+class StageClock
+{
+public:
+	StageClock(double& totalMs, UINT64& allocations)
+		: mTotalMs(totalMs), mAllocations(allocations), mStartAllocations(AllocationCounter::Count())
+	{
+		QueryPerformanceCounter(&mStart);
+	}
+
+	StageClock(const StageClock& rhs) = delete;
+	StageClock& operator=(const StageClock& rhs) = delete;
+
+	~StageClock()
+	{
+		LARGE_INTEGER end, frequency;
+		QueryPerformanceCounter(&end);
+		QueryPerformanceFrequency(&frequency);
+		mTotalMs += 1000.0*(end.QuadPart - mStart.QuadPart) / frequency.QuadPart;
+		mAllocations += AllocationCounter::Count() - mStartAllocations;
+	}
+
+private:
+	double& mTotalMs;
+	UINT64& mAllocations;
+	UINT64 mStartAllocations;
+	LARGE_INTEGER mStart;
+};
+
+// Per-frame totals for the -headless and -benchmark reports.
+class FrameReport
+{
+public:
+	FrameReport()
+	{
+		mFrameTimes.AddBudget(1000.0 / 60.0);
+		mFrameTimes.AddBudget(1000.0 / 30.0);
+	}
+
+	FrameReport(const FrameReport& rhs) = delete;
+	FrameReport& operator=(const FrameReport& rhs) = delete;
+
+	// Allocations are only counted in steady state frames, once the caches have
+	// filled.
+	void AddFrame(const double stageMs[StageCount], const UINT64 stageAllocations[StageCount],
+		double frameMs, const RenderStats& stats, bool steadyState)
+	{
+		double cpuMs = 0.0;
+		for(int i = 0; i < StageCount; ++i)
+		{
+			mStages[i].Add(stageMs[i]);
+			cpuMs += stageMs[i];
+		}
+		mCpu.Add(cpuMs);
+		mFrameTimes.Record(frameMs);
+
+		if(steadyState)
+		{
+			UINT64 allocations = 0;
+			for(int i = 0; i < StageCount; ++i)
+			{
+				mAllocations[i] += stageAllocations[i];
+				allocations += stageAllocations[i];
+			}
+			if(allocations > 0)
+				mFramesAllocating++;
+		}
+
+		mCommands.Draws += stats.Draws;
+		mCommands.Instances += stats.Instances;
+		mCommands.PipelineBinds += stats.PipelineBinds;
+		mCommands.RootSignatureBinds += stats.RootSignatureBinds;
+		mCommands.DescriptorHeapBinds += stats.DescriptorHeapBinds;
+		mCommands.DescriptorTableBinds += stats.DescriptorTableBinds;
+		mCommands.RootConstantBinds += stats.RootConstantBinds;
+		mCommands.RootBufferBinds += stats.RootBufferBinds;
+		mCommands.VertexBufferBinds += stats.VertexBufferBinds;
+		mCommands.IndexBufferBinds += stats.IndexBufferBinds;
+		mCommands.TopologyChanges += stats.TopologyChanges;
+		mCommands.RenderTargetBinds += stats.RenderTargetBinds;
+		mCommands.Clears += stats.Clears;
+		mCommands.Barriers += stats.Barriers;
+		mCommands.Queries += stats.Queries;
+		mCommands.Commands += stats.Commands;
+		mFrames++;
+	}
+
+	int Frames()const
+	{
+		return mFrames;
+	}
+
+	int FramesAllocating()const
+	{
+		return mFramesAllocating;
+	}
+
+	// The "cpu_ms" and "per_frame" members; extra is appended to per_frame as
+	// name/total pairs averaged over the frames.
+	void WriteJson(std::ostream& report, const std::vector<std::pair<const char*, UINT64>>& extra)const
+	{
+		const double frames = (double)std::max<int>(mFrames, 1);
+		auto writeTimes = [&](const char* name, const Totals& totals, bool last)
+		{
+			report << "    \"" << name << "\": { \"avg_ms\": " << totals.Sum / frames
+				<< ", \"min_ms\": " << totals.Min << ", \"max_ms\": " << totals.Max << " }"
+				<< (last ? "\n" : ",\n");
+		};
+		auto writeCount = [&](const char* name, UINT64 total, bool last)
+		{
+			report << "    \"" << name << "\": " << total / frames << (last ? "\n" : ",\n");
+		};
+
+		report << "  \"cpu_ms\": {\n";
+		for(int i = 0; i < StageCount; ++i)
+			writeTimes(gFrameStageNames[i], mStages[i], false);
+		writeTimes("frame", mCpu, true);
+		report << "  },\n";
+		report << "  \"per_frame\": {\n";
+		writeCount("draws", mCommands.Draws, false);
+		writeCount("instances", mCommands.Instances, false);
+		writeCount("pipeline_binds", mCommands.PipelineBinds, false);
+		writeCount("root_signature_binds", mCommands.RootSignatureBinds, false);
+		writeCount("descriptor_heap_binds", mCommands.DescriptorHeapBinds, false);
+		writeCount("descriptor_table_binds", mCommands.DescriptorTableBinds, false);
+		writeCount("root_constant_binds", mCommands.RootConstantBinds, false);
+		writeCount("root_buffer_binds", mCommands.RootBufferBinds, false);
+		writeCount("vertex_buffer_binds", mCommands.VertexBufferBinds, false);
+		writeCount("index_buffer_binds", mCommands.IndexBufferBinds, false);
+		writeCount("topology_changes", mCommands.TopologyChanges, false);
+		writeCount("render_target_binds", mCommands.RenderTargetBinds, false);
+		writeCount("clears", mCommands.Clears, false);
+		writeCount("barriers", mCommands.Barriers, false);
+		writeCount("queries", mCommands.Queries, false);
+		writeCount("commands", mCommands.Commands, extra.empty());
+		for(size_t i = 0; i < extra.size(); ++i)
+			writeCount(extra[i].first, extra[i].second, i + 1 == extra.size());
+		report << "  },\n";
+		report << "  \"steady_state_allocations\": {\n";
+		report << "    \"counted\": " << (AllocationCounter::Enabled() ? "true" : "false") << ",\n";
+		report << "    \"frames_allocating\": " << mFramesAllocating << ",\n";
+		for(int i = 0; i < StageCount; ++i)
+			report << "    \"" << gFrameStageNames[i] << "\": " << mAllocations[i] << (i + 1 == StageCount ? "\n" : ",\n");
+		report << "  },\n";
+		report << "  \"frame_times\": " << mFrameTimes.ToJson();
+	}
+
+private:
+	struct Totals
+	{
+		double Sum = 0.0;
+		double Min = DBL_MAX;
+		double Max = 0.0;
+
+		void Add(double ms)
+		{
+			Sum += ms;
+			Min = std::min<double>(Min, ms);
+			Max = std::max<double>(Max, ms);
+		}
+	};
+
+	Totals mStages[StageCount];
+	Totals mCpu;
+	UINT64 mAllocations[StageCount] = {};
+	int mFramesAllocating = 0;
+	FrameTimeHistogram mFrameTimes;
+	RenderStats mCommands;
+	int mFrames = 0;
+};
+
 class TreeBillboardsApp : public D3DApp
 {
 public:
@@ -72,6 +516,36 @@ public:
 
     virtual bool Initialize()override;
 
+	// Waits for the shader and PSO jobs still running first, so every one of them
+	// is in the trace.
+	bool WriteStartupTrace(const std::wstring& filename);
+
+	// Call before Initialize.  Reverse-Z (the default) renders with an infinite far
+	// plane into a D32 float depth buffer cleared to 0, without the stencil nothing
+	// uses; off, the usual [zn, zf] to [0, 1] into D24S8.
+	void SetReverseZ(bool value);
+
+	// Runs frameCount frames without presenting: Update as usual, with the frame
+	// recorded into a NullRenderContext instead of a command list.  Writes the CPU
+	// time per stage, command counts and upload bytes to reportFile as JSON.  With
+	// requireZeroAllocations, returns 2 if any stage allocated after the warm up
+	// frames, or 3 at once in builds that do not count allocations (all but debug
+	// builds).  With a camera path loaded the camera follows it, otherwise it stays
+	// put.  Only the recording is swapped out: Initialize has already created the
+	// device and, on it, the scene's buffers, textures and PSOs, so a headless run
+	// still needs a D3D12 device, WARP at least.
+	int RunHeadless(int frameCount, const std::wstring& reportFile, bool requireZeroAllocations);
+
+	// Runs frameCount frames, after a warm up, with the camera on the loaded camera
+	// path or else gBenchmarkPath, a fixed 1/60 s step and a fixed random seed, so
+	// every run draws the same frames.  Writes frame times, CPU time per stage, GPU
+	// time per layer, command counts and memory use to reportFile as JSON.
+	int RunBenchmark(int frameCount, const std::wstring& reportFile);
+
+	// Loads a path recorded with R for RunBenchmark and RunHeadless to play in a
+	// loop.  False if the file cannot be read or holds no keys.
+	bool LoadCameraPath(const std::wstring& filename);
+
 private:
     virtual void OnResize()override;
     virtual void Update(const GameTimer& gt)override;
@@ -80,16 +554,27 @@ private:
     virtual void OnMouseDown(WPARAM btnState, int x, int y)override;
     virtual void OnMouseUp(WPARAM btnState, int x, int y)override;
     virtual void OnMouseMove(WPARAM btnState, int x, int y)override;
+	virtual void OnKeyUp(WPARAM key)override;
 
     void OnKeyboardInput(const GameTimer& gt);
+	void UpdateBenchmarkCamera(const GameTimer& gt);
+	void WriteMemoryJson(std::ostream& report);
+	void TrackGeometry(const MeshGeometry& geo);
 	void UpdateCamera(const GameTimer& gt);
 	void AnimateMaterials(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
+	void UpdateLightClusters(const GameTimer& gt);
 	void UpdateWaves(const GameTimer& gt); 
+	UINT64 UploadBytesWritten()const;
+	void CaptureHudSnapshot(HudSnapshot& snapshot);
+	void UpdateHud();
 
 	void LoadTextures();
+	void BuildOverlayFont();
+	void AnalyzeTextureAlpha();
+	void MoveOpaqueAlphaTestedItems();
     void BuildRootSignature();
 	void BuildDescriptorHeaps();
     void BuildShadersAndInputLayouts();
@@ -99,10 +584,22 @@ private:
 	void BuildTreeSpritesGeometry();
 	void BuildShapeGeometry();
     void BuildPSOs();
+	void CreatePSOAsync(Pipeline pipeline, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+		const char* vs, const char* gs, const char* ps);
+	void ResolvePipelines();
+	ID3D12PipelineState* GetPSO(Pipeline pipeline)const;
+	void WaitForPipelineJobs();
+	void UpdateShaderHotReload();
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
-    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void RecordFrame(RenderContext& context);
+	void BeginGpuMarker(RenderContext& context, const char* name);
+	void EndGpuMarker(RenderContext& context);
+	void ReadGpuTimestamps();
+    void DrawRenderItems(RenderContext& context, const std::vector<RenderItem*>& ritems);
+	void DrawTreeSpritesPulled(RenderContext& context, const std::vector<RenderItem*>& ritems);
+	void DrawOverlay(RenderContext& context);
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
@@ -120,22 +617,83 @@ private:
 
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
 
+	// Hash of the serialized root signature; part of every pipeline cache key.
+	std::uint64_t mRootSignatureHash = 0;
+
 	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
+	Material* mWaterMaterial = nullptr; // scrolled every frame
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
+
+	// Alpha range of each texture's DDS file, and the texture behind each SRV
+	// heap slot; used to draw alpha-tested items that never clip as opaque.
+	std::unordered_map<std::string, DDSAlphaInfo> mTextureAlpha;
+	std::vector<std::string> mSrvHeapTextures;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
 
+	// mPSOs by Pipeline, filled by ResolvePipelines at the end of Initialize and
+	// again when a reload swaps PSOs.
+	ID3D12PipelineState* mPipelines[(int)Pipeline::Count] = {};
+
+	ShaderCache mShaderCache;
+	ShaderPermutations mShaderPermutations;
+	std::unique_ptr<PipelineStateCache> mPipelineCache;
+
+	// Background jobs that fill mShaders and mPSOs.  Each slot is inserted on the
+	// main thread before its job starts; the job only writes through a pointer to
+	// its own slot.  A PSO job depends on the shader jobs it uses.
+	std::unordered_map<std::string, concurrency::task<void>> mShaderTasks;
+	std::unordered_map<std::string, concurrency::task<void>> mPSOTasks;
+
+	StartupTimeline mStartupTimeline;
+
+	// Shader hot reload.  An edit under Shaders\ starts a job that recompiles the
+	// affected permutations and rebuilds the PSOs using them; Update swaps the
+	// results in between frames.
+	struct PipelineSource
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+		std::string VS;
+		std::string GS;
+		std::string PS;
+	};
+
+	struct ShaderReload
+	{
+		std::unordered_map<std::string, ComPtr<ID3DBlob>> Shaders;
+		std::unordered_map<std::string, std::vector<std::wstring>> Sources;
+		std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> PSOs;
+	};
+
+	ShaderReload ReloadShaders(const std::vector<std::string>& shaders, const std::vector<std::string>& pipelines);
+
+	std::unordered_map<std::string, PipelineSource> mPipelineSources;
+	ShaderDependencyGraph mShaderDependencies;
+	std::unique_ptr<ShaderWatcher> mShaderWatcher;
+	concurrency::task<ShaderReload> mShaderReloadJob;
+	bool mShaderReloadPending = false;
+
+	// PSOs replaced by a reload, released once the GPU passes the fence value
+	// of the last frame that could have used them.
+	std::vector<std::pair<UINT64, ComPtr<ID3D12PipelineState>>> mRetiredPSOs;
+
     std::vector<D3D12_INPUT_ELEMENT_DESC> mStdInputLayout;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mTreeSpriteInputLayout;
+	std::vector<D3D12_INPUT_ELEMENT_DESC> mOverlayInputLayout;
 
     RenderItem* mWavesRitem = nullptr;
 
 	// List of all the render items.
 	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
 
+	// UpdateObjectCBs gathers the dirty items' constants here to transpose their
+	// matrices in one batch; one entry per render item.
+	std::vector<ObjectConstants> mDirtyObjects;
+	std::vector<UINT> mDirtyObjectIndices;
+
 	// Render items divided by PSO.
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
@@ -143,6 +701,16 @@ private:
 
     PassConstants mMainPassCB;
 
+	SceneLights mLights;
+	ShaderPermutations::Key mLightBuckets;
+
+	// Clustered lighting, used when mLightBuckets has FeatureClustered.  The
+	// light list is static and uploaded to each frame resource once; the
+	// clusters are rebinned every frame for the current view.
+	LightClusters mLightClusters;
+	std::vector<Light> mClusterLights;
+	int mClusterLightsDirty = gNumFrameResources;
+
 	//XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
 	//XMFLOAT4X4 mView = MathHelper::Identity4x4();
 	//XMFLOAT4X4 mProj = MathHelper::Identity4x4();
@@ -153,9 +721,164 @@ private:
 
 	Camera mCamera;
 
+	// Walls stop the camera and it slides along them; C turns that off to fly
+	// through them.
+	CollisionGrid mWallCollision;
+	bool mCameraCollision = true;
+
+	// R starts recording the camera into mRecordedPath and R again writes it to
+	// camera_path.bin; -camerapath plays such a file back from mCameraPath.
+	CameraPath mCameraPath;
+	CameraPath mRecordedPath;
+	bool mRecordingPath = false;
+	double mRecordStart = 0.0;
+
+	// Trees are expanded by the vertex shader from a structured buffer; G switches
+	// back to the geometry shader path for comparison.
+	bool mTreeGeometryShader = false;
+
+	// Depth-only pass over the opaque and alpha-tested layers, then a colour pass
+	// with an EQUAL depth test so each pixel is shaded once with early-Z.  Z toggles it.
+	bool mDepthPrePass = true;
+
+	// CPU time of each FrameStage in the current frame, in milliseconds, and the
+	// heap allocations it made (debug builds).  Past the first few frames every
+	// stage should allocate nothing; -headless -zeroalloc fails otherwise.
+	double mStageMs[StageCount] = {};
+	UINT64 mStageAllocations[StageCount] = {};
+
+	// Commands recorded by the last Draw.
+	RenderStats mFrameStats;
+
+	// Set by RunBenchmark, and by RunHeadless with a camera path loaded: the camera
+	// follows mCameraPath, or gBenchmarkPath without one, instead of the keys.
+	bool mBenchmark = false;
+
+	// GPU time per render layer, read back a few frames late.  T writes the
+	// rolling statistics to gpu_timings.txt.
+	GpuTimestampLog mGpuTimestamps;
+	UINT64 mTimestampFrequency = 0;
+
+	// Performance HUD, off until toggled with H.  While it is shown, and in
+	// -headless runs, which write the final snapshot next to their report, Update
+	// snapshots the previous frame, whose stages have all run, and lays it out into
+	// mOverlay; RecordFrame draws it last.
+	OverlayBatch mOverlay;
+	PerformanceHud mHud;
+	HudSnapshot mHudSnapshot;
+	UINT64 mHudUploadBytes = 0; // all frame resources' upload bytes at the last snapshot
+	double mHudMemorySampleSeconds = -1.0; // real time of the last memory sample
+	bool mShowHud = false;
+	ComPtr<ID3D12Resource> mOverlayFont;
+	ComPtr<ID3D12Resource> mOverlayFontUpload;
+
     POINT mLastMousePos;
 };
 
+// Offline build step: fills the shader cache without creating a window or device.
+// Run from the project directory, e.g. as a post-build event.
+int CompileShaderCache()
+{
+	ShaderCache cache(gShaderCacheDir);
+	ShaderPermutations permutations(cache);
+
+	const ShaderPermutations::Key lightBuckets = SelectLightBuckets(CreateSceneLights());
+	for(const ShaderDesc& desc : gShaderDescs)
+		permutations.GetOrCompile(desc.Filename, desc.EntryPoint, desc.Target, PermutationFor(desc, lightBuckets));
+
+	return 0;
+}
+
+// Headless check of the CPU light binning: bins random lights and the castle
+// torches for a few views, compares Bin against the brute force BinReference and
+// writes the timings to light_clusters_bench.txt.  Returns 1 on a mismatch.
+int BenchmarkLightClusters()
+{
+	LightClusters clusters(gClusterTilesX, gClusterTilesY, gClusterSlicesZ, gMaxClusterLightIndices);
+	LightClusters reference(gClusterTilesX, gClusterTilesY, gClusterSlicesZ, gMaxClusterLightIndices);
+	clusters.SetProjection(0.25f*MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+	reference.SetProjection(0.25f*MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+
+	const XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	const XMMATRIX views[] =
+	{
+		XMMatrixLookAtLH(XMVectorSet(0.0f, 5.0f, -70.0f, 1.0f), XMVectorSet(0.0f, 5.0f, 0.0f, 1.0f), up),
+		XMMatrixLookAtLH(XMVectorSet(-20.0f, 6.0f, 0.0f, 1.0f), XMVectorSet(20.0f, 4.0f, 10.0f, 1.0f), up),
+		XMMatrixLookAtLH(XMVectorSet(0.0f, 80.0f, -40.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), up),
+	};
+
+	std::mt19937 rng(58);
+	std::uniform_real_distribution<float> coord(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> height(0.0f, 20.0f);
+	std::uniform_real_distribution<float> radius(2.0f, 12.0f);
+
+	auto randomLights = [&](UINT count)
+	{
+		std::vector<Light> lights(count);
+		for(Light& light : lights)
+		{
+			light.Position = XMFLOAT3(coord(rng), height(rng), coord(rng));
+			light.FalloffEnd = radius(rng);
+		}
+		return lights;
+	};
+
+	std::vector<std::pair<std::string, std::vector<Light>>> scenes;
+	scenes.push_back({ "torches", ClusteredLightList(CreateSceneLights()) });
+	scenes.push_back({ "random64", randomLights(64) });
+	scenes.push_back({ "random256", randomLights(256) });
+	scenes.push_back({ "random1024", randomLights(1024) });
+
+	__int64 frequency = 0;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&frequency);
+	auto milliseconds = [frequency](__int64 start, __int64 end)
+	{
+		return 1000.0*(end - start) / frequency;
+	};
+
+	const int iterations = 200;
+	UINT mismatches = 0;
+
+	std::ofstream report(L"light_clusters_bench.txt");
+	report << "scene lights view indices bin_ms reference_ms match\n";
+
+	for(const auto& scene : scenes)
+	{
+		const Light* lights = scene.second.data();
+		const UINT lightCount = (UINT)scene.second.size();
+
+		for(UINT v = 0; v < _countof(views); ++v)
+		{
+			__int64 start = 0, end = 0;
+
+			QueryPerformanceCounter((LARGE_INTEGER*)&start);
+			for(int i = 0; i < iterations; ++i)
+				clusters.Bin(lights, lightCount, views[v]);
+			QueryPerformanceCounter((LARGE_INTEGER*)&end);
+			const double binMs = milliseconds(start, end) / iterations;
+
+			QueryPerformanceCounter((LARGE_INTEGER*)&start);
+			reference.BinReference(lights, lightCount, views[v]);
+			QueryPerformanceCounter((LARGE_INTEGER*)&end);
+			const double referenceMs = milliseconds(start, end);
+
+			bool match = clusters.LightIndices() == reference.LightIndices();
+			for(UINT c = 0; match && c < clusters.ClusterCount(); ++c)
+			{
+				match = clusters.Ranges()[c].Offset == reference.Ranges()[c].Offset &&
+					clusters.Ranges()[c].Count == reference.Ranges()[c].Count;
+			}
+			if(!match)
+				++mismatches;
+
+			report << scene.first << ' ' << lightCount << ' ' << v << ' ' << clusters.LightIndices().size() << ' '
+				<< binMs << ' ' << referenceMs << ' ' << (match ? "yes" : "NO") << '\n';
+		}
+	}
+
+	return mismatches == 0 ? 0 : 1;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     PSTR cmdLine, int showCmd)
 {
@@ -164,13 +887,106 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+    // Counts heap allocations per frame stage (debug CRT only).
+    AllocationCounter::Install();
+
     try
     {
+        if(strstr(cmdLine, "-compileshaders") != nullptr)
+            return CompileShaderCache();
+
+        if(strstr(cmdLine, "-benchclusters") != nullptr)
+            return BenchmarkLightClusters();
+
+        if(strstr(cmdLine, "-selftest") != nullptr)
+            return RunTreeSelfTests();
+
+        if(strstr(cmdLine, "-microbench") != nullptr)
+            return RunMicroBenchmarks();
+
+        // -headless N: N frames without showing the window or presenting, reported
+        // to headless_report.json.  The device and scene are still created, so D3D12
+        // must be available; -warp uses the software adapter, so no GPU is needed.
+        // -zeroalloc exits with 2 if a frame allocated after the warm up, and with 3 in
+        // builds that cannot count allocations (only debug builds can).
+        int headlessFrames = 0;
+        if(const char* headless = strstr(cmdLine, "-headless"))
+            headlessFrames = std::max<int>(1, atoi(headless + strlen("-headless")));
+
         TreeBillboardsApp theApp(hInstance);
+        theApp.SetHeadless(headlessFrames > 0);
+        if(strstr(cmdLine, "-warp") != nullptr)
+            theApp.SetDriverType(D3D_DRIVER_TYPE_WARP);
+
+        // -fixeddelta advances the scene by 1/60 s a frame however long it takes,
+        // so two runs see the same frames; -timescale X speeds it up or slows it down.
+        if(strstr(cmdLine, "-fixeddelta") != nullptr)
+            theApp.Timer().SetFixedDelta(1.0 / 60.0);
+        if(const char* timeScale = strstr(cmdLine, "-timescale"))
+            theApp.Timer().SetTimeScale(atof(timeScale + strlen("-timescale")));
+
+        // -fps N caps the frame rate, -vsync presents on the vertical blank and
+        // -lowlatency queues one frame and starts it as late as the cap allows.
+        if(const char* fps = strstr(cmdLine, "-fps"))
+            theApp.Pacer().SetTargetFps(atof(fps + strlen("-fps")));
+        if(strstr(cmdLine, "-vsync") != nullptr)
+            theApp.Pacer().SetSyncInterval(1);
+        theApp.SetLowLatency(strstr(cmdLine, "-lowlatency") != nullptr);
+
+        // -forwardz renders with the standard [near, far] to [0, 1] depth instead of
+        // reverse-Z, for comparing the two.
+        if(strstr(cmdLine, "-forwardz") != nullptr)
+            theApp.SetReverseZ(false);
+
+        // -camerapath file plays a path recorded with R (camera_path.bin) in place of
+        // the built in flythrough for -benchmark, and moves the -headless camera.
+        if(const char* cameraPath = strstr(cmdLine, "-camerapath"))
+        {
+            std::string filename(cameraPath + strlen("-camerapath"));
+            filename.erase(0, filename.find_first_not_of(' '));
+            filename = filename.substr(0, filename.find(' '));
+            if(!theApp.LoadCameraPath(std::wstring(filename.begin(), filename.end())))
+            {
+                OutputDebugStringA("WinMain: Cannot read the -camerapath file.\n");
+                return 1;
+            }
+        }
+
         if(!theApp.Initialize())
             return 0;
 
-        return theApp.Run();
+        if(strstr(cmdLine, "-startuptrace") != nullptr)
+            theApp.WriteStartupTrace(L"startup_trace.json");
+
+        Profiler::SetThreadName("Main");
+
+        // -benchmark N: N frames along the scripted flythrough, reported to
+        // benchmark_report.json; 1800 (30 s of path) when N is left out.
+        int benchmarkFrames = 0;
+        if(const char* benchmark = strstr(cmdLine, "-benchmark"))
+        {
+            benchmarkFrames = atoi(benchmark + strlen("-benchmark"));
+            if(benchmarkFrames <= 0)
+                benchmarkFrames = 1800;
+        }
+
+        int result = 0;
+        if(headlessFrames > 0)
+            result = theApp.RunHeadless(headlessFrames, L"headless_report.json", strstr(cmdLine, "-zeroalloc") != nullptr);
+        else if(benchmarkFrames > 0)
+            result = theApp.RunBenchmark(benchmarkFrames, L"benchmark_report.json");
+        else
+            result = theApp.Run();
+
+        // P writes the same trace while running.
+        if(strstr(cmdLine, "-profiletrace") != nullptr)
+            Profiler::WriteChromeTrace(L"profile_trace.json");
+
+        // F writes the frame time histogram while running.
+        if(strstr(cmdLine, "-frametimes") != nullptr)
+            theApp.FrameTimes().Write(L"frame_times.json");
+
+        return result;
     }
     catch(DxException& e)
     {
@@ -180,21 +996,35 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 }
 
 TreeBillboardsApp::TreeBillboardsApp(HINSTANCE hInstance)
-    : D3DApp(hInstance)
+    : D3DApp(hInstance), mShaderCache(gShaderCacheDir), mShaderPermutations(mShaderCache),
+	mLightClusters(gClusterTilesX, gClusterTilesY, gClusterSlicesZ, gMaxClusterLightIndices),
+	mGpuTimestamps(gNumFrameResources, gMaxGpuMarkers, gGpuStatsWindow), mOverlay(gMaxOverlayQuads)
 {
+	SetReverseZ(true);
 }
 
 TreeBillboardsApp::~TreeBillboardsApp()
 {
+	WaitForPipelineJobs();
+
     if(md3dDevice != nullptr)
         FlushCommandQueue();
 }
 
+void TreeBillboardsApp::SetReverseZ(bool value)
+{
+	mCamera.SetDepthMode(value ? Camera::DepthMode::ReverseZInfinite : Camera::DepthMode::Standard);
+	mDepthStencilFormat = value ? DXGI_FORMAT_D32_FLOAT : DXGI_FORMAT_D24_UNORM_S8_UINT;
+	mDepthClearValue = value ? 0.0f : 1.0f;
+}
+
 bool TreeBillboardsApp::Initialize()
 {
     if(!D3DApp::Initialize())
         return false;
 
+	StartupTimeline::Scope initScope(mStartupTimeline, "Initialize");
+
     // Reset the command list to prep for initialization commands.
     ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
@@ -202,20 +1032,47 @@ bool TreeBillboardsApp::Initialize()
 	// so we have to query this information.
     mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
+	ThrowIfFailed(mCommandQueue->GetTimestampFrequency(&mTimestampFrequency));
+
     mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
- 
-	LoadTextures();
-    BuildRootSignature();
-	BuildDescriptorHeaps();
+
+	// Compiled pipeline blobs live next to the shader bytecode.
+	mPipelineCache = std::make_unique<PipelineStateCache>(md3dDevice.Get(), mdxgiFactory.Get(), gShaderCacheDir);
+
+	mShaderWatcher = std::make_unique<ShaderWatcher>(L"Shaders", L"*.hlsl");
+
+	// Kick off the shader jobs first so they compile while the main thread loads
+	// textures and builds geometry.
     BuildShadersAndInputLayouts();
-    BuildLandGeometry();
-    BuildWavesGeometry();
-	BuildBoxGeometry();
-	BuildTreeSpritesGeometry();
-	BuildShapeGeometry();
+
+	{
+		StartupTimeline::Scope scope(mStartupTimeline, "LoadTextures");
+		LoadTextures();
+		BuildOverlayFont();
+	}
+	{
+		StartupTimeline::Scope scope(mStartupTimeline, "AnalyzeTextureAlpha");
+		AnalyzeTextureAlpha();
+	}
+	BuildRootSignature();
+	BuildDescriptorHeaps();
+	{
+		StartupTimeline::Scope scope(mStartupTimeline, "BuildGeometry");
+		BuildLandGeometry();
+		BuildWavesGeometry();
+		BuildBoxGeometry();
+		BuildTreeSpritesGeometry();
+		BuildShapeGeometry();
+	}
 	BuildMaterials();
     BuildRenderItems();
+
+	const std::vector<BoundingBox> wallBounds = CastleWallBounds();
+	mWallCollision.Build(wallBounds.data(), (UINT)wallBounds.size());
+	MoveOpaqueAlphaTestedItems();
     BuildFrameResources();
+
+	// Queues the PSO jobs; they compile while the initialization commands run.
     BuildPSOs();
 
     // Execute the initialization commands.
@@ -224,24 +1081,245 @@ bool TreeBillboardsApp::Initialize()
     mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
     // Wait until initialization is complete.
-    FlushCommandQueue();
+	{
+		StartupTimeline::Scope scope(mStartupTimeline, "FlushCommandQueue");
+		FlushCommandQueue();
+	}
+	{
+		StartupTimeline::Scope scope(mStartupTimeline, "ResolvePipelines");
+		ResolvePipelines();
+	}
 
     return true;
 }
+
+bool TreeBillboardsApp::WriteStartupTrace(const std::wstring& filename)
+{
+	WaitForPipelineJobs();
+	return mStartupTimeline.Write(filename);
+}
+
+int TreeBillboardsApp::RunHeadless(int frameCount, const std::wstring& reportFile, bool requireZeroAllocations)
+{
+	// Every frame would count 0 allocations and pass.
+	if(requireZeroAllocations && !AllocationCounter::Enabled())
+	{
+		const char* message = "RunHeadless: -zeroalloc needs allocation counting, which only debug builds have.\n";
+		fputs(message, stderr);
+		OutputDebugStringA(message);
+		return 3;
+	}
+
+	NullRenderContext context;
+
+	// CPU time per frame; there is no present, so this is the whole frame.
+	FrameReport frames;
+	UINT64 streamBytes = 0;
+
+	const UINT64 uploadStart = UploadBytesWritten();
+
+	mBenchmark = mCameraPath.KeyCount() > 0;
+	mTimer.Reset();
+	for(int frame = 0; frame < frameCount; ++frame)
+	{
+		mTimer.Tick();
+
+		// Nothing is submitted, so every frame resource fence stays 0 and Update
+		// never waits.
+		Update(mTimer);
+
+		context.Reset();
+		{
+			StageClock clock(mStageMs[StageRecord], mStageAllocations[StageRecord]);
+			RecordFrame(context);
+		}
+		mFrameStats = context.Stats();
+
+		double frameMs = 0.0;
+		for(int i = 0; i < StageCount; ++i)
+			frameMs += mStageMs[i];
+		frames.AddFrame(mStageMs, mStageAllocations, frameMs, context.Stats(), frame >= gAllocationWarmupFrames);
+		streamBytes += context.Stream().size();
+	}
+	mBenchmark = false;
+
+	if(frameCount <= 0)
+		return 1;
+
+	std::ofstream report(reportFile);
+	if(!report)
+		return 1;
+
+	report << "{\n";
+	report << "  \"frames\": " << frameCount << ",\n";
+	report << "  \"adapter\": \"" << (md3dDriverType == D3D_DRIVER_TYPE_WARP ? "warp" : "hardware") << "\",\n";
+	report << "  \"camera_path_keys\": " << mCameraPath.KeyCount() << ",\n";
+	frames.WriteJson(report, { { "command_stream_bytes", streamBytes }, { "upload_bytes", UploadBytesWritten() - uploadStart } });
+	report << "}\n";
+
+	// The last frame's commands, for diffing against another build.
+	std::ofstream stream(reportFile + L".commands.txt");
+	context.WriteText(stream);
+
+	// What the HUD would show for the last frame.
+	std::ofstream hud(reportFile + L".hud.txt");
+	PerformanceHud::WriteText(hud, mHudSnapshot);
+
+	if(requireZeroAllocations && frames.FramesAllocating() > 0)
+		return 2;
+
+	return 0;
+}
+
+int TreeBillboardsApp::RunBenchmark(int frameCount, const std::wstring& reportFile)
+{
+	if(frameCount <= 0)
+		return 1;
+
+	// The waves, the only random part of a frame, disturb the same cells each run.
+	srand(gBenchmarkSeed);
+	mTimer.SetFixedDelta(1.0 / 60.0);
+	mTimer.SetTimeScale(1.0);
+	mBenchmark = true;
+
+	FrameReport frames;
+	mTimer.Reset();
+
+	MSG msg = {0};
+	for(int frame = 0; frame < gBenchmarkWarmupFrames + frameCount; )
+	{
+		if(PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
+		{
+			if(msg.message == WM_QUIT)
+				return (int)msg.wParam;
+
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+			continue;
+		}
+
+		// Keep going if the window loses focus, which would stop the timer.
+		mTimer.Start();
+
+		WaitForNextFrame();
+		mTimer.Tick();
+		{
+			PROFILE_SCOPE("Frame");
+			CalculateFrameStats();
+			Update(mTimer);
+			Draw(mTimer);
+		}
+		mPacer.EndFrame();
+
+		// Frame time is the wall clock time between frames, present included.
+		if(frame >= gBenchmarkWarmupFrames)
+			frames.AddFrame(mStageMs, mStageAllocations, 1000.0*mTimer.RealDeltaSeconds(), mFrameStats, true);
+		++frame;
+	}
+
+	FlushCommandQueue();
+	mBenchmark = false;
+
+	std::ofstream report(reportFile);
+	if(!report)
+		return 1;
+
+	report << "{\n";
+	report << "  \"frames\": " << frameCount << ",\n";
+	report << "  \"warmup_frames\": " << gBenchmarkWarmupFrames << ",\n";
+	report << "  \"adapter\": \"" << (md3dDriverType == D3D_DRIVER_TYPE_WARP ? "warp" : "hardware") << "\",\n";
+	report << "  \"resolution\": [" << mClientWidth << ", " << mClientHeight << "],\n";
+	report << "  \"msaa\": " << (m4xMsaaState ? 4 : 1) << ",\n";
+	report << "  \"sync_interval\": " << mPacer.SyncInterval() << ",\n";
+	report << "  \"target_fps\": " << mPacer.TargetFps() << ",\n";
+	report << "  \"camera_path_keys\": " << mCameraPath.KeyCount() << ",\n";
+
+	// The timestamp window holds the last gGpuStatsWindow frames of the run.
+	report << "  \"gpu_ms\": {\n";
+	for(uint32_t i = 0; i < mGpuTimestamps.MarkerCount(); ++i)
+	{
+		const RollingStats& stats = mGpuTimestamps.MarkerStats(i);
+		report << "    \"" << mGpuTimestamps.MarkerName(i) << "\": { \"avg_ms\": " << stats.Average()
+			<< ", \"p99_ms\": " << stats.Percentile(0.99) << ", \"max_ms\": " << stats.Max() << " }"
+			<< (i + 1 == mGpuTimestamps.MarkerCount() ? "\n" : ",\n");
+	}
+	report << "  },\n";
+
+	WriteMemoryJson(report);
+	frames.WriteJson(report, {});
+	report << "}\n";
+
+	return 0;
+}
+
+bool TreeBillboardsApp::LoadCameraPath(const std::wstring& filename)
+{
+	return mCameraPath.Load(filename) && mCameraPath.KeyCount() > 0;
+}
+
+void TreeBillboardsApp::WriteMemoryJson(std::ostream& report)
+{
+	const double mb = 1.0 / (1024.0*1024.0);
+
+	PROCESS_MEMORY_COUNTERS process = {};
+	process.cb = sizeof(process);
+	GetProcessMemoryInfo(GetCurrentProcess(), &process, sizeof(process));
+
+	DXGI_QUERY_VIDEO_MEMORY_INFO local = {};
+	DXGI_QUERY_VIDEO_MEMORY_INFO nonLocal = {};
+	ComPtr<IDXGIAdapter3> adapter;
+	if(SUCCEEDED(mdxgiFactory->EnumAdapterByLuid(md3dDevice->GetAdapterLuid(), IID_PPV_ARGS(&adapter))))
+	{
+		adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &local);
+		adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &nonLocal);
+	}
+
+	report << "  \"memory_mb\": {\n";
+	report << "    \"working_set\": " << process.WorkingSetSize*mb << ",\n";
+	report << "    \"peak_working_set\": " << process.PeakWorkingSetSize*mb << ",\n";
+	report << "    \"private_bytes\": " << process.PagefileUsage*mb << ",\n";
+	report << "    \"gpu_local\": " << local.CurrentUsage*mb << ",\n";
+	report << "    \"gpu_local_budget\": " << local.Budget*mb << ",\n";
+	report << "    \"gpu_non_local\": " << nonLocal.CurrentUsage*mb << "\n";
+	report << "  },\n";
+	report << "  \"tracked_memory\": " << MemoryTracker::ToJson() << ",\n";
+}
  
 void TreeBillboardsApp::OnResize()
 {
     D3DApp::OnResize();
 
     // The window resized, so update the aspect ratio and recompute the projection matrix.
-    //XMMATRIX P = XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
-    //XMStoreFloat4x4(&mProj, P);
+	mCamera.SetLens(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
+
+	mLightClusters.SetProjection(mCamera.GetFovY(), mCamera.GetAspect(), mCamera.GetNearZ(), mCamera.GetFarZ());
 }
 
 void TreeBillboardsApp::Update(const GameTimer& gt)
 {
-    OnKeyboardInput(gt);
-	//UpdateCamera(gt);
+	PROFILE_SCOPE("Update");
+
+	if(mShowHud || mHeadless)
+	{
+		CaptureHudSnapshot(mHudSnapshot);
+		mHud.AddFrame(mHudSnapshot);
+	}
+
+	std::fill(std::begin(mStageMs), std::end(mStageMs), 0.0);
+	std::fill(std::begin(mStageAllocations), std::end(mStageAllocations), 0);
+
+	{
+		StageClock clock(mStageMs[StageHotReload], mStageAllocations[StageHotReload]);
+		UpdateShaderHotReload();
+	}
+	{
+		StageClock clock(mStageMs[StageInput], mStageAllocations[StageInput]);
+		if(mBenchmark)
+			UpdateBenchmarkCamera(gt);
+		else
+			OnKeyboardInput(gt);
+		//UpdateCamera(gt);
+	}
 
     // Cycle through the circular frame resource array.
     mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
@@ -251,86 +1329,246 @@ void TreeBillboardsApp::Update(const GameTimer& gt)
     // If not, wait until the GPU has completed commands up to this fence point.
     if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
     {
-        HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
+		StageClock clock(mStageMs[StageWaitForGpu], mStageAllocations[StageWaitForGpu]);
+		PROFILE_SCOPE("WaitForFrameResource");
+        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, mFenceEvent));
+        WaitForSingleObject(mFenceEvent, INFINITE);
     }
 
-	AnimateMaterials(gt);
-	UpdateObjectCBs(gt);
-	UpdateMaterialCBs(gt);
-	UpdateMainPassCB(gt);
-    UpdateWaves(gt);
+	// The frame that last used this frame resource has finished, so its
+	// timestamps are resolved.  Frames that were never submitted (-headless)
+	// leave Fence at 0 and are skipped.
+	if(mCurrFrameResource->Fence != 0 && mGpuTimestamps.Pending(mCurrFrameResourceIndex))
+		ReadGpuTimestamps();
+
+	{
+		StageClock clock(mStageMs[StageAnimateMaterials], mStageAllocations[StageAnimateMaterials]);
+		AnimateMaterials(gt);
+	}
+	{
+		StageClock clock(mStageMs[StageObjects], mStageAllocations[StageObjects]);
+		UpdateObjectCBs(gt);
+	}
+	{
+		StageClock clock(mStageMs[StageMaterials], mStageAllocations[StageMaterials]);
+		UpdateMaterialCBs(gt);
+	}
+	{
+		StageClock clock(mStageMs[StageLightClusters], mStageAllocations[StageLightClusters]);
+		UpdateLightClusters(gt);
+	}
+	{
+		StageClock clock(mStageMs[StagePass], mStageAllocations[StagePass]);
+		UpdateMainPassCB(gt);
+	}
+	{
+		StageClock clock(mStageMs[StageWaves], mStageAllocations[StageWaves]);
+		UpdateWaves(gt);
+	}
+	{
+		StageClock clock(mStageMs[StageHud], mStageAllocations[StageHud]);
+		UpdateHud();
+	}
 }
 
 void TreeBillboardsApp::Draw(const GameTimer& gt)
 {
-    auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
+	PROFILE_SCOPE("Draw");
 
-    // Reuse the memory associated with command recording.
-    // We can only reset when the associated command lists have finished execution on the GPU.
-    ThrowIfFailed(cmdListAlloc->Reset());
+	{
+		StageClock clock(mStageMs[StageSubmit], mStageAllocations[StageSubmit]);
+
+		auto& cmdListAlloc = mCurrFrameResource->CmdListAlloc;
+
+		// Reuse the memory associated with command recording.
+		// We can only reset when the associated command lists have finished execution on the GPU.
+		ThrowIfFailed(cmdListAlloc->Reset());
+
+		// A command list can be reset after it has been added to the command queue via ExecuteCommandList.
+		// Reusing the command list reuses memory.
+		ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), GetPSO(Pipeline::Opaque)));
+	}
+
+	D3D12RenderContext context(mCommandList.Get());
+	{
+		StageClock clock(mStageMs[StageRecord], mStageAllocations[StageRecord]);
+		RecordFrame(context);
+	}
+	mFrameStats = context.Stats();
+
+	StageClock clock(mStageMs[StageSubmit], mStageAllocations[StageSubmit]);
+
+    // Done recording commands.
+    ThrowIfFailed(mCommandList->Close());
+
+    // Add the command list to the queue for execution.
+    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
+    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+    // Swap the back and front buffers
+	{
+		PROFILE_SCOPE("Present");
+		ThrowIfFailed(mSwapChain->Present(mPacer.SyncInterval(), 0));
+	}
+	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
-    // A command list can be reset after it has been added to the command queue via ExecuteCommandList.
-    // Reusing the command list reuses memory.
-    ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
+    // Advance the fence value to mark commands up to this fence point.
+    mCurrFrameResource->Fence = ++mCurrentFence;
+
+    // Add an instruction to the command queue to set a new fence point. 
+    // Because we are on the GPU timeline, the new fence point won't be 
+    // set until the GPU finishes processing all the commands prior to this Signal().
+    mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+}
+
+void TreeBillboardsApp::RecordFrame(RenderContext& context)
+{
+	PROFILE_SCOPE("RecordFrame");
+
+	mGpuTimestamps.BeginFrame(mCurrFrameResourceIndex);
+	BeginGpuMarker(context, "Frame");
 
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
+    context.SetViewport(mScreenViewport);
+    context.SetScissorRect(mScissorRect);
 
     // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	context.Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	const D3D12_CPU_DESCRIPTOR_HANDLE backBufferView = CurrentBackBufferView();
+	const D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView = DepthStencilView();
 
     // Clear the back buffer and depth buffer.
-    mCommandList->ClearRenderTargetView(CurrentBackBufferView(), (float*)&mMainPassCB.FogColor, 0, nullptr);
-    mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+    context.ClearRenderTarget(backBufferView, (float*)&mMainPassCB.FogColor);
+    context.ClearDepthStencil(depthStencilView, mDepthClearValue, 0);
 
     // Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+    context.SetRenderTargets(1, &backBufferView, &depthStencilView);
 
 	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
-	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+	context.SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
+	context.SetGraphicsRootSignature(mRootSignature.Get());
 
 	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
-
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+	context.SetGraphicsRootConstantBufferView(RootPass, passCB->GetGPUVirtualAddress());
+
+	// Bound once per frame; draws select their entries with root constants.
+	context.SetGraphicsRootShaderResourceView(RootObjects,
+		mCurrFrameResource->ObjectBuffer->Resource()->GetGPUVirtualAddress());
+	context.SetGraphicsRootShaderResourceView(RootMaterials,
+		mCurrFrameResource->MaterialBuffer->Resource()->GetGPUVirtualAddress());
+	context.SetGraphicsRootShaderResourceView(RootClusterLights,
+		mCurrFrameResource->ClusterLights->Resource()->GetGPUVirtualAddress());
+	context.SetGraphicsRootShaderResourceView(RootClusterRanges,
+		mCurrFrameResource->ClusterRanges->Resource()->GetGPUVirtualAddress());
+	context.SetGraphicsRootShaderResourceView(RootClusterLightIndices,
+		mCurrFrameResource->ClusterLightIndices->Resource()->GetGPUVirtualAddress());
+
+	if(mDepthPrePass)
+	{
+		// Depth only, with no render target bound.  Only the alpha-tested items
+		// run a pixel shader, and it just clips.
+		context.SetRenderTargets(0, nullptr, &depthStencilView);
+
+		BeginGpuMarker(context, "DepthPrePass");
+		context.SetPipelineState(GetPSO(Pipeline::OpaqueDepth));
+		DrawRenderItems(context, mRitemLayer[(int)RenderLayer::Opaque]);
+
+		context.SetPipelineState(GetPSO(Pipeline::AlphaTestedDepth));
+		DrawRenderItems(context, mRitemLayer[(int)RenderLayer::AlphaTested]);
+		EndGpuMarker(context);
+
+		// Colour with depth EQUAL and no depth writes.  Clipped texels already
+		// failed in the pre-pass, so the alpha-tested items use the opaque PS
+		// and keep early depth rejection.
+		context.SetRenderTargets(1, &backBufferView, &depthStencilView);
+
+		BeginGpuMarker(context, "Opaque");
+		context.SetPipelineState(GetPSO(Pipeline::OpaqueEqual));
+		DrawRenderItems(context, mRitemLayer[(int)RenderLayer::Opaque]);
+		EndGpuMarker(context);
+
+		BeginGpuMarker(context, "AlphaTested");
+		context.SetPipelineState(GetPSO(Pipeline::AlphaTestedEqual));
+		DrawRenderItems(context, mRitemLayer[(int)RenderLayer::AlphaTested]);
+		EndGpuMarker(context);
+	}
+	else
+	{
+		BeginGpuMarker(context, "Opaque");
+		context.SetPipelineState(GetPSO(Pipeline::Opaque));
+		DrawRenderItems(context, mRitemLayer[(int)RenderLayer::Opaque]);
+		EndGpuMarker(context);
+
+		BeginGpuMarker(context, "AlphaTested");
+		context.SetPipelineState(GetPSO(Pipeline::AlphaTested));
+		DrawRenderItems(context, mRitemLayer[(int)RenderLayer::AlphaTested]);
+		EndGpuMarker(context);
+	}
 
-	mCommandList->SetPipelineState(mPSOs["alphaTested"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTested]);
+	BeginGpuMarker(context, "AlphaTestedTreeSprites");
+	if(mTreeGeometryShader)
+	{
+		context.SetPipelineState(GetPSO(Pipeline::TreeSprites));
+		DrawRenderItems(context, mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites]);
+	}
+	else
+	{
+		context.SetPipelineState(GetPSO(Pipeline::TreeSpritesPulled));
+		DrawTreeSpritesPulled(context, mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites]);
+	}
+	EndGpuMarker(context);
 
-	mCommandList->SetPipelineState(mPSOs["treeSprites"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites]);
+	BeginGpuMarker(context, "Transparent");
+	context.SetPipelineState(GetPSO(Pipeline::Transparent));
+	DrawRenderItems(context, mRitemLayer[(int)RenderLayer::Transparent]);
+	EndGpuMarker(context);
 
-	mCommandList->SetPipelineState(mPSOs["transparent"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Transparent]);
+	if(mOverlay.VertexCount() > 0)
+	{
+		BeginGpuMarker(context, "Overlay");
+		DrawOverlay(context);
+		EndGpuMarker(context);
+	}
 
     // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+	context.Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
 
-    // Done recording commands.
-    ThrowIfFailed(mCommandList->Close());
+	EndGpuMarker(context);
 
-    // Add the command list to the queue for execution.
-    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	const UINT queryCount = mGpuTimestamps.EndFrame();
+	if(queryCount > 0)
+	{
+		context.ResolveTimestamps(mCurrFrameResource->TimestampQueries.Get(), 0, queryCount,
+			mCurrFrameResource->TimestampReadback.Get(), 0);
+	}
+}
 
-    // Swap the back and front buffers
-    ThrowIfFailed(mSwapChain->Present(0, 0));
-	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+void TreeBillboardsApp::BeginGpuMarker(RenderContext& context, const char* name)
+{
+	const UINT query = mGpuTimestamps.Begin(name);
+	if(query != GpuTimestampLog::NoQuery)
+		context.WriteTimestamp(mCurrFrameResource->TimestampQueries.Get(), query);
+}
 
-    // Advance the fence value to mark commands up to this fence point.
-    mCurrFrameResource->Fence = ++mCurrentFence;
+void TreeBillboardsApp::EndGpuMarker(RenderContext& context)
+{
+	const UINT query = mGpuTimestamps.End();
+	if(query != GpuTimestampLog::NoQuery)
+		context.WriteTimestamp(mCurrFrameResource->TimestampQueries.Get(), query);
+}
 
-    // Add an instruction to the command queue to set a new fence point. 
-    // Because we are on the GPU timeline, the new fence point won't be 
-    // set until the GPU finishes processing all the commands prior to this Signal().
-    mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+void TreeBillboardsApp::ReadGpuTimestamps()
+{
+	const SIZE_T byteSize = mGpuTimestamps.MaxQueries()*sizeof(UINT64);
+	const D3D12_RANGE readRange = { 0, byteSize };
+	const D3D12_RANGE writeRange = { 0, 0 };
+
+	UINT64* ticks = nullptr;
+	ID3D12Resource* readback = mCurrFrameResource->TimestampReadback.Get();
+	ThrowIfFailed(readback->Map(0, &readRange, reinterpret_cast<void**>(&ticks)));
+	mGpuTimestamps.Retire(mCurrFrameResourceIndex, ticks, mTimestampFrequency);
+	readback->Unmap(0, &writeRange);
 }
 
 void TreeBillboardsApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -379,10 +1617,55 @@ void TreeBillboardsApp::OnMouseMove(WPARAM btnState, int x, int y)
     mLastMousePos.x = x;
     mLastMousePos.y = y;
 }
+
+void TreeBillboardsApp::OnKeyUp(WPARAM key)
+{
+	if(key == 'G')
+		mTreeGeometryShader = !mTreeGeometryShader;
+	else if(key == 'Z')
+		mDepthPrePass = !mDepthPrePass;
+	else if(key == 'P')
+		Profiler::WriteChromeTrace(L"profile_trace.json");
+	else if(key == 'F')
+		FrameTimes().Write(L"frame_times.json");
+	else if(key == 'M')
+		MemoryTracker::WriteReport(L"memory_report.txt");
+	else if(key == 'V')
+		mPacer.SetSyncInterval(mPacer.SyncInterval() == 0 ? 1 : 0);
+	else if(key == 'L')
+		SetLowLatency(!mPacer.LowLatency());
+	else if(key == 'H')
+	{
+		// Start the upload count and the memory sample afresh.
+		mShowHud = !mShowHud;
+		mHudUploadBytes = UploadBytesWritten();
+		mHudMemorySampleSeconds = -1.0;
+	}
+	else if(key == 'C')
+		mCameraCollision = !mCameraCollision;
+	else if(key == 'R')
+	{
+		mRecordingPath = !mRecordingPath;
+		if(mRecordingPath)
+		{
+			mRecordedPath.Clear();
+			mRecordedPath.Reserve(gRecordedPathKeys);
+			mRecordStart = mTimer.TotalSeconds();
+		}
+		else
+			mRecordedPath.Save(L"camera_path.bin");
+	}
+	else if(key == 'T')
+	{
+		std::ofstream fout(L"gpu_timings.txt");
+		fout << mGpuTimestamps.Report();
+	}
+}
  
 void TreeBillboardsApp::OnKeyboardInput(const GameTimer& gt)
 {
 	const float dt = gt.DeltaTime();
+	const XMFLOAT3 start = mCamera.GetPosition3f();
 
 	//GetAsyncKeyState returns a short (2 bytes)
 	if (GetAsyncKeyState('W') & 0x8000) //most significant bit (MSB) is 1 when key is pressed (1000 000 000 000)
@@ -397,6 +1680,30 @@ void TreeBillboardsApp::OnKeyboardInput(const GameTimer& gt)
 	if (GetAsyncKeyState('D') & 0x8000)
 		mCamera.Strafe(20.0f*dt);
 
+	if(mCameraCollision)
+	{
+		const XMFLOAT3 end = mCamera.GetPosition3f();
+		const XMFLOAT3 delta(end.x - start.x, end.y - start.y, end.z - start.z);
+		mCamera.SetPosition(mWallCollision.Move(start, delta, gCameraRadius));
+	}
+
+	mCamera.UpdateViewMatrix();
+
+	if(mRecordingPath)
+		mRecordedPath.AddKey((float)(gt.TotalSeconds() - mRecordStart), mCamera);
+}
+
+void TreeBillboardsApp::UpdateBenchmarkCamera(const GameTimer& gt)
+{
+	if(mCameraPath.KeyCount() > 0)
+	{
+		const double duration = mCameraPath.Duration();
+		const double t = duration > 0.0 ? fmod(gt.TotalSeconds(), duration) : 0.0;
+		mCameraPath.Apply(mCameraPath.StartTime() + (float)t, mCamera);
+	}
+	else
+		PlaceOnBenchmarkPath(gt.TotalSeconds(), mCamera);
+
 	mCamera.UpdateViewMatrix();
 }
  
@@ -418,8 +1725,10 @@ void TreeBillboardsApp::OnKeyboardInput(const GameTimer& gt)
 
 void TreeBillboardsApp::AnimateMaterials(const GameTimer& gt)
 {
+	PROFILE_SCOPE("AnimateMaterials");
+
 	// Scroll the water material texture coordinates.
-	auto waterMat = mMaterials["water"].get();
+	auto waterMat = mWaterMaterial;
 
 	float& tu = waterMat->MatTransform(3, 0);
 	float& tv = waterMat->MatTransform(3, 1);
@@ -442,31 +1751,40 @@ void TreeBillboardsApp::AnimateMaterials(const GameTimer& gt)
 
 void TreeBillboardsApp::UpdateObjectCBs(const GameTimer& gt)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
+	PROFILE_SCOPE("UpdateObjectCBs");
+
+	auto currObjectCB = mCurrFrameResource->ObjectBuffer.get();
+	UINT dirtyCount = 0;
 	for(auto& e : mAllRitems)
 	{
 		// Only update the cbuffer data if the constants have changed.  
 		// This needs to be tracked per frame resource.
 		if(e->NumFramesDirty > 0)
 		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
-
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
-
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+			mDirtyObjects[dirtyCount].World = e->World;
+			mDirtyObjects[dirtyCount].TexTransform = e->TexTransform;
+			mDirtyObjectIndices[dirtyCount] = e->ObjCBIndex;
+			++dirtyCount;
 
 			// Next FrameResource need to be updated too.
 			e->NumFramesDirty--;
 		}
 	}
+
+	// Both matrices of every dirty item, transposed in place as one array.
+	static_assert(sizeof(ObjectConstants) == 2*sizeof(XMFLOAT4X4), "ObjectConstants is read as two matrices.");
+	XMFLOAT4X4* matrices = reinterpret_cast<XMFLOAT4X4*>(mDirtyObjects.data());
+	MathHelper::TransposeMatrices(matrices, matrices, 2*dirtyCount);
+
+	for(UINT i = 0; i < dirtyCount; ++i)
+		currObjectCB->CopyData(mDirtyObjectIndices[i], mDirtyObjects[i]);
 }
 
 void TreeBillboardsApp::UpdateMaterialCBs(const GameTimer& gt)
 {
-	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
+	PROFILE_SCOPE("UpdateMaterialCBs");
+
+	auto currMaterialCB = mCurrFrameResource->MaterialBuffer.get();
 	for(auto& e : mMaterials)
 	{
 		// Only update the cbuffer data if the constants have changed.  If the cbuffer
@@ -492,16 +1810,16 @@ void TreeBillboardsApp::UpdateMaterialCBs(const GameTimer& gt)
 
 void TreeBillboardsApp::UpdateMainPassCB(const GameTimer& gt)
 {
-	//XMMATRIX view = XMLoadFloat4x4(&mView);
-	//XMMATRIX proj = XMLoadFloat4x4(&mProj);
+	PROFILE_SCOPE("UpdateMainPassCB");
 
+	// The camera caches these, inverses included, so a frame the camera did not
+	// move costs only the transposes.
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX proj = mCamera.GetProj();
-
-	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
+	XMMATRIX viewProj = mCamera.GetViewProj();
+	XMMATRIX invView = mCamera.GetInvView();
+	XMMATRIX invProj = mCamera.GetInvProj();
+	XMMATRIX invViewProj = mCamera.GetInvViewProj();
 
 	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
 	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
@@ -513,33 +1831,72 @@ void TreeBillboardsApp::UpdateMainPassCB(const GameTimer& gt)
 	mMainPassCB.EyePosW = mCamera.GetPosition3f();
 	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
 	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
-	mMainPassCB.NearZ = 1.0f;
-	mMainPassCB.FarZ = 1000.0f;
+	mMainPassCB.NearZ = mCamera.GetNearZ();
+	mMainPassCB.FarZ = mCamera.GetFarZ();
 	mMainPassCB.TotalTime = gt.TotalTime();
 	mMainPassCB.DeltaTime = gt.DeltaTime();
 	mMainPassCB.AmbientLight = { 0.0f, 0.0f, 0.0f, 1.0f };
-	mMainPassCB.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
-	mMainPassCB.Lights[0].Strength = { 0.0f, 1.0f, 0.0f };
-	//mMainPassCB.Lights[0].Color = { 0.0f, 1.0f, 0.0f };
-	mMainPassCB.Lights[1].Direction = { -0.57735f, -0.57735f, 0.57735f };
-	mMainPassCB.Lights[1].Strength = { 1.0f, 0.0f, 0.0f };
-	//mMainPassCB.Lights[1].Color = { 1.0f, 0.0f, 0.0f };
-	mMainPassCB.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
-	mMainPassCB.Lights[2].Strength = { 0.0f, 0.0f, 1.0f };
-	//mMainPassCB.Lights[2].Color = { 0.0f, 0.0f, 1.0f };
-	//mMainPassCB.Lights[0].Position = { 0.0f, 0.0f, 20.0f };
+
+	mMainPassCB.ClusterDims = XMUINT3(mLightClusters.TilesX(), mLightClusters.TilesY(), mLightClusters.SlicesZ());
+	mMainPassCB.ClusterTileScale = XMFLOAT2((float)mLightClusters.TilesX() / mClientWidth,
+		(float)mLightClusters.TilesY() / mClientHeight);
+	mMainPassCB.ClusterZScale = mLightClusters.SliceScale();
+	mMainPassCB.ClusterZBias = mLightClusters.SliceBias();
+
+	// Each light type starts at the bucket offset the shader variant expects;
+	// unused slots in a bucket get a light that contributes nothing.
+	Light unusedLight;
+	unusedLight.Strength = { 0.0f, 0.0f, 0.0f };
+
+	Light* lights = mMainPassCB.Lights;
+	auto packLights = [&lights, &unusedLight](const std::vector<Light>& source, UINT bucketSize)
+	{
+		for(UINT i = 0; i < bucketSize; ++i)
+			*lights++ = i < source.size() ? source[i] : unusedLight;
+	};
+	packLights(mLights.Directional, mLightBuckets.NumDirLights);
+	packLights(mLights.Point, mLightBuckets.NumPointLights);
+	packLights(mLights.Spot, mLightBuckets.NumSpotLights);
+
+	// The lights past the variant's buckets are never read, so they are not uploaded.
+	const UINT usedBytes = (UINT)(offsetof(PassConstants, Lights) + mLightBuckets.LightCount()*sizeof(Light));
 
 	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
+	currPassCB->CopyData(0, mMainPassCB, usedBytes);
+}
+
+void TreeBillboardsApp::UpdateLightClusters(const GameTimer& gt)
+{
+	PROFILE_SCOPE("UpdateLightClusters");
+
+	if((mLightBuckets.Features & ShaderPermutations::FeatureClustered) == 0)
+		return;
+
+	auto currFrame = mCurrFrameResource;
+	if(mClusterLightsDirty > 0)
+	{
+		currFrame->ClusterLights->CopyRange(0, mClusterLights.data(), (UINT)mClusterLights.size());
+		mClusterLightsDirty--;
+	}
+
+	// Lights past the index capacity are dropped from the clusters that overflow.
+	mLightClusters.Bin(mClusterLights.data(), (UINT)mClusterLights.size(), mCamera.GetView());
+
+	const std::vector<UINT>& indices = mLightClusters.LightIndices();
+	currFrame->ClusterRanges->CopyRange(0, mLightClusters.Ranges().data(), mLightClusters.ClusterCount());
+	if(!indices.empty())
+		currFrame->ClusterLightIndices->CopyRange(0, indices.data(), (UINT)indices.size());
 }
 
 void TreeBillboardsApp::UpdateWaves(const GameTimer& gt)
 {
+	PROFILE_SCOPE("UpdateWaves");
+
 	// Every quarter second, generate a random wave.
-	static float t_base = 0.0f;
-	if((mTimer.TotalTime() - t_base) >= 0.25f)
+	static double t_base = 0.0;
+	if((gt.TotalSeconds() - t_base) >= 0.25)
 	{
-		t_base += 0.25f;
+		t_base += 0.25;
 
 		int i = MathHelper::Rand(4, mWaves->RowCount() - 5);
 		int j = MathHelper::Rand(4, mWaves->ColumnCount() - 5);
@@ -573,6 +1930,85 @@ void TreeBillboardsApp::UpdateWaves(const GameTimer& gt)
 	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
 }
 
+UINT64 TreeBillboardsApp::UploadBytesWritten()const
+{
+	UINT64 bytes = 0;
+	for(const auto& frameResource : mFrameResources)
+		bytes += frameResource->UploadBytesWritten();
+	return bytes;
+}
+
+void TreeBillboardsApp::CaptureHudSnapshot(HudSnapshot& snapshot)
+{
+	// Memory is carried over between samples.
+	const UINT64 gpuMemoryBytes = snapshot.GpuMemoryBytes;
+	const UINT64 cpuMemoryBytes = snapshot.CpuMemoryBytes;
+	const UINT64 workingSetBytes = snapshot.WorkingSetBytes;
+
+	snapshot = HudSnapshot();
+	snapshot.FrameMs = 1000.0*mTimer.RealDeltaSeconds();
+
+	for(int i = 0; i < StageCount; ++i)
+	{
+		snapshot.AddCpuStage(gFrameStageNames[i], mStageMs[i]);
+		snapshot.CpuMs += mStageMs[i];
+	}
+	snapshot.WavesMs = mStageMs[StageWaves];
+
+	// Averages over the timestamp window; the whole-frame marker is the total.
+	for(uint32_t i = 0; i < mGpuTimestamps.MarkerCount(); ++i)
+	{
+		const double ms = mGpuTimestamps.MarkerStats(i).Average();
+		if(mGpuTimestamps.MarkerName(i) == "Frame")
+			snapshot.GpuMs = ms;
+		else
+			snapshot.AddGpuLayer(mGpuTimestamps.MarkerName(i).c_str(), ms);
+	}
+
+	snapshot.Commands = mFrameStats;
+
+	const UINT64 uploadBytes = UploadBytesWritten();
+	snapshot.UploadBytes = uploadBytes - mHudUploadBytes;
+	mHudUploadBytes = uploadBytes;
+
+	// The timer restarts for -headless, so a sample from the future is stale too.
+	const double now = mTimer.RealTotalSeconds();
+	if(now >= mHudMemorySampleSeconds && now - mHudMemorySampleSeconds < gHudMemorySampleSeconds)
+	{
+		snapshot.GpuMemoryBytes = gpuMemoryBytes;
+		snapshot.CpuMemoryBytes = cpuMemoryBytes;
+		snapshot.WorkingSetBytes = workingSetBytes;
+		return;
+	}
+	mHudMemorySampleSeconds = now;
+
+	for(int i = 0; i < (int)MemoryCategory::Count; ++i)
+	{
+		const MemoryCategory category = (MemoryCategory)i;
+		if(category == MemoryCategory::CpuBlob || category == MemoryCategory::CpuHeap)
+			snapshot.CpuMemoryBytes += MemoryTracker::CurrentBytes(category);
+		else
+			snapshot.GpuMemoryBytes += MemoryTracker::CurrentBytes(category);
+	}
+
+	PROCESS_MEMORY_COUNTERS process = {};
+	process.cb = sizeof(process);
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &process, sizeof(process)))
+		snapshot.WorkingSetBytes = process.WorkingSetSize;
+}
+
+void TreeBillboardsApp::UpdateHud()
+{
+	PROFILE_SCOPE("UpdateHud");
+
+	mOverlay.Clear();
+	if(mShowHud)
+		mHud.Build(mHudSnapshot, mOverlay, 8.0f, 8.0f);
+
+	if(mOverlay.VertexCount() > 0)
+		mCurrFrameResource->OverlayVB->CopyRange(0, mOverlay.Vertices(), mOverlay.VertexCount());
+}
+
 void TreeBillboardsApp::LoadTextures()
 {
 	auto grassTex = std::make_unique<Texture>();
@@ -671,40 +2107,92 @@ void TreeBillboardsApp::LoadTextures()
 	mTextures[redTileTex->Name] = std::move(redTileTex);
 	mTextures[glassTex->Name] = std::move(glassTex);
 	mTextures[sandTex->Name] = std::move(sandTex);
+
+	for(const auto& e : mTextures)
+	{
+		d3dUtil::TrackResource(md3dDevice.Get(), e.second->Resource.Get(), MemoryCategory::Texture, e.first);
+		d3dUtil::TrackResource(md3dDevice.Get(), e.second->UploadHeap.Get(), MemoryCategory::Upload, e.first + ".upload");
+	}
 }
 
-void TreeBillboardsApp::BuildRootSignature()
+void TreeBillboardsApp::BuildOverlayFont()
 {
-	CD3DX12_DESCRIPTOR_RANGE texTable;
-	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+	// Rendered with GDI at startup, so the HUD needs no font file.
+	const FontAtlas atlas = OverlayBatch::CreateFontAtlas(L"Consolas", 14);
+	mOverlay.SetFont(atlas);
+
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8_UNORM, atlas.Width, atlas.Height, 1, 1),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(mOverlayFont.GetAddressOf())));
+
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(mOverlayFont.Get(), 0, 1)),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(mOverlayFontUpload.GetAddressOf())));
+
+	D3D12_SUBRESOURCE_DATA texels = {};
+	texels.pData = atlas.Pixels.data();
+	texels.RowPitch = atlas.Width;
+	texels.SlicePitch = atlas.Width*atlas.Height;
+	UpdateSubresources<1>(mCommandList.Get(), mOverlayFont.Get(), mOverlayFontUpload.Get(), 0, 0, 1, &texels);
+
+	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mOverlayFont.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+	d3dUtil::TrackResource(md3dDevice.Get(), mOverlayFont.Get(), MemoryCategory::Texture, "overlayFont");
+	d3dUtil::TrackResource(md3dDevice.Get(), mOverlayFontUpload.Get(), MemoryCategory::Upload, "overlayFont.upload");
+}
 
-    // Root parameter can be a table, root descriptor or root constants.
-    CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+void TreeBillboardsApp::AnalyzeTextureAlpha()
+{
+	// Reads each file again; the loader does not expose the texel data.
+	for(const auto& e : mTextures)
+	{
+		ComPtr<ID3DBlob> file = d3dUtil::LoadBinary(e.second->Filename);
+		mTextureAlpha[e.first] = AnalyzeDDSAlpha(file->GetBufferPointer(), file->GetBufferSize());
+	}
+}
 
-	// Perfomance TIP: Order from most frequent to least frequent.
-	slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
-    slotRootParameter[1].InitAsConstantBufferView(0);
-    slotRootParameter[2].InitAsConstantBufferView(1);
-    slotRootParameter[3].InitAsConstantBufferView(2);
+void TreeBillboardsApp::MoveOpaqueAlphaTestedItems()
+{
+	// An item whose texture alpha times material alpha never drops below the
+	// threshold is never clipped, so it can go through the opaque PSOs and keep
+	// early depth rejection.  The opaque PSOs cull back faces, which is fine
+	// for the closed shapes in this layer.
+	auto neverClips = [this](const RenderItem* ri)
+	{
+		const std::string& texture = mSrvHeapTextures.at(ri->Mat->DiffuseSrvHeapIndex);
+		const DDSAlphaInfo& alpha = mTextureAlpha.at(texture);
 
-	auto staticSamplers = GetStaticSamplers();
+		return alpha.Valid && alpha.MinAlpha*ri->Mat->DiffuseAlbedo.w >= gAlphaTestThreshold;
+	};
 
-    // A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter,
-		(UINT)staticSamplers.size(), staticSamplers.data(),
-		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	std::vector<RenderItem*>& alphaTested = mRitemLayer[(int)RenderLayer::AlphaTested];
+	std::vector<RenderItem*>& opaque = mRitemLayer[(int)RenderLayer::Opaque];
 
-    // create a root signature with a single slot which points to a descriptor range consisting of a single constant buffer
-    ComPtr<ID3DBlob> serializedRootSig = nullptr;
-    ComPtr<ID3DBlob> errorBlob = nullptr;
-    HRESULT hr = D3D12SerializeRootSignature(&rootSigDesc, D3D_ROOT_SIGNATURE_VERSION_1,
-        serializedRootSig.GetAddressOf(), errorBlob.GetAddressOf());
+	auto firstOpaque = std::stable_partition(alphaTested.begin(), alphaTested.end(),
+		[&neverClips](const RenderItem* ri) { return !neverClips(ri); });
+	opaque.insert(opaque.end(), firstOpaque, alphaTested.end());
+	alphaTested.erase(firstOpaque, alphaTested.end());
+}
 
-    if(errorBlob != nullptr)
-    {
-        ::OutputDebugStringA((char*)errorBlob->GetBufferPointer());
-    }
-    ThrowIfFailed(hr);
+void TreeBillboardsApp::BuildRootSignature()
+{
+	// The shaders only sample with the anisotropic wrap sampler (s4).
+	RootSignatureBuilder builder;
+	BuildRootLayout(builder, GetStaticSamplers()[4]);
+
+	// Version 1.1 when the runtime supports it; 1.0 otherwise, without the flags.
+	ComPtr<ID3DBlob> serializedRootSig = builder.Serialize(RootSignatureBuilder::HighestVersion(md3dDevice.Get()));
+
+	mRootSignatureHash = d3dUtil::HashBytes(serializedRootSig->GetBufferPointer(), serializedRootSig->GetBufferSize());
 
     ThrowIfFailed(md3dDevice->CreateRootSignature(
 		0,
@@ -719,7 +2207,7 @@ void TreeBillboardsApp::BuildDescriptorHeaps()
 	// Create the SRV heap.
 	//
 	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 12;
+	srvHeapDesc.NumDescriptors = 13;
 	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
@@ -825,31 +2313,43 @@ void TreeBillboardsApp::BuildDescriptorHeaps()
 	srvDesc.Texture2DArray.ArraySize = treeArrayTex->GetDesc().DepthOrArraySize;
 	md3dDevice->CreateShaderResourceView(treeArrayTex.Get(), &srvDesc, hDescriptor);
 
+	// HUD font atlas.
+	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+
+	srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = mOverlayFont->GetDesc().Format;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = 1;
+	md3dDevice->CreateShaderResourceView(mOverlayFont.Get(), &srvDesc, hDescriptor);
 
+	// Texture behind each slot above, in order.
+	mSrvHeapTextures = { "grassTex", "waterTex", "fenceTex", "brickTex", "ballTex", "darkBrickTex",
+		"darkLightBrickTex", "lightBrickTex", "redTileTex", "glassTex", "sandTex", "treeArrayTex" };
 }
 
 void TreeBillboardsApp::BuildShadersAndInputLayouts()
 {
-	const D3D_SHADER_MACRO defines[] =
-	{
-		"FOG", "1",
-		NULL, NULL
-	};
-
-	const D3D_SHADER_MACRO alphaTestDefines[] =
+	// The lit stages are compiled for the smallest light buckets that hold the
+	// main pass lights.
+	mLights = CreateSceneLights();
+	mLightBuckets = SelectLightBuckets(mLights);
+	mClusterLights = ClusteredLightList(mLights);
+
+	// One job per permutation.  Each loads precompiled bytecode when the cache is
+	// warm and only compiles on a miss.
+	for(const ShaderDesc& desc : gShaderDescs)
 	{
-		"FOG", "1",
-		"ALPHA_TEST", "1",
-		NULL, NULL
-	};
+		ComPtr<ID3DBlob>* slot = &mShaders[desc.Name];
+		mShaderDependencies.SetShaderSources(desc.Name, ShaderCache::GatherSourceFiles(desc.Filename));
 
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_0");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", defines, "PS", "ps_5_0");
-	mShaders["alphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_0");
-	
-	mShaders["treeSpriteVS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "VS", "vs_5_0");
-	mShaders["treeSpriteGS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "GS", "gs_5_0");
-	mShaders["treeSpritePS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", alphaTestDefines, "PS", "ps_5_0");
+		const ShaderPermutations::Key key = PermutationFor(desc, mLightBuckets);
+		mShaderTasks[desc.Name] = concurrency::create_task([this, desc, key, slot]()
+		{
+			StartupTimeline::Scope scope(mStartupTimeline, std::string("Shader ") + desc.Name);
+			*slot = mShaderPermutations.GetOrCompile(desc.Filename, desc.EntryPoint, desc.Target, key);
+		});
+	}
 
     mStdInputLayout =
     {
@@ -863,6 +2363,26 @@ void TreeBillboardsApp::BuildShadersAndInputLayouts()
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 		{ "SIZE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 	};
+
+	mOverlayInputLayout =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+}
+
+void TreeBillboardsApp::TrackGeometry(const MeshGeometry& geo)
+{
+	// The waves draw from a per-frame upload buffer, so have no vertex buffer here.
+	if(geo.VertexBufferGPU != nullptr)
+	{
+		d3dUtil::TrackResource(md3dDevice.Get(), geo.VertexBufferGPU.Get(), MemoryCategory::Geometry, geo.Name + ".vertices");
+		d3dUtil::TrackResource(md3dDevice.Get(), geo.VertexBufferUploader.Get(), MemoryCategory::Upload, geo.Name + ".vertices.upload");
+	}
+
+	d3dUtil::TrackResource(md3dDevice.Get(), geo.IndexBufferGPU.Get(), MemoryCategory::Geometry, geo.Name + ".indices");
+	d3dUtil::TrackResource(md3dDevice.Get(), geo.IndexBufferUploader.Get(), MemoryCategory::Upload, geo.Name + ".indices.upload");
 }
 
 void TreeBillboardsApp::BuildLandGeometry()
@@ -894,10 +2414,10 @@ void TreeBillboardsApp::BuildLandGeometry()
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "landGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	geo->VertexBufferCPU = d3dUtil::CreateBlob(vbByteSize, MemoryCategory::CpuBlob, geo->Name + ".vertices");
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	geo->IndexBufferCPU = d3dUtil::CreateBlob(ibByteSize, MemoryCategory::CpuBlob, geo->Name + ".indices");
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
@@ -918,6 +2438,7 @@ void TreeBillboardsApp::BuildLandGeometry()
 
 	geo->DrawArgs["grid"] = submesh;
 
+	TrackGeometry(*geo);
 	mGeometries["landGeo"] = std::move(geo);
 }
 
@@ -956,7 +2477,7 @@ void TreeBillboardsApp::BuildWavesGeometry()
 	geo->VertexBufferCPU = nullptr;
 	geo->VertexBufferGPU = nullptr;
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	geo->IndexBufferCPU = d3dUtil::CreateBlob(ibByteSize, MemoryCategory::CpuBlob, geo->Name + ".indices");
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
 	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
@@ -974,6 +2495,7 @@ void TreeBillboardsApp::BuildWavesGeometry()
 
 	geo->DrawArgs["grid"] = submesh;
 
+	TrackGeometry(*geo);
 	mGeometries["waterGeo"] = std::move(geo);
 }
 
@@ -999,10 +2521,10 @@ void TreeBillboardsApp::BuildBoxGeometry()
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "boxGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	geo->VertexBufferCPU = d3dUtil::CreateBlob(vbByteSize, MemoryCategory::CpuBlob, geo->Name + ".vertices");
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	geo->IndexBufferCPU = d3dUtil::CreateBlob(ibByteSize, MemoryCategory::CpuBlob, geo->Name + ".indices");
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
@@ -1023,19 +2545,14 @@ void TreeBillboardsApp::BuildBoxGeometry()
 
 	geo->DrawArgs["box"] = submesh;
 
+	TrackGeometry(*geo);
 	mGeometries["boxGeo"] = std::move(geo);
 }
 
 void TreeBillboardsApp::BuildTreeSpritesGeometry()
 {
-	struct TreeSpriteVertex
-	{
-		XMFLOAT3 Pos;
-		XMFLOAT2 Size;
-	};
-
 	//static const int treeCount = 16;
-	std::array<TreeSpriteVertex, 16> vertices;
+	std::array<TreeSpriteVertex, 6> vertices;
 	//for(UINT i = 0; i < treeCount; ++i)
 	//{
 	//	float x = MathHelper::RandF(-50.0f, -25.0f);
@@ -1062,10 +2579,11 @@ void TreeBillboardsApp::BuildTreeSpritesGeometry()
 	vertices[5].Pos = XMFLOAT3(60, 8.5, 0);
 	vertices[5].Size = XMFLOAT2(20.0f, 20.0f);
 
-	std::array<std::uint16_t, 16> indices =
+	// The vertex-pulling path reads the same buffer as a StructuredBuffer and
+	// draws one instance per tree, so only initialized trees may be listed.
+	std::array<std::uint16_t, 6> indices =
 	{
-		0, 1, 2, 3, 4, 5, 6, 7,
-		8, 9, 10, 11, 12, 13, 14, 15
+		0, 1, 2, 3, 4, 5
 	};
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(TreeSpriteVertex);
@@ -1074,10 +2592,10 @@ void TreeBillboardsApp::BuildTreeSpritesGeometry()
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "treeSpritesGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	geo->VertexBufferCPU = d3dUtil::CreateBlob(vbByteSize, MemoryCategory::CpuBlob, geo->Name + ".vertices");
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	geo->IndexBufferCPU = d3dUtil::CreateBlob(ibByteSize, MemoryCategory::CpuBlob, geo->Name + ".indices");
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
@@ -1098,6 +2616,7 @@ void TreeBillboardsApp::BuildTreeSpritesGeometry()
 
 	geo->DrawArgs["points"] = submesh;
 
+	TrackGeometry(*geo);
 	mGeometries["treeSpritesGeo"] = std::move(geo);
 }
 
@@ -1530,13 +3049,13 @@ void TreeBillboardsApp::BuildShapeGeometry()
 
 
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	geo->VertexBufferCPU = d3dUtil::CreateBlob(vbByteSize, MemoryCategory::CpuBlob, geo->Name + ".vertices");
 
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
 
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	geo->IndexBufferCPU = d3dUtil::CreateBlob(ibByteSize, MemoryCategory::CpuBlob, geo->Name + ".indices");
 
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
@@ -1590,6 +3109,7 @@ void TreeBillboardsApp::BuildShapeGeometry()
 
 
 
+	TrackGeometry(*geo);
 	mGeometries[geo->Name] = std::move(geo);
 
 }
@@ -1600,24 +3120,17 @@ void TreeBillboardsApp::BuildPSOs()
     D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc;
 
 	//
-	// PSO for opaque objects.
+	// PSO for opaque objects.  The shader bytecode is filled in by the PSO job
+	// once the shader jobs it depends on have finished.
 	//
     ZeroMemory(&opaquePsoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
 	opaquePsoDesc.InputLayout = { mStdInputLayout.data(), (UINT)mStdInputLayout.size() };
 	opaquePsoDesc.pRootSignature = mRootSignature.Get();
-	opaquePsoDesc.VS = 
-	{ 
-		reinterpret_cast<BYTE*>(mShaders["standardVS"]->GetBufferPointer()), 
-		mShaders["standardVS"]->GetBufferSize()
-	};
-	opaquePsoDesc.PS = 
-	{ 
-		reinterpret_cast<BYTE*>(mShaders["opaquePS"]->GetBufferPointer()),
-		mShaders["opaquePS"]->GetBufferSize()
-	};
 	opaquePsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	opaquePsoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
 	opaquePsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+	if(mCamera.GetDepthMode() == Camera::DepthMode::ReverseZInfinite)
+		opaquePsoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER;
 	opaquePsoDesc.SampleMask = UINT_MAX;
 	opaquePsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
 	opaquePsoDesc.NumRenderTargets = 1;
@@ -1625,7 +3138,7 @@ void TreeBillboardsApp::BuildPSOs()
 	opaquePsoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
 	opaquePsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
 	opaquePsoDesc.DSVFormat = mDepthStencilFormat;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["opaque"])));
+	CreatePSOAsync(Pipeline::Opaque, opaquePsoDesc, "standardVS", nullptr, "opaquePS");
 
 	//
 	// PSO for transparent objects
@@ -1646,45 +3159,244 @@ void TreeBillboardsApp::BuildPSOs()
 	transparencyBlendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
 
 	transparentPsoDesc.BlendState.RenderTarget[0] = transparencyBlendDesc;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&transparentPsoDesc, IID_PPV_ARGS(&mPSOs["transparent"])));
+	CreatePSOAsync(Pipeline::Transparent, transparentPsoDesc, "standardVS", nullptr, "opaquePS");
 
 	//
 	// PSO for alpha tested objects
 	//
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC alphaTestedPsoDesc = opaquePsoDesc;
-	alphaTestedPsoDesc.PS = 
-	{ 
-		reinterpret_cast<BYTE*>(mShaders["alphaTestedPS"]->GetBufferPointer()),
-		mShaders["alphaTestedPS"]->GetBufferSize()
-	};
 	alphaTestedPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&alphaTestedPsoDesc, IID_PPV_ARGS(&mPSOs["alphaTested"])));
+	CreatePSOAsync(Pipeline::AlphaTested, alphaTestedPsoDesc, "standardVS", nullptr, "alphaTestedPS");
+
+	//
+	// PSOs for the depth pre-pass.  They use the same vertex shader as the colour
+	// pass so both produce bit-identical depth for the EQUAL test.
+	//
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC opaqueDepthPsoDesc = opaquePsoDesc;
+	opaqueDepthPsoDesc.NumRenderTargets = 0;
+	opaqueDepthPsoDesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
+	CreatePSOAsync(Pipeline::OpaqueDepth, opaqueDepthPsoDesc, "standardVS", nullptr, nullptr);
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC alphaTestedDepthPsoDesc = opaqueDepthPsoDesc;
+	alphaTestedDepthPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	CreatePSOAsync(Pipeline::AlphaTestedDepth, alphaTestedDepthPsoDesc, "standardVS", nullptr, "alphaClipPS");
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC opaqueEqualPsoDesc = opaquePsoDesc;
+	opaqueEqualPsoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL;
+	opaqueEqualPsoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	CreatePSOAsync(Pipeline::OpaqueEqual, opaqueEqualPsoDesc, "standardVS", nullptr, "opaquePS");
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC alphaTestedEqualPsoDesc = opaqueEqualPsoDesc;
+	alphaTestedEqualPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	CreatePSOAsync(Pipeline::AlphaTestedEqual, alphaTestedEqualPsoDesc, "standardVS", nullptr, "opaquePS");
 
 	//
 	// PSO for tree sprites
 	//
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC treeSpritePsoDesc = opaquePsoDesc;
-	treeSpritePsoDesc.VS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["treeSpriteVS"]->GetBufferPointer()),
-		mShaders["treeSpriteVS"]->GetBufferSize()
-	};
-	treeSpritePsoDesc.GS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["treeSpriteGS"]->GetBufferPointer()),
-		mShaders["treeSpriteGS"]->GetBufferSize()
-	};
-	treeSpritePsoDesc.PS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["treeSpritePS"]->GetBufferPointer()),
-		mShaders["treeSpritePS"]->GetBufferSize()
-	};
 	treeSpritePsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
 	treeSpritePsoDesc.InputLayout = { mTreeSpriteInputLayout.data(), (UINT)mTreeSpriteInputLayout.size() };
 	treeSpritePsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	CreatePSOAsync(Pipeline::TreeSprites, treeSpritePsoDesc, "treeSpriteVS", "treeSpriteGS", "treeSpritePS");
+
+	//
+	// PSO for tree sprites expanded in the vertex shader.  The tree data is
+	// pulled from a root SRV, so there is no input layout.
+	//
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC treeSpritePulledPsoDesc = opaquePsoDesc;
+	treeSpritePulledPsoDesc.InputLayout = { nullptr, 0 };
+	treeSpritePulledPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	CreatePSOAsync(Pipeline::TreeSpritesPulled, treeSpritePulledPsoDesc, "treeSpritePulledVS", nullptr, "treeSpritePulledPS");
+
+	//
+	// PSO for the HUD: alpha blended over the frame, with no depth test.
+	//
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC overlayPsoDesc = transparentPsoDesc;
+	overlayPsoDesc.InputLayout = { mOverlayInputLayout.data(), (UINT)mOverlayInputLayout.size() };
+	overlayPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	overlayPsoDesc.DepthStencilState.DepthEnable = false;
+	overlayPsoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	CreatePSOAsync(Pipeline::Overlay, overlayPsoDesc, "overlayVS", nullptr, "overlayPS");
+}
+
+void TreeBillboardsApp::CreatePSOAsync(Pipeline pipeline, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+	const char* vs, const char* gs, const char* ps)
+{
+	const std::string name = gPipelineNames[(int)pipeline];
+
+	// Resolve the slots on the main thread; the job itself never touches the maps.
+	const ComPtr<ID3DBlob>* vsSlot = vs != nullptr ? &mShaders.at(vs) : nullptr;
+	const ComPtr<ID3DBlob>* gsSlot = gs != nullptr ? &mShaders.at(gs) : nullptr;
+	const ComPtr<ID3DBlob>* psSlot = ps != nullptr ? &mShaders.at(ps) : nullptr;
+	ComPtr<ID3D12PipelineState>* psoSlot = &mPSOs[name];
+
+	// Remembered so a shader reload can rebuild this PSO.
+	mPipelineSources[name] = { desc, vs != nullptr ? vs : "", gs != nullptr ? gs : "", ps != nullptr ? ps : "" };
+
+	std::vector<std::string> stages;
+	for(const char* shader : { vs, gs, ps })
+	{
+		if(shader != nullptr)
+			stages.push_back(shader);
+	}
+	mShaderDependencies.SetPipelineShaders(name, stages);
+
+	std::vector<concurrency::task<void>> shaderJobs;
+	for(const char* shader : { vs, gs, ps })
+	{
+		if(shader != nullptr)
+			shaderJobs.push_back(mShaderTasks.at(shader));
+	}
+
+	mPSOTasks[name] = concurrency::when_all(shaderJobs.begin(), shaderJobs.end()).then(
+		[this, name, desc, vsSlot, gsSlot, psSlot, psoSlot]()
+	{
+		StartupTimeline::Scope scope(mStartupTimeline, "PSO " + name);
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = desc;
+		psoDesc.VS = ShaderBytecode(vsSlot != nullptr ? vsSlot->Get() : nullptr);
+		psoDesc.GS = ShaderBytecode(gsSlot != nullptr ? gsSlot->Get() : nullptr);
+		psoDesc.PS = ShaderBytecode(psSlot != nullptr ? psSlot->Get() : nullptr);
+		*psoSlot = mPipelineCache->GetOrCreate(psoDesc, mRootSignatureHash);
+	});
+}
+
+void TreeBillboardsApp::ResolvePipelines()
+{
+	// wait() rethrows anything a PSO job (or a shader job it depends on) threw.
+	for(auto& job : mPSOTasks)
+		job.second.wait();
+	mPSOTasks.clear();
+
+	for(int i = 0; i < (int)Pipeline::Count; ++i)
+		mPipelines[i] = mPSOs.at(gPipelineNames[i]).Get();
+}
+
+ID3D12PipelineState* TreeBillboardsApp::GetPSO(Pipeline pipeline)const
+{
+	return mPipelines[(int)pipeline];
+}
+
+void TreeBillboardsApp::WaitForPipelineJobs()
+{
+	// The jobs reference this object, so they must finish before it is destroyed.
+	// Errors are irrelevant at this point.
+	for(auto& job : mShaderTasks)
+	{
+		try { job.second.wait(); } catch(...) {}
+	}
+
+	for(auto& job : mPSOTasks)
+	{
+		try { job.second.wait(); } catch(...) {}
+	}
+
+	if(mShaderReloadPending)
+	{
+		try { mShaderReloadJob.wait(); } catch(...) {}
+	}
+}
+
+void TreeBillboardsApp::UpdateShaderHotReload()
+{
+	PROFILE_SCOPE("UpdateShaderHotReload");
+
+	// Release PSOs replaced by earlier reloads once the GPU is done with them.
+	const UINT64 completedFence = mFence->GetCompletedValue();
+	mRetiredPSOs.erase(std::remove_if(mRetiredPSOs.begin(), mRetiredPSOs.end(),
+		[completedFence](const std::pair<UINT64, ComPtr<ID3D12PipelineState>>& retired)
+	{
+		return retired.first <= completedFence;
+	}), mRetiredPSOs.end());
+
+	if(mShaderReloadPending)
+	{
+		if(!mShaderReloadJob.is_done())
+			return;
+
+		mShaderReloadPending = false;
+		ShaderReload reload = mShaderReloadJob.get();
+
+		for(auto& shader : reload.Shaders)
+			mShaders[shader.first] = shader.second;
+
+		for(auto& sources : reload.Sources)
+			mShaderDependencies.SetShaderSources(sources.first, sources.second);
+
+		// No frame is being recorded here, but frames already submitted may still
+		// reference the old PSO, so it is retired instead of released.
+		for(auto& pso : reload.PSOs)
+		{
+			mRetiredPSOs.push_back({ mCurrentFence, mPSOs[pso.first] });
+			mPSOs[pso.first] = pso.second;
+		}
+		ResolvePipelines();
+	}
+
+	std::vector<std::wstring> changedFiles;
+	if(mShaderWatcher == nullptr || !mShaderWatcher->Poll(changedFiles))
+		return;
+
+	std::vector<std::string> shaders = mShaderDependencies.ShadersAffectedBy(changedFiles);
+	if(shaders.empty())
+		return;
+
+	std::vector<std::string> pipelines = mShaderDependencies.PipelinesUsing(shaders);
+
+	mShaderReloadPending = true;
+	mShaderReloadJob = concurrency::create_task([this, shaders, pipelines]()
+	{
+		return ReloadShaders(shaders, pipelines);
+	});
+}
+
+TreeBillboardsApp::ShaderReload TreeBillboardsApp::ReloadShaders(
+	const std::vector<std::string>& shaders, const std::vector<std::string>& pipelines)
+{
+	// Runs on a worker.  mShaders and mPipelineSources are only written by the
+	// main thread while no reload job is pending.
+	ShaderReload reload;
+	try
+	{
+		for(const std::string& name : shaders)
+		{
+			const ShaderDesc& desc = FindShaderDesc(name);
+			mShaderPermutations.Evict(desc.Filename);
+			reload.Shaders[name] = mShaderPermutations.GetOrCompile(desc.Filename, desc.EntryPoint,
+				desc.Target, PermutationFor(desc, mLightBuckets));
+			reload.Sources[name] = ShaderCache::GatherSourceFiles(desc.Filename);
+		}
+
+		auto stage = [this, &reload](const std::string& name) -> ID3DBlob*
+		{
+			if(name.empty())
+				return nullptr;
+
+			auto recompiled = reload.Shaders.find(name);
+			return recompiled != reload.Shaders.end() ? recompiled->second.Get() : mShaders.at(name).Get();
+		};
+
+		for(const std::string& name : pipelines)
+		{
+			const PipelineSource& source = mPipelineSources.at(name);
+
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = source.Desc;
+			psoDesc.VS = ShaderBytecode(stage(source.VS));
+			psoDesc.GS = ShaderBytecode(stage(source.GS));
+			psoDesc.PS = ShaderBytecode(stage(source.PS));
+			reload.PSOs[name] = mPipelineCache->GetOrCreate(psoDesc, mRootSignatureHash);
+		}
+	}
+	catch(DxException& e)
+	{
+		// Typically a syntax error.  Keep drawing with the previous shaders; the
+		// next save triggers another attempt.
+		::OutputDebugStringW((L"Shader reload failed: " + e.ToString() + L"\n").c_str());
+		return ShaderReload();
+	}
 
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&treeSpritePsoDesc, IID_PPV_ARGS(&mPSOs["treeSprites"])));
+	return reload;
 }
 
 void TreeBillboardsApp::BuildFrameResources()
@@ -1692,8 +3404,13 @@ void TreeBillboardsApp::BuildFrameResources()
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaves->VertexCount()));
+            1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaves->VertexCount(),
+            gMaxClusterLights, mLightClusters.ClusterCount(), mLightClusters.MaxLightIndices(),
+            mGpuTimestamps.MaxQueries(), gMaxOverlayQuads*6));
     }
+
+	mDirtyObjects.resize(mAllRitems.size());
+	mDirtyObjectIndices.resize(mAllRitems.size());
 }
 
 void TreeBillboardsApp::BuildMaterials()
@@ -1797,6 +3514,7 @@ void TreeBillboardsApp::BuildMaterials()
 	sand->Roughness = 0.125f;
 
 	mMaterials["grass"] = std::move(grass);
+	mWaterMaterial = water.get();
 	mMaterials["water"] = std::move(water);
 	mMaterials["wirefence"] = std::move(wirefence);
 	mMaterials["treeSprites"] = std::move(treeSprites);
@@ -3030,123 +4748,91 @@ void TreeBillboardsApp::BuildRenderItems()
 
 	mAllRitems.push_back(std::move(sphere3Ritem));
 
-	//verticals
-	
-	BuildBox(45, XMMatrixTranslation(-39.667f, 5.0f, 45.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(46, XMMatrixTranslation(-39.667f, 5.0f, 22.667f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(47, XMMatrixTranslation(-39.667f, 5.0f, 0.0f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(48, XMMatrixTranslation(-39.667f, 5.0f, -22.667f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-
-	BuildBox(49, XMMatrixTranslation(-28.334f, 5.0f, 45.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(50, XMMatrixTranslation(-28.334f, 5.0f, 34.0f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(51, XMMatrixTranslation(-28.334f, 5.0f, 11.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(52, XMMatrixTranslation(-28.334f, 5.0f, -45.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-
-	BuildBox(53, XMMatrixTranslation(-17, 5.0f, 45.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(54, XMMatrixTranslation(-17, 5.0f, -22.667f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(55, XMMatrixTranslation(-17, 5.0f, -34), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-
-	BuildBox(56, XMMatrixTranslation(-5.66f, 5.0f, 34), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(57, XMMatrixTranslation(-5.66f, 5.0f, -22.667f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(58, XMMatrixTranslation(-5.66f, 5.0f, -45.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-
-	BuildBox(59, XMMatrixTranslation(5.66f, 5.0f, 34), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(60, XMMatrixTranslation(5.66f, 5.0f, -34), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-
-	BuildBox(61, XMMatrixTranslation(17, 5.0f, 45.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(62, XMMatrixTranslation(17, 5.0f, 22.667f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(63, XMMatrixTranslation(17, 5.0f, -22.667f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(64, XMMatrixTranslation(17, 5.0f, -34), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(65, XMMatrixTranslation(17, 5.0f, -45.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-
-	BuildBox(66, XMMatrixTranslation(28.334f, 5.0f, 45.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(67, XMMatrixTranslation(28.334f, 5.0f, 22.667f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(68, XMMatrixTranslation(28.334f, 5.0f, 11.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(69, XMMatrixTranslation(28.334f, 5.0f, 0), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(70, XMMatrixTranslation(28.334f, 5.0f, -22.667f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(71, XMMatrixTranslation(28.334f, 5.0f, -45.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-
-	BuildBox(72, XMMatrixTranslation(39.667f, 5.0f, 45.334f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(73, XMMatrixTranslation(39.667f, 5.0f, 22.667f), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(74, XMMatrixTranslation(39.667f, 5.0f, 0), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-	BuildBox(75, XMMatrixTranslation(39.667f, 5.0f, -34), XMMatrixScaling(0.5f, 6.0f, 11.334f));
-
-
-	//horizontals
-	BuildBox(76, XMMatrixTranslation(-45.334f, 5.0f, 5.66f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(77, XMMatrixTranslation(-45.334f, 5.0f, -5.66f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-
-	BuildBox(78, XMMatrixTranslation(-34, 5.0f, 17), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(79, XMMatrixTranslation(-34, 5.0f, 5.66f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(80, XMMatrixTranslation(-34, 5.0f, -17), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(81, XMMatrixTranslation(-34, 5.0f, -28.33f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(82, XMMatrixTranslation(-34, 5.0f, -39.66f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-
-	BuildBox(83, XMMatrixTranslation(-22.667f, 5.0f, 39.66f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(84, XMMatrixTranslation(-22.667f, 5.0f, 17), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-
-	BuildBox(85, XMMatrixTranslation(-11.334f, 5.0f, 28.334f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
+	// Maze and perimeter walls.
+	for(UINT i = 0; i < gCastleWallCount; ++i)
+	{
+		const CastleWall& wall = gCastleWalls[i];
+		BuildBox(gFirstWallObjectIndex + i, XMMatrixTranslation(wall.Center.x, wall.Center.y, wall.Center.z),
+			XMMatrixScaling(wall.Size.x, wall.Size.y, wall.Size.z));
+	}
 
-	BuildBox(86, XMMatrixTranslation(0, 5.0f, 39.667f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(87, XMMatrixTranslation(0, 5.0f, -28.334f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
 
-	BuildBox(88, XMMatrixTranslation(11.334f, 5.0f, 28.334f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
+}
 
-	BuildBox(89, XMMatrixTranslation(22.667f, 5.0f, 39.667f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(90, XMMatrixTranslation(22.667f, 5.0f, -5.667f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(91, XMMatrixTranslation(22.667f, 5.0f, -28.334f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(92, XMMatrixTranslation(22.667f, 5.0f, -39.667f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
+void TreeBillboardsApp::DrawRenderItems(RenderContext& context, const std::vector<RenderItem*>& ritems)
+{
+	PROFILE_SCOPE("DrawRenderItems");
 
-	BuildBox(93, XMMatrixTranslation(34, 5.0f, 28.334f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(94, XMMatrixTranslation(34, 5.0f, 17), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(95, XMMatrixTranslation(34, 5.0f, -17), XMMatrixScaling(11.334f, 6.0f, 0.5f));
+    // For each render item...
+    for(size_t i = 0; i < ritems.size(); ++i)
+    {
+        auto ri = ritems[i];
 
-	BuildBox(96, XMMatrixTranslation(45.334f, 5.0f, 5.66f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(97, XMMatrixTranslation(45.334f, 5.0f, -5.66f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(98, XMMatrixTranslation(45.334f, 5.0f, -28.334f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
-	BuildBox(99, XMMatrixTranslation(45.334f, 5.0f, -39.667f), XMMatrixScaling(11.334f, 6.0f, 0.5f));
+        const D3D12_VERTEX_BUFFER_VIEW vertexBufferView = ri->Geo->VertexBufferView();
+        context.SetVertexBuffers(0, 1, &vertexBufferView);
+        context.SetIndexBuffer(ri->Geo->IndexBufferView());
+        context.SetPrimitiveTopology(ri->PrimitiveType);
 
+		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
 
-	//perimeter
-	BuildBox(100, XMMatrixTranslation(-51, 5.0f, 0), XMMatrixScaling(0.5f, 6.0f, 102));
-	BuildBox(101, XMMatrixTranslation(51, 5.0f, 0), XMMatrixScaling(0.5f, 6.0f, 102));
-	BuildBox(102, XMMatrixTranslation(0, 5.0f, 51), XMMatrixScaling(102, 6.0f, 0.5f));
-	BuildBox(103, XMMatrixTranslation(-5.667f, 5.0f, -51), XMMatrixScaling(90.667f, 6.0f, 0.5f));
+		const UINT drawIndices[] = { ri->ObjCBIndex, (UINT)ri->Mat->MatCBIndex };
 
+		context.SetGraphicsRootDescriptorTable(RootDiffuseTexture, tex);
+		context.SetGraphicsRoot32BitConstants(RootDrawIndices, _countof(drawIndices), drawIndices, 0);
 
+        context.DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+    }
 }
 
-void TreeBillboardsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+void TreeBillboardsApp::DrawTreeSpritesPulled(RenderContext& context, const std::vector<RenderItem*>& ritems)
 {
-    UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-    UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+	PROFILE_SCOPE("DrawTreeSpritesPulled");
 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
-	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+	// Four strip vertices per tree, one instance per tree point.
+	context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
 
-    // For each render item...
     for(size_t i = 0; i < ritems.size(); ++i)
     {
         auto ri = ritems[i];
 
-        cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-        cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-        cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
-
 		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
 		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
 
-        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
+		const UINT drawIndices[] = { ri->ObjCBIndex, (UINT)ri->Mat->MatCBIndex };
 
-		cmdList->SetGraphicsRootDescriptorTable(0, tex);
-        cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-        cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
+		// The point vertex buffer doubles as the StructuredBuffer<TreeSprite>.
+		// Its index buffer is the identity, and SV_InstanceID does not include
+		// the start instance, so the first tree is addressed through the SRV.
+		D3D12_GPU_VIRTUAL_ADDRESS treesAddress = ri->Geo->VertexBufferGPU->GetGPUVirtualAddress() +
+			(ri->BaseVertexLocation + ri->StartIndexLocation)*sizeof(TreeSpriteVertex);
 
-        cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+		context.SetGraphicsRootDescriptorTable(RootDiffuseTexture, tex);
+		context.SetGraphicsRoot32BitConstants(RootDrawIndices, _countof(drawIndices), drawIndices, 0);
+		context.SetGraphicsRootShaderResourceView(RootTreeSprites, treesAddress);
+
+		context.DrawInstanced(4, ri->IndexCount, 0, 0);
     }
 }
 
+void TreeBillboardsApp::DrawOverlay(RenderContext& context)
+{
+	// One draw: the panel, graph bars and text share the atlas and the PSO.
+	D3D12_VERTEX_BUFFER_VIEW vbv;
+	vbv.BufferLocation = mCurrFrameResource->OverlayVB->Resource()->GetGPUVirtualAddress();
+	vbv.StrideInBytes = sizeof(OverlayVertex);
+	vbv.SizeInBytes = mOverlay.VertexCount()*sizeof(OverlayVertex);
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE font(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	font.Offset(gOverlayFontSrvIndex, mCbvSrvDescriptorSize);
+
+	context.SetPipelineState(GetPSO(Pipeline::Overlay));
+	context.SetGraphicsRootDescriptorTable(RootDiffuseTexture, font);
+	context.SetVertexBuffers(0, 1, &vbv);
+	context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context.DrawInstanced(mOverlay.VertexCount(), 1, 0, 0);
+}
+
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> TreeBillboardsApp::GetStaticSamplers()
 {
 	// Applications usually only need a handful of samplers.  So just define them all up front
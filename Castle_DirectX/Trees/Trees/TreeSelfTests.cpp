@@ -0,0 +1,313 @@
+//***************************************************************************************
+// TreeSelfTests.cpp
+//***************************************************************************************
+
+#include "TreeSelfTests.h"
+#include "../../Common/CameraPath.h"
+#include "../../Common/CollisionGrid.h"
+#include "../../Common/SelfTests.h"
+#include "Billboard.h"
+#include "CastleScene.h"
+#include "RootLayout.h"
+#include <cstring>
+#include <random>
+#include <sstream>
+
+using namespace DirectX;
+
+namespace
+{
+	// Checks the wall grid against the brute force sweep over random moves round the
+	// castle, and that no move from outside the walls ends inside one.
+	bool CheckWallCollision()
+	{
+		const std::vector<BoundingBox> bounds = CastleWallBounds();
+		CollisionGrid grid;
+		grid.Build(bounds.data(), (UINT)bounds.size());
+
+		// True when the sphere overlaps a wall by more than rounding.
+		auto overlaps = [&bounds](const XMFLOAT3& p)
+		{
+			for(const BoundingBox& box : bounds)
+			{
+				const float dx = std::max(fabsf(p.x - box.Center.x) - box.Extents.x, 0.0f);
+				const float dy = std::max(fabsf(p.y - box.Center.y) - box.Extents.y, 0.0f);
+				const float dz = std::max(fabsf(p.z - box.Center.z) - box.Extents.z, 0.0f);
+				if(dx*dx + dy*dy + dz*dz < 0.999f*gCameraRadius*gCameraRadius)
+					return true;
+			}
+			return false;
+		};
+
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+		std::uniform_real_distribution<float> height(0.0f, 12.0f);
+		std::uniform_real_distribution<float> step(-3.0f, 3.0f);
+		for(int i = 0; i < 10000; ++i)
+		{
+			const XMFLOAT3 start(position(random), height(random), position(random));
+			const XMFLOAT3 delta(step(random), 0.25f*step(random), step(random));
+
+			CollisionGrid::Hit hit;
+			CollisionGrid::Hit reference;
+			const bool hits = grid.Sweep(start, delta, gCameraRadius, hit);
+			if(hits != grid.SweepReference(start, delta, gCameraRadius, reference) ||
+				hit.Time != reference.Time || hit.Box != reference.Box)
+				return false;
+
+			if(!overlaps(start) && overlaps(grid.Move(start, delta, gCameraRadius)))
+				return false;
+		}
+
+		return true;
+	}
+
+	// Records a pose every 1/60 s along gBenchmarkPath and round trips the path through
+	// its binary form.  The copy must keep the times and positions exactly and the
+	// orientations to the 16 bit quantization, give each key back when sampled or
+	// applied at its time, and stay on the flythrough between keys.  A truncated file
+	// must not load.
+	bool CheckCameraPath()
+	{
+		const UINT keyCount = 600;
+		Camera camera;
+		CameraPath path;
+		path.Reserve(keyCount);
+		for(UINT i = 0; i < keyCount; ++i)
+		{
+			PlaceOnBenchmarkPath(i / 60.0, camera);
+			camera.UpdateViewMatrix();
+			path.AddKey(i / 60.0f, camera);
+		}
+
+		std::stringstream file(std::ios::in | std::ios::out | std::ios::binary);
+		CameraPath copy;
+		if(path.KeyCount() != keyCount || !path.Write(file) || !copy.Read(file) || copy.KeyCount() != keyCount)
+			return false;
+
+		auto sameRotation = [](const XMFLOAT4& a, const XMFLOAT4& b, float tolerance)
+		{
+			return fabsf(XMVectorGetX(XMQuaternionDot(XMLoadFloat4(&a), XMLoadFloat4(&b)))) >= 1.0f - tolerance;
+		};
+		auto samePosition = [](const XMFLOAT3& a, const XMFLOAT3& b, float tolerance)
+		{
+			return fabsf(a.x - b.x) <= tolerance && fabsf(a.y - b.y) <= tolerance && fabsf(a.z - b.z) <= tolerance;
+		};
+
+		for(UINT i = 0; i < keyCount; ++i)
+		{
+			const CameraPath::Key& key = path.GetKey(i);
+			const CameraPath::Key& loaded = copy.GetKey(i);
+			if(loaded.Time != key.Time || !samePosition(loaded.Position, key.Position, 0.0f) ||
+				!sameRotation(loaded.Orientation, key.Orientation, 1.0e-5f))
+				return false;
+
+			XMFLOAT3 position;
+			XMFLOAT4 orientation;
+			copy.Sample(key.Time, position, orientation);
+			if(!samePosition(position, key.Position, 1.0e-4f) || !sameRotation(orientation, loaded.Orientation, 1.0e-5f))
+				return false;
+
+			copy.Apply(key.Time, camera);
+			camera.UpdateViewMatrix();
+			XMFLOAT4 applied;
+			XMStoreFloat4(&applied, camera.GetOrientation());
+			if(!sameRotation(applied, key.Orientation, 1.0e-4f))
+				return false;
+
+			// Half way to the next key.
+			if(i + 1 < keyCount)
+			{
+				const double between = (i + 0.5) / 60.0;
+				copy.Sample((float)between, position, orientation);
+				PlaceOnBenchmarkPath(between, camera);
+				camera.UpdateViewMatrix();
+				XMFLOAT4 expected;
+				XMStoreFloat4(&expected, camera.GetOrientation());
+				if(!samePosition(position, camera.GetPosition3f(), 1.0e-2f) || !sameRotation(orientation, expected, 1.0e-4f))
+					return false;
+			}
+		}
+
+		const std::string bytes = file.str();
+		std::stringstream truncated(bytes.substr(0, bytes.size() - 1), std::ios::in | std::ios::binary);
+
+		// A header claiming the most keys a file may have, with none behind it.
+		std::string header = bytes.substr(0, 12);
+		const std::uint32_t maxKeys = 1u << 24;
+		memcpy(&header[8], &maxKeys, sizeof(maxKeys));
+		std::stringstream unbacked(header, std::ios::in | std::ios::binary);
+
+		// The first key's quaternion, after its time and position, zeroed.
+		std::string zeroed = bytes;
+		std::fill(zeroed.begin() + 28, zeroed.begin() + 36, '\0');
+		std::stringstream noRotation(zeroed, std::ios::in | std::ios::binary);
+
+		return !copy.Read(truncated) && !copy.Read(unbacked) && !copy.Read(noRotation) && copy.KeyCount() == keyCount;
+	}
+
+	// Checks the CPU reference of the tree billboard expansion (ExpandBillboard and
+	// the texture slice in TreeSprite.hlsl) against corners worked out by hand: a tree
+	// seen straight down -z, and one seen from above along (3, 4) in the xz-plane.
+	bool CheckBillboards()
+	{
+		struct Expected
+		{
+			XMFLOAT3 Center;
+			XMFLOAT2 Size;
+			XMFLOAT3 Eye;
+			XMFLOAT3 Normal;
+			XMFLOAT3 Corners[4];
+		};
+
+		const XMFLOAT2 texC[4] = { { 0.0f, 1.0f }, { 0.0f, 0.0f }, { 1.0f, 1.0f }, { 1.0f, 0.0f } };
+		const Expected trees[] =
+		{
+			// look = (0, 0, -1), right = up x look = (-1, 0, 0), half size 4 x 6.
+			{ { 10.0f, 5.0f, 0.0f }, { 8.0f, 12.0f }, { 10.0f, 5.0f, -20.0f }, { 0.0f, 0.0f, -1.0f },
+				{ { 6.0f, -1.0f, 0.0f }, { 6.0f, 11.0f, 0.0f }, { 14.0f, -1.0f, 0.0f }, { 14.0f, 11.0f, 0.0f } } },
+
+			// look = (0.6, 0, 0.8) whatever the eye height, right = (0.8, 0, -0.6), half size 1 x 2.
+			{ { 0.0f, 0.0f, 0.0f }, { 2.0f, 4.0f }, { 3.0f, 100.0f, 4.0f }, { 0.6f, 0.0f, 0.8f },
+				{ { 0.8f, -2.0f, -0.6f }, { 0.8f, 2.0f, -0.6f }, { -0.8f, -2.0f, 0.6f }, { -0.8f, 2.0f, 0.6f } } },
+		};
+
+		auto matches = [](float a, float b) { return fabsf(a - b) <= 1.0e-5f; };
+		for(const Expected& tree : trees)
+		{
+			for(unsigned int corner = 0; corner < 4; ++corner)
+			{
+				const BillboardVertex v = ExpandBillboardCorner(tree.Center, tree.Size, tree.Eye, corner);
+				const XMFLOAT3& p = tree.Corners[corner];
+				if(!matches(v.PosW.x, p.x) || !matches(v.PosW.y, p.y) || !matches(v.PosW.z, p.z) ||
+					!matches(v.NormalW.x, tree.Normal.x) || !matches(v.NormalW.y, tree.Normal.y) || !matches(v.NormalW.z, tree.Normal.z) ||
+					v.TexC.x != texC[corner].x || v.TexC.y != texC[corner].y)
+					return false;
+			}
+		}
+
+		// Three slices in the tree texture array, picked by tree index.
+		const unsigned int slices[][2] = { { 0, 0 }, { 1, 1 }, { 2, 2 }, { 3, 0 }, { 7, 1 }, { 299, 2 } };
+		for(const auto& slice : slices)
+		{
+			if(BillboardTextureSlice(slice[0], 3) != slice[1])
+				return false;
+		}
+
+		return true;
+	}
+
+	// Checks the app's root layout slot by slot in both versions: register, space,
+	// visibility, root constant size and the 1.1 flags, and that the 1.0 fallback keeps
+	// all of it but the flags.  Builds descriptions only, so needs no device.
+	bool CheckRootSignatureLayout()
+	{
+		struct Expected
+		{
+			D3D12_ROOT_PARAMETER_TYPE Type;
+			UINT Register;
+			UINT Space;
+			D3D12_SHADER_VISIBILITY Visibility;
+			UINT Flags; // D3D12_ROOT_DESCRIPTOR_FLAGS, or the range flags of a table
+		};
+
+		const UINT whileSet = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+		const Expected expected[RootParameterCount] =
+		{
+			{ D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE, 0, 0, D3D12_SHADER_VISIBILITY_PIXEL, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC },
+			{ D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS, 0, 0, D3D12_SHADER_VISIBILITY_ALL, 0 },
+			{ D3D12_ROOT_PARAMETER_TYPE_CBV, 1, 0, D3D12_SHADER_VISIBILITY_ALL, whileSet },
+			{ D3D12_ROOT_PARAMETER_TYPE_SRV, 0, 1, D3D12_SHADER_VISIBILITY_VERTEX, whileSet },
+			{ D3D12_ROOT_PARAMETER_TYPE_SRV, 1, 1, D3D12_SHADER_VISIBILITY_ALL, whileSet },
+			{ D3D12_ROOT_PARAMETER_TYPE_SRV, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC },
+			{ D3D12_ROOT_PARAMETER_TYPE_SRV, 2, 1, D3D12_SHADER_VISIBILITY_PIXEL, whileSet },
+			{ D3D12_ROOT_PARAMETER_TYPE_SRV, 3, 1, D3D12_SHADER_VISIBILITY_PIXEL, whileSet },
+			{ D3D12_ROOT_PARAMETER_TYPE_SRV, 4, 1, D3D12_SHADER_VISIBILITY_PIXEL, whileSet },
+		};
+
+		// What both versions share: the 1.0 structures use the same member names.
+		auto matches = [](const auto& param, const Expected& e)
+		{
+			if(param.ParameterType != e.Type || param.ShaderVisibility != e.Visibility)
+				return false;
+
+			switch(param.ParameterType)
+			{
+			case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+				return param.DescriptorTable.NumDescriptorRanges == 1 &&
+					param.DescriptorTable.pDescriptorRanges[0].RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SRV &&
+					param.DescriptorTable.pDescriptorRanges[0].NumDescriptors == 1 &&
+					param.DescriptorTable.pDescriptorRanges[0].BaseShaderRegister == e.Register &&
+					param.DescriptorTable.pDescriptorRanges[0].RegisterSpace == e.Space &&
+					param.DescriptorTable.pDescriptorRanges[0].OffsetInDescriptorsFromTableStart == D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+			case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+				// Object and material index.
+				return param.Constants.Num32BitValues == 2 &&
+					param.Constants.ShaderRegister == e.Register && param.Constants.RegisterSpace == e.Space;
+			default:
+				return param.Descriptor.ShaderRegister == e.Register && param.Descriptor.RegisterSpace == e.Space;
+			}
+		};
+
+		const D3D12_ROOT_SIGNATURE_FLAGS flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS;
+
+		RootSignatureBuilder builder;
+		BuildRootLayout(builder, CD3DX12_STATIC_SAMPLER_DESC(4, D3D12_FILTER_ANISOTROPIC));
+
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC desc_1_1 = builder.Desc_1_1();
+		const D3D12_ROOT_SIGNATURE_DESC1& v11 = desc_1_1.Desc_1_1;
+		if(desc_1_1.Version != D3D_ROOT_SIGNATURE_VERSION_1_1 || v11.NumParameters != RootParameterCount ||
+			v11.Flags != flags || v11.NumStaticSamplers != 1 ||
+			v11.pStaticSamplers[0].ShaderRegister != 4 || v11.pStaticSamplers[0].ShaderVisibility != D3D12_SHADER_VISIBILITY_PIXEL)
+			return false;
+
+		for(UINT i = 0; i < RootParameterCount; ++i)
+		{
+			const D3D12_ROOT_PARAMETER1& param = v11.pParameters[i];
+			if(!matches(param, expected[i]))
+				return false;
+
+			if(param.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+			{
+				if((UINT)param.DescriptorTable.pDescriptorRanges[0].Flags != expected[i].Flags)
+					return false;
+			}
+			else if(param.ParameterType != D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
+			{
+				if((UINT)param.Descriptor.Flags != expected[i].Flags)
+					return false;
+			}
+		}
+
+		// The fallback, built twice to check that rebuilding it starts afresh.
+		builder.Desc_1_0();
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC desc_1_0 = builder.Desc_1_0();
+		const D3D12_ROOT_SIGNATURE_DESC& v10 = desc_1_0.Desc_1_0;
+		if(desc_1_0.Version != D3D_ROOT_SIGNATURE_VERSION_1_0 || v10.NumParameters != RootParameterCount ||
+			v10.Flags != flags || v10.NumStaticSamplers != 1 || v10.pStaticSamplers[0].ShaderRegister != 4)
+			return false;
+
+		for(UINT i = 0; i < RootParameterCount; ++i)
+		{
+			if(!matches(v10.pParameters[i], expected[i]))
+				return false;
+		}
+
+		return true;
+	}
+
+	const SelfTest gTreeSelfTests[] =
+	{
+		{ "wall collision", CheckWallCollision },
+		{ "camera path", CheckCameraPath },
+		{ "billboards", CheckBillboards },
+		{ "root signature layout", CheckRootSignatureLayout },
+	};
+}
+
+int RunTreeSelfTests()
+{
+	return RunSelfTests(gTreeSelfTests, _countof(gTreeSelfTests));
+}
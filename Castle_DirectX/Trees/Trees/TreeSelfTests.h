@@ -0,0 +1,11 @@
+//***************************************************************************************
+// TreeSelfTests.h
+//
+// -selftest: the Common self-tests, then checks of this app's scene, billboards and
+// root layout.  Needs no window or device.
+//***************************************************************************************
+
+#pragma once
+
+// Returns 0 if every check passes, else 2; failures go to stderr and the debugger.
+int RunTreeSelfTests();
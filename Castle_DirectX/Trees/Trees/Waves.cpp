@@ -3,6 +3,8 @@
 //***************************************************************************************
 
 #include "Waves.h"
+#include "../../Common/Profiler.h"
+#include "../../Common/MemoryTracker.h"
 #include <ppl.h>
 #include <algorithm>
 #include <vector>
@@ -49,10 +51,13 @@ Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
             mTangentX[i*n + j] = XMFLOAT3(1.0f, 0.0f, 0.0f);
         }
     }
+
+    MemoryTracker::Add(this, MemoryCategory::CpuHeap, "Waves", 4*sizeof(XMFLOAT3)*(std::uint64_t)mVertexCount);
 }
 
 Waves::~Waves()
 {
+    MemoryTracker::Remove(this);
 }
 
 int Waves::RowCount()const
@@ -87,6 +92,8 @@ float Waves::Depth()const
 
 void Waves::Update(float dt)
 {
+	PROFILE_SCOPE("Waves::Update");
+
 	static float t = 0;
 
 	// Accumulate time.